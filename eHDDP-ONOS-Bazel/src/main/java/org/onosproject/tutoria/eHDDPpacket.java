@@ -33,6 +33,8 @@ public class eHDDPpacket extends BasePacket {
         static public final short eHDDP_ETHERNET_TYPE = (short)65450; /** 43775 **/
         /** @brief Numero máximo de elementos posibles en un paquete */
         static public final short eHDDP_MAX_ELEMENT = (short)31;
+        /** @brief Flag de un reply lleno cuyo camino sigue en un reply de continuacion */
+        static public final byte eHDDP_FLAG_MORE = (byte)0x10;
         /** @brief Tamaño maximo de un paquete (ojo que me lo devuelve en bit) */
         static private short eHDDP_PACKET_SIZE =
                 (Byte.SIZE + Byte.SIZE + Byte.SIZE + Long.SIZE + Byte.SIZE + 6*Byte.SIZE + Long.SIZE +
@@ -48,6 +50,7 @@ public class eHDDPpacket extends BasePacket {
         private BitSet Flags = new BitSet(), Version = new BitSet();
         private byte configuration[];
         private byte Opcode, Num_hops, Previous_MAC_Length;
+        private boolean More_frames;
         private long id_mac_devices[], Num_Sec, Num_Ack;
 
     /** Metodos de la clase */
@@ -232,7 +235,7 @@ public class eHDDPpacket extends BasePacket {
      * @return BitSet [] Device_type_len
      */
     public int getDevice_type_len(int pos) {
-        return ((configuration[pos] & 0b11000000) << 6) +1;
+        return ((configuration[pos] & 0b11000000) >> 6) +1;
     }
 
     /**
@@ -241,7 +244,7 @@ public class eHDDPpacket extends BasePacket {
      * @return int Device_id_len
      */
     public int getDevice_id_len(int pos) {
-        return ((configuration[pos] & 0b00111000) << 3) +1;
+        return ((configuration[pos] & 0b00111000) >> 3) +1;
     }
     /**
      * @brief obtiene el valor port_len del paquete
@@ -249,9 +252,17 @@ public class eHDDPpacket extends BasePacket {
      * @return int port_len
      */
     public int getport_len(int pos) {
-        return ((configuration[pos] & 0b00000110) << 1) +1;
+        return ((configuration[pos] & 0b00000110) >> 1) +1;
     }
 
+    /**
+     * @brief indica si el reply estaba lleno y su camino sigue en un reply de continuacion,
+     * que empieza repitiendo el ultimo dispositivo de este
+     *
+     * @return boolean More_frames
+     */
+    public boolean getMoreFrames() { return More_frames; }
+
     /**
      * @brief obtiene el valor port_len del paquete
      *
@@ -437,7 +448,9 @@ public class eHDDPpacket extends BasePacket {
         final ByteBuffer bb = ByteBuffer.wrap(data, offset, size);
 
         /** Sacamos el primer byte (Flags and Version) */
-        BitSet aux_BitSet = BitSet.valueOf(new byte[] { bb.get() });
+        byte flags_version = bb.get();
+        BitSet aux_BitSet = BitSet.valueOf(new byte[] { flags_version });
+        this.More_frames = (flags_version & eHDDP_FLAG_MORE) != 0;
         this.Flags = BitSet_split_vars(aux_BitSet, 7, 4);
         this.Version = BitSet_split_vars(aux_BitSet, 3, 0);
 
@@ -500,7 +513,9 @@ public class eHDDPpacket extends BasePacket {
             /** Creamos la clase para ser rellenada */
             eHDDPpacket packet = new eHDDPpacket();
             /** Sacamos el primer byte (Flags and Version) */
-            BitSet aux_BitSet = BitSet.valueOf(new byte[] { bb.get() });
+            byte flags_version = bb.get();
+            BitSet aux_BitSet = BitSet.valueOf(new byte[] { flags_version });
+            packet.More_frames = (flags_version & eHDDP_FLAG_MORE) != 0;
             packet.Flags = packet.BitSet_split_vars(aux_BitSet, 7, 4);
             packet.Version = packet.BitSet_split_vars(aux_BitSet, 3, 0);
 
@@ -596,7 +611,7 @@ public class eHDDPpacket extends BasePacket {
                 type_device = 0;
                 break;
             case 1:
-                type_device = (short) bb.get();
+                type_device = (short) (bb.get() & 0xff);
                 break;
             default:
                 type_device = (short) bb.getShort();
@@ -615,10 +630,10 @@ public class eHDDPpacket extends BasePacket {
                 port = 0;
                 break;
             case 1:
-                port = (int) bb.get();
+                port = bb.get() & 0xff;
                 break;
             case 2:
-                port = (int) bb.getShort();
+                port = bb.getShort() & 0xffff;
                 break;
             default:
                 port = (int) bb.getInt();
@@ -636,13 +651,13 @@ public class eHDDPpacket extends BasePacket {
                 id_mac_device = 0;
                 break;
             case 1:
-                id_mac_device = (long) bb.get();
+                id_mac_device = bb.get() & 0xffL;
                 break;
             case 2:
-                id_mac_device = (long) bb.getShort();
+                id_mac_device = bb.getShort() & 0xffffL;
                 break;
             case 4:
-                id_mac_device = (long) bb.getInt();
+                id_mac_device = bb.getInt() & 0xffffffffL;
                 break;
             default:
                 id_mac_device = (long) bb.getLong();
@@ -267,6 +267,11 @@ public class eHDDPproviderlink implements LinkProvider{
                     break;
             }
 
+            /** Si el camino sigue en un reply de continuacion, el ultimo elemento no esta unido
+             * al sdn device que ha enviado el packet in: el enlace llega con la continuacion */
+            if (num + 1 == Packet_in_eHDDP.getNumHops() && Packet_in_eHDDP.getMoreFrames())
+                break;
+
             /** Si estamos en el ultimo elemento lo unimos con el sdn device que ha enviado el packet in */
             if (num + 1 == Packet_in_eHDDP.getNumHops()){
                 dstDpid[1] = srcDpIdpacketin;
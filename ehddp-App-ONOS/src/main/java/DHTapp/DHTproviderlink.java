@@ -266,6 +266,11 @@ public class DHTproviderlink implements LinkProvider{
                     break;
             }
 
+            /** Si el camino sigue en un reply de continuacion, el ultimo elemento no esta unido
+             * al sdn device que ha enviado el packet in: el enlace llega con la continuacion */
+            if (num + 1 == Packet_in_dht.getNumHops() && Packet_in_dht.getMoreFrames())
+                break;
+
             /** Si estamos en el ultimo elemento lo unimos con el sdn device que ha enviado el packet in */
             if (num + 1 == Packet_in_dht.getNumHops()){
                 dstDpid[1] = srcDpIdpacketin;
@@ -90,6 +90,204 @@ OFP_ASSERT(sizeof(struct openflow_ext_set_dp_desc) == 272);
 #define ofq_error_string(rv) (((rv) < OFQ_ERR_COUNT) && ((rv) >= 0) ? \
     openflow_queue_error_strings[rv] : "Unknown error code")
 
+/****************************************************************
+ *
+ * Experimenter multipart messages
+ *
+ ****************************************************************/
+
+/* 'exp_type' of the experimenter multipart messages, whose body starts with
+ * a struct ofp_experimenter_multipart_header with 'experimenter' set to
+ * OPENFLOW_VENDOR_ID. */
+enum ofp_extension_stats_types {
+    OFP_EXT_STATS_LATENCY,     /* Per-stage latency histograms. */
+    OFP_EXT_STATS_DISCOVERY,   /* eHDDP and ARP-path counters. */
+    OFP_EXT_STATS_CONNECTIONS, /* Controller connection counters. */
+    OFP_EXT_STATS_BUFFERS,     /* Packet-in buffer counters. */
+    OFP_EXT_STATS_QUEUES       /* Userspace port scheduler counters. */
+};
+
+/* Stages of the datapath with a latency histogram. Lookups have one per
+ * flow table. */
+enum openflow_ext_latency_stages {
+    OFP_EXT_LATENCY_RX,         /* Receiving a frame from a port. */
+    OFP_EXT_LATENCY_PARSE,      /* Creating the packet, parsing its headers. */
+    OFP_EXT_LATENCY_LOOKUP,     /* Looking up a flow table. */
+    OFP_EXT_LATENCY_ACTIONS,    /* Apply-actions and the action set. */
+    OFP_EXT_LATENCY_GROUP,      /* Executing a group. */
+    OFP_EXT_LATENCY_METER,      /* Applying a meter. */
+    OFP_EXT_LATENCY_TX,         /* Sending a frame through a port. */
+    OFP_EXT_LATENCY_PACKET_IN,  /* Encoding and sending a packet-in. */
+    OFP_EXT_LATENCY_QUEUE,      /* Waiting in a userspace port queue. */
+
+    OFP_EXT_LATENCY_N_STAGES
+};
+
+/* What a latency request does before the histograms are returned. */
+enum openflow_ext_latency_command {
+    OFP_EXT_LATENCY_GET,        /* Nothing. */
+    OFP_EXT_LATENCY_ENABLE,     /* Starts timing the stages. */
+    OFP_EXT_LATENCY_DISABLE,    /* Stops timing the stages. */
+    OFP_EXT_LATENCY_CLEAR       /* Empties the histograms. */
+};
+
+/* Body of an OFPMP_EXPERIMENTER request of type OFP_EXT_STATS_LATENCY. */
+struct openflow_ext_latency_request {
+    struct ofp_experimenter_multipart_header header;
+    uint8_t command;            /* One of OFP_EXT_LATENCY_GET... */
+    uint8_t pad[7];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_request) == 16);
+
+/* 'flags' of a latency reply. */
+enum openflow_ext_latency_flags {
+    OFP_EXT_LATENCY_ENABLED   = 1 << 0, /* Stages are being timed. */
+    OFP_EXT_LATENCY_TRUNCATED = 1 << 1  /* Some stages were sent without
+                                           their buckets for lack of room. */
+};
+
+/* A non-empty bucket of a latency histogram. */
+struct openflow_ext_latency_bucket {
+    uint64_t ns;                /* Lowest latency in the bucket. */
+    uint64_t count;             /* Samples in the bucket. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_bucket) == 16);
+
+/* Histogram of a stage with samples. */
+struct openflow_ext_latency_stage {
+    uint16_t length;            /* Length of this entry, with its buckets. */
+    uint8_t stage;              /* One of OFP_EXT_LATENCY_RX... */
+    uint8_t table_id;           /* Table of a lookup, otherwise 0xff. */
+    uint8_t pad[4];
+    uint64_t count;             /* Samples. */
+    uint64_t sum_ns;            /* Sum of the samples. */
+    uint64_t max_ns;            /* Largest sample. */
+    struct openflow_ext_latency_bucket buckets[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_stage) == 32);
+
+/* Body of an OFPMP_EXPERIMENTER reply of type OFP_EXT_STATS_LATENCY. */
+struct openflow_ext_latency_reply {
+    struct ofp_experimenter_multipart_header header;
+    uint32_t flags;             /* OFP_EXT_LATENCY_* flags. */
+    uint8_t pad[4];
+    struct openflow_ext_latency_stage stages[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_reply) == 16);
+
+/* Counters of the eHDDP discovery and of the ARP path, kept per port. Each
+ * is counted on the port the frame arrived on. */
+enum openflow_ext_discovery_counters {
+    OFP_EXT_DISCOVERY_REQUEST_IN,     /* eHDDP requests received. */
+    OFP_EXT_DISCOVERY_REPLY_IN,       /* eHDDP replies received. */
+    OFP_EXT_DISCOVERY_ACK_IN,         /* eHDDP ACKs received. */
+    OFP_EXT_DISCOVERY_BAD_OPCODE_IN,  /* eHDDP frames of unknown opcode. */
+    OFP_EXT_DISCOVERY_REQUEST_DUP,    /* Requests dropped as duplicates. */
+    OFP_EXT_DISCOVERY_REQUEST_FLOOD,  /* Requests flooded on. */
+    OFP_EXT_DISCOVERY_REPLY_CREATE,   /* Replies created for a request. */
+    OFP_EXT_DISCOVERY_REPLY_FORWARD,  /* Replies forwarded to the controller. */
+    OFP_EXT_DISCOVERY_REPLY_CONTINUE, /* Full replies continued in a new
+                                         frame. */
+    OFP_EXT_DISCOVERY_REPLY_FULL,     /* Full replies dropped. */
+    OFP_EXT_DISCOVERY_REPLY_NO_PORT,  /* Replies without a path back. */
+    OFP_EXT_DISCOVERY_ARP_REQUEST,    /* ARP requests for the control IP. */
+    OFP_EXT_DISCOVERY_ARP_REPLY,      /* ARP replies from the control IP. */
+    OFP_EXT_DISCOVERY_ARP_LEARN,      /* Source MACs learnt by the ARP path. */
+    OFP_EXT_DISCOVERY_ARP_FLOOD,      /* Broadcasts flooded by the ARP path. */
+    OFP_EXT_DISCOVERY_ARP_UNICAST,    /* Frames sent to a learnt port. */
+    OFP_EXT_DISCOVERY_ARP_UNKNOWN,    /* Frames to an unknown or dead port. */
+
+    OFP_EXT_DISCOVERY_N_COUNTERS
+};
+
+/* Counters of a port with any of them set. */
+struct openflow_ext_discovery_port {
+    uint32_t port_no;
+    uint8_t pad[4];
+    uint64_t counters[0];       /* 'n_counters' of the reply, indexed by
+                                   OFP_EXT_DISCOVERY_REQUEST_IN... */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_discovery_port) == 8);
+
+/* Body of an OFPMP_EXPERIMENTER reply of type OFP_EXT_STATS_DISCOVERY. The
+ * request has no body past its ofp_experimenter_multipart_header. Times are
+ * wall-clock milliseconds, 0 if the event has not happened. */
+struct openflow_ext_discovery_reply {
+    struct ofp_experimenter_multipart_header header;
+    uint64_t exploration;       /* Start of the last exploration, as set by
+                                   the controller in its requests. */
+    uint64_t first_request;     /* First request of that exploration seen. */
+    uint64_t convergence;       /* From 'exploration' to 'first_request'. */
+    uint64_t controller_connect;/* Connection to the controller. */
+    uint64_t local_port_ready;  /* In-band local port up. */
+    uint64_t replies_merged;    /* Replies merged into a pending frame. */
+    uint64_t seen_evictions;    /* Live duplicate-filter entries evicted. */
+    uint16_t n_counters;        /* Counters per port. */
+    uint8_t pad[6];
+    struct openflow_ext_discovery_port ports[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_discovery_reply) == 72);
+
+/* A connection of a controller to the switch. */
+struct openflow_ext_connection {
+    uint32_t remote;            /* Controller, in the order they connected. */
+    uint8_t auxiliary_id;       /* 0 for the main connection. */
+    uint8_t connected;          /* 1 if the connection is up. */
+    uint8_t pad[2];
+    uint32_t txq;               /* Messages waiting to be sent. */
+    uint32_t txq_max;           /* Most messages that have waited at once. */
+    uint64_t packet_ins;        /* Packet-ins sent. */
+    uint64_t dropped;           /* Messages dropped, queue full. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_connection) == 32);
+
+/* Body of an OFPMP_EXPERIMENTER reply of type OFP_EXT_STATS_CONNECTIONS. The
+ * request has no body past its ofp_experimenter_multipart_header. */
+struct openflow_ext_connections_reply {
+    struct ofp_experimenter_multipart_header header;
+    struct openflow_ext_connection conns[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_connections_reply) == 8);
+
+/* Body of an OFPMP_EXPERIMENTER reply of type OFP_EXT_STATS_BUFFERS. The
+ * request has no body past its ofp_experimenter_multipart_header. */
+struct openflow_ext_buffers_reply {
+    struct ofp_experimenter_multipart_header header;
+    uint32_t buffers;           /* Number of buffers. */
+    uint32_t buffered;          /* Packets currently buffered. */
+    uint64_t bytes;             /* Memory used by the buffered packets. */
+    uint64_t max_bytes;         /* Memory budget for buffered packets. */
+    uint64_t saves;             /* Packets saved to a buffer. */
+    uint64_t save_failures;     /* Packets not saved for lack of room. */
+    uint64_t hits;              /* Buffers retrieved by the controller. */
+    uint64_t misses;            /* Retrievals of unknown or reused buffers. */
+    uint64_t evictions;         /* Packets evicted for newer ones. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_buffers_reply) == 72);
+
+/* A queue of a port served by the userspace scheduler. */
+struct openflow_ext_queue {
+    uint32_t port_no;
+    uint32_t queue_id;
+    uint32_t backlog_packets;   /* Frames waiting. */
+    uint8_t pad[4];
+    uint64_t backlog_bytes;     /* Bytes waiting. */
+    uint64_t sent;              /* Frames sent. */
+    uint64_t dropped;           /* Frames dropped, queue full or send error. */
+    uint64_t sojourn_msec;      /* Total time sent frames waited. */
+    uint64_t sojourn_max_msec;  /* Longest time a sent frame waited. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_queue) == 56);
+
+/* Body of an OFPMP_EXPERIMENTER reply of type OFP_EXT_STATS_QUEUES. The
+ * request has no body past its ofp_experimenter_multipart_header. Only the
+ * queues of ports with a userspace scheduler are listed. */
+struct openflow_ext_queues_reply {
+    struct ofp_experimenter_multipart_header header;
+    struct openflow_ext_queue queues[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_queues_reply) == 8);
+
 /****************************************************************
  *
  * Unsupported, but potential extended queue properties
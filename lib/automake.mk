@@ -27,6 +27,8 @@ lib_libopenflow_a_SOURCES = \
 	lib/flow.h \
 	lib/hash.c \
 	lib/hash.h \
+	lib/histogram.c \
+	lib/histogram.h \
 	lib/hmap.c \
 	lib/hmap.h \
 	lib/ipv6_util.c \
@@ -35,6 +37,10 @@ lib_libopenflow_a_SOURCES = \
 	lib/list.h \
 	lib/mac-learning.c \
 	lib/mac-learning.h \
+	lib/netdev-pcap.c \
+	lib/netdev-pcap.h \
+	lib/netdev-shm.c \
+	lib/netdev-shm.h \
 	lib/netdev.c \
 	lib/netdev.h \
 	lib/ofp.c \
@@ -72,6 +78,9 @@ lib_libopenflow_a_SOURCES = \
 	lib/tag.h \
 	lib/timeval.c \
 	lib/timeval.h \
+	lib/trace-events.def \
+	lib/trace.c \
+	lib/trace.h \
 	lib/type-props.h \
 	lib/util.c \
 	lib/util.h \
@@ -94,6 +103,7 @@ lib_libopenflow_a_LIBADD = oflib/ofl-actions.o \
                            oflib/ofl-actions-pack.o \
                            oflib/ofl-actions-print.o \
                            oflib/ofl-actions-unpack.o \
+                           oflib/ofl-arena.o \
                            oflib/ofl-messages.o \
                            oflib/ofl-messages-pack.o \
                            oflib/ofl-messages-print.o \
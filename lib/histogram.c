@@ -0,0 +1,64 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "histogram.h"
+
+/* Returns the lowest value that goes into 'bucket'. */
+uint64_t
+histogram_bucket_floor(int bucket)
+{
+    if (bucket < 16) {
+        return bucket;
+    }
+    bucket -= 16;
+    return (uint64_t) (8 + bucket % 8) << (bucket / 8 + 1);
+}
+
+/* Returns the lowest value of the bucket below which a 'fraction' of the
+ * values in 'h' fall, or the largest value if that is the last one. */
+uint64_t
+histogram_percentile(const struct histogram *h, double fraction)
+{
+    uint64_t rank = h->count * fraction;
+    uint64_t n = 0;
+    int i;
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        n += h->buckets[i];
+        if (n > rank) {
+            return histogram_bucket_floor(i);
+        }
+    }
+    return h->max;
+}
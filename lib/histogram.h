@@ -0,0 +1,79 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H 1
+
+#include <stdint.h>
+
+/* Histogram of 64-bit values, with buckets that grow with the value so that
+ * a bucket is never wider than 1/8 of the values it holds.  Values below 16
+ * get a bucket each; above, each power of 2 is split into 8 buckets. */
+
+#define HISTOGRAM_BUCKETS (16 + 60 * 8)
+
+struct histogram {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;             /* Values added. */
+    uint64_t sum;               /* Sum of the values added. */
+    uint64_t max;               /* Largest value added. */
+};
+
+/* Returns the bucket that holds 'value'. */
+static inline int
+histogram_bucket(uint64_t value)
+{
+    int exp;
+
+    if (value < 16) {
+        return value;
+    }
+    exp = 63 - __builtin_clzll(value);
+    return 16 + (exp - 4) * 8 + ((value >> (exp - 3)) & 7);
+}
+
+static inline void
+histogram_add(struct histogram *h, uint64_t value)
+{
+    h->buckets[histogram_bucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+uint64_t histogram_bucket_floor(int bucket);
+uint64_t histogram_percentile(const struct histogram *, double fraction);
+
+#endif /* histogram.h */
@@ -0,0 +1,502 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "netdev-pcap.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "hash.h"
+#include "histogram.h"
+#include "hmap.h"
+#include "ofpbuf.h"
+#include "packets.h"
+#include "pcap.h"
+#include "poll-loop.h"
+#include "util.h"
+
+#include "vlog.h"
+#define LOG_MODULE VLM_netdev
+
+/* Line rate of pace=line, in bits per second, as the port advertises. */
+#define LINE_RATE 1000000000LL
+
+/* Bytes a frame takes on the wire besides its own: preamble, frame check
+ * sequence and inter-frame gap. */
+#define WIRE_OVERHEAD (8 + 4 + 12)
+
+enum pace {
+    PACE_MAX,
+    PACE_LINE,
+    PACE_PCAP
+};
+
+struct pcap_frame {
+    struct hmap_node node;      /* In bench.frames, by hash of the bytes. */
+    struct ofpbuf *buf;
+    long long int usec;         /* Timestamp in the file. */
+    long long int due_ns;       /* When last replayed, it was due; -1 if not
+                                 * replayed yet. */
+};
+
+struct netdev_pcap_replay {
+    char *file_name;
+    struct pcap_frame *frames;
+    size_t n_frames;
+    enum pace pace;
+    unsigned int loops;         /* Passes over the file, 0 for no limit. */
+
+    unsigned int pass;          /* Passes done. */
+    size_t next;                /* Next frame to receive. */
+    long long int start_ns;     /* When the pass began, 0 if not yet. */
+    long long int due_ns;       /* When 'next' is due. */
+    bool done;
+    bool indexed;               /* 'frames' are in bench.frames. */
+};
+
+struct netdev_pcap_out {
+    FILE *file;                 /* NULL for a sink. */
+};
+
+static struct {
+    int n_replays;              /* Replay ports open. */
+    int n_done;                 /* ...that are over. */
+    unsigned long long int replayed;
+    unsigned long long int recorded;
+    long long int first_ns;     /* First frame replayed. */
+    long long int last_ns;      /* Last frame replayed or recorded. */
+    struct hmap frames;         /* Frames of all replay ports. */
+    struct histogram latency;   /* Nanoseconds from due to sent. */
+} bench = { .frames = HMAP_INITIALIZER(&bench.frames) };
+
+static long long int
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void
+name_to_etheraddr(const char *name, uint8_t etheraddr[ETH_ADDR_LEN])
+{
+    uint32_t hash = hash_bytes(name, strlen(name), 0);
+
+    etheraddr[0] = 0x02;
+    etheraddr[1] = 0x00;
+    etheraddr[2] = hash >> 24;
+    etheraddr[3] = hash >> 16;
+    etheraddr[4] = hash >> 8;
+    etheraddr[5] = hash;
+}
+
+/* Replay ports. */
+
+static int
+load_frames(struct netdev_pcap_replay *r)
+{
+    size_t allocated = 0;
+    FILE *file;
+    int error = 0;
+
+    file = pcap_open(r->file_name, "rb");
+    if (!file) {
+        return errno ? errno : EINVAL;
+    }
+    for (;;) {
+        struct ofpbuf *buf;
+        long long int usec;
+        int c = getc(file);
+
+        if (c == EOF) {
+            break;
+        }
+        ungetc(c, file);
+
+        error = pcap_read_stamped(file, &buf, &usec);
+        if (error) {
+            break;
+        }
+        if (r->n_frames >= allocated) {
+            allocated = allocated ? allocated * 2 : 1024;
+            r->frames = xrealloc(r->frames, allocated * sizeof *r->frames);
+        }
+        /* Padded as netdev_recv() would, so that the frames the output
+         * ports send compare equal to them. */
+        if (buf->size < ETH_TOTAL_MIN) {
+            ofpbuf_put_zeros(buf, ETH_TOTAL_MIN - buf->size);
+        }
+        r->frames[r->n_frames].buf = buf;
+        r->frames[r->n_frames].usec = usec;
+        r->frames[r->n_frames].due_ns = -1;
+        r->n_frames++;
+    }
+    fclose(file);
+
+    if (!error && !r->n_frames) {
+        VLOG_ERR(LOG_MODULE, "%s: no packets to replay", r->file_name);
+        error = EINVAL;
+    }
+    return error;
+}
+
+static uint32_t
+hash_frame(const struct ofpbuf *buf)
+{
+    return hash_bytes(buf->data, buf->size, 0);
+}
+
+/* Returns when the frame with the bytes in 'buf' was due at its replay port,
+ * or -1 if no replayed frame has them, e.g. as the datapath rewrote them.
+ * Of identical frames, the latest replayed is taken. */
+static long long int
+frame_due_ns(const struct ofpbuf *buf)
+{
+    long long int due_ns = -1;
+    struct pcap_frame *f;
+
+    HMAP_FOR_EACH_WITH_HASH (f, struct pcap_frame, node, hash_frame(buf),
+                             &bench.frames) {
+        if (f->due_ns > due_ns && f->buf->size == buf->size
+            && !memcmp(f->buf->data, buf->data, buf->size)) {
+            due_ns = f->due_ns;
+        }
+    }
+    return due_ns;
+}
+
+static void
+pcap_replay_close(void *aux)
+{
+    struct netdev_pcap_replay *r = aux;
+    size_t i;
+
+    bench.n_replays--;
+    if (r->done) {
+        bench.n_done--;
+    }
+    for (i = 0; i < r->n_frames; i++) {
+        if (r->indexed) {
+            hmap_remove(&bench.frames, &r->frames[i].node);
+        }
+        ofpbuf_delete(r->frames[i].buf);
+    }
+    free(r->frames);
+    free(r->file_name);
+    free(r);
+}
+
+/* Parses the number of passes of "loop=", which 0 makes unlimited.  Returns
+ * false if 's' is not a number in range. */
+static bool
+str_to_loops(const char *s, unsigned int *loops)
+{
+    unsigned long int n;
+    char *tail;
+
+    errno = 0;
+    n = strtoul(s, &tail, 10);
+    if (!*s || *tail || errno || n > UINT_MAX || s[0] == '-') {
+        return false;
+    }
+    *loops = n;
+    return true;
+}
+
+static int
+pcap_replay_open(const char *name, uint8_t etheraddr[ETH_ADDR_LEN], void **auxp)
+{
+    struct netdev_pcap_replay *r = xcalloc(1, sizeof *r);
+    char *args = xstrdup(name);
+    char *save_ptr = NULL;
+    char *option;
+    size_t i;
+    int error;
+
+    r->file_name = xstrdup(strtok_r(args, ":", &save_ptr));
+    r->pace = PACE_MAX;
+    r->loops = 1;
+    while ((option = strtok_r(NULL, ":", &save_ptr)) != NULL) {
+        if (!strcmp(option, "pace=max")) {
+            r->pace = PACE_MAX;
+        } else if (!strcmp(option, "pace=line")) {
+            r->pace = PACE_LINE;
+        } else if (!strcmp(option, "pace=pcap")) {
+            r->pace = PACE_PCAP;
+        } else if (!strncmp(option, "loop=", 5)
+                   && str_to_loops(option + 5, &r->loops)) {
+            /* Parsed. */
+        } else {
+            VLOG_ERR(LOG_MODULE, "pcap:%s: unknown or invalid option \"%s\"", name, option);
+            free(args);
+            free(r->file_name);
+            free(r);
+            return EINVAL;
+        }
+    }
+    free(args);
+
+    bench.n_replays++;
+    error = load_frames(r);
+    if (error) {
+        pcap_replay_close(r);
+        return error;
+    }
+    /* The frames stay where they are from now on: the output ports look
+     * them up to learn when the frames they send were due. */
+    for (i = 0; i < r->n_frames; i++) {
+        hmap_insert(&bench.frames, &r->frames[i].node,
+                    hash_frame(r->frames[i].buf));
+    }
+    r->indexed = true;
+
+    name_to_etheraddr(name, etheraddr);
+    *auxp = r;
+    return 0;
+}
+
+static int
+pcap_replay_recv(void *aux, struct ofpbuf *buffer)
+{
+    struct netdev_pcap_replay *r = aux;
+    struct pcap_frame *f;
+    long long int now;
+
+    if (r->done) {
+        return EAGAIN;
+    }
+    now = now_ns();
+    if (!r->start_ns) {
+        r->start_ns = r->due_ns = now;
+    }
+    if (r->pace == PACE_MAX) {
+        r->due_ns = now;
+    } else if (r->due_ns > now) {
+        return EAGAIN;
+    }
+
+    f = &r->frames[r->next];
+    ofpbuf_put(buffer, f->buf->data, f->buf->size);
+    if (!bench.first_ns) {
+        bench.first_ns = now;
+    }
+    bench.last_ns = now;
+    f->due_ns = r->due_ns;
+    bench.replayed++;
+
+    if (++r->next == r->n_frames) {
+        r->next = 0;
+        if (++r->pass == r->loops) {
+            r->done = true;
+            bench.n_done++;
+        }
+    }
+    if (r->pace == PACE_LINE) {
+        r->due_ns += (f->buf->size + WIRE_OVERHEAD) * 8 * 1000000000LL / LINE_RATE;
+    } else if (r->pace == PACE_PCAP) {
+        if (r->next == 0) {
+            r->start_ns = r->due_ns;
+        }
+        r->due_ns = r->start_ns + (r->frames[r->next].usec - r->frames[0].usec) * 1000;
+    }
+    return 0;
+}
+
+static void
+pcap_replay_recv_wait(void *aux)
+{
+    struct netdev_pcap_replay *r = aux;
+    long long int delay;
+
+    if (r->done) {
+        return;
+    }
+    delay = r->pace == PACE_MAX || !r->start_ns ? 0 : r->due_ns - now_ns();
+    if (delay <= 0) {
+        poll_immediate_wake();
+    } else {
+        poll_timer_wait((delay + 999999) / 1000000);
+    }
+}
+
+static int
+pcap_replay_send(void *aux UNUSED, const struct ofpbuf *buffer UNUSED)
+{
+    return 0;
+}
+
+const struct netdev_class netdev_pcap_class = {
+    "pcap",
+    pcap_replay_open,
+    pcap_replay_close,
+    pcap_replay_recv,
+    pcap_replay_recv_wait,
+    pcap_replay_send,
+};
+
+/* Recording and counting ports. */
+
+static int
+pcap_out_open(const char *name, uint8_t etheraddr[ETH_ADDR_LEN], void **auxp)
+{
+    struct netdev_pcap_out *out = xmalloc(sizeof *out);
+
+    out->file = pcap_open(name, "wb");
+    if (!out->file) {
+        free(out);
+        return errno ? errno : EINVAL;
+    }
+    name_to_etheraddr(name, etheraddr);
+    *auxp = out;
+    return 0;
+}
+
+static int
+sink_open(const char *name, uint8_t etheraddr[ETH_ADDR_LEN], void **auxp)
+{
+    struct netdev_pcap_out *out = xmalloc(sizeof *out);
+
+    out->file = NULL;
+    name_to_etheraddr(name, etheraddr);
+    *auxp = out;
+    return 0;
+}
+
+static void
+pcap_out_close(void *aux)
+{
+    struct netdev_pcap_out *out = aux;
+
+    if (out->file) {
+        fclose(out->file);
+    }
+    free(out);
+}
+
+static int
+pcap_out_recv(void *aux UNUSED, struct ofpbuf *buffer UNUSED)
+{
+    return EAGAIN;
+}
+
+static void
+pcap_out_recv_wait(void *aux UNUSED)
+{
+}
+
+static int
+pcap_out_send(void *aux, const struct ofpbuf *buffer)
+{
+    struct netdev_pcap_out *out = aux;
+    long long int now = now_ns();
+    long long int due_ns;
+
+    if (out->file) {
+        struct timeval tv;
+
+        gettimeofday(&tv, NULL);
+        pcap_write_stamped(out->file, buffer, tv.tv_sec * 1000000LL + tv.tv_usec);
+    }
+
+    bench.recorded++;
+    bench.last_ns = now;
+    due_ns = frame_due_ns(buffer);
+    if (due_ns >= 0) {
+        long long int latency = now - due_ns;
+
+        histogram_add(&bench.latency, latency > 0 ? latency : 0);
+    }
+    return 0;
+}
+
+const struct netdev_class netdev_pcap_out_class = {
+    "pcap-out",
+    pcap_out_open,
+    pcap_out_close,
+    pcap_out_recv,
+    pcap_out_recv_wait,
+    pcap_out_send,
+};
+
+const struct netdev_class netdev_sink_class = {
+    "sink",
+    sink_open,
+    pcap_out_close,
+    pcap_out_recv,
+    pcap_out_recv_wait,
+    pcap_out_send,
+};
+
+/* Returns true if there are replay ports and all of them are over. */
+bool
+netdev_pcap_replay_done(void)
+{
+    return bench.n_replays && bench.n_done == bench.n_replays;
+}
+
+static double
+latency_percentile_us(double fraction)
+{
+    return histogram_percentile(&bench.latency, fraction) / 1e3;
+}
+
+/* Prints to 'stream' the rates and latencies of the frames that went
+ * through the replay, recording and counting ports.  'dropped' is the number
+ * of frames the datapath dropped on output. */
+void
+netdev_pcap_bench_report(FILE *stream, unsigned long long int dropped)
+{
+    double secs = (bench.last_ns - bench.first_ns) / 1e9;
+
+    if (secs <= 0) {
+        secs = 1e-9;
+    }
+    fprintf(stream, "replayed:  %llu frames, %.0f pps\n",
+            bench.replayed, bench.replayed / secs);
+    fprintf(stream, "forwarded: %llu frames, %.0f pps\n",
+            bench.recorded, bench.recorded / secs);
+    fprintf(stream, "dropped:   %llu frames\n", dropped);
+    fprintf(stream, "elapsed:   %.3f s\n", secs);
+    if (bench.latency.count) {
+        fprintf(stream, "latency:   p50 %.1f us, p90 %.1f us, p99 %.1f us, "
+                "p99.9 %.1f us, max %.1f us\n",
+                latency_percentile_us(0.5), latency_percentile_us(0.9),
+                latency_percentile_us(0.99), latency_percentile_us(0.999),
+                bench.latency.max / 1e3);
+    }
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#ifndef NETDEV_PCAP_H
+#define NETDEV_PCAP_H 1
+
+/* Ports backed by pcap files, for reproducible throughput tests.
+ *
+ * "pcap:FILE[:OPTION]..." replays the packets of FILE as received frames and
+ * discards what is sent to it.  The options are:
+ *
+ *   - pace=max (default): each frame as soon as the datapath takes it.
+ *   - pace=line: at the line rate of a 1 Gbps port.
+ *   - pace=pcap: keeping the gaps between the timestamps of FILE.
+ *   - loop=N: replays FILE N times, or forever if N is 0 (default: 1).
+ *
+ * "pcap-out:FILE" records the frames sent to it into FILE, and "sink:NAME"
+ * only counts them.  Neither receives any frame.
+ *
+ * Each frame leaving through a recording or counting port is taken to be the
+ * last one a replay port handed to the datapath.  The time in between,
+ * counted from when the frame was due, is its latency. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "netdev.h"
+
+extern const struct netdev_class netdev_pcap_class;
+extern const struct netdev_class netdev_pcap_out_class;
+extern const struct netdev_class netdev_sink_class;
+
+bool netdev_pcap_replay_done(void);
+void netdev_pcap_bench_report(FILE *, unsigned long long int dropped);
+
+#endif /* netdev-pcap.h */
@@ -0,0 +1,463 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "netdev-shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "hash.h"
+#include "ofpbuf.h"
+#include "packets.h"
+#include "poll-loop.h"
+#include "util.h"
+
+#include "vlog.h"
+#define LOG_MODULE VLM_netdev
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+#define SHM_MAGIC "OFSHMLNK"
+#define SHM_VERSION 1
+
+/* Slots per ring.  Must be a power of 2. */
+#define SHM_RING_SLOTS 512
+
+/* Largest frame a slot holds. */
+#define SHM_FRAME_MAX 2044
+
+struct shm_slot {
+    uint32_t size;
+    uint8_t data[SHM_FRAME_MAX];
+};
+
+/* Frames towards one end of the link.  The producer only writes 'head' and
+ * the consumer only writes 'tail' and 'waiting', each on its own cache
+ * line. */
+struct shm_ring {
+    uint32_t head;              /* Number of frames ever put. */
+    uint8_t pad0[60];
+    uint32_t tail;              /* Number of frames ever taken. */
+    uint32_t waiting;           /* Consumer wants an eventfd wakeup. */
+    uint8_t pad1[56];
+    struct shm_slot slots[SHM_RING_SLOTS];
+};
+
+/* One end of the link. */
+struct shm_end {
+    uint32_t attached;          /* Nonzero while a process has it open. */
+    int32_t pid;                /* That process. */
+};
+
+struct shm_segment {
+    char magic[8];
+    uint32_t version;
+    struct shm_end ends[2];
+    struct shm_ring rings[2];   /* rings[i] carries frames towards end i. */
+};
+
+/* The two ends swap their eventfds through datagram sockets in the abstract
+ * namespace: an end that opens sends SHM_HELLO with its eventfd to the other
+ * one, which answers SHM_REPLY with its own. */
+enum {
+    SHM_HELLO,
+    SHM_REPLY
+};
+
+struct netdev_shm {
+    char *shm_name;             /* Name of the segment. */
+    struct shm_segment *seg;
+    int end;                    /* Our end of the link, 0 or 1. */
+    int efd;                    /* Our eventfd. */
+    int peer_efd;               /* The peer's eventfd, or -1. */
+    int sock;                   /* Receives the peer's eventfd. */
+    struct sockaddr_un peer_addr;
+    socklen_t peer_addr_len;
+    uint64_t rx_dropped;        /* Frames dropped for a bad size. */
+};
+
+static socklen_t
+end_address(const char *name, int end, struct sockaddr_un *sun)
+{
+    memset(sun, 0, sizeof *sun);
+    sun->sun_family = AF_UNIX;
+    snprintf(sun->sun_path + 1, sizeof sun->sun_path - 1,
+             "ofdatapath-shm-%s-%d", name, end);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + strlen(sun->sun_path + 1);
+}
+
+/* Sends our eventfd to the peer.  Fails quietly if the peer is not there:
+ * it will send SHM_HELLO when it opens. */
+static void
+send_efd(struct netdev_shm *shm, uint8_t type)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+
+    iov.iov_base = &type;
+    iov.iov_len = sizeof type;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = &shm->peer_addr;
+    msg.msg_namelen = shm->peer_addr_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &shm->efd, sizeof(int));
+    sendmsg(shm->sock, &msg, MSG_DONTWAIT);
+}
+
+/* Takes the eventfds the peer sent, keeping the newest one. */
+static void
+recv_efds(struct netdev_shm *shm)
+{
+    for (;;) {
+        char control[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr *cmsg;
+        struct msghdr msg;
+        struct iovec iov;
+        uint8_t type;
+        int fd;
+
+        iov.iov_base = &type;
+        iov.iov_len = sizeof type;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (recvmsg(shm->sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC) < 0) {
+            return;
+        }
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof fd);
+        if (shm->peer_efd >= 0) {
+            close(shm->peer_efd);
+        }
+        shm->peer_efd = fd;
+        if (type == SHM_HELLO) {
+            send_efd(shm, SHM_REPLY);
+        }
+    }
+}
+
+/* Takes a free end of 'seg' for this process, or the end of a process that
+ * is gone.  Returns the end, or -1 if both are in use. */
+static int
+claim_end(struct shm_segment *seg)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (__sync_bool_compare_and_swap(&seg->ends[i].attached, 0, 1)) {
+            return i;
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        int32_t pid = seg->ends[i].pid;
+
+        if (pid > 0 && kill(pid, 0) < 0 && errno == ESRCH
+            && __sync_bool_compare_and_swap(&seg->ends[i].pid, pid, getpid())) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void
+shm_close_link(void *aux)
+{
+    struct netdev_shm *shm = aux;
+    struct shm_segment *seg = shm->seg;
+
+    seg->ends[shm->end].pid = 0;
+    __sync_lock_release(&seg->ends[shm->end].attached);
+    __sync_synchronize();
+    if (!seg->ends[!shm->end].attached) {
+        shm_unlink(shm->shm_name);
+    }
+
+    munmap(seg, sizeof *seg);
+    if (shm->efd >= 0) {
+        close(shm->efd);
+    }
+    if (shm->peer_efd >= 0) {
+        close(shm->peer_efd);
+    }
+    if (shm->sock >= 0) {
+        close(shm->sock);
+    }
+    free(shm->shm_name);
+    free(shm);
+}
+
+static int
+shm_open_link(const char *name, uint8_t etheraddr[ETH_ADDR_LEN], void **auxp)
+{
+    struct netdev_shm *shm;
+    struct shm_segment *seg;
+    struct stat s;
+    char *shm_name;
+    uint32_t hash;
+    int fd, end, error;
+
+    if (!name[0] || strchr(name, '/')) {
+        return EINVAL;
+    }
+
+    shm_name = xasprintf("/ofdatapath-shm-%s", name);
+    fd = shm_open(shm_name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        error = errno;
+        VLOG_ERR(LOG_MODULE, "shm_open(%s) failed: %s", shm_name, strerror(error));
+        free(shm_name);
+        return error;
+    }
+    /* Both ends may be sizing the segment at once; they agree on the size,
+     * and the new pages are zeroed either way. */
+    if (fstat(fd, &s) < 0
+        || (s.st_size != sizeof *seg && ftruncate(fd, sizeof *seg) < 0)) {
+        error = errno;
+        close(fd);
+        free(shm_name);
+        return error;
+    }
+    seg = mmap(NULL, sizeof *seg, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    error = seg == MAP_FAILED ? errno : 0;
+    close(fd);
+    if (error) {
+        free(shm_name);
+        return error;
+    }
+
+    if (seg->version && seg->version != SHM_VERSION) {
+        VLOG_ERR(LOG_MODULE, "%s: segment of version %"PRIu32", expected %d",
+                 shm_name, seg->version, SHM_VERSION);
+        munmap(seg, sizeof *seg);
+        free(shm_name);
+        return EPROTO;
+    }
+    memcpy(seg->magic, SHM_MAGIC, sizeof seg->magic);
+    seg->version = SHM_VERSION;
+
+    end = claim_end(seg);
+    if (end < 0) {
+        VLOG_ERR(LOG_MODULE, "%s: both ends of the link are in use", shm_name);
+        munmap(seg, sizeof *seg);
+        free(shm_name);
+        return EBUSY;
+    }
+    /* The frames left towards this end were sent to a previous process, or
+     * to nobody: a process that took over the end of one that died must not
+     * receive them. */
+    __atomic_store_n(&seg->rings[end].tail,
+                     __atomic_load_n(&seg->rings[end].head, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+    seg->rings[end].waiting = 0;
+
+    shm = xmalloc(sizeof *shm);
+    shm->shm_name = shm_name;
+    shm->seg = seg;
+    shm->end = end;
+    shm->sock = -1;
+    shm->peer_efd = -1;
+    shm->rx_dropped = 0;
+    shm->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (shm->efd < 0) {
+        error = errno;
+        shm_close_link(shm);
+        return error;
+    }
+    shm->peer_efd = -1;
+    seg->ends[end].pid = getpid();
+
+    shm->sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (shm->sock >= 0) {
+        struct sockaddr_un sun;
+        socklen_t len = end_address(name, end, &sun);
+
+        if (bind(shm->sock, (struct sockaddr *) &sun, len) < 0) {
+            close(shm->sock);
+            shm->sock = -1;
+        }
+    }
+    if (shm->sock < 0) {
+        error = errno;
+        VLOG_ERR(LOG_MODULE, "%s: cannot create the wakeup socket: %s",
+                 shm_name, strerror(error));
+        shm_close_link(shm);
+        return error;
+    }
+    shm->peer_addr_len = end_address(name, !end, &shm->peer_addr);
+    send_efd(shm, SHM_HELLO);
+
+    /* A locally administered address that tells the two ends apart. */
+    hash = hash_bytes(name, strlen(name), 0);
+    etheraddr[0] = 0x02;
+    etheraddr[1] = 0x00;
+    etheraddr[2] = hash >> 24;
+    etheraddr[3] = hash >> 16;
+    etheraddr[4] = hash >> 8;
+    etheraddr[5] = (hash & 0xfe) | end;
+
+    *auxp = shm;
+    return 0;
+}
+
+static int
+shm_recv(void *aux, struct ofpbuf *buffer)
+{
+    struct netdev_shm *shm = aux;
+    struct shm_ring *ring = &shm->seg->rings[shm->end];
+    uint32_t tail = ring->tail;
+    struct shm_slot *slot;
+    uint32_t size;
+
+    ring->waiting = 0;
+    if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+        uint64_t n;
+
+        recv_efds(shm);
+        /* Consume any wakeup, so that the next poll blocks. */
+        if (read(shm->efd, &n, sizeof n) < 0 && errno != EAGAIN) {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "%s: eventfd read failed: %s",
+                         shm->shm_name, strerror(errno));
+        }
+        return EAGAIN;
+    }
+
+    /* The size is the peer's to write: a frame that cannot fit a slot is
+     * dropped rather than trusted.  A buffer short of room grows. */
+    slot = &ring->slots[tail & (SHM_RING_SLOTS - 1)];
+    size = slot->size;
+    if (size > SHM_FRAME_MAX) {
+        shm->rx_dropped++;
+        VLOG_WARN_RL(LOG_MODULE, &rl, "%s: dropped frame of %"PRIu32" bytes "
+                     "(%"PRIu64" dropped so far)", shm->shm_name, size,
+                     shm->rx_dropped);
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        return EAGAIN;
+    }
+    ofpbuf_put(buffer, slot->data, size);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void
+shm_recv_wait(void *aux)
+{
+    struct netdev_shm *shm = aux;
+    struct shm_ring *ring = &shm->seg->rings[shm->end];
+
+    /* Announce the sleep before looking at the ring for the last time: a
+     * producer that puts a frame afterwards sees 'waiting' and signals. */
+    ring->waiting = 1;
+    __sync_synchronize();
+    if (ring->tail != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+        poll_immediate_wake();
+    } else {
+        poll_fd_wait(shm->efd, POLLIN);
+    }
+    poll_fd_wait(shm->sock, POLLIN);
+}
+
+static void
+wake_peer(struct netdev_shm *shm)
+{
+    uint64_t one = 1;
+
+    if (shm->peer_efd < 0) {
+        recv_efds(shm);
+    }
+    if (shm->peer_efd >= 0 && write(shm->peer_efd, &one, sizeof one) < 0
+        && errno != EAGAIN) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "%s: eventfd write failed: %s",
+                     shm->shm_name, strerror(errno));
+    }
+}
+
+static int
+shm_send(void *aux, const struct ofpbuf *buffer)
+{
+    struct netdev_shm *shm = aux;
+    struct shm_ring *ring = &shm->seg->rings[!shm->end];
+    uint32_t head = ring->head;
+    struct shm_slot *slot;
+
+    if (buffer->size > SHM_FRAME_MAX) {
+        return EMSGSIZE;
+    }
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= SHM_RING_SLOTS) {
+        return EAGAIN;
+    }
+
+    slot = &ring->slots[head & (SHM_RING_SLOTS - 1)];
+    slot->size = buffer->size;
+    memcpy(slot->data, buffer->data, buffer->size);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    __sync_synchronize();
+    if (ring->waiting) {
+        wake_peer(shm);
+    }
+    return 0;
+}
+
+const struct netdev_class netdev_shm_class = {
+    "shm",
+    shm_open_link,
+    shm_close_link,
+    shm_recv,
+    shm_recv_wait,
+    shm_send,
+};
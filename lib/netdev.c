@@ -71,6 +71,7 @@
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <inttypes.h>
+#include <linux/pkt_sched.h>
 #include <linux/rtnetlink.h>
 #include <linux/if_tun.h>
 #include <linux/if_packet.h>
@@ -112,6 +113,8 @@
 
 #include "fatal-signal.h"
 #include "list.h"
+#include "netdev-pcap.h"
+#include "netdev-shm.h"
 #include "netlink.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
@@ -165,11 +168,26 @@ struct netdev
 
     int save_flags;    /* Initial device flags. */
     int changed_flags; /* Flags that we changed. */
+
+    /* Devices of a registered class instead of kernel interfaces. */
+    const struct netdev_class *dev_class;
+    void *aux;
+    enum netdev_flags dev_flags;
 };
 
 /* All open network devices. */
 static struct list netdev_list = LIST_INITIALIZER(&netdev_list);
 
+/* Registered classes of network devices, starting with the built-in ones. */
+#define MAX_NETDEV_CLASSES 8
+static const struct netdev_class *netdev_classes[MAX_NETDEV_CLASSES] = {
+    &netdev_shm_class,
+    &netdev_pcap_class,
+    &netdev_pcap_out_class,
+    &netdev_sink_class,
+};
+static size_t n_netdev_classes = 4;
+
 /* An AF_INET socket (used for ioctl operations). */
 static int af_inet_sock = -1;
 
@@ -178,6 +196,8 @@ static int af_inet_sock = -1;
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
 
 static void init_netdev(void);
+static int do_open_class_netdev(const struct netdev_class *, const char *name,
+                                struct netdev **);
 static int do_open_netdev(const char *name, int ethertype, int tap_fd,
                           struct netdev **netdev_);
 static int restore_flags(struct netdev *netdev);
@@ -223,7 +243,6 @@ get_ipv6_address(const char *name, struct in6_addr *in6)
     fclose(file);
 }
 
-#define TC_QDISC_NO_CONFIG_ERR 512
 /* All queues in a port, lie beneath a qdisc */
 #define TC_QDISC 0x0001
 /* This is a root class. In order to efficiently share excess bandwidth
@@ -234,38 +253,273 @@ get_ipv6_address(const char *name, struct in6_addr *in6)
  * without any bandwidth guarantees */
 #define TC_DEFAULT_CLASS 0xfffe
 #define TC_MIN_RATE 1
-/* This configures an HTB qdisc under the defined device. */
-#define COMMAND_ADD_DEV_QDISC "/sbin/tc qdisc add dev %s " \
-                              "root handle %x: htb default %x"
-#define COMMAND_DEL_DEV_QDISC "/sbin/tc qdisc del dev %s root"
-#define COMMAND_ADD_CLASS "/sbin/tc class add dev %s parent %x:%x " \
-                          "classid %x:%x htb rate %dkbit ceil %dkbit"
-#define COMMAND_CHANGE_CLASS "/sbin/tc class change dev %s parent %x:%x " \
-                             "classid %x:%x htb rate %dkbit ceil %dkbit"
-#define COMMAND_DEL_CLASS "/sbin/tc class del dev %s parent %x:%x classid %x:%x"
 
-static int
-netdev_setup_root_class(const struct netdev *netdev, uint16_t class_id,
-                        uint16_t rate)
+/* Most requests sent to the kernel at once, by netdev_setup_slicing(). */
+#define TC_MAX_BATCH 4
+
+/* Size of the rate tables of HTB classes, in bytes. */
+#define TC_RTAB_SIZE 1024
+
+/* Queues are configured over rtnetlink, the same way /sbin/tc does it.
+ * Running tc meant forking a shell and a tc process for every request,
+ * which stalled the datapath for tens of milliseconds each time. */
+static struct nl_sock *tc_sock;
+
+/* Ticks of the packet scheduler clock per second, and the HZ the kernel sizes
+ * buffers by, read from /proc/net/psched. */
+static double tc_ticks_per_s = 1.0;
+static unsigned int tc_buffer_hz = 100;
+
+static void
+read_psched(void)
 {
-    char command[1024];
-    int actual_rate;
+    unsigned int a, b, c, d;
+    FILE *stream;
 
-    /* we need to translate from .1% to kbps */
-    actual_rate = rate * netdev->speed;
+    stream = fopen("/proc/net/psched", "r");
+    if (!stream)
+    {
+        VLOG_WARN(LOG_MODULE, "/proc/net/psched: open failed: %s", strerror(errno));
+        return;
+    }
+    if (fscanf(stream, "%x %x %x %x", &a, &b, &c, &d) != 4)
+    {
+        VLOG_WARN(LOG_MODULE, "/proc/net/psched: read failed");
+        fclose(stream);
+        return;
+    }
+    fclose(stream);
 
-    snprintf(command, sizeof(command), COMMAND_ADD_CLASS, netdev->name,
-             TC_QDISC, 0, TC_QDISC, class_id, actual_rate, netdev->speed * 1000);
-    if (system(command) != 0)
+    if (!a || !b || !c)
     {
-        VLOG_ERR(LOG_MODULE, "Problem configuring root class %d for device %s",
-                 class_id, netdev->name);
-        return -1;
+        VLOG_WARN(LOG_MODULE, "/proc/net/psched: invalid scheduler parameters");
+        return;
+    }
+    tc_ticks_per_s = (double)a * c / b;
+    if (c == 1000000)
+    {
+        tc_buffer_hz = d;
     }
+}
+
+static int
+tc_init(void)
+{
+    int error;
 
+    if (tc_sock)
+    {
+        return 0;
+    }
+    error = nl_sock_create(NETLINK_ROUTE, 0, 0, 0, &tc_sock);
+    if (error)
+    {
+        VLOG_ERR(LOG_MODULE, "could not create rtnetlink socket for queues: %s",
+                 strerror(error));
+        return error;
+    }
+    read_psched();
     return 0;
 }
 
+/* Starts in 'request' a traffic control message of the given type for
+ * 'netdev'. The caller fills in the handles of the returned tcmsg before
+ * adding attributes. */
+static struct tcmsg *
+tc_make_request(const struct netdev *netdev, int type, unsigned int flags,
+                struct ofpbuf *request)
+{
+    struct tcmsg *tcmsg;
+
+    ofpbuf_init(request, 512);
+    nl_msg_put_nlmsghdr(request, tc_sock, sizeof *tcmsg, type,
+                        NLM_F_REQUEST | NLM_F_ACK | flags);
+    tcmsg = nl_msg_put_uninit(request, sizeof *tcmsg);
+    memset(tcmsg, 0, sizeof *tcmsg);
+    tcmsg->tcm_family = AF_UNSPEC;
+    tcmsg->tcm_ifindex = netdev->ifindex;
+    return tcmsg;
+}
+
+/* Sends the 'n' requests to the kernel in a single datagram and waits for
+ * each to be acknowledged, storing its result, 0 or a positive errno value,
+ * in 'errors'. Returns 0, or the errno value if the exchange itself failed.
+ * Frees the requests in any case. */
+static int
+tc_transact(struct ofpbuf requests[], int errors[], size_t n)
+{
+    struct iovec iov[TC_MAX_BATCH];
+    size_t i, pending;
+    int error;
+
+    assert(n <= TC_MAX_BATCH);
+    for (i = 0; i < n; i++)
+    {
+        nl_msg_nlmsghdr(&requests[i])->nlmsg_len = requests[i].size;
+        iov[i].iov_base = requests[i].data;
+        iov[i].iov_len = requests[i].size;
+        errors[i] = -1;
+    }
+
+    error = nl_sock_sendv(tc_sock, iov, n, true);
+    for (pending = n; !error && pending > 0;)
+    {
+        struct ofpbuf *reply;
+        uint32_t seq;
+
+        error = nl_sock_recv(tc_sock, &reply, true);
+        if (error)
+        {
+            break;
+        }
+        seq = nl_msg_nlmsghdr(reply)->nlmsg_seq;
+        for (i = 0; i < n; i++)
+        {
+            if (errors[i] < 0 && nl_msg_nlmsghdr(&requests[i])->nlmsg_seq == seq)
+            {
+                if (!nl_msg_nlmsgerr(reply, &errors[i]))
+                {
+                    errors[i] = 0;
+                }
+                pending--;
+                break;
+            }
+        }
+        ofpbuf_delete(reply);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        ofpbuf_uninit(&requests[i]);
+    }
+    return error;
+}
+
+/* Returns the transmission time of 'size' bytes at 'Bps' bytes per second, in
+ * scheduler ticks. */
+static uint32_t
+tc_bytes_to_ticks(uint64_t Bps, uint64_t size)
+{
+    double ticks;
+
+    if (!Bps)
+    {
+        return UINT32_MAX;
+    }
+    ticks = tc_ticks_per_s * size / Bps;
+    return ticks < UINT32_MAX ? (uint32_t)ticks : UINT32_MAX;
+}
+
+/* Fills 'rate' for 'Bps' bytes per second. A rate that does not fit in 32
+ * bits is saturated there, as tc does, and must also be sent in a 64-bit
+ * attribute. */
+static void
+tc_fill_rate(struct tc_ratespec *rate, uint64_t Bps, int mtu)
+{
+    int cell_log = 0;
+
+    mtu += ETH_HEADER_LEN + VLAN_HEADER_LEN;
+    while (mtu >= 256)
+    {
+        mtu >>= 1;
+        cell_log++;
+    }
+
+    memset(rate, 0, sizeof *rate);
+    rate->cell_log = cell_log;
+    rate->rate = Bps > UINT32_MAX ? UINT32_MAX : Bps;
+}
+
+/* Appends the rate table of 'rate': the transmission time of packets of each
+ * size cell. Newer kernels compute it themselves, older ones require it. */
+static void
+tc_put_rtab(struct ofpbuf *msg, uint16_t type, const struct tc_ratespec *rate)
+{
+    uint32_t *rtab;
+    size_t i;
+
+    rtab = nl_msg_put_unspec_uninit(msg, type, TC_RTAB_SIZE);
+    for (i = 0; i < TC_RTAB_SIZE / sizeof *rtab; i++)
+    {
+        rtab[i] = tc_bytes_to_ticks(rate->rate, (i + 1) << rate->cell_log);
+    }
+}
+
+/* Returns the buffer, in ticks, that lets a class send at 'Bps' across a
+ * kernel tick, plus a full frame. */
+static uint32_t
+tc_calc_buffer(uint64_t Bps, int mtu)
+{
+    return tc_bytes_to_ticks(Bps, Bps / tc_buffer_hz + mtu);
+}
+
+/* Appends to 'request' a tc message creating ('create') or changing the HTB
+ * class 'class_id' under 'parent', with a minimum rate of 'rate' in .1% of
+ * the link and a ceiling at the link speed. */
+static void
+tc_put_class(const struct netdev *netdev, uint16_t parent, uint16_t class_id,
+             uint16_t rate, bool create, struct ofpbuf *request)
+{
+    struct tcmsg *tcmsg;
+    struct tc_htb_opt opt;
+    struct ofpbuf options;
+    uint64_t rate_Bps, ceil_Bps;
+
+    tcmsg = tc_make_request(netdev, RTM_NEWTCLASS,
+                            create ? NLM_F_CREATE | NLM_F_EXCL : 0, request);
+    tcmsg->tcm_parent = TC_H_MAKE(TC_QDISC << 16, parent);
+    tcmsg->tcm_handle = TC_H_MAKE(TC_QDISC << 16, class_id);
+
+    /* .1% of the link speed, which is in Mbps, gives kbps. Fast links
+     * overflow 32 bits in bytes per second. */
+    rate_Bps = (uint64_t)rate * netdev->speed * 1000 / 8;
+    ceil_Bps = (uint64_t)netdev->speed * 1000 * 1000 / 8;
+
+    memset(&opt, 0, sizeof opt);
+    tc_fill_rate(&opt.rate, rate_Bps, netdev->mtu);
+    tc_fill_rate(&opt.ceil, ceil_Bps, netdev->mtu);
+    opt.buffer = tc_calc_buffer(rate_Bps, netdev->mtu);
+    opt.cbuffer = tc_calc_buffer(ceil_Bps, netdev->mtu);
+
+    /* nl_msg_put_nested() wants a whole message, but TCA_OPTIONS holds bare
+     * attributes. */
+    nl_msg_put_string(request, TCA_KIND, "htb");
+    ofpbuf_init(&options, sizeof opt + 2 * TC_RTAB_SIZE + 64);
+    nl_msg_put_unspec(&options, TCA_HTB_PARMS, &opt, sizeof opt);
+    if (rate_Bps > UINT32_MAX)
+    {
+        nl_msg_put_u64(&options, TCA_HTB_RATE64, rate_Bps);
+    }
+    if (ceil_Bps > UINT32_MAX)
+    {
+        nl_msg_put_u64(&options, TCA_HTB_CEIL64, ceil_Bps);
+    }
+    tc_put_rtab(&options, TCA_HTB_RTAB, &opt.rate);
+    tc_put_rtab(&options, TCA_HTB_CTAB, &opt.ceil);
+    nl_msg_put_unspec(request, TCA_OPTIONS, options.data, options.size);
+    ofpbuf_uninit(&options);
+}
+
+/* Sends the single 'request', logging 'what' if it fails. */
+static int
+tc_transact_one(struct ofpbuf *request, const struct netdev *netdev,
+                const char *what, uint16_t class_id)
+{
+    int error, result;
+
+    error = tc_transact(request, &result, 1);
+    if (!error)
+    {
+        error = result;
+    }
+    if (error)
+    {
+        VLOG_ERR(LOG_MODULE, "Problem %s class %d for device %s: %s",
+                 what, class_id, netdev->name, strerror(error));
+    }
+    return error;
+}
+
 /** Defines a class for the specific queue discipline. A class
  * represents an OpenFlow queue.
  *
@@ -273,30 +527,28 @@ netdev_setup_root_class(const struct netdev *netdev, uint16_t class_id,
  * @param class_id unique identifier for this queue. TC limits this to 16-bits,
  * so we need to keep an internal mapping between class_id and OpenFlow
  * queue_id
- * @param rate the minimum rate for this queue in kbps
- * @return 0 on success, non-zero value when the configuration was not
+ * @param rate the minimum rate for this queue in .1% of the link speed
+ * @return 0 on success, a positive errno value when the configuration was not
  * successful.
  */
 int netdev_setup_class(const struct netdev *netdev, uint16_t class_id,
                        uint16_t rate)
 {
-    char command[1024];
-    int actual_rate;
-
-    /* we need to translate from .1% to kbps */
-    actual_rate = rate * netdev->speed;
+    struct ofpbuf request;
+    int error;
 
-    snprintf(command, sizeof(command), COMMAND_ADD_CLASS, netdev->name,
-             TC_QDISC, TC_ROOT_CLASS, TC_QDISC, class_id, actual_rate,
-             netdev->speed * 1000);
-    if (system(command) != 0)
+    if (netdev->dev_class)
+    {
+        return EOPNOTSUPP;
+    }
+    error = tc_init();
+    if (error)
     {
-        VLOG_ERR(LOG_MODULE, "Problem configuring class %d for device %s", class_id,
-                 netdev->name);
-        return -1;
+        return error;
     }
 
-    return 0;
+    tc_put_class(netdev, TC_ROOT_CLASS, class_id, rate, true, &request);
+    return tc_transact_one(&request, netdev, "configuring", class_id);
 }
 
 /** Changes a class already defined.
@@ -305,53 +557,56 @@ int netdev_setup_class(const struct netdev *netdev, uint16_t class_id,
  * @param class_id unique identifier for this queue. TC limits this to 16-bits,
  * so we need to keep an internal mapping between class_id and OpenFlow
  * queue_id
- * @param rate the minimum rate for this queue in kbps
- * @return 0 on success, non-zero value when the configuration was not
+ * @param rate the minimum rate for this queue in .1% of the link speed
+ * @return 0 on success, a positive errno value when the configuration was not
  * successful.
  */
 int netdev_change_class(const struct netdev *netdev, uint16_t class_id, uint16_t rate)
 {
-    char command[1024];
-    int actual_rate;
-
-    /* we need to translate from .1% to kbps */
-    actual_rate = rate * netdev->speed;
+    struct ofpbuf request;
+    int error;
 
-    snprintf(command, sizeof(command), COMMAND_CHANGE_CLASS, netdev->name,
-             TC_QDISC, TC_ROOT_CLASS, TC_QDISC, class_id, actual_rate,
-             netdev->speed * 1000);
-    if (system(command) != 0)
+    if (netdev->dev_class)
+    {
+        return EOPNOTSUPP;
+    }
+    error = tc_init();
+    if (error)
     {
-        VLOG_ERR(LOG_MODULE, "Problem configuring class %d for device %s",
-                 class_id, netdev->name);
-        return -1;
+        return error;
     }
 
-    return 0;
+    tc_put_class(netdev, TC_ROOT_CLASS, class_id, rate, false, &request);
+    return tc_transact_one(&request, netdev, "changing", class_id);
 }
 
 /** Deletes a class already defined to represent an OpenFlow queue.
  *
  * @param netdev the device under configuration
  * @param class_id unique identifier for this queue.
- * @param rate the minimum rate for this queue in kbps
- * @return 0 on success, non-zero value when the configuration was not
+ * @return 0 on success, a positive errno value when the configuration was not
  * successful.
  */
 int netdev_delete_class(const struct netdev *netdev, uint16_t class_id)
 {
-    char command[1024];
+    struct ofpbuf request;
+    struct tcmsg *tcmsg;
+    int error;
 
-    snprintf(command, sizeof(command), COMMAND_DEL_CLASS, netdev->name,
-             TC_QDISC, TC_ROOT_CLASS, TC_QDISC, class_id);
-    if (system(command) != 0)
+    if (netdev->dev_class)
     {
-        VLOG_ERR(LOG_MODULE, "Problem deleting class %d for device %s", class_id,
-                 netdev->name);
-        return -1;
+        return EOPNOTSUPP;
+    }
+    error = tc_init();
+    if (error)
+    {
+        return error;
     }
 
-    return 0;
+    tcmsg = tc_make_request(netdev, RTM_DELTCLASS, 0, &request);
+    tcmsg->tcm_parent = TC_H_MAKE(TC_QDISC << 16, TC_ROOT_CLASS);
+    tcmsg->tcm_handle = TC_H_MAKE(TC_QDISC << 16, class_id);
+    return tc_transact_one(&request, netdev, "deleting", class_id);
 }
 
 static int
@@ -430,46 +685,44 @@ error_already_set:
  * http://luxik.cdi.cz/~devik/qos/htb/
  * http://luxik.cdi.cz/~devik/qos/htb/manual/userg.htm
  *
- * @param netdev_name the device to be configured
- * @return 0 on success, non-zero value when the configuration was not
- * successful.
+ * @param netdev the device to be configured
+ * @param request where the request is stored
  */
-static int
-do_setup_qdisc(const char *netdev_name)
+static void
+put_setup_qdisc(const struct netdev *netdev, struct ofpbuf *request)
 {
-    char command[1024];
-    int error;
-
-    snprintf(command, sizeof(command), COMMAND_ADD_DEV_QDISC, netdev_name,
-             TC_QDISC, TC_DEFAULT_CLASS);
-    error = system(command);
-    if (error)
-    {
-        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s", netdev_name);
-        fprintf(stderr, "Error is %d\n", error);
-        return error;
-    }
-    return 0;
+    struct tc_htb_glob glob;
+    struct ofpbuf options;
+    struct tcmsg *tcmsg;
+
+    tcmsg = tc_make_request(netdev, RTM_NEWQDISC, NLM_F_CREATE | NLM_F_EXCL,
+                            request);
+    tcmsg->tcm_parent = TC_H_ROOT;
+    tcmsg->tcm_handle = TC_H_MAKE(TC_QDISC << 16, 0);
+
+    memset(&glob, 0, sizeof glob);
+    glob.version = 3;
+    glob.rate2quantum = 10;
+    glob.defcls = TC_DEFAULT_CLASS;
+
+    nl_msg_put_string(request, TCA_KIND, "htb");
+    ofpbuf_init(&options, sizeof glob + 16);
+    nl_msg_put_unspec(&options, TCA_HTB_INIT, &glob, sizeof glob);
+    nl_msg_put_unspec(request, TCA_OPTIONS, options.data, options.size);
+    ofpbuf_uninit(&options);
 }
 
 /** Remove current queue disciplines from a net device
- * @param netdev_name the device under configuration
+ * @param netdev the device under configuration
+ * @param request where the request is stored
  */
-static int
-do_remove_qdisc(const char *netdev_name)
+static void
+put_remove_qdisc(const struct netdev *netdev, struct ofpbuf *request)
 {
-    char command[1024];
-    int error;
-    snprintf(command, sizeof(command), COMMAND_DEL_DEV_QDISC, netdev_name);
-    error = system(command);
-    if (error && error != TC_QDISC_NO_CONFIG_ERR)
-    {
-        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s ", netdev_name);
-        return error;
-    }
-    /* There is no need for a device to already be configured. Therefore no
-     * need to indicate any error */
-    return 0;
+    struct tcmsg *tcmsg;
+
+    tcmsg = tc_make_request(netdev, RTM_DELQDISC, 0, request);
+    tcmsg->tcm_parent = TC_H_ROOT;
 }
 
 /** Configures a port to support slicing
@@ -478,42 +731,70 @@ do_remove_qdisc(const char *netdev_name)
  */
 int netdev_setup_slicing(struct netdev *netdev, uint16_t num_queues)
 {
+    struct ofpbuf requests[TC_MAX_BATCH];
+    int errors[TC_MAX_BATCH];
     int i;
     int *fd;
     int error;
 
+    if (netdev->dev_class)
+    {
+        /* Frames go out as they are sent; there are no queues to set up. */
+        return 0;
+    }
+
     netdev->num_queues = num_queues;
 
-    /* remove any previous queue configuration for this device */
-    error = do_remove_qdisc(netdev->name);
+    error = tc_init();
     if (error)
     {
         return error;
     }
 
-    /* Configure tc queue discipline to allow slicing queues */
-    error = do_setup_qdisc(netdev->name);
+    /* All of the configuration goes to the kernel in one batch:
+     *
+     * - remove any previous queue configuration for this device;
+     *
+     * - configure tc queue discipline to allow slicing queues;
+     *
+     * - define a root class for the queue disc. In order to allow spare
+     *   bandwidth to be used efficiently, we need all the classes under a
+     *   root class. For details, refer to :
+     *   http://luxik.cdi.cz/~devik/qos/htb/
+     *
+     * - configure a default class. This would be the best-effort, getting
+     *   everything that remains from the other queues.tc requires a min-rate
+     *   to configure a class, we put a min_rate here */
+    put_remove_qdisc(netdev, &requests[0]);
+    put_setup_qdisc(netdev, &requests[1]);
+    tc_put_class(netdev, 0, TC_ROOT_CLASS, 1000, true, &requests[2]);
+    tc_put_class(netdev, TC_ROOT_CLASS, TC_DEFAULT_CLASS, TC_MIN_RATE, true,
+                 &requests[3]);
+    error = tc_transact(requests, errors, 4);
     if (error)
     {
+        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s: %s",
+                  netdev->name, strerror(error));
         return error;
     }
 
-    /* This define a root class for the queue disc. In order to allow spare
-     * bandwidth to be used efficiently, we need all the classes under a root
-     * class. For details, refer to :
-     * http://luxik.cdi.cz/~devik/qos/htb/ */
-    error = netdev_setup_root_class(netdev, TC_ROOT_CLASS, 1000);
-    if (error)
+    /* There is no need for a device to already be configured. Therefore no
+     * need to indicate any error */
+    if (errors[0] && errors[0] != ENOENT && errors[0] != EINVAL)
     {
-        return error;
+        VLOG_WARN(LOG_MODULE, "Problem removing qdisc for device %s: %s",
+                  netdev->name, strerror(errors[0]));
+        return errors[0];
     }
-    /* we configure a default class. This would be the best-effort, getting
-     * everything that remains from the other queues.tc requires a min-rate
-     * to configure a class, we put a min_rate here */
-    error = netdev_setup_class(netdev, TC_DEFAULT_CLASS, 1);
-    if (error)
+    for (i = 1; i < 4; i++)
     {
-        return error;
+        if (errors[i])
+        {
+            VLOG_WARN(LOG_MODULE, "Problem configuring %s for device %s: %s",
+                      i == 1 ? "qdisc" : i == 2 ? "root class" : "default class",
+                      netdev->name, strerror(errors[i]));
+            return errors[i];
+        }
     }
 
     /* the tc backend has been configured. Now, we need to create sockets that
@@ -713,6 +994,19 @@ do_ethtool(struct netdev *netdev)
  * categories. */
 int netdev_open(const char *name, int ethertype, struct netdev **netdevp)
 {
+    size_t i;
+
+    for (i = 0; i < n_netdev_classes; i++)
+    {
+        const struct netdev_class *class = netdev_classes[i];
+        size_t len = strlen(class->prefix);
+
+        if (!strncmp(name, class->prefix, len) && name[len] == ':')
+        {
+            return do_open_class_netdev(class, name, netdevp);
+        }
+    }
+
     if (!strncmp(name, "tap:", 4))
     {
         return netdev_open_tap(name + 4, netdevp);
@@ -723,6 +1017,44 @@ int netdev_open(const char *name, int ethertype, struct netdev **netdevp)
     }
 }
 
+/* Registers 'class', so that netdev_open() opens the devices named after its
+ * prefix through it. */
+void netdev_register_class(const struct netdev_class *class)
+{
+    assert(n_netdev_classes < MAX_NETDEV_CLASSES);
+    netdev_classes[n_netdev_classes++] = class;
+}
+
+static int
+do_open_class_netdev(const struct netdev_class *class, const char *name,
+                     struct netdev **netdevp)
+{
+    struct netdev *netdev = xcalloc(1, sizeof *netdev);
+    int error;
+
+    *netdevp = NULL;
+    error = class->open(name + strlen(class->prefix) + 1, netdev->etheraddr,
+                        &netdev->aux);
+    if (error)
+    {
+        free(netdev);
+        return error;
+    }
+
+    netdev->name = xstrdup(name);
+    netdev->netdev_fd = netdev->tap_fd = netdev->netlink_fd = -1;
+    netdev->queue_fd[0] = -1;
+    netdev->ifindex = -1;
+    netdev->mtu = ETH_PAYLOAD_MAX;
+    netdev->speed = 1000;
+    netdev->curr = netdev->advertised = netdev->supported = OFPPF_1GB_FD | OFPPF_COPPER;
+    netdev->dev_class = class;
+    netdev->dev_flags = NETDEV_UP;
+
+    *netdevp = netdev;
+    return 0;
+}
+
 /* Opens a TAP virtual network device.  If 'name' is a nonnull, non-empty
  * string, attempts to assign that name to the TAP device (failing if the name
  * is already in use); otherwise, a name is automatically assigned.  Returns
@@ -964,7 +1296,13 @@ void netdev_close(struct netdev *netdev)
 {
     int i;
 
-    if (netdev)
+    if (netdev && netdev->dev_class)
+    {
+        netdev->dev_class->close(netdev->aux);
+        free(netdev->name);
+        free(netdev);
+    }
+    else if (netdev)
     {
         /* Bring down interface and drop promiscuous mode, if we brought up
          * the interface or enabled promiscuous mode. */
@@ -1013,6 +1351,10 @@ int netdev_link_state(struct netdev *netdev)
     struct nlmsghdr *nlm;
     struct ifinfomsg *ifa;
     enum netdev_flags flags;
+    if (netdev->dev_class)
+    {
+        return NETDEV_LINK_NO_CHANGE;
+    }
     nlm = (struct nlmsghdr *)buff;
     do
     {
@@ -1076,6 +1418,16 @@ int netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
     assert(buffer->size == 0);
     assert(ofpbuf_tailroom(buffer) >= ETH_TOTAL_MIN);
 
+    if (netdev->dev_class)
+    {
+        int error = netdev->dev_class->recv(netdev->aux, buffer);
+        if (!error)
+        {
+            pad_to_minimum_length(buffer);
+        }
+        return error;
+    }
+
 #ifdef HAVE_PACKET_AUXDATA
     /* Code from libpcap to reconstruct VLAN header */
     memset(&msg, 0, sizeof(struct msghdr));
@@ -1196,13 +1548,34 @@ int netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
  * when a packet is ready to be received with netdev_recv() on 'netdev'. */
 void netdev_recv_wait(struct netdev *netdev)
 {
+    if (netdev->dev_class)
+    {
+        netdev->dev_class->recv_wait(netdev->aux);
+        return;
+    }
     poll_fd_wait(netdev->tap_fd, POLLIN);
 }
 
+/* Registers with the poll loop to wake up from the next call to poll_block()
+ * when a link event is ready to be read with netdev_link_state() on
+ * 'netdev'. */
+void netdev_link_state_wait(struct netdev *netdev)
+{
+    if (netdev->dev_class || netdev->netlink_fd < 0)
+    {
+        return;
+    }
+    poll_fd_wait(netdev->netlink_fd, POLLIN);
+}
+
 /* Discards all packets waiting to be received from 'netdev'. */
 int netdev_drain(struct netdev *netdev)
 {
-    if (netdev->tap_fd != netdev->netdev_fd)
+    if (netdev->dev_class)
+    {
+        return 0;
+    }
+    else if (netdev->tap_fd != netdev->netdev_fd)
     {
         drain_fd(netdev->tap_fd, netdev->txqlen);
         return 0;
@@ -1233,6 +1606,11 @@ int netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
 
     assert(class_id <= NETDEV_MAX_QUEUES);
 
+    if (netdev->dev_class)
+    {
+        return netdev->dev_class->send(netdev->aux, buffer);
+    }
+
     do
     {
         n_bytes = write(netdev->queue_fd[class_id], buffer->data, buffer->size);
@@ -1275,7 +1653,11 @@ int netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
  * unlikely to ever be used.  It is included for completeness. */
 void netdev_send_wait(struct netdev *netdev)
 {
-    if (netdev->tap_fd == netdev->netdev_fd)
+    if (netdev->dev_class)
+    {
+        poll_immediate_wake();
+    }
+    else if (netdev->tap_fd == netdev->netdev_fd)
     {
         poll_fd_wait(netdev->tap_fd, POLLOUT);
     }
@@ -1292,6 +1674,12 @@ int netdev_set_etheraddr(struct netdev *netdev, const uint8_t mac[ETH_ADDR_LEN])
 {
     struct ifreq ifr;
 
+    if (netdev->dev_class)
+    {
+        memcpy(netdev->etheraddr, mac, ETH_ADDR_LEN);
+        return 0;
+    }
+
     memset(&ifr, 0, sizeof ifr);
     strncpy(ifr.ifr_name, netdev->name, sizeof ifr.ifr_name);
     ifr.ifr_hwaddr.sa_family = netdev->hwaddr_family;
@@ -1330,12 +1718,22 @@ int netdev_get_mtu(const struct netdev *netdev)
     return netdev->mtu;
 }
 
+/* Returns the link speed of 'netdev' in Mbps, the one its queue classes are
+ * sized against. */
+int netdev_get_speed(const struct netdev *netdev)
+{
+    return netdev->speed;
+}
+
 /* Returns the features supported by 'netdev' of type 'type', as a bitmap
  * of bits from enum ofp_phy_features, in host byte order. */
 uint32_t
 netdev_get_features(struct netdev *netdev, int type)
 {
-    do_ethtool(netdev);
+    if (!netdev->dev_class)
+    {
+        do_ethtool(netdev);
+    }
     switch (type)
     {
     case NETDEV_FEAT_CURRENT:
@@ -1361,7 +1759,11 @@ bool netdev_get_in4(const struct netdev *netdev, struct in_addr *in4)
 
     strncpy(ifr.ifr_name, netdev->name, sizeof ifr.ifr_name);
     ifr.ifr_addr.sa_family = AF_INET;
-    if (ioctl(af_inet_sock, SIOCGIFADDR, &ifr) == 0)
+    if (netdev->dev_class)
+    {
+        /* Not a kernel interface: no address. */
+    }
+    else if (ioctl(af_inet_sock, SIOCGIFADDR, &ifr) == 0)
     {
         struct sockaddr_in *sin = (struct sockaddr_in *)&ifr.ifr_addr;
         ip = sin->sin_addr;
@@ -1415,6 +1817,10 @@ int netdev_set_in4(struct netdev *netdev, struct in_addr addr, struct in_addr ma
 {
     int error;
 
+    if (netdev->dev_class)
+    {
+        return EOPNOTSUPP;
+    }
     error = do_set_addr(netdev, af_inet_sock,
                         SIOCSIFADDR, "SIOCSIFADDR", addr);
     if (!error && addr.s_addr != INADDR_ANY)
@@ -1460,6 +1866,11 @@ bool netdev_get_in6(const struct netdev *netdev, struct in6_addr *in6)
  * Returns 0 if successful, otherwise a positive errno value. */
 int netdev_get_flags(const struct netdev *netdev, enum netdev_flags *flagsp)
 {
+    if (netdev->dev_class)
+    {
+        *flagsp = netdev->dev_flags | NETDEV_CARRIER;
+        return 0;
+    }
     return netdev_nodev_get_flags(netdev->name, flagsp);
 }
 
@@ -1489,6 +1900,12 @@ do_update_flags(struct netdev *netdev, enum netdev_flags off,
     int old_flags, new_flags;
     int error;
 
+    if (netdev->dev_class)
+    {
+        netdev->dev_flags = (netdev->dev_flags & ~off) | on;
+        return 0;
+    }
+
     error = get_flags(netdev->name, &old_flags);
     if (error)
     {
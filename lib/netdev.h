@@ -82,6 +82,30 @@ enum netdev_link_state
 
 struct netdev;
 
+/* A kind of network device that is not a kernel interface, such as an
+ * in-memory link.  Its devices are opened as "<prefix>:<name>" and only move
+ * frames: they have no IP addresses, kernel flags or queues. */
+struct netdev_class
+{
+    const char *prefix;
+
+    /* Opens the device 'name', given without the prefix.  On success returns
+     * 0, stores the private data of the device in '*aux' and its Ethernet
+     * address in 'etheraddr'; otherwise returns a positive errno value. */
+    int (*open)(const char *name, uint8_t etheraddr[6], void **aux);
+    void (*close)(void *aux);
+
+    /* Appends the next received frame to 'buffer' and returns 0, or returns
+     * EAGAIN if there is none. */
+    int (*recv)(void *aux, struct ofpbuf *buffer);
+    void (*recv_wait)(void *aux);
+
+    /* Sends the frame in 'buffer', which the caller keeps. */
+    int (*send)(void *aux, const struct ofpbuf *buffer);
+};
+
+void netdev_register_class(const struct netdev_class *);
+
 int netdev_open(const char *name, int ethertype, struct netdev **);
 int netdev_open_tap(const char *name, struct netdev **);
 void netdev_close(struct netdev *);
@@ -89,6 +113,7 @@ void netdev_close(struct netdev *);
 int netdev_recv(struct netdev *, struct ofpbuf *, size_t);
 void netdev_recv_wait(struct netdev *);
 int netdev_link_state(struct netdev *netdev);
+void netdev_link_state_wait(struct netdev *);
 int netdev_drain(struct netdev *);
 int netdev_send(struct netdev *, const struct ofpbuf *, uint16_t class_id);
 void netdev_send_wait(struct netdev *);
@@ -96,6 +121,7 @@ int netdev_set_etheraddr(struct netdev *, const uint8_t mac[6]);
 const uint8_t *netdev_get_etheraddr(const struct netdev *);
 const char *netdev_get_name(const struct netdev *);
 int netdev_get_mtu(const struct netdev *);
+int netdev_get_speed(const struct netdev *);
 uint32_t netdev_get_features(struct netdev *, int);
 bool netdev_get_in4(const struct netdev *, struct in_addr *);
 int netdev_set_in4(struct netdev *, struct in_addr addr, struct in_addr mask);
@@ -54,6 +54,7 @@ ofpbuf_use(struct ofpbuf *b, void *base, size_t allocated)
     b->l2 = b->l3 = b->l4 = b->l7 = NULL;
     b->next = NULL;
     b->private_p = NULL;
+    b->refcnt = NULL;
 }
 
 /* Initializes 'b' as an empty ofpbuf with an initial capacity of 'size'
@@ -64,11 +65,18 @@ ofpbuf_init(struct ofpbuf *b, size_t size)
     ofpbuf_use(b, size ? xmalloc(size) : NULL, size);
 }
 
-/* Frees memory that 'b' points to. */
+/* Frees memory that 'b' points to, unless it is still shared with other
+ * ofpbufs. */
 void
 ofpbuf_uninit(struct ofpbuf *b)
 {
     if (b) {
+        if (b->refcnt) {
+            if (--*b->refcnt > 0) {
+                return;
+            }
+            free(b->refcnt);
+        }
         free(b->base);
     }
 }
@@ -125,6 +133,30 @@ ofpbuf_clone_data(const void *data, size_t size)
     return b;
 }
 
+/* Creates and returns a new ofpbuf that refers to the same data as 'b',
+ * without copying them.  The data are freed when the last ofpbuf that refers
+ * to them is deleted.
+ *
+ * Afterwards, neither 'b' nor the returned ofpbuf may be used to modify the
+ * data or to make them grow, since that would affect, or reallocate, the
+ * data of every ofpbuf that shares them.  Pulling data off the front, as done
+ * when a message is only partially sent, is fine. */
+struct ofpbuf *
+ofpbuf_share(struct ofpbuf *b)
+{
+    struct ofpbuf *share = xmalloc(sizeof *share);
+
+    if (!b->refcnt) {
+        b->refcnt = xmalloc(sizeof *b->refcnt);
+        *b->refcnt = 1;
+    }
+    *share = *b;
+    share->next = NULL;
+    share->private_p = NULL;
+    ++*b->refcnt;
+    return share;
+}
+
 /* Frees memory that 'b' points to, as well as 'b' itself. */
 void
 ofpbuf_delete(struct ofpbuf *b) 
@@ -407,6 +407,10 @@ BUILD_ASSERT_DECL(MPLS_HEADER_LEN == sizeof(struct mpls_header));
 #define LEN_EHDDP_PORT_PKT 47 //  (Ethernet(14) + Nuevo puerto(4) + Tamaño nombre(1) + Nombre puerto(8) + IP (16) + Antiguo puerto(4) = 47 )
 /*Fin modificacion UAH*/
 
+/* Fixed part of the eHDDP header. It is followed by 'num_devices' device
+ * elements: a configuration byte, then the device type, the device ID, the
+ * input port and the output port, in network byte order and each as wide as
+ * the configuration byte says. */
 struct ehddp_header{
     uint8_t flags;
     uint8_t opcode;
@@ -418,16 +422,43 @@ struct ehddp_header{
     uint8_t last_mac[ETH_ADDR_LEN];
     uint8_t src_mac[ETH_ADDR_LEN];
     uint32_t time_block;
-    uint8_t configurations[EHDDP_MAX_ELEMENTS];
-    uint16_t type_devices[EHDDP_MAX_ELEMENTS];
-    uint64_t ids[EHDDP_MAX_ELEMENTS];
-    uint32_t in_ports[EHDDP_MAX_ELEMENTS];
-    uint32_t out_ports[EHDDP_MAX_ELEMENTS];
 }__attribute__((packed));
 
-BUILD_ASSERT_DECL(((4*sizeof(uint8_t)) + (2*sizeof(uint64_t)) + sizeof(uint32_t) + 3 * ETH_ADDR_LEN * sizeof(u_int8_t) +
-     (sizeof(uint8_t)*EHDDP_MAX_ELEMENTS) + (sizeof(uint16_t)*EHDDP_MAX_ELEMENTS) + (sizeof(uint64_t)*EHDDP_MAX_ELEMENTS) + 
-     (2*sizeof(uint32_t)*EHDDP_MAX_ELEMENTS)) == (sizeof(struct ehddp_header))); 
+BUILD_ASSERT_DECL(((4*sizeof(uint8_t)) + (2*sizeof(uint64_t)) + sizeof(uint32_t) + 3 * ETH_ADDR_LEN * sizeof(u_int8_t))
+     == (sizeof(struct ehddp_header)));
+
+/* Widths, in bytes, that the configuration byte of a device element gives to
+ * its fields. Bit 0 flags a bidirectional link. */
+#define EHDDP_CONF_TYPE_LEN(CONF) ((((CONF) >> 6) & 0x03) + 1)
+#define EHDDP_CONF_ID_LEN(CONF)   ((((CONF) >> 3) & 0x07) + 1)
+#define EHDDP_CONF_PORT_LEN(CONF) ((((CONF) >> 1) & 0x03) + 1)
+#define EHDDP_CONF_BIDIRECTIONAL  0x01
+#define EHDDP_CONF_ELEMENT_LEN(CONF) \
+    (1 + EHDDP_CONF_TYPE_LEN(CONF) + EHDDP_CONF_ID_LEN(CONF) + 2 * EHDDP_CONF_PORT_LEN(CONF))
+
+/* Largest device element: 2-byte type, 8-byte ID and 4-byte ports. */
+#define EHDDP_ELEMENT_MAX_LEN (1 + 2 + 8 + 4 + 4)
+
+/* Room for the device list of a frame; what EHDDP_MAX_ELEMENTS elements took
+ * before the fields could be narrowed. The controller reads 'num_devices' as
+ * a signed byte, which bounds the number of devices too. */
+#define EHDDP_MAX_ELEMENTS_LEN (EHDDP_MAX_ELEMENTS * EHDDP_ELEMENT_MAX_LEN)
+#define EHDDP_MAX_DEVICES 127
+
+/* The first byte of the header carries the version in its low nibble and the
+ * flags in its high nibble. A reply flagged EHDDP_FLAG_MORE was full when a
+ * switch had to add itself, and its path goes on in a continuation reply with
+ * the same sequence number that repeats its last device. */
+#define EHDDP_FLAG_MORE 0x10
+
+/* A device element, in host byte order. */
+struct ehddp_element {
+    uint8_t  configuration;
+    uint16_t type_device;
+    uint64_t id;
+    uint32_t in_port;
+    uint32_t out_port;
+};
 
 #define LEN_EHDDP_OFP_PORT_PKT 32
 
@@ -75,7 +75,7 @@ pcap_open(const char *file_name, const char *mode)
     }
 
     if (mode[0] == 'r') {
-        if (!pcap_read_header(file)) {
+        if (pcap_read_header(file)) {
             fclose(file);
             return NULL;
         }
@@ -119,8 +119,25 @@ pcap_write_header(FILE *file)
     fwrite(&ph, sizeof ph, 1, file);
 }
 
+static uint32_t
+swap32(uint32_t x)
+{
+    return (((x & 0xff000000) >> 24) |
+            ((x & 0x00ff0000) >>  8) |
+            ((x & 0x0000ff00) <<  8) |
+            ((x & 0x000000ff) << 24));
+}
+
 int
 pcap_read(FILE *file, struct ofpbuf **bufp)
+{
+    return pcap_read_stamped(file, bufp, NULL);
+}
+
+/* Like pcap_read(), and also stores the timestamp of the packet, in
+ * microseconds, into '*usecp' if 'usecp' is nonnull. */
+int
+pcap_read_stamped(FILE *file, struct ofpbuf **bufp, long long int *usecp)
 {
     struct pcaprec_hdr prh;
     struct ofpbuf *buf;
@@ -140,10 +157,7 @@ pcap_read(FILE *file, struct ofpbuf **bufp)
     /* Calculate length. */
     len = prh.incl_len;
     if (len > 0xffff) {
-        uint32_t swapped_len = (((len & 0xff000000) >> 24) |
-                                ((len & 0x00ff0000) >>  8) |
-                                ((len & 0x0000ff00) <<  8) |
-                                ((len & 0x000000ff) << 24));
+        uint32_t swapped_len = swap32(len);
         if (swapped_len > 0xffff) {
             VLOG_WARN(LOG_MODULE, "bad packet length %zu or %"PRIu32" "
                       "reading pcap file",
@@ -151,6 +165,11 @@ pcap_read(FILE *file, struct ofpbuf **bufp)
             return EPROTO;
         }
         len = swapped_len;
+        prh.ts_sec = swap32(prh.ts_sec);
+        prh.ts_usec = swap32(prh.ts_usec);
+    }
+    if (usecp) {
+        *usecp = prh.ts_sec * 1000000LL + prh.ts_usec;
     }
 
     /* Read packet. */
@@ -168,11 +187,18 @@ pcap_read(FILE *file, struct ofpbuf **bufp)
 }
 
 void
-pcap_write(FILE *file, struct ofpbuf *buf)
+pcap_write(FILE *file, const struct ofpbuf *buf)
+{
+    pcap_write_stamped(file, buf, 0);
+}
+
+/* Like pcap_write(), with a timestamp of 'usec' microseconds. */
+void
+pcap_write_stamped(FILE *file, const struct ofpbuf *buf, long long int usec)
 {
     struct pcaprec_hdr prh;
-    prh.ts_sec = 0;
-    prh.ts_usec = 0;
+    prh.ts_sec = usec / 1000000;
+    prh.ts_usec = usec % 1000000;
     prh.incl_len = buf->size;
     prh.orig_len = buf->size;
     fwrite(&prh, sizeof prh, 1, file);
@@ -42,6 +42,8 @@ FILE *pcap_open(const char *file_name, const char *mode);
 int pcap_read_header(FILE *);
 void pcap_write_header(FILE *);
 int pcap_read(FILE *, struct ofpbuf **);
-void pcap_write(FILE *, struct ofpbuf *);
+int pcap_read_stamped(FILE *, struct ofpbuf **, long long int *usecp);
+void pcap_write(FILE *, const struct ofpbuf *);
+void pcap_write_stamped(FILE *, const struct ofpbuf *, long long int usec);
 
 #endif /* dhcp.h */
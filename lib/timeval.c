@@ -54,6 +54,9 @@ static struct timeval now;
 /* Time at which to die with SIGALRM (if not TIME_MIN). */
 static time_t deadline = TIME_MIN;
 
+/* Is the current time set by time_set_virtual() instead of the kernel? */
+static bool virtual_clock;
+
 static void sigalrm_handler(int);
 static void refresh_if_ticked(void);
 static time_t time_add(time_t, time_t);
@@ -99,7 +102,22 @@ time_init(void)
 void
 time_refresh(void)
 {
-    gettimeofday(&now, NULL);
+    if (!virtual_clock) {
+        gettimeofday(&now, NULL);
+    }
+    tick = false;
+}
+
+/* Stops following the kernel clock and sets the current time to 'msec'.  From
+ * then on the time only changes through further calls, which lets a simulation
+ * run many datapaths in one process against a clock of its own. */
+void
+time_set_virtual(long long int msec)
+{
+    time_init();
+    virtual_clock = true;
+    now.tv_sec = msec / 1000;
+    now.tv_usec = msec % 1000 * 1000;
     tick = false;
 }
 
@@ -230,6 +248,9 @@ unblock_sigalrm(const sigset_t *oldsigs)
 
 long long int current_timestamp(void) {
     struct timeval te; 
+    if (virtual_clock) {
+        return time_msec();
+    }
     gettimeofday(&te, NULL); // get current time
     return ((long long int) (te.tv_sec*1000LL + te.tv_usec/1000)); // calculate milliseconds
 }
@@ -63,5 +63,6 @@ long long int time_msec(void);
 void time_alarm(unsigned int secs);
 int time_poll(struct pollfd *, int n_pollfds, int timeout);
 long long int current_timestamp(void);
+void time_set_virtual(long long int msec);
 
 #endif /* timeval.h */
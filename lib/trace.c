@@ -0,0 +1,276 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "trace.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dynamic-string.h"
+#include "packets.h"
+#include "timeval.h"
+#include "util.h"
+
+/* Number of records kept per thread.  Must be a power of 2. */
+#define TRACE_RING_SIZE 4096
+
+#define TRACE_MAGIC "OFTRACE"
+#define TRACE_VERSION 1
+
+/* Per-thread ring of records. */
+struct trace_ring {
+    struct trace_ring *next;    /* Next in 'all_rings'. */
+    unsigned int id;            /* Identifies the ring in dumps. */
+    uint32_t head;              /* Number of records ever put. */
+    struct trace_record records[TRACE_RING_SIZE];
+};
+
+/* Header of a dump file, followed by each ring. */
+struct trace_file_header {
+    char magic[8];              /* TRACE_MAGIC. */
+    uint32_t version;           /* TRACE_VERSION. */
+    uint32_t n_events;          /* N_TRACE_EVENTS of the writer. */
+};
+
+/* Header of a ring in a dump file, followed by its records, oldest first. */
+struct trace_ring_header {
+    uint32_t id;
+    uint32_t n_records;
+};
+
+struct trace_event_desc {
+    const char *name;
+    const char *fields;
+};
+
+static const struct trace_event_desc trace_events[N_TRACE_EVENTS] = {
+#define TRACE_EVENT(NAME, FIELDS) { #NAME, FIELDS },
+#include "trace-events.def"
+#undef TRACE_EVENT
+};
+
+bool trace_enabled = true;
+
+static __thread struct trace_ring *thread_ring;
+
+/* All rings ever created.  Rings are only ever added, at the head, and
+ * never freed, so readers may walk the list without locking. */
+static struct trace_ring *all_rings;
+static unsigned int n_rings;
+
+static struct trace_ring *
+trace_ring_create(void)
+{
+    struct trace_ring *ring = xcalloc(1, sizeof *ring);
+
+    ring->id = __sync_fetch_and_add(&n_rings, 1);
+    do {
+        ring->next = all_rings;
+    } while (!__sync_bool_compare_and_swap(&all_rings, ring->next, ring));
+    return ring;
+}
+
+/* Stores a record of 'event' with the given fields into the calling thread's
+ * ring.  Use TRACE() instead of calling this directly. */
+void
+trace_put(enum trace_event event, uint64_t f0, uint64_t f1, uint64_t f2,
+          uint64_t f3)
+{
+    struct trace_ring *ring = thread_ring;
+    struct trace_record *r;
+
+    if (!ring) {
+        ring = thread_ring = trace_ring_create();
+    }
+    r = &ring->records[ring->head & (TRACE_RING_SIZE - 1)];
+    r->time = time_msec();
+    r->seq = ring->head++;
+    r->event = event;
+    r->fields[0] = f0;
+    r->fields[1] = f1;
+    r->fields[2] = f2;
+    r->fields[3] = f3;
+}
+
+const char *
+trace_event_name(enum trace_event event)
+{
+    return event < N_TRACE_EVENTS ? trace_events[event].name : "UNKNOWN";
+}
+
+void
+trace_set_enabled(bool enabled)
+{
+    trace_enabled = enabled;
+}
+
+/* Writes the contents of all rings to 'file_name'.  Records that other
+ * threads put while the dump is in progress may come out torn.  Returns 0 if
+ * successful, otherwise a positive errno value. */
+int
+trace_dump(const char *file_name)
+{
+    struct trace_file_header fh;
+    struct trace_ring *ring;
+    FILE *file;
+    int error = 0;
+
+    file = fopen(file_name, "wb");
+    if (!file) {
+        return errno;
+    }
+
+    memset(&fh, 0, sizeof fh);
+    strncpy(fh.magic, TRACE_MAGIC, sizeof fh.magic);
+    fh.version = TRACE_VERSION;
+    fh.n_events = N_TRACE_EVENTS;
+    if (fwrite(&fh, sizeof fh, 1, file) != 1) {
+        error = errno;
+    }
+
+    for (ring = all_rings; ring && !error; ring = ring->next) {
+        uint32_t head = ring->head;
+        uint32_t n = MIN(head, TRACE_RING_SIZE);
+        uint32_t start = (head - n) & (TRACE_RING_SIZE - 1);
+        uint32_t n_tail = MIN(n, TRACE_RING_SIZE - start);
+        struct trace_ring_header rh;
+
+        rh.id = ring->id;
+        rh.n_records = n;
+        if (fwrite(&rh, sizeof rh, 1, file) != 1
+            || fwrite(&ring->records[start], sizeof *ring->records, n_tail,
+                      file) != n_tail
+            || fwrite(ring->records, sizeof *ring->records, n - n_tail,
+                      file) != n - n_tail) {
+            error = errno;
+        }
+    }
+
+    if (fclose(file) && !error) {
+        error = errno;
+    }
+    return error;
+}
+
+static void
+trace_format_record(struct ds *s, uint32_t ring_id,
+                    const struct trace_record *r)
+{
+    const char *p;
+    int i;
+
+    ds_put_format(s, "%"PRIu64" %"PRIu32".%"PRIu32" %s", r->time, ring_id,
+                  r->seq, trace_event_name(r->event));
+    if (r->event >= N_TRACE_EVENTS) {
+        ds_put_format(s, "(%"PRIu16")", r->event);
+        return;
+    }
+
+    p = trace_events[r->event].fields;
+    for (i = 0; i < TRACE_MAX_FIELDS && *p; i++) {
+        const char *colon = strchr(p, ':');
+        uint64_t v = r->fields[i];
+        uint8_t ea[ETH_ADDR_LEN];
+        uint32_t ip;
+
+        if (!colon) {
+            break;
+        }
+        ds_put_format(s, " %.*s=", (int) (colon - p), p);
+        switch (colon[1]) {
+        case 'd':
+            ds_put_format(s, "%"PRId64, (int64_t) v);
+            break;
+        case 'x':
+            ds_put_format(s, "%#"PRIx64, v);
+            break;
+        case 'e':
+            eth_addr_from_uint64(v, ea);
+            ds_put_format(s, ETH_ADDR_FMT, ETH_ADDR_ARGS(ea));
+            break;
+        case 'i':
+            ip = v;
+            ds_put_format(s, IP_FMT, IP_ARGS(&ip));
+            break;
+        default:
+            ds_put_format(s, "%"PRIu64, v);
+            break;
+        }
+        p = strchr(colon, ' ');
+        if (!p) {
+            break;
+        }
+        p++;
+    }
+}
+
+/* Reads a dump written by trace_dump() from 'in', and writes it as text to
+ * 'out', one record per line.  Returns 0 if successful, otherwise a positive
+ * errno value. */
+int
+trace_decode(FILE *in, FILE *out)
+{
+    struct trace_file_header fh;
+    struct trace_ring_header rh;
+    struct ds s;
+
+    if (fread(&fh, sizeof fh, 1, in) != 1
+        || strncmp(fh.magic, TRACE_MAGIC, sizeof fh.magic)
+        || fh.version != TRACE_VERSION) {
+        return EPROTO;
+    }
+    if (fh.n_events != N_TRACE_EVENTS) {
+        fprintf(stderr, "warning: trace was written with %"PRIu32" events, "
+                "but %d are known\n", fh.n_events, N_TRACE_EVENTS);
+    }
+
+    ds_init(&s);
+    while (fread(&rh, sizeof rh, 1, in) == 1) {
+        uint32_t i;
+
+        for (i = 0; i < rh.n_records; i++) {
+            struct trace_record r;
+
+            if (fread(&r, sizeof r, 1, in) != 1) {
+                ds_destroy(&s);
+                return EPROTO;
+            }
+            ds_clear(&s);
+            trace_format_record(&s, rh.id, &r);
+            fprintf(out, "%s\n", ds_cstr(&s));
+        }
+    }
+    ds_destroy(&s);
+    return 0;
+}
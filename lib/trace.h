@@ -0,0 +1,103 @@
+/* Copyright (c) 2008 The Board of Trustees of The Leland Stanford
+ * Junior University
+ * 
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H 1
+
+/* Binary trace ring.
+ *
+ * A cheap alternative to vlog for events on the per-packet path.  Recording
+ * an event stores a fixed-size binary record, with the event ID and up to
+ * TRACE_MAX_FIELDS integer fields, into a ring owned by the calling thread;
+ * the oldest records are overwritten, and nothing is formatted.  The rings
+ * can be dumped to a file at run time (see "vlogconf --trace-dump") and
+ * decoded later ("vlogconf --trace-decode"), so the cost of formatting is
+ * only paid by whoever reads the trace.
+ *
+ * Events are declared in trace-events.def with TRACE_EVENT(NAME, FIELDS),
+ * where FIELDS is a string of space-separated "name:type" items, and type is
+ * one of:
+ *
+ *      u   unsigned decimal
+ *      d   signed decimal
+ *      x   hexadecimal
+ *      e   Ethernet address, as returned by eth_addr_to_uint64()
+ *      i   IPv4 address, in network byte order
+ *
+ * An event is recorded with TRACE(NAME, field...), e.g.
+ *
+ *      TRACE(EHDDP_REPLY_FORWARD, pkt->in_port, out_port, type_device);
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum trace_event {
+#define TRACE_EVENT(NAME, FIELDS) TRACE_##NAME,
+#include "trace-events.def"
+#undef TRACE_EVENT
+    N_TRACE_EVENTS
+};
+
+#define TRACE_MAX_FIELDS 4
+
+struct trace_record {
+    uint64_t time;                      /* time_msec() at recording. */
+    uint32_t seq;                       /* Sequence number in the ring. */
+    uint16_t event;                     /* One of TRACE_*. */
+    uint16_t pad;
+    uint64_t fields[TRACE_MAX_FIELDS];
+};
+
+/* Records are only stored while this is true (the default). */
+extern bool trace_enabled;
+
+void trace_put(enum trace_event, uint64_t, uint64_t, uint64_t, uint64_t);
+
+#define TRACE(EVENT, ...) TRACE__(TRACE_##EVENT, ##__VA_ARGS__, 0, 0, 0, 0)
+#define TRACE__(EVENT, F0, F1, F2, F3, ...)                     \
+    do {                                                        \
+        if (trace_enabled) {                                    \
+            trace_put(EVENT, (uint64_t) (F0), (uint64_t) (F1),  \
+                      (uint64_t) (F2), (uint64_t) (F3));        \
+        }                                                       \
+    } while (0)
+
+const char *trace_event_name(enum trace_event);
+void trace_set_enabled(bool);
+
+int trace_dump(const char *file_name);
+int trace_decode(FILE *in, FILE *out);
+
+#endif /* trace.h */
@@ -49,6 +49,7 @@
 #include "poll-loop.h"
 #include "socket-util.h"
 #include "timeval.h"
+#include "trace.h"
 #include "util.h"
 
 #ifndef SCM_CREDENTIALS
@@ -265,6 +266,16 @@ poll_server(int fd UNUSED, short int events UNUSED, void *server_)
             reply = msg ? msg : xstrdup("ack");
         } else if (!strcmp(cmd_buf, "list")) {
             reply = vlog_get_levels();
+        } else if (!strncmp(cmd_buf, "trace-dump ", 11)) {
+            int error = trace_dump(cmd_buf + 11);
+            reply = (error
+                     ? xasprintf("could not dump trace to \"%s\": %s",
+                                 cmd_buf + 11, strerror(error))
+                     : xstrdup("ack"));
+        } else if (!strcmp(cmd_buf, "trace on")
+                   || !strcmp(cmd_buf, "trace off")) {
+            trace_set_enabled(!strcmp(cmd_buf, "trace on"));
+            reply = xstrdup("ack");
         } else if (!strcmp(cmd_buf, "reopen")) {
             int error = vlog_reopen_log_file();
             reply = (error
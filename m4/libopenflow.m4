@@ -101,6 +101,10 @@ AC_DEFUN([OFP_CHECK_SOCKET_LIBS],
   [AC_CHECK_LIB([socket], [connect])
    AC_SEARCH_LIBS([gethostbyname], [resolv], [RESOLVER_LIBS=-lresolv])])
 
+dnl Checks for libraries needed by lib/netdev-shm.c.
+AC_DEFUN([OFP_CHECK_SHM_LIBS],
+  [AC_SEARCH_LIBS([shm_open], [rt])])
+
 dnl Checks for the directory in which to store the PKI.
 AC_DEFUN([OFP_CHECK_PKIDIR],
   [AC_ARG_WITH(
@@ -160,6 +164,7 @@ AC_DEFUN([OFP_CHECK_LIBOPENFLOW],
    AC_REQUIRE([OFP_CHECK_OPENSSL])
    AC_REQUIRE([OFP_CHECK_FAULT_LIBS])
    AC_REQUIRE([OFP_CHECK_SOCKET_LIBS])
+   AC_REQUIRE([OFP_CHECK_SHM_LIBS])
    AC_REQUIRE([OFP_CHECK_PKIDIR])
    AC_REQUIRE([OFP_CHECK_RUNDIR])
    AC_REQUIRE([OFP_CHECK_LOGDIR])
@@ -324,19 +324,15 @@ int nblink_extract_proto_fields(struct ofpbuf * pktin, _nbPDMLField * field, str
             m_value =  ntohs(m_value);
             //ofl_structs_match_put8(pktout, header, m_value);
         }
-        else if(header==OXM_OF_EHDDP_TYPE_DEVICE)          
-        {
-            uint16_t m_value =  *((uint16_t*)((uint8_t*)pktin->data + field->Position));
-            m_value =  ntohs(m_value);
-            //ofl_structs_match_put16(pktout, header, m_value);
-        }
-        else if (header==OXM_OF_EHDDP_IN_PORTS || header==OXM_OF_EHDDP_OUT_PORTS ||header == OXM_OF_EHDDP_TIM_BLO)  
+        /* Los campos de cada dispositivo (tipo, id y puertos) tienen el ancho
+         * que indica su byte de configuracion, no el del OXM: no se leen aqui */
+        else if (header == OXM_OF_EHDDP_TIM_BLO)
         {
             uint32_t m_value =  *((uint32_t*)((uint8_t*)pktin->data + field->Position));
             m_value = htonl(m_value);
             //ofl_structs_match_put32(pktout, header, m_value);
         }
-        else if(header==OXM_OF_EHDDP_IDS || header == OXM_OF_EHDDP_NUM_SEC || header == OXM_OF_EHDDP_NUM_ACK)
+        else if(header == OXM_OF_EHDDP_NUM_SEC || header == OXM_OF_EHDDP_NUM_ACK)
         {
             uint64_t m_value =  *((uint64_t*)((uint8_t*)pktin->data + field->Position));
             m_value =  ntoh64(m_value);
@@ -414,8 +410,32 @@ int nblink_extract_proto_fields(struct ofpbuf * pktin, _nbPDMLField * field, str
     return 0;
 }
 
+/* Looks up the field called 'name' in 'proto' and stores it in 'pktout' as
+ * 'header', unless 'fields' is non-null and does not contain 'header'. */
+static void
+nblink_extract_named(struct ofpbuf * pktin, _nbPDMLProto * proto, const char * name,
+                     struct ofl_match * pktout, uint32_t header,
+                     const struct oxm_field_set * fields)
+{
+    _nbPDMLField * field = NULL;
+
+    if (fields != NULL && !oxm_field_set_contains(fields, header))
+        return;
+
+    PDMLReader->GetPDMLField(proto->Name, (char*) name, proto->FirstField, &field);
+    if (field != NULL)
+        nblink_extract_proto_fields(pktin, field, pktout, header);
+}
 
-extern "C" int nblink_packet_parse(struct ofpbuf * pktin,  struct ofl_match * pktout, struct protocols_std * pkt_proto)
+static inline bool
+nblink_wants(const struct oxm_field_set * fields, uint32_t header)
+{
+    return fields == NULL || oxm_field_set_contains(fields, header);
+}
+
+extern "C" int nblink_packet_parse(struct ofpbuf * pktin,  struct ofl_match * pktout,
+                                   struct protocols_std * pkt_proto,
+                                   const struct oxm_field_set * fields)
 {
     protocol_reset(pkt_proto);
     if (pktin == NULL)
@@ -445,228 +465,167 @@ extern "C" int nblink_packet_parse(struct ofpbuf * pktin,  struct ofl_match * pk
     _nbPDMLProto * proto;
     _nbPDMLField * field;
 
-    /*Moficiacion UAH*/
-    uint8_t num_devices = 0, iter = 0;
-    /*Fin modicacion UAH*/
-
     int destination_num = 0;
     proto = curr_packet->FirstProto;
-    bool proto_done = true;
-
 
+    /* The protocol pointers are always set, since the eHDDP and ARP handlers
+     * read the headers directly; only the match fields are filtered. */
     while (proto!= NULL)
     {
-        /* Getting first field of the protocol  */
-            field = proto->FirstField;
-            proto_done = false;
             string protocol_Name (proto->Name);
-            string field_Name (field->Name);
 
             /* Copying data from the packet */
             if (protocol_Name.compare("ethernet") == 0 && pkt_proto->eth == NULL)
             {
                 pkt_proto->eth = (struct eth_header *) ( (uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dst", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ETH_DST);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "src", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ETH_SRC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "type", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ETH_TYPE);
+                nblink_extract_named(pktin, proto, "dst", pktout, OXM_OF_ETH_DST, fields);
+                nblink_extract_named(pktin, proto, "src", pktout, OXM_OF_ETH_SRC, fields);
+                nblink_extract_named(pktin, proto, "type", pktout, OXM_OF_ETH_TYPE, fields);
 
             }           
             else if ((protocol_Name.compare("vlan") == 0))
             {
                 if(pkt_proto->vlan_last == NULL){
                     pkt_proto->vlan = pkt_proto->vlan_last = (struct vlan_header *) ((uint8_t*)  pktin->data + proto->Position);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "pri", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_VLAN_PCP);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "vlanid", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_VLAN_VID);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "type", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ETH_TYPE);
+                    nblink_extract_named(pktin, proto, "pri", pktout, OXM_OF_VLAN_PCP, fields);
+                    nblink_extract_named(pktin, proto, "vlanid", pktout, OXM_OF_VLAN_VID, fields);
+                    nblink_extract_named(pktin, proto, "type", pktout, OXM_OF_ETH_TYPE, fields);
                 }
                 else{
                     pkt_proto->vlan_last = (struct vlan_header *) ((uint8_t*)  pktin->data + proto->Position);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "type", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ETH_TYPE);
+                    nblink_extract_named(pktin, proto, "type", pktout, OXM_OF_ETH_TYPE, fields);
                 }
 
             }
             else if (protocol_Name.compare("mpls") == 0 && pkt_proto->mpls == NULL)
             {
                 pkt_proto->mpls = (struct mpls_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "label", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_MPLS_LABEL);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "cos", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_MPLS_TC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "bos", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_MPLS_BOS);
+                nblink_extract_named(pktin, proto, "label", pktout, OXM_OF_MPLS_LABEL, fields);
+                nblink_extract_named(pktin, proto, "cos", pktout, OXM_OF_MPLS_TC, fields);
+                nblink_extract_named(pktin, proto, "bos", pktout, OXM_OF_MPLS_BOS, fields);
             }
             else if (protocol_Name.compare("arp") == 0 && pkt_proto->arp == NULL)
             {
                 pkt_proto->arp = (struct arp_eth_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "op", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ARP_OP);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "sHwAddr", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ARP_SHA);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "sIPAddr", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ARP_SPA);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dHwAddr", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ARP_THA);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dIPAddr", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ARP_TPA);
+                nblink_extract_named(pktin, proto, "op", pktout, OXM_OF_ARP_OP, fields);
+                nblink_extract_named(pktin, proto, "sHwAddr", pktout, OXM_OF_ARP_SHA, fields);
+                nblink_extract_named(pktin, proto, "sIPAddr", pktout, OXM_OF_ARP_SPA, fields);
+                nblink_extract_named(pktin, proto, "dHwAddr", pktout, OXM_OF_ARP_THA, fields);
+                nblink_extract_named(pktin, proto, "dIPAddr", pktout, OXM_OF_ARP_TPA, fields);
 
             }
             else if (protocol_Name.compare("pbb") == 0 && pkt_proto->pbb == NULL)
             {
                 pkt_proto->pbb = (struct pbb_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "isid", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_PBB_ISID);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "type", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ETH_TYPE);
+                nblink_extract_named(pktin, proto, "isid", pktout, OXM_OF_PBB_ISID, fields);
+                nblink_extract_named(pktin, proto, "type", pktout, OXM_OF_ETH_TYPE, fields);
             }
             /*Modificacion UAH Discovery hybrid topologies, JAH-*/
             else if (protocol_Name.compare("EHDDP")==0 && pkt_proto->ehddp==NULL)
             {
+                /* The per-hop fields are read by the eHDDP handlers straight
+                 * from the header, so only the fixed part is looked up. */
                 pkt_proto->ehddp = (struct ehddp_header *) ((uint8_t*) pktin->data + proto->Position);
-                
-                PDMLReader->GetPDMLField(proto->Name, (char*) "flags", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_FLAGS);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "opcode", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_OPCODE);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "num_devices", proto->FirstField, &field);
-                /*salvamos el numero de devices*/
-                num_devices = (uint8_t) atoi(field->Value);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NUM_DEVICE);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "num_sec", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NUM_SEC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "previous_size_mac", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_PRE_MAC_SIZ);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "nxt_mac", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_PRE_MAC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "num_ack", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NUM_ACK);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "last_mac", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_LAS_MAC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "src_mac", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_SRC_MAC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "time_block", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_TIM_BLO);
-
-                for (iter = 0; iter < num_devices; iter++){
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "configurations", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_CONFIG);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "type_devices", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_TYPE_DEVICE);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "ids", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_IDS);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "in_ports", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_IN_PORTS);
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "out_ports", proto->FirstField, &field);
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_OUT_PORTS);
-                }
+                nblink_extract_named(pktin, proto, "flags", pktout, OXM_OF_EHDDP_FLAGS, fields);
+                nblink_extract_named(pktin, proto, "opcode", pktout, OXM_OF_EHDDP_OPCODE, fields);
+                nblink_extract_named(pktin, proto, "num_devices", pktout, OXM_OF_EHDDP_NUM_DEVICE, fields);
+                nblink_extract_named(pktin, proto, "num_sec", pktout, OXM_OF_EHDDP_NUM_SEC, fields);
+                nblink_extract_named(pktin, proto, "previous_size_mac", pktout, OXM_OF_EHDDP_PRE_MAC_SIZ, fields);
+                nblink_extract_named(pktin, proto, "nxt_mac", pktout, OXM_OF_EHDDP_PRE_MAC, fields);
+                nblink_extract_named(pktin, proto, "num_ack", pktout, OXM_OF_EHDDP_NUM_ACK, fields);
+                nblink_extract_named(pktin, proto, "last_mac", pktout, OXM_OF_EHDDP_LAS_MAC, fields);
+                nblink_extract_named(pktin, proto, "src_mac", pktout, OXM_OF_EHDDP_SRC_MAC, fields);
+                nblink_extract_named(pktin, proto, "time_block", pktout, OXM_OF_EHDDP_TIM_BLO, fields);
             }
             else if (protocol_Name.compare("EHDDP_NOTIFICACION")==0 && pkt_proto->ehddp_notify==NULL)
             {
                 pkt_proto->ehddp_notify = (struct ehddp_notify *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "NewLocalPort", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NOT_NEW);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "IpLocalPort", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NOT_IP);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "MACLocalPort", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NOT_MAC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "OldLocalPort", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_EHDDP_NOT_OLD);
+                nblink_extract_named(pktin, proto, "NewLocalPort", pktout, OXM_OF_EHDDP_NOT_NEW, fields);
+                nblink_extract_named(pktin, proto, "IpLocalPort", pktout, OXM_OF_EHDDP_NOT_IP, fields);
+                nblink_extract_named(pktin, proto, "MACLocalPort", pktout, OXM_OF_EHDDP_NOT_MAC, fields);
+                nblink_extract_named(pktin, proto, "OldLocalPort", pktout, OXM_OF_EHDDP_NOT_OLD, fields);
             }
             /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
             if (protocol_Name.compare("ip") == 0 && pkt_proto->ipv4 == NULL)
             {
                 pkt_proto->ipv4 = (struct ip_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "ip dscp", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IP_DSCP);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "ip ecn", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IP_ECN);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "src", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV4_SRC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dst", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV4_DST);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "nextp", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IP_PROTO);
+                nblink_extract_named(pktin, proto, "ip dscp", pktout, OXM_OF_IP_DSCP, fields);
+                nblink_extract_named(pktin, proto, "ip ecn", pktout, OXM_OF_IP_ECN, fields);
+                nblink_extract_named(pktin, proto, "src", pktout, OXM_OF_IPV4_SRC, fields);
+                nblink_extract_named(pktin, proto, "dst", pktout, OXM_OF_IPV4_DST, fields);
+                nblink_extract_named(pktin, proto, "nextp", pktout, OXM_OF_IP_PROTO, fields);
             }
             else if (protocol_Name.compare("ipv6") == 0 && pkt_proto->ipv6 == NULL)
             {
 
                 _nbPDMLField * ip_proto = NULL;
-                uint8_t i;
+                bool want_eh = nblink_wants(fields, OXM_OF_IPV6_EXTHDR);
+                bool want_proto = nblink_wants(fields, OXM_OF_IP_PROTO);
                 pkt_proto->ipv6 = (struct ipv6_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "ipv6 dscp", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IP_DSCP);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "ipv6 ecn", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IP_ECN);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "flabel", proto->FirstField, &field);                
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_FLABEL);
-                /*Initialize extension header OXM */
-                struct ofl_match_tlv * EH_field;
-                uint16_t bit_field = OFPIEH_NONEXT;
-                EH_field = (struct ofl_match_tlv *) malloc(sizeof(struct ofl_match_tlv));
-                EH_field->value = (uint8_t*) malloc(OXM_LENGTH(OXM_OF_IPV6_EXTHDR));
-                EH_field->header = OXM_OF_IPV6_EXTHDR;
-                /*Set everything to zero */
-                memset(EH_field->value,0x0, sizeof(uint16_t));
-
-                char *pEnd;
-                uint16_t next_header = strtol(field->Value, &pEnd,16);
-                /*Set OFPIEH_NONEXT */
-                if (next_header == IPV6_NO_NEXT_HEADER)
-                {
-                    uint16_t *ext_hdrs;
-
-                    ext_hdrs = (uint16_t*) EH_field->value;
-                    *ext_hdrs ^=  OFPIEH_NONEXT;
-                    *ext_hdrs = *ext_hdrs;
-                }
-
-                hmap_insert_fast(&pktout->match_fields, &EH_field->hmap_node,
-                            hash_int(EH_field->header, 0));
-                pktout->header.length += 6;
-
-                PDMLReader->GetPDMLField(proto->Name, (char*) "src", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_SRC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dst", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_DST);
+                nblink_extract_named(pktin, proto, "ipv6 dscp", pktout, OXM_OF_IP_DSCP, fields);
+                nblink_extract_named(pktin, proto, "ipv6 ecn", pktout, OXM_OF_IP_ECN, fields);
+                nblink_extract_named(pktin, proto, "flabel", pktout, OXM_OF_IPV6_FLABEL, fields);
+                nblink_extract_named(pktin, proto, "src", pktout, OXM_OF_IPV6_SRC, fields);
+                nblink_extract_named(pktin, proto, "dst", pktout, OXM_OF_IPV6_DST, fields);
+
+                if (want_eh || want_proto)
+                    PDMLReader->GetPDMLField(proto->Name, (char*) "nexthdr", proto->FirstField, &ip_proto);
+
+                if (want_eh){
+                    /*Initialize extension header OXM */
+                    struct ofl_match_tlv * EH_field;
+                    EH_field = (struct ofl_match_tlv *) malloc(sizeof(struct ofl_match_tlv));
+                    EH_field->value = (uint8_t*) malloc(OXM_LENGTH(OXM_OF_IPV6_EXTHDR));
+                    EH_field->header = OXM_OF_IPV6_EXTHDR;
+                    /*Set everything to zero */
+                    memset(EH_field->value,0x0, sizeof(uint16_t));
+
+                    /*Set OFPIEH_NONEXT */
+                    if (ip_proto != NULL && strtol(ip_proto->Value, NULL, 16) == IPV6_NO_NEXT_HEADER)
+                    {
+                        uint16_t *ext_hdrs;
 
+                        ext_hdrs = (uint16_t*) EH_field->value;
+                        *ext_hdrs ^=  OFPIEH_NONEXT;
+                    }
 
-                PDMLReader->GetPDMLField(proto->Name, (char*) "nexthdr", proto->FirstField, &ip_proto);                
-                if (PDMLReader->GetPDMLField(proto->Name, (char*) "HBH", proto->FirstField, &field) == nbSUCCESS){                    
-                    nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_HOP, field, &destination_num);                    
-                        ip_proto = field->FirstChild;                    
+                    hmap_insert_fast(&pktout->match_fields, &EH_field->hmap_node,
+                                hash_int(EH_field->header, 0));
+                    pktout->header.length += 6;
                 }
-                if(PDMLReader->GetPDMLField(proto->Name, (char*) "FH", proto->FirstField, &field) == nbSUCCESS){
-                    nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_FRAG, field, &destination_num);
-                    if(!field->NextField)
-                        ip_proto = field->FirstChild;
-                }
-                if(PDMLReader->GetPDMLField(proto->Name, (char*) "AH",proto->FirstField, &field) == nbSUCCESS){
-                    nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_AUTH, field, &destination_num);
-                    if(!field->NextField)
-                        ip_proto = field->FirstChild;
-                }
-                if(PDMLReader->GetPDMLField(proto->Name, (char*) "DOH", proto->FirstField, &field) == nbSUCCESS){                   
-                    nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_DEST, field, &destination_num);
-                    if(!field->NextField)
-                        ip_proto = field->FirstChild;
-                }
-                if(PDMLReader->GetPDMLField(proto->Name, (char*) "RH", proto->FirstField, &field) == nbSUCCESS){
-                    nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_ROUTER, field, &destination_num);
-                    if(!field->NextField)
-                        ip_proto = field->FirstChild;
+
+                if (want_eh || want_proto){
+                    if (PDMLReader->GetPDMLField(proto->Name, (char*) "HBH", proto->FirstField, &field) == nbSUCCESS){                    
+                        nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_HOP, field, &destination_num);                    
+                            ip_proto = field->FirstChild;                    
+                    }
+                    if(PDMLReader->GetPDMLField(proto->Name, (char*) "FH", proto->FirstField, &field) == nbSUCCESS){
+                        nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_FRAG, field, &destination_num);
+                        if(!field->NextField)
+                            ip_proto = field->FirstChild;
+                    }
+                    if(PDMLReader->GetPDMLField(proto->Name, (char*) "AH",proto->FirstField, &field) == nbSUCCESS){
+                        nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_AUTH, field, &destination_num);
+                        if(!field->NextField)
+                            ip_proto = field->FirstChild;
+                    }
+                    if(PDMLReader->GetPDMLField(proto->Name, (char*) "DOH", proto->FirstField, &field) == nbSUCCESS){                   
+                        nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_DEST, field, &destination_num);
+                        if(!field->NextField)
+                            ip_proto = field->FirstChild;
+                    }
+                    if(PDMLReader->GetPDMLField(proto->Name, (char*) "RH", proto->FirstField, &field) == nbSUCCESS){
+                        nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_ROUTER, field, &destination_num);
+                        if(!field->NextField)
+                            ip_proto = field->FirstChild;
+                    }
+                    if(PDMLReader->GetPDMLField(proto->Name, (char*) "ESP", proto->FirstField, &field) == nbSUCCESS){                    
+                        nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_ESP, field, &destination_num);
+                        if(!field->NextField)
+                            ip_proto = field->FirstChild;
+                    } 
                 }
-                if(PDMLReader->GetPDMLField(proto->Name, (char*) "ESP", proto->FirstField, &field) == nbSUCCESS){                    
-                    nblink_extract_exthdr_fields(pktin, pktout, OFPIEH_ESP, field, &destination_num);
-                    if(!field->NextField)
-                        ip_proto = field->FirstChild;
-                } 
-                if (ip_proto){
+                if (ip_proto && want_proto){
 
                     nblink_extract_proto_fields(pktin, ip_proto, pktout, OXM_OF_IP_PROTO);
                 }                 
@@ -674,77 +633,46 @@ extern "C" int nblink_packet_parse(struct ofpbuf * pktin,  struct ofl_match * pk
             if (protocol_Name.compare("tcp") == 0 && pkt_proto->tcp == NULL)
             {
                 pkt_proto->tcp = (struct tcp_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "sport", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_TCP_SRC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dport", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_TCP_DST);
+                nblink_extract_named(pktin, proto, "sport", pktout, OXM_OF_TCP_SRC, fields);
+                nblink_extract_named(pktin, proto, "dport", pktout, OXM_OF_TCP_DST, fields);
             }
             else if (protocol_Name.compare("udp") == 0 && pkt_proto->udp == NULL)
             {
                 pkt_proto->udp = (struct udp_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "sport", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_UDP_SRC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dport", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_UDP_DST);
+                nblink_extract_named(pktin, proto, "sport", pktout, OXM_OF_UDP_SRC, fields);
+                nblink_extract_named(pktin, proto, "dport", pktout, OXM_OF_UDP_DST, fields);
             }
             else if (protocol_Name.compare("sctp") == 0 && pkt_proto->sctp == NULL)
             {
                 pkt_proto->sctp = (struct sctp_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "sport", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_SCTP_SRC);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "dport", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_SCTP_DST);
+                nblink_extract_named(pktin, proto, "sport", pktout, OXM_OF_SCTP_SRC, fields);
+                nblink_extract_named(pktin, proto, "dport", pktout, OXM_OF_SCTP_DST, fields);
             }
 
             if (protocol_Name.compare("icmp") == 0 && pkt_proto->icmp == NULL){
                 pkt_proto->icmp = (struct icmp_header *) ((uint8_t*) pktin->data + proto->Position);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "type", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ICMPV4_TYPE);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "code", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ICMPV4_CODE);                
+                nblink_extract_named(pktin, proto, "type", pktout, OXM_OF_ICMPV4_TYPE, fields);
+                nblink_extract_named(pktin, proto, "code", pktout, OXM_OF_ICMPV4_CODE, fields);
 
             }
             else if (protocol_Name.compare("icmp6") == 0 && pkt_proto->icmp == NULL){
                 pkt_proto->icmp = (struct icmp_header *) ((uint8_t*) pktin->data + proto->Position);
 
-                PDMLReader->GetPDMLField(proto->Name, (char*) "type", proto->FirstField, &field);
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ICMPV6_TYPE);
-                PDMLReader->GetPDMLField(proto->Name, (char*) "code", proto->FirstField, &field);                
-                nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_ICMPV6_CODE);
-                if (PDMLReader->GetPDMLField(proto->Name, (char*) "NeighSol", proto->FirstField, &field) == nbSUCCESS ||
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "NeighAdv", proto->FirstField, &field) == nbSUCCESS){
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "target_address", proto->FirstField, &field);                                            
-                    
-                    nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_ND_TARGET);                    
+                nblink_extract_named(pktin, proto, "type", pktout, OXM_OF_ICMPV6_TYPE, fields);
+                nblink_extract_named(pktin, proto, "code", pktout, OXM_OF_ICMPV6_CODE, fields);
+                if (nblink_wants(fields, OXM_OF_IPV6_ND_TARGET) &&
+                    (PDMLReader->GetPDMLField(proto->Name, (char*) "NeighSol", proto->FirstField, &field) == nbSUCCESS ||
+                     PDMLReader->GetPDMLField(proto->Name, (char*) "NeighAdv", proto->FirstField, &field) == nbSUCCESS)){
+                    nblink_extract_named(pktin, proto, "target_address", pktout, OXM_OF_IPV6_ND_TARGET, fields);
                 }
-                if (PDMLReader->GetPDMLField(proto->Name, (char*) "NDO", proto->FirstField, &field) == nbSUCCESS){
-                    uint8_t type;
-                    PDMLReader->GetPDMLField(proto->Name, (char*) "ndotype", proto->FirstField, &field);
-                    if (PDMLReader->GetPDMLField(proto->Name, (char*) "src_link_layer_address", proto->FirstField, &field) == nbSUCCESS){
-                        nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_ND_SLL);
-                    }
-                    if(PDMLReader->GetPDMLField(proto->Name, (char*) "dst_link_layer_address", proto->FirstField, &field) == nbSUCCESS){
-                        nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_ND_TLL);   
-                    }
+                if ((nblink_wants(fields, OXM_OF_IPV6_ND_SLL) || nblink_wants(fields, OXM_OF_IPV6_ND_TLL)) &&
+                    PDMLReader->GetPDMLField(proto->Name, (char*) "NDO", proto->FirstField, &field) == nbSUCCESS){
+                    nblink_extract_named(pktin, proto, "src_link_layer_address", pktout, OXM_OF_IPV6_ND_SLL, fields);
+                    nblink_extract_named(pktin, proto, "dst_link_layer_address", pktout, OXM_OF_IPV6_ND_TLL, fields);
                 }
             }
-            while (!field->isField)
-            {
-            // This is necessary for Protocols with a Block as a first "field" on NetBee,
-            // for instance the "vlan" protocol (see NetPDL for further details).
-                field = field->FirstChild;            
-            }
-            if (field->NextField == NULL && field->ParentField != NULL)
-            // If we are under a block with no more fields, return to the block and move on.
-            {
-                field = field->ParentField;
-
-            }
             proto = proto->NextProto;
 
         }            
     return 1;
 }
-
-
-
@@ -51,10 +51,16 @@ extern "C"
 #endif
 int nblink_initialize(void);
 
+struct oxm_field_set;
+
+/* Decodes 'pktin', pointing 'pkt_proto' at its headers and storing in
+ * 'pktout' the match fields found in 'fields' (all of them if 'fields' is
+ * null). */
 #ifdef __cplusplus
 extern "C"
 #endif
-int nblink_packet_parse(struct ofpbuf * pktin, struct ofl_match * pktout, struct protocols_std * pkt_proto);
+int nblink_packet_parse(struct ofpbuf * pktin, struct ofl_match * pktout, struct protocols_std * pkt_proto,
+                        const struct oxm_field_set * fields);
 
 
 
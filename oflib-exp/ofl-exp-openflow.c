@@ -29,6 +29,7 @@
  * Author: Zoltán Lajos Kis <zoltan.lajos.kis@ericsson.com>
  */
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +39,7 @@
 #include "ofl-exp-openflow.h"
 #include "../oflib/ofl-log.h"
 #include "../oflib/ofl-print.h"
+#include "../oflib/ofl-utils.h"
 
 #define LOG_MODULE ofl_exp_of
 OFL_LOG_INIT(LOG_MODULE)
@@ -229,3 +231,737 @@ ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg) {
     fclose(stream);
     return str;
 }
+
+
+static const char *latency_stage_names[] = {
+    "rx", "parse", "lookup", "actions", "group", "meter", "tx", "packet-in",
+    "queue"
+};
+
+static const char *discovery_counter_names[] = {
+    "req_in", "rep_in", "ack_in", "bad_in", "req_dup", "req_flood",
+    "rep_create", "rep_fwd", "rep_cont", "rep_full", "rep_no_port",
+    "arp_req", "arp_rep", "arp_learn", "arp_flood", "arp_ucast", "arp_unknown"
+};
+
+int
+ofl_exp_openflow_stats_req_pack(struct ofl_msg_multipart_request_header *msg, uint8_t **buf, size_t *buf_len) {
+    struct ofl_exp_openflow_mp_request_header *exp = (struct ofl_exp_openflow_mp_request_header *)msg;
+
+    switch (exp->type) {
+        case (OFP_EXT_STATS_LATENCY): {
+            struct ofl_exp_openflow_mp_request_latency *l = (struct ofl_exp_openflow_mp_request_latency *)exp;
+            struct ofp_multipart_request *req;
+            struct openflow_ext_latency_request *ofp;
+
+            *buf_len = sizeof(struct ofp_multipart_request) + sizeof(struct openflow_ext_latency_request);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            req = (struct ofp_multipart_request *)(*buf);
+            ofp = (struct openflow_ext_latency_request *)req->body;
+            ofp->header.experimenter = htonl(exp->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp->type);
+            ofp->command = l->command;
+            memset(ofp->pad, 0x00, 7);
+            return 0;
+        }
+        case (OFP_EXT_STATS_DISCOVERY):
+        case (OFP_EXT_STATS_CONNECTIONS):
+        case (OFP_EXT_STATS_BUFFERS):
+        case (OFP_EXT_STATS_QUEUES): {
+            struct ofp_multipart_request *req;
+            struct ofp_experimenter_multipart_header *ofp;
+
+            *buf_len = sizeof(struct ofp_multipart_request) + sizeof(struct ofp_experimenter_multipart_header);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            req = (struct ofp_multipart_request *)(*buf);
+            ofp = (struct ofp_experimenter_multipart_header *)req->body;
+            ofp->experimenter = htonl(exp->header.experimenter_id);
+            ofp->exp_type     = htonl(exp->type);
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openflow Experimenter stats request.");
+            return -1;
+        }
+    }
+}
+
+ofl_err
+ofl_exp_openflow_stats_req_unpack(struct ofp_multipart_request *os, size_t *len, struct ofl_msg_multipart_request_header **msg) {
+    struct ofp_experimenter_multipart_header *exp;
+
+    if (*len < sizeof(struct ofp_experimenter_multipart_header)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received EXPERIMENTER stats request has invalid length (%zu).", *len);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+    }
+    exp = (struct ofp_experimenter_multipart_header *)os->body;
+
+    switch (ntohl(exp->exp_type)) {
+        case (OFP_EXT_STATS_LATENCY): {
+            struct openflow_ext_latency_request *src;
+            struct ofl_exp_openflow_mp_request_latency *dst;
+
+            if (*len < sizeof(struct openflow_ext_latency_request)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_LATENCY request has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_latency_request);
+
+            src = (struct openflow_ext_latency_request *)exp;
+            dst = (struct ofl_exp_openflow_mp_request_latency *)malloc(sizeof(struct ofl_exp_openflow_mp_request_latency));
+            dst->header.header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type                   = ntohl(exp->exp_type);
+            dst->command                       = src->command;
+
+            (*msg) = (struct ofl_msg_multipart_request_header *)dst;
+            return 0;
+        }
+        case (OFP_EXT_STATS_DISCOVERY):
+        case (OFP_EXT_STATS_CONNECTIONS):
+        case (OFP_EXT_STATS_BUFFERS):
+        case (OFP_EXT_STATS_QUEUES): {
+            struct ofl_exp_openflow_mp_request_header *dst;
+
+            *len -= sizeof(struct ofp_experimenter_multipart_header);
+
+            dst = (struct ofl_exp_openflow_mp_request_header *)malloc(sizeof(struct ofl_exp_openflow_mp_request_header));
+            dst->header.experimenter_id = ntohl(exp->experimenter);
+            dst->type                   = ntohl(exp->exp_type);
+
+            (*msg) = (struct ofl_msg_multipart_request_header *)dst;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter stats request.");
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+        }
+    }
+}
+
+int
+ofl_exp_openflow_stats_req_free(struct ofl_msg_multipart_request_header *msg) {
+    free(msg);
+    return 0;
+}
+
+char *
+ofl_exp_openflow_stats_req_to_string(struct ofl_msg_multipart_request_header *msg) {
+    struct ofl_exp_openflow_mp_request_header *exp = (struct ofl_exp_openflow_mp_request_header *)msg;
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    switch (exp->type) {
+        case (OFP_EXT_STATS_LATENCY): {
+            static const char *commands[] = {"get", "enable", "disable", "clear"};
+            struct ofl_exp_openflow_mp_request_latency *l = (struct ofl_exp_openflow_mp_request_latency *)exp;
+
+            fprintf(stream, "{type=\"latency\", cmd=\"%s\"}",
+                    l->command < 4 ? commands[l->command] : "?");
+            break;
+        }
+        case (OFP_EXT_STATS_DISCOVERY): {
+            fprintf(stream, "{type=\"discovery\"}");
+            break;
+        }
+        case (OFP_EXT_STATS_CONNECTIONS): {
+            fprintf(stream, "{type=\"connections\"}");
+            break;
+        }
+        case (OFP_EXT_STATS_BUFFERS): {
+            fprintf(stream, "{type=\"buffers\"}");
+            break;
+        }
+        case (OFP_EXT_STATS_QUEUES): {
+            fprintf(stream, "{type=\"queues\"}");
+            break;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter stats request.");
+            fprintf(stream, "{type=\"ofexp\", exp_type=\"%u\"}", exp->type);
+        }
+    }
+
+    fclose(stream);
+    return str;
+}
+
+int
+ofl_exp_openflow_stats_reply_pack(struct ofl_msg_multipart_reply_header *msg, uint8_t **buf, size_t *buf_len) {
+    struct ofl_exp_openflow_mp_reply_header *exp = (struct ofl_exp_openflow_mp_reply_header *)msg;
+
+    switch (exp->type) {
+        case (OFP_EXT_STATS_LATENCY): {
+            struct ofl_exp_openflow_mp_reply_latency *l = (struct ofl_exp_openflow_mp_reply_latency *)exp;
+            struct ofp_multipart_reply *resp;
+            struct openflow_ext_latency_reply *ofp;
+            uint8_t *ptr;
+            size_t i, j;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct openflow_ext_latency_reply);
+            for (i = 0; i < l->stages_num; i++) {
+                *buf_len += sizeof(struct openflow_ext_latency_stage)
+                          + l->stages[i].buckets_num * sizeof(struct openflow_ext_latency_bucket);
+            }
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ofp = (struct openflow_ext_latency_reply *)resp->body;
+            ofp->header.experimenter = htonl(exp->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp->type);
+            ofp->flags = htonl(l->flags);
+            memset(ofp->pad, 0x00, 4);
+
+            ptr = (uint8_t *)ofp->stages;
+            for (i = 0; i < l->stages_num; i++) {
+                struct ofl_exp_openflow_latency_stage *src = &l->stages[i];
+                struct openflow_ext_latency_stage *dst = (struct openflow_ext_latency_stage *)ptr;
+                size_t length = sizeof(struct openflow_ext_latency_stage)
+                              + src->buckets_num * sizeof(struct openflow_ext_latency_bucket);
+
+                dst->length   = htons(length);
+                dst->stage    = src->stage;
+                dst->table_id = src->table_id;
+                memset(dst->pad, 0x00, 4);
+                dst->count    = hton64(src->count);
+                dst->sum_ns   = hton64(src->sum_ns);
+                dst->max_ns   = hton64(src->max_ns);
+                for (j = 0; j < src->buckets_num; j++) {
+                    dst->buckets[j].ns    = hton64(src->buckets[j].ns);
+                    dst->buckets[j].count = hton64(src->buckets[j].count);
+                }
+                ptr += length;
+            }
+            return 0;
+        }
+        case (OFP_EXT_STATS_DISCOVERY): {
+            struct ofl_exp_openflow_mp_reply_discovery *d = (struct ofl_exp_openflow_mp_reply_discovery *)exp;
+            struct ofp_multipart_reply *resp;
+            struct openflow_ext_discovery_reply *ofp;
+            size_t port_len = sizeof(struct openflow_ext_discovery_port)
+                            + OFP_EXT_DISCOVERY_N_COUNTERS * sizeof(uint64_t);
+            size_t i, j;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct openflow_ext_discovery_reply)
+                     + d->ports_num * port_len;
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ofp = (struct openflow_ext_discovery_reply *)resp->body;
+            ofp->header.experimenter = htonl(exp->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp->type);
+            ofp->exploration        = hton64(d->exploration);
+            ofp->first_request      = hton64(d->first_request);
+            ofp->convergence        = hton64(d->convergence);
+            ofp->controller_connect = hton64(d->controller_connect);
+            ofp->local_port_ready   = hton64(d->local_port_ready);
+            ofp->replies_merged     = hton64(d->replies_merged);
+            ofp->seen_evictions     = hton64(d->seen_evictions);
+            ofp->n_counters         = htons(OFP_EXT_DISCOVERY_N_COUNTERS);
+            memset(ofp->pad, 0x00, 6);
+
+            for (i = 0; i < d->ports_num; i++) {
+                struct openflow_ext_discovery_port *dst =
+                        (struct openflow_ext_discovery_port *)((uint8_t *)ofp->ports + i * port_len);
+
+                dst->port_no = htonl(d->ports[i].port_no);
+                memset(dst->pad, 0x00, 4);
+                for (j = 0; j < OFP_EXT_DISCOVERY_N_COUNTERS; j++) {
+                    dst->counters[j] = hton64(d->ports[i].counters[j]);
+                }
+            }
+            return 0;
+        }
+        case (OFP_EXT_STATS_CONNECTIONS): {
+            struct ofl_exp_openflow_mp_reply_connections *c = (struct ofl_exp_openflow_mp_reply_connections *)exp;
+            struct ofp_multipart_reply *resp;
+            struct openflow_ext_connections_reply *ofp;
+            size_t i;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct openflow_ext_connections_reply)
+                     + c->conns_num * sizeof(struct openflow_ext_connection);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ofp = (struct openflow_ext_connections_reply *)resp->body;
+            ofp->header.experimenter = htonl(exp->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp->type);
+
+            for (i = 0; i < c->conns_num; i++) {
+                struct ofl_exp_openflow_connection *src = &c->conns[i];
+                struct openflow_ext_connection *dst = &ofp->conns[i];
+
+                dst->remote       = htonl(src->remote);
+                dst->auxiliary_id = src->auxiliary_id;
+                dst->connected    = src->connected;
+                memset(dst->pad, 0x00, 2);
+                dst->txq          = htonl(src->txq);
+                dst->txq_max      = htonl(src->txq_max);
+                dst->packet_ins   = hton64(src->packet_ins);
+                dst->dropped      = hton64(src->dropped);
+            }
+            return 0;
+        }
+        case (OFP_EXT_STATS_BUFFERS): {
+            struct ofl_exp_openflow_mp_reply_buffers *b = (struct ofl_exp_openflow_mp_reply_buffers *)exp;
+            struct ofp_multipart_reply *resp;
+            struct openflow_ext_buffers_reply *ofp;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct openflow_ext_buffers_reply);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ofp = (struct openflow_ext_buffers_reply *)resp->body;
+            ofp->header.experimenter = htonl(exp->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp->type);
+            ofp->buffers       = htonl(b->buffers);
+            ofp->buffered      = htonl(b->buffered);
+            ofp->bytes         = hton64(b->bytes);
+            ofp->max_bytes     = hton64(b->max_bytes);
+            ofp->saves         = hton64(b->saves);
+            ofp->save_failures = hton64(b->save_failures);
+            ofp->hits          = hton64(b->hits);
+            ofp->misses        = hton64(b->misses);
+            ofp->evictions     = hton64(b->evictions);
+            return 0;
+        }
+        case (OFP_EXT_STATS_QUEUES): {
+            struct ofl_exp_openflow_mp_reply_queues *q = (struct ofl_exp_openflow_mp_reply_queues *)exp;
+            struct ofp_multipart_reply *resp;
+            struct openflow_ext_queues_reply *ofp;
+            size_t i;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct openflow_ext_queues_reply)
+                     + q->queues_num * sizeof(struct openflow_ext_queue);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ofp = (struct openflow_ext_queues_reply *)resp->body;
+            ofp->header.experimenter = htonl(exp->header.experimenter_id);
+            ofp->header.exp_type     = htonl(exp->type);
+
+            for (i = 0; i < q->queues_num; i++) {
+                struct ofl_exp_openflow_queue *src = &q->queues[i];
+                struct openflow_ext_queue *dst = &ofp->queues[i];
+
+                dst->port_no          = htonl(src->port_no);
+                dst->queue_id         = htonl(src->queue_id);
+                dst->backlog_packets  = htonl(src->backlog_packets);
+                memset(dst->pad, 0x00, 4);
+                dst->backlog_bytes    = hton64(src->backlog_bytes);
+                dst->sent             = hton64(src->sent);
+                dst->dropped          = hton64(src->dropped);
+                dst->sojourn_msec     = hton64(src->sojourn_msec);
+                dst->sojourn_max_msec = hton64(src->sojourn_max_msec);
+            }
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openflow Experimenter stats reply.");
+            return -1;
+        }
+    }
+}
+
+ofl_err
+ofl_exp_openflow_stats_reply_unpack(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_multipart_reply_header **msg) {
+    struct ofp_experimenter_multipart_header *exp;
+
+    if (*len < sizeof(struct ofp_experimenter_multipart_header)) {
+        OFL_LOG_WARN(LOG_MODULE, "Received EXPERIMENTER stats reply has invalid length (%zu).", *len);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+    }
+    exp = (struct ofp_experimenter_multipart_header *)os->body;
+
+    switch (ntohl(exp->exp_type)) {
+        case (OFP_EXT_STATS_LATENCY): {
+            struct openflow_ext_latency_reply *src;
+            struct ofl_exp_openflow_mp_reply_latency *dst;
+            uint8_t *ptr;
+            size_t i;
+
+            if (*len < sizeof(struct openflow_ext_latency_reply)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_LATENCY reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_latency_reply);
+
+            src = (struct openflow_ext_latency_reply *)exp;
+            dst = (struct ofl_exp_openflow_mp_reply_latency *)malloc(sizeof(struct ofl_exp_openflow_mp_reply_latency));
+            dst->header.header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type                   = ntohl(exp->exp_type);
+            dst->flags                         = ntohl(src->flags);
+            dst->stages_num = 0;
+            dst->stages = NULL;
+
+            ptr = (uint8_t *)src->stages;
+            while (*len > 0) {
+                struct openflow_ext_latency_stage *s = (struct openflow_ext_latency_stage *)ptr;
+                struct ofl_exp_openflow_latency_stage *d;
+                size_t length;
+
+                if (*len < sizeof(struct openflow_ext_latency_stage)
+                    || (length = ntohs(s->length)) < sizeof(struct openflow_ext_latency_stage)
+                    || length > *len
+                    || (length - sizeof(struct openflow_ext_latency_stage)) % sizeof(struct openflow_ext_latency_bucket)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_LATENCY reply has an invalid stage.");
+                    ofl_exp_openflow_stats_reply_free((struct ofl_msg_multipart_reply_header *)dst);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= length;
+
+                dst->stages = realloc(dst->stages, (dst->stages_num + 1) * sizeof(struct ofl_exp_openflow_latency_stage));
+                d = &dst->stages[dst->stages_num++];
+                d->stage    = s->stage;
+                d->table_id = s->table_id;
+                d->count    = ntoh64(s->count);
+                d->sum_ns   = ntoh64(s->sum_ns);
+                d->max_ns   = ntoh64(s->max_ns);
+                d->buckets_num = (length - sizeof(struct openflow_ext_latency_stage))
+                               / sizeof(struct openflow_ext_latency_bucket);
+                d->buckets = (struct ofl_exp_openflow_latency_bucket *)malloc(d->buckets_num * sizeof(struct ofl_exp_openflow_latency_bucket));
+                for (i = 0; i < d->buckets_num; i++) {
+                    d->buckets[i].ns    = ntoh64(s->buckets[i].ns);
+                    d->buckets[i].count = ntoh64(s->buckets[i].count);
+                }
+                ptr += length;
+            }
+
+            (*msg) = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        case (OFP_EXT_STATS_DISCOVERY): {
+            struct openflow_ext_discovery_reply *src;
+            struct ofl_exp_openflow_mp_reply_discovery *dst;
+            size_t n_counters, port_len, i, j;
+
+            if (*len < sizeof(struct openflow_ext_discovery_reply)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_DISCOVERY reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_discovery_reply);
+
+            src = (struct openflow_ext_discovery_reply *)exp;
+            n_counters = ntohs(src->n_counters);
+            port_len = sizeof(struct openflow_ext_discovery_port) + n_counters * sizeof(uint64_t);
+            if (*len % port_len != 0) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_DISCOVERY reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+
+            dst = (struct ofl_exp_openflow_mp_reply_discovery *)malloc(sizeof(struct ofl_exp_openflow_mp_reply_discovery));
+            dst->header.header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type                   = ntohl(exp->exp_type);
+            dst->exploration        = ntoh64(src->exploration);
+            dst->first_request      = ntoh64(src->first_request);
+            dst->convergence        = ntoh64(src->convergence);
+            dst->controller_connect = ntoh64(src->controller_connect);
+            dst->local_port_ready   = ntoh64(src->local_port_ready);
+            dst->replies_merged     = ntoh64(src->replies_merged);
+            dst->seen_evictions     = ntoh64(src->seen_evictions);
+
+            /* Counters unknown to this side are skipped, missing ones are 0. */
+            dst->ports_num = *len / port_len;
+            dst->ports = (struct ofl_exp_openflow_discovery_port *)calloc(dst->ports_num, sizeof(struct ofl_exp_openflow_discovery_port));
+            for (i = 0; i < dst->ports_num; i++) {
+                struct openflow_ext_discovery_port *p =
+                        (struct openflow_ext_discovery_port *)((uint8_t *)src->ports + i * port_len);
+
+                dst->ports[i].port_no = ntohl(p->port_no);
+                for (j = 0; j < n_counters && j < OFP_EXT_DISCOVERY_N_COUNTERS; j++) {
+                    dst->ports[i].counters[j] = ntoh64(p->counters[j]);
+                }
+            }
+            *len = 0;
+
+            (*msg) = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        case (OFP_EXT_STATS_CONNECTIONS): {
+            struct openflow_ext_connections_reply *src;
+            struct ofl_exp_openflow_mp_reply_connections *dst;
+            size_t i;
+
+            if (*len < sizeof(struct openflow_ext_connections_reply)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_CONNECTIONS reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_connections_reply);
+            if (*len % sizeof(struct openflow_ext_connection) != 0) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_CONNECTIONS reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+
+            src = (struct openflow_ext_connections_reply *)exp;
+            dst = (struct ofl_exp_openflow_mp_reply_connections *)malloc(sizeof(struct ofl_exp_openflow_mp_reply_connections));
+            dst->header.header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type                   = ntohl(exp->exp_type);
+            dst->conns_num = *len / sizeof(struct openflow_ext_connection);
+            dst->conns = (struct ofl_exp_openflow_connection *)malloc(dst->conns_num * sizeof(struct ofl_exp_openflow_connection));
+            for (i = 0; i < dst->conns_num; i++) {
+                struct openflow_ext_connection *c = &src->conns[i];
+
+                dst->conns[i].remote       = ntohl(c->remote);
+                dst->conns[i].auxiliary_id = c->auxiliary_id;
+                dst->conns[i].connected    = c->connected != 0;
+                dst->conns[i].txq          = ntohl(c->txq);
+                dst->conns[i].txq_max      = ntohl(c->txq_max);
+                dst->conns[i].packet_ins   = ntoh64(c->packet_ins);
+                dst->conns[i].dropped      = ntoh64(c->dropped);
+            }
+            *len = 0;
+
+            (*msg) = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        case (OFP_EXT_STATS_BUFFERS): {
+            struct openflow_ext_buffers_reply *src;
+            struct ofl_exp_openflow_mp_reply_buffers *dst;
+
+            if (*len < sizeof(struct openflow_ext_buffers_reply)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_BUFFERS reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_buffers_reply);
+
+            src = (struct openflow_ext_buffers_reply *)exp;
+            dst = (struct ofl_exp_openflow_mp_reply_buffers *)malloc(sizeof(struct ofl_exp_openflow_mp_reply_buffers));
+            dst->header.header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type                   = ntohl(exp->exp_type);
+            dst->buffers       = ntohl(src->buffers);
+            dst->buffered      = ntohl(src->buffered);
+            dst->bytes         = ntoh64(src->bytes);
+            dst->max_bytes     = ntoh64(src->max_bytes);
+            dst->saves         = ntoh64(src->saves);
+            dst->save_failures = ntoh64(src->save_failures);
+            dst->hits          = ntoh64(src->hits);
+            dst->misses        = ntoh64(src->misses);
+            dst->evictions     = ntoh64(src->evictions);
+
+            (*msg) = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        case (OFP_EXT_STATS_QUEUES): {
+            struct openflow_ext_queues_reply *src;
+            struct ofl_exp_openflow_mp_reply_queues *dst;
+            size_t i;
+
+            if (*len < sizeof(struct openflow_ext_queues_reply)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_QUEUES reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct openflow_ext_queues_reply);
+            if (*len % sizeof(struct openflow_ext_queue) != 0) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_STATS_QUEUES reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+
+            src = (struct openflow_ext_queues_reply *)exp;
+            dst = (struct ofl_exp_openflow_mp_reply_queues *)malloc(sizeof(struct ofl_exp_openflow_mp_reply_queues));
+            dst->header.header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type                   = ntohl(exp->exp_type);
+            dst->queues_num = *len / sizeof(struct openflow_ext_queue);
+            dst->queues = (struct ofl_exp_openflow_queue *)malloc(dst->queues_num * sizeof(struct ofl_exp_openflow_queue));
+            for (i = 0; i < dst->queues_num; i++) {
+                struct openflow_ext_queue *q = &src->queues[i];
+
+                dst->queues[i].port_no          = ntohl(q->port_no);
+                dst->queues[i].queue_id         = ntohl(q->queue_id);
+                dst->queues[i].backlog_packets  = ntohl(q->backlog_packets);
+                dst->queues[i].backlog_bytes    = ntoh64(q->backlog_bytes);
+                dst->queues[i].sent             = ntoh64(q->sent);
+                dst->queues[i].dropped          = ntoh64(q->dropped);
+                dst->queues[i].sojourn_msec     = ntoh64(q->sojourn_msec);
+                dst->queues[i].sojourn_max_msec = ntoh64(q->sojourn_max_msec);
+            }
+            *len = 0;
+
+            (*msg) = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter stats reply.");
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+        }
+    }
+}
+
+int
+ofl_exp_openflow_stats_reply_free(struct ofl_msg_multipart_reply_header *msg) {
+    struct ofl_exp_openflow_mp_reply_header *exp = (struct ofl_exp_openflow_mp_reply_header *)msg;
+
+    switch (exp->type) {
+        case (OFP_EXT_STATS_LATENCY): {
+            struct ofl_exp_openflow_mp_reply_latency *l = (struct ofl_exp_openflow_mp_reply_latency *)exp;
+            size_t i;
+
+            for (i = 0; i < l->stages_num; i++) {
+                free(l->stages[i].buckets);
+            }
+            free(l->stages);
+            break;
+        }
+        case (OFP_EXT_STATS_DISCOVERY): {
+            free(((struct ofl_exp_openflow_mp_reply_discovery *)exp)->ports);
+            break;
+        }
+        case (OFP_EXT_STATS_CONNECTIONS): {
+            free(((struct ofl_exp_openflow_mp_reply_connections *)exp)->conns);
+            break;
+        }
+        case (OFP_EXT_STATS_BUFFERS): {
+            break;
+        }
+        case (OFP_EXT_STATS_QUEUES): {
+            free(((struct ofl_exp_openflow_mp_reply_queues *)exp)->queues);
+            break;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown Openflow Experimenter stats reply.");
+        }
+    }
+    free(msg);
+    return 0;
+}
+
+/* Returns the lowest latency of the bucket below which a 'fraction' of the
+ * samples of 's' fall. */
+static uint64_t
+latency_percentile(struct ofl_exp_openflow_latency_stage *s, double fraction) {
+    uint64_t rank = s->count * fraction;
+    uint64_t n = 0;
+    size_t i;
+
+    for (i = 0; i < s->buckets_num; i++) {
+        n += s->buckets[i].count;
+        if (n > rank) {
+            return s->buckets[i].ns;
+        }
+    }
+    return s->max_ns;
+}
+
+char *
+ofl_exp_openflow_stats_reply_to_string(struct ofl_msg_multipart_reply_header *msg) {
+    struct ofl_exp_openflow_mp_reply_header *exp = (struct ofl_exp_openflow_mp_reply_header *)msg;
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    switch (exp->type) {
+        case (OFP_EXT_STATS_LATENCY): {
+            struct ofl_exp_openflow_mp_reply_latency *l = (struct ofl_exp_openflow_mp_reply_latency *)exp;
+            size_t i;
+
+            fprintf(stream, "{type=\"latency\", enabled=\"%s\"%s, stages=[",
+                    l->flags & OFP_EXT_LATENCY_ENABLED ? "yes" : "no",
+                    l->flags & OFP_EXT_LATENCY_TRUNCATED ? ", truncated=\"yes\"" : "");
+            for (i = 0; i < l->stages_num; i++) {
+                struct ofl_exp_openflow_latency_stage *s = &l->stages[i];
+
+                fprintf(stream, "%s\n  {stage=\"%s\"", i ? "," : "",
+                        s->stage < OFP_EXT_LATENCY_N_STAGES ? latency_stage_names[s->stage] : "?");
+                if (s->stage == OFP_EXT_LATENCY_LOOKUP) {
+                    fprintf(stream, ", table=\"%u\"", s->table_id);
+                }
+                fprintf(stream, ", count=\"%"PRIu64"\", mean=\"%"PRIu64"ns\"",
+                        s->count, s->count ? s->sum_ns / s->count : 0);
+                if (s->buckets_num) {
+                    fprintf(stream, ", p50=\"%"PRIu64"ns\", p90=\"%"PRIu64"ns\", "
+                                    "p99=\"%"PRIu64"ns\", p99.9=\"%"PRIu64"ns\"",
+                            latency_percentile(s, 0.5), latency_percentile(s, 0.9),
+                            latency_percentile(s, 0.99), latency_percentile(s, 0.999));
+                }
+                fprintf(stream, ", max=\"%"PRIu64"ns\"}", s->max_ns);
+            }
+            fprintf(stream, "]}");
+            break;
+        }
+        case (OFP_EXT_STATS_DISCOVERY): {
+            struct ofl_exp_openflow_mp_reply_discovery *d = (struct ofl_exp_openflow_mp_reply_discovery *)exp;
+            size_t i, j;
+
+            fprintf(stream, "{type=\"discovery\", exploration=\"%"PRIu64"\", "
+                            "first_req=\"%"PRIu64"\", convergence=\"%"PRIu64"ms\", "
+                            "ctrl_connect=\"%"PRIu64"\", local_port=\"%"PRIu64"\", "
+                            "merged=\"%"PRIu64"\", evictions=\"%"PRIu64"\", ports=[",
+                    d->exploration, d->first_request, d->convergence,
+                    d->controller_connect, d->local_port_ready,
+                    d->replies_merged, d->seen_evictions);
+            for (i = 0; i < d->ports_num; i++) {
+                fprintf(stream, "%s\n  {port=\"", i ? "," : "");
+                ofl_port_print(stream, d->ports[i].port_no);
+                fprintf(stream, "\"");
+                for (j = 0; j < OFP_EXT_DISCOVERY_N_COUNTERS; j++) {
+                    if (d->ports[i].counters[j] != 0) {
+                        fprintf(stream, ", %s=\"%"PRIu64"\"", discovery_counter_names[j],
+                                d->ports[i].counters[j]);
+                    }
+                }
+                fprintf(stream, "}");
+            }
+            fprintf(stream, "]}");
+            break;
+        }
+        case (OFP_EXT_STATS_CONNECTIONS): {
+            struct ofl_exp_openflow_mp_reply_connections *c = (struct ofl_exp_openflow_mp_reply_connections *)exp;
+            size_t i;
+
+            fprintf(stream, "{type=\"connections\", conns=[");
+            for (i = 0; i < c->conns_num; i++) {
+                struct ofl_exp_openflow_connection *conn = &c->conns[i];
+
+                fprintf(stream, "%s\n  {remote=\"%u\", aux=\"%u\", connected=\"%s\", "
+                                "txq=\"%u\", txq_max=\"%u\", pkt_in=\"%"PRIu64"\", "
+                                "dropped=\"%"PRIu64"\"}",
+                        i ? "," : "", conn->remote, conn->auxiliary_id,
+                        conn->connected ? "yes" : "no", conn->txq, conn->txq_max,
+                        conn->packet_ins, conn->dropped);
+            }
+            fprintf(stream, "]}");
+            break;
+        }
+        case (OFP_EXT_STATS_BUFFERS): {
+            struct ofl_exp_openflow_mp_reply_buffers *b = (struct ofl_exp_openflow_mp_reply_buffers *)exp;
+
+            fprintf(stream, "{type=\"buffers\", buffers=\"%u\", buffered=\"%u\", "
+                            "bytes=\"%"PRIu64"\", max_bytes=\"%"PRIu64"\", "
+                            "saves=\"%"PRIu64"\", save_fail=\"%"PRIu64"\", "
+                            "hits=\"%"PRIu64"\", misses=\"%"PRIu64"\", "
+                            "evictions=\"%"PRIu64"\"}",
+                    b->buffers, b->buffered, b->bytes, b->max_bytes, b->saves,
+                    b->save_failures, b->hits, b->misses, b->evictions);
+            break;
+        }
+        case (OFP_EXT_STATS_QUEUES): {
+            struct ofl_exp_openflow_mp_reply_queues *q = (struct ofl_exp_openflow_mp_reply_queues *)exp;
+            size_t i;
+
+            fprintf(stream, "{type=\"queues\", queues=[");
+            for (i = 0; i < q->queues_num; i++) {
+                struct ofl_exp_openflow_queue *queue = &q->queues[i];
+
+                fprintf(stream, "%s\n  {port=\"", i ? "," : "");
+                ofl_port_print(stream, queue->port_no);
+                fprintf(stream, "\", q=\"%u\", backlog=\"%u\", backlog_bytes=\"%"PRIu64"\", "
+                                "sent=\"%"PRIu64"\", dropped=\"%"PRIu64"\", "
+                                "sojourn_avg_ms=\"%"PRIu64"\", sojourn_max_ms=\"%"PRIu64"\"}",
+                        queue->queue_id, queue->backlog_packets, queue->backlog_bytes,
+                        queue->sent, queue->dropped,
+                        queue->sent ? queue->sojourn_msec / queue->sent : 0,
+                        queue->sojourn_max_msec);
+            }
+            fprintf(stream, "]}");
+            break;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter stats reply.");
+            fprintf(stream, "{type=\"ofexp\", exp_type=\"%u\"}", exp->type);
+        }
+    }
+
+    fclose(stream);
+    return str;
+}
@@ -35,6 +35,7 @@
 
 #include "../oflib/ofl-structs.h"
 #include "../oflib/ofl-messages.h"
+#include "openflow/openflow-ext.h"
 
 
 struct ofl_exp_openflow_msg_header {
@@ -58,6 +59,118 @@ struct ofl_exp_openflow_msg_set_dp_desc {
 };
 
 
+struct ofl_exp_openflow_mp_request_header {
+    struct ofl_msg_multipart_request_experimenter   header; /* OPENFLOW_VENDOR_ID */
+
+    uint32_t   type; /* OFP_EXT_STATS_* */
+};
+
+struct ofl_exp_openflow_mp_reply_header {
+    struct ofl_msg_multipart_reply_experimenter   header; /* OPENFLOW_VENDOR_ID */
+
+    uint32_t   type; /* OFP_EXT_STATS_* */
+};
+
+struct ofl_exp_openflow_mp_request_latency {
+    struct ofl_exp_openflow_mp_request_header   header; /* OFP_EXT_STATS_LATENCY */
+
+    uint8_t   command; /* OFP_EXT_LATENCY_GET... */
+};
+
+struct ofl_exp_openflow_latency_bucket {
+    uint64_t   ns;    /* lowest latency in the bucket */
+    uint64_t   count;
+};
+
+struct ofl_exp_openflow_latency_stage {
+    uint8_t    stage;    /* OFP_EXT_LATENCY_RX... */
+    uint8_t    table_id; /* table of a lookup, otherwise 0xff */
+    uint64_t   count;
+    uint64_t   sum_ns;
+    uint64_t   max_ns;
+
+    size_t                                   buckets_num;
+    struct ofl_exp_openflow_latency_bucket  *buckets; /* non-empty buckets, by latency */
+};
+
+struct ofl_exp_openflow_mp_reply_latency {
+    struct ofl_exp_openflow_mp_reply_header   header; /* OFP_EXT_STATS_LATENCY */
+
+    uint32_t                                flags; /* OFP_EXT_LATENCY_ENABLED... */
+    size_t                                  stages_num;
+    struct ofl_exp_openflow_latency_stage  *stages;
+};
+
+struct ofl_exp_openflow_discovery_port {
+    uint32_t   port_no;
+    uint64_t   counters[OFP_EXT_DISCOVERY_N_COUNTERS]; /* OFP_EXT_DISCOVERY_REQUEST_IN... */
+};
+
+struct ofl_exp_openflow_mp_reply_discovery {
+    struct ofl_exp_openflow_mp_reply_header   header; /* OFP_EXT_STATS_DISCOVERY */
+
+    uint64_t   exploration;
+    uint64_t   first_request;
+    uint64_t   convergence;
+    uint64_t   controller_connect;
+    uint64_t   local_port_ready;
+    uint64_t   replies_merged;
+    uint64_t   seen_evictions;
+
+    size_t                                   ports_num;
+    struct ofl_exp_openflow_discovery_port  *ports;
+};
+
+struct ofl_exp_openflow_connection {
+    uint32_t   remote;       /* controller, in the order they connected */
+    uint8_t    auxiliary_id; /* 0 for the main connection */
+    bool       connected;
+    uint32_t   txq;          /* messages waiting to be sent */
+    uint32_t   txq_max;
+    uint64_t   packet_ins;
+    uint64_t   dropped;      /* messages dropped, queue full */
+};
+
+struct ofl_exp_openflow_mp_reply_connections {
+    struct ofl_exp_openflow_mp_reply_header   header; /* OFP_EXT_STATS_CONNECTIONS */
+
+    size_t                               conns_num;
+    struct ofl_exp_openflow_connection  *conns;
+};
+
+struct ofl_exp_openflow_mp_reply_buffers {
+    struct ofl_exp_openflow_mp_reply_header   header; /* OFP_EXT_STATS_BUFFERS */
+
+    uint32_t   buffers;
+    uint32_t   buffered;      /* packets currently buffered */
+    uint64_t   bytes;
+    uint64_t   max_bytes;
+    uint64_t   saves;
+    uint64_t   save_failures;
+    uint64_t   hits;
+    uint64_t   misses;
+    uint64_t   evictions;
+};
+
+struct ofl_exp_openflow_queue {
+    uint32_t   port_no;
+    uint32_t   queue_id;
+    uint32_t   backlog_packets;  /* frames waiting */
+    uint64_t   backlog_bytes;
+    uint64_t   sent;
+    uint64_t   dropped;          /* queue full or send error */
+    uint64_t   sojourn_msec;     /* total time sent frames waited */
+    uint64_t   sojourn_max_msec;
+};
+
+struct ofl_exp_openflow_mp_reply_queues {
+    struct ofl_exp_openflow_mp_reply_header   header; /* OFP_EXT_STATS_QUEUES */
+
+    size_t                          queues_num;
+    struct ofl_exp_openflow_queue  *queues;
+};
+
+
 
 int
 ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter *msg, uint8_t **buf, size_t *buf_len);
@@ -71,5 +184,29 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg);
 char *
 ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg);
 
+int
+ofl_exp_openflow_stats_req_pack(struct ofl_msg_multipart_request_header *msg, uint8_t **buf, size_t *buf_len);
+
+ofl_err
+ofl_exp_openflow_stats_req_unpack(struct ofp_multipart_request *os, size_t *len, struct ofl_msg_multipart_request_header **msg);
+
+int
+ofl_exp_openflow_stats_req_free(struct ofl_msg_multipart_request_header *msg);
+
+char *
+ofl_exp_openflow_stats_req_to_string(struct ofl_msg_multipart_request_header *msg);
+
+int
+ofl_exp_openflow_stats_reply_pack(struct ofl_msg_multipart_reply_header *msg, uint8_t **buf, size_t *buf_len);
+
+ofl_err
+ofl_exp_openflow_stats_reply_unpack(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_multipart_reply_header **msg);
+
+int
+ofl_exp_openflow_stats_reply_free(struct ofl_msg_multipart_reply_header *msg);
+
+char *
+ofl_exp_openflow_stats_reply_to_string(struct ofl_msg_multipart_reply_header *msg);
+
 
 #endif /* OFL_EXP_OPENFLOW_H */
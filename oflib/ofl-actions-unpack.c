@@ -75,7 +75,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_PORT);
             }
 
-            da = (struct ofl_action_output *)malloc(sizeof(struct ofl_action_output));
+            da = (struct ofl_action_output *)ofl_malloc(sizeof(struct ofl_action_output));
             da->port = ntohl(sa->port);
             da->max_len = ntohs(sa->max_len);
 
@@ -86,14 +86,14 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_COPY_TTL_OUT: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
         case OFPAT_COPY_TTL_IN: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -108,7 +108,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_mpls_ttl *)src;
 
-            da = (struct ofl_action_mpls_ttl *)malloc(sizeof(struct ofl_action_mpls_ttl));
+            da = (struct ofl_action_mpls_ttl *)ofl_malloc(sizeof(struct ofl_action_mpls_ttl));
             da->mpls_ttl = sa->mpls_ttl;
 
             *len -= sizeof(struct ofp_action_mpls_ttl);
@@ -119,7 +119,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_DEC_MPLS_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_mpls_ttl);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -148,7 +148,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_ARGUMENT);
             }
 
-            da = (struct ofl_action_push *)malloc(sizeof(struct ofl_action_push));
+            da = (struct ofl_action_push *)ofl_malloc(sizeof(struct ofl_action_push));
             da->ethertype = ntohs(sa->ethertype);
 
             *len -= sizeof(struct ofp_action_push);
@@ -160,7 +160,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_POP_PBB: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
                 
@@ -175,7 +175,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_pop_mpls *)src;
 
-            da = (struct ofl_action_pop_mpls *)malloc(sizeof(struct ofl_action_pop_mpls));
+            da = (struct ofl_action_pop_mpls *)ofl_malloc(sizeof(struct ofl_action_pop_mpls));
             da->ethertype = ntohs(sa->ethertype);
 
             *len -= sizeof(struct ofp_action_pop_mpls);
@@ -194,7 +194,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_set_queue *)src;
 
-            da = (struct ofl_action_set_queue *)malloc(sizeof(struct ofl_action_set_queue));
+            da = (struct ofl_action_set_queue *)ofl_malloc(sizeof(struct ofl_action_set_queue));
             da->queue_id = ntohl(sa->queue_id);
 
             *len -= sizeof(struct ofp_action_set_queue);
@@ -222,7 +222,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
                 return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_OUT_GROUP);
             }
 
-            da = (struct ofl_action_group *)malloc(sizeof(struct ofl_action_group));
+            da = (struct ofl_action_group *)ofl_malloc(sizeof(struct ofl_action_group));
             da->group_id = ntohl(sa->group_id);
 
             *len -= sizeof(struct ofp_action_group);
@@ -241,7 +241,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 
             sa = (struct ofp_action_nw_ttl *)src;
 
-            da = (struct ofl_action_set_nw_ttl *)malloc(sizeof(struct ofl_action_set_nw_ttl));
+            da = (struct ofl_action_set_nw_ttl *)ofl_malloc(sizeof(struct ofl_action_set_nw_ttl));
             da->nw_ttl = sa->nw_ttl;
 
             *len -= sizeof(struct ofp_action_nw_ttl);
@@ -252,7 +252,7 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
         case OFPAT_DEC_NW_TTL: {
             //ofp_action_header length was already checked
             *len -= sizeof(struct ofp_action_header);
-            *dst = (struct ofl_action_header *)malloc(sizeof(struct ofl_action_header));
+            *dst = (struct ofl_action_header *)ofl_malloc(sizeof(struct ofl_action_header));
             break;
         }
 
@@ -262,13 +262,13 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
             uint8_t *value;
             
             sa = (struct ofp_action_set_field*) src;
-            da = (struct ofl_action_set_field *)malloc(sizeof(struct ofl_action_set_field));
-            da->field = (struct ofl_match_tlv*) malloc(sizeof(struct ofl_match_tlv));
+            da = (struct ofl_action_set_field *)ofl_malloc(sizeof(struct ofl_action_set_field));
+            da->field = (struct ofl_match_tlv*) ofl_malloc(sizeof(struct ofl_match_tlv));
             
             memcpy(&da->field->header,sa->field,4);
             da->field->header = ntohl(da->field->header);
             value = (uint8_t *) src + sizeof (struct ofp_action_set_field);
-            da->field->value = malloc(OXM_LENGTH(da->field->header));
+            da->field->value = ofl_malloc(OXM_LENGTH(da->field->header));
             /*TODO: need to check if other fields are valid */
             if(da->field->header == OXM_OF_IN_PORT || da->field->header == OXM_OF_IN_PHY_PORT
                                     || da->field->header == OXM_OF_METADATA
@@ -20,7 +20,9 @@
 #include <netinet/in.h>
 #include "ofl.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 #include "ofl-log.h"
+#include "oxm-match.h"
 
 #define LOG_MODULE ofl_act
 OFL_LOG_INIT(LOG_MODULE)
@@ -30,9 +32,9 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
     switch (act->type) {
         case OFPAT_SET_FIELD:{
             struct ofl_action_set_field *a = (struct ofl_action_set_field*) act;
-            free(a->field->value);
-            free(a->field);
-            free(a);
+            ofl_free(a->field->value);
+            ofl_free(a->field);
+            ofl_free(a);
             return;
             break;        
         }
@@ -64,7 +66,90 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
         default: {
         }
     }
-    free(act);
+    ofl_free(act);
+}
+
+ofl_err
+ofl_actions_clone(struct ofl_action_header *src, struct ofl_action_header **dst, struct ofl_exp *exp) {
+    size_t size;
+
+    switch (src->type) {
+        case OFPAT_OUTPUT:
+            size = sizeof(struct ofl_action_output);
+            break;
+        case OFPAT_SET_MPLS_TTL:
+            size = sizeof(struct ofl_action_mpls_ttl);
+            break;
+        case OFPAT_PUSH_VLAN:
+        case OFPAT_PUSH_MPLS:
+        case OFPAT_PUSH_PBB:
+            size = sizeof(struct ofl_action_push);
+            break;
+        case OFPAT_POP_MPLS:
+            size = sizeof(struct ofl_action_pop_mpls);
+            break;
+        case OFPAT_SET_QUEUE:
+            size = sizeof(struct ofl_action_set_queue);
+            break;
+        case OFPAT_GROUP:
+            size = sizeof(struct ofl_action_group);
+            break;
+        case OFPAT_SET_NW_TTL:
+            size = sizeof(struct ofl_action_set_nw_ttl);
+            break;
+        case OFPAT_COPY_TTL_OUT:
+        case OFPAT_COPY_TTL_IN:
+        case OFPAT_DEC_MPLS_TTL:
+        case OFPAT_POP_VLAN:
+        case OFPAT_POP_PBB:
+        case OFPAT_DEC_NW_TTL:
+            size = sizeof(struct ofl_action_header);
+            break;
+        case OFPAT_SET_FIELD: {
+            struct ofl_action_set_field *sa = (struct ofl_action_set_field *)src;
+            struct ofl_action_set_field *da = (struct ofl_action_set_field *)ofl_malloc(sizeof(struct ofl_action_set_field));
+            size_t len = OXM_LENGTH(sa->field->header);
+
+            da->header = sa->header;
+            da->field = (struct ofl_match_tlv *)ofl_malloc(sizeof(struct ofl_match_tlv));
+            da->field->header = sa->field->header;
+            da->field->value = ofl_malloc(len);
+            memcpy(da->field->value, sa->field->value, len);
+            *dst = (struct ofl_action_header *)da;
+            return 0;
+        }
+        case OFPAT_EXPERIMENTER: {
+            struct ofp_action_header *buf;
+            size_t len;
+            ofl_err error;
+
+            /* The layout of experimenter actions is only known to their
+             * callbacks, so go through the wire format. */
+            if (exp == NULL || exp->act == NULL || exp->act->pack == NULL ||
+                exp->act->unpack == NULL || exp->act->ofp_len == NULL) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to clone experimenter action, but no callback is given.");
+                return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_EXPERIMENTER);
+            }
+            len = exp->act->ofp_len(src);
+            buf = (struct ofp_action_header *)malloc(len);
+            exp->act->pack(src, buf);
+            error = exp->act->unpack(buf, &len, dst);
+            free(buf);
+            if (error) {
+                return error;
+            }
+            (*dst)->type = src->type;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to clone unknown action type (%u).", src->type);
+            return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_TYPE);
+        }
+    }
+
+    *dst = (struct ofl_action_header *)ofl_malloc(size);
+    memcpy(*dst, src, size);
+    return 0;
 }
 
 ofl_err
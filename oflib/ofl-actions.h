@@ -130,6 +130,12 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 void
 ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp);
 
+/* Makes a deep copy of the action in src. Memory is allocated with
+ * ofl_malloc(). In case of an experimenter action, it uses the passed in
+ * experimenter callback to pack and unpack it. */
+ofl_err
+ofl_actions_clone(struct ofl_action_header *src, struct ofl_action_header **dst, struct ofl_exp *exp);
+
 
 
 /****************************************************************************
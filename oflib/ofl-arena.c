@@ -0,0 +1,110 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "ofl-arena.h"
+#include "lib/util.h"
+
+/* Alignment of all allocations. */
+#define OFL_ARENA_ALIGN 16
+
+struct ofl_arena_chunk {
+    struct ofl_arena_chunk *next;
+    size_t                  size;   /* Bytes available in data. */
+    size_t                  used;   /* Bytes handed out from data. */
+    uint8_t                 data[] __attribute__((aligned(OFL_ARENA_ALIGN)));
+};
+
+static struct ofl_arena *current_arena = NULL;
+
+void
+ofl_arena_init(struct ofl_arena *arena, size_t chunk_size) {
+    arena->chunks = NULL;
+    arena->chunk_size = chunk_size;
+}
+
+void *
+ofl_arena_alloc(struct ofl_arena *arena, size_t size) {
+    struct ofl_arena_chunk *chunk = arena->chunks;
+    void *ptr;
+
+    size = ROUND_UP(size, OFL_ARENA_ALIGN);
+
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunk_size = MAX(arena->chunk_size, size);
+
+        chunk = xmalloc(sizeof *chunk + chunk_size);
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void
+ofl_arena_clear(struct ofl_arena *arena) {
+    struct ofl_arena_chunk *chunk, *next;
+
+    if (arena->chunks == NULL) {
+        return;
+    }
+    /* Keep the oldest chunk, which is the last one in the list. */
+    for (chunk = arena->chunks; chunk->next != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    chunk->used = 0;
+    arena->chunks = chunk;
+}
+
+void
+ofl_arena_destroy(struct ofl_arena *arena) {
+    struct ofl_arena_chunk *chunk, *next;
+
+    for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    arena->chunks = NULL;
+}
+
+struct ofl_arena *
+ofl_arena_set_current(struct ofl_arena *arena) {
+    struct ofl_arena *prev = current_arena;
+
+    current_arena = arena;
+    return prev;
+}
+
+void *
+ofl_malloc(size_t size) {
+    if (current_arena != NULL) {
+        return ofl_arena_alloc(current_arena, size);
+    }
+    return malloc(size);
+}
+
+void
+ofl_free(void *ptr) {
+    if (current_arena == NULL) {
+        free(ptr);
+    }
+}
@@ -0,0 +1,79 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OFL_ARENA_H
+#define OFL_ARENA_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/****************************************************************************
+ * Region allocator for OFLib structures.
+ *
+ * An arena hands out memory by bumping a pointer in large chunks, and all of
+ * it is released at once. OFLib unpack and clone functions allocate through
+ * ofl_malloc(), which uses the current arena if one is set, and the heap
+ * otherwise; ofl_free() is a no-op for the current arena. This way a whole
+ * message can be unpacked with a single allocation, and released with a
+ * single call.
+ *
+ * The current arena is global, so it must only be set around a synchronous
+ * call into OFLib.
+ ****************************************************************************/
+
+struct ofl_arena_chunk;
+
+struct ofl_arena {
+    struct ofl_arena_chunk *chunks;     /* Most recently added first. */
+    size_t                  chunk_size; /* Minimum size of a new chunk. */
+};
+
+/* Initializes an empty arena. No memory is allocated until first use. */
+void
+ofl_arena_init(struct ofl_arena *arena, size_t chunk_size);
+
+/* Returns 'size' bytes of memory from the arena, suitably aligned for any
+ * OFLib structure. */
+void *
+ofl_arena_alloc(struct ofl_arena *arena, size_t size);
+
+/* Releases everything allocated from the arena, but keeps its first chunk
+ * for reuse. */
+void
+ofl_arena_clear(struct ofl_arena *arena);
+
+/* Releases all memory held by the arena. */
+void
+ofl_arena_destroy(struct ofl_arena *arena);
+
+/* Makes 'arena' the current arena (or unsets it if null), and returns the
+ * previous one. */
+struct ofl_arena *
+ofl_arena_set_current(struct ofl_arena *arena);
+
+/* Allocates from the current arena, or from the heap if there is none. */
+void *
+ofl_malloc(size_t size);
+
+/* Frees memory allocated by ofl_malloc(). Does nothing while an arena is
+ * current, as all memory allocated at that time belongs to the arena. */
+void
+ofl_free(void *ptr);
+
+
+#endif /* OFL_ARENA_H */
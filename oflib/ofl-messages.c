@@ -34,8 +34,8 @@ OFL_LOG_INIT(LOG_MODULE)
  * structures. */
 static int
 ofl_msg_free_error(struct ofl_msg_error *msg) {
-    free(msg->data);
-    free(msg);
+    ofl_free(msg->data);
+    ofl_free(msg);
 
     return 0;
 }
@@ -80,7 +80,7 @@ ofl_msg_free_multipart_request(struct ofl_msg_multipart_request_header *msg, str
         default:
             return -1;
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -93,11 +93,11 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
     switch (msg->type) {
         case OFPMP_DESC: {
             struct ofl_msg_reply_desc *stat = (struct ofl_msg_reply_desc *) msg;
-            free(stat->mfr_desc);
-            free(stat->hw_desc);
-            free(stat->sw_desc);
-            free(stat->serial_num);
-            free(stat->dp_desc);
+            ofl_free(stat->mfr_desc);
+            ofl_free(stat->hw_desc);
+            ofl_free(stat->sw_desc);
+            ofl_free(stat->serial_num);
+            ofl_free(stat->dp_desc);
             break;
         }
         case OFPMP_FLOW: {
@@ -144,7 +144,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
         }
         case OFPMP_METER_FEATURES:{
             struct ofl_msg_multipart_reply_meter_features *feat = (struct ofl_msg_multipart_reply_meter_features *)msg;
-            free(feat->features);
+            ofl_free(feat->features);
             break;
         }
         case OFPMP_GROUP_DESC: {
@@ -166,7 +166,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
             break;        
         }
         case OFPMP_EXPERIMENTER: {
-            if (exp == NULL || exp->stats || exp->stats->reply_free == NULL) {
+            if (exp == NULL || exp->stats == NULL || exp->stats->reply_free == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free EXPERIMENTER stats reply, but no callback was given.");
                 break;
             }
@@ -181,7 +181,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
         }
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -197,7 +197,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
         }
         case OFPT_ECHO_REQUEST:
         case OFPT_ECHO_REPLY: {
-            free(((struct ofl_msg_echo *)msg)->data);
+            ofl_free(((struct ofl_msg_echo *)msg)->data);
             break;
         }
         case OFPT_EXPERIMENTER: {
@@ -218,16 +218,16 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
             break;
         }
         case OFPT_GET_CONFIG_REPLY: {
-            free(((struct ofl_msg_get_config_reply *)msg)->config);
+            ofl_free(((struct ofl_msg_get_config_reply *)msg)->config);
             break;
         }
         case OFPT_SET_CONFIG: {
-            free(((struct ofl_msg_set_config *)msg)->config);
+            ofl_free(((struct ofl_msg_set_config *)msg)->config);
             break;
         }
         case OFPT_PACKET_IN: {
             ofl_structs_free_match(((struct ofl_msg_packet_in *)msg)->match,NULL);
-            free(((struct ofl_msg_packet_in *)msg)->data);
+            ofl_free(((struct ofl_msg_packet_in *)msg)->data);
             break;
         }
         case OFPT_FLOW_REMOVED: {
@@ -235,7 +235,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
             break;
         }
         case OFPT_PORT_STATUS: {
-            free(((struct ofl_msg_port_status *)msg)->desc);
+            ofl_free(((struct ofl_msg_port_status *)msg)->desc);
             break;
         }
         case OFPT_PACKET_OUT: {
@@ -283,7 +283,21 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
         }
     }
     
-    free(msg);
+    ofl_free(msg);
+    return 0;
+}
+
+int
+ofl_msg_free_arena(struct ofl_msg_header *msg, struct ofl_exp *exp, struct ofl_arena *arena) {
+    struct ofl_arena *prev;
+
+    /* Walking the message still releases what was not taken from the arena,
+     * such as the buckets of match hash maps. */
+    prev = ofl_arena_set_current(arena);
+    ofl_msg_free(msg, exp);
+    ofl_arena_set_current(prev);
+
+    ofl_arena_clear(arena);
     return 0;
 }
 
@@ -293,19 +307,19 @@ ofl_msg_free_meter_mod(struct ofl_msg_meter_mod * msg, bool with_bands){
        OFL_UTILS_FREE_ARR_FUN(msg->bands, msg->meter_bands_num,
                                   ofl_structs_free_meter_bands);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int
 ofl_msg_free_packet_out(struct ofl_msg_packet_out *msg, bool with_data, struct ofl_exp *exp) {
     if (with_data) {
-        free(msg->data);
+        ofl_free(msg->data);
     }
     OFL_UTILS_FREE_ARR_FUN2(msg->actions, msg->actions_num,
                             ofl_actions_free, exp);
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -316,7 +330,7 @@ ofl_msg_free_group_mod(struct ofl_msg_group_mod *msg, bool with_buckets, struct
                                 ofl_structs_free_bucket, exp);
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -330,7 +344,7 @@ ofl_msg_free_flow_mod(struct ofl_msg_flow_mod *msg, bool with_match, bool with_i
                                 ofl_structs_free_instruction, exp);
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -340,7 +354,7 @@ ofl_msg_free_flow_removed(struct ofl_msg_flow_removed *msg, bool with_stats, str
     if (with_stats) {
         ofl_structs_free_flow_stats(msg->stats, exp);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -364,7 +378,7 @@ ofl_msg_merge_multipart_request_table_features(struct ofl_msg_multipart_request_
 
       for (i=0; i < merge->tables_num; i++) {
         j = orig->tables_num + i;
-        orig->table_features[j] = (struct ofl_table_features *)malloc(sizeof(struct ofl_table_features));
+        orig->table_features[j] = (struct ofl_table_features *)ofl_malloc(sizeof(struct ofl_table_features));
         memcpy(orig->table_features[j], merge->table_features[i], sizeof(struct ofl_table_features));
 	properties = merge->table_features[i]->properties;
 	properties_num = merge->table_features[i]->properties_num;
@@ -375,10 +389,10 @@ ofl_msg_merge_multipart_request_table_features(struct ofl_msg_multipart_request_
 	  case OFPTFPT_INSTRUCTIONS_MISS: {
 	    struct ofl_table_feature_prop_instructions *old_prop_i = (struct ofl_table_feature_prop_instructions*) old_prop;
 	    struct ofl_table_feature_prop_instructions *new_prop_i;
-	    new_prop_i = (struct ofl_table_feature_prop_instructions*) malloc(sizeof(struct ofl_table_feature_prop_instructions));
+	    new_prop_i = (struct ofl_table_feature_prop_instructions*) ofl_malloc(sizeof(struct ofl_table_feature_prop_instructions));
 	    new_prop = (struct ofl_table_feature_prop_header *) new_prop_i;
 	    memcpy((char *) new_prop, (char *) old_prop, sizeof(struct ofl_table_feature_prop_instructions));
-	    new_prop_i->instruction_ids = (struct ofl_instruction_header*) malloc(sizeof(struct ofl_instruction_header) * old_prop_i->ids_num);
+	    new_prop_i->instruction_ids = (struct ofl_instruction_header*) ofl_malloc(sizeof(struct ofl_instruction_header) * old_prop_i->ids_num);
 	    memcpy((char *) new_prop_i->instruction_ids, (char *) old_prop_i->instruction_ids, sizeof(struct ofl_instruction_header) * old_prop_i->ids_num);
 	    break;
 	  }
@@ -386,10 +400,10 @@ ofl_msg_merge_multipart_request_table_features(struct ofl_msg_multipart_request_
 	  case OFPTFPT_NEXT_TABLES_MISS: {
 	    struct ofl_table_feature_prop_next_tables *old_prop_nt = (struct ofl_table_feature_prop_next_tables*) old_prop;
 	    struct ofl_table_feature_prop_next_tables *new_prop_nt;
-	    new_prop_nt = (struct ofl_table_feature_prop_next_tables*) malloc(sizeof(struct ofl_table_feature_prop_next_tables));
+	    new_prop_nt = (struct ofl_table_feature_prop_next_tables*) ofl_malloc(sizeof(struct ofl_table_feature_prop_next_tables));
 	    new_prop = (struct ofl_table_feature_prop_header *) new_prop_nt;
 	    memcpy((char *) new_prop, (char *) old_prop, sizeof(struct ofl_table_feature_prop_next_tables));
-	    new_prop_nt->next_table_ids = (uint8_t*) malloc(sizeof(uint8_t) * old_prop_nt->table_num);
+	    new_prop_nt->next_table_ids = (uint8_t*) ofl_malloc(sizeof(uint8_t) * old_prop_nt->table_num);
 	    memcpy((char *) new_prop_nt->next_table_ids, (char *) old_prop_nt->next_table_ids, sizeof(uint8_t) * old_prop_nt->table_num);
 	    break;
 	  }
@@ -399,10 +413,10 @@ ofl_msg_merge_multipart_request_table_features(struct ofl_msg_multipart_request_
 	  case OFPTFPT_APPLY_ACTIONS_MISS: {
 	    struct ofl_table_feature_prop_actions *old_prop_a = (struct ofl_table_feature_prop_actions*) old_prop;
 	    struct ofl_table_feature_prop_actions *new_prop_a;
-	    new_prop_a = (struct ofl_table_feature_prop_actions*) malloc(sizeof(struct ofl_table_feature_prop_actions));
+	    new_prop_a = (struct ofl_table_feature_prop_actions*) ofl_malloc(sizeof(struct ofl_table_feature_prop_actions));
 	    new_prop = (struct ofl_table_feature_prop_header *) new_prop_a;
 	    memcpy((char *) new_prop, (char *) old_prop, sizeof(struct ofl_table_feature_prop_actions));
-	    new_prop_a->action_ids = (struct ofl_action_header*) malloc(sizeof(struct ofl_action_header) * old_prop_a->actions_num);
+	    new_prop_a->action_ids = (struct ofl_action_header*) ofl_malloc(sizeof(struct ofl_action_header) * old_prop_a->actions_num);
 	    memcpy((char *) new_prop_a->action_ids, (char *) old_prop_a->action_ids, sizeof(struct ofl_action_header) * old_prop_a->actions_num);
 	    break;
 	  }
@@ -414,10 +428,10 @@ ofl_msg_merge_multipart_request_table_features(struct ofl_msg_multipart_request_
 	  case OFPTFPT_APPLY_SETFIELD_MISS: { 
 	    struct ofl_table_feature_prop_oxm *old_prop_o = (struct ofl_table_feature_prop_oxm*) old_prop;
 	    struct ofl_table_feature_prop_oxm *new_prop_o;
-	    new_prop_o = (struct ofl_table_feature_prop_oxm*) malloc(sizeof(struct ofl_table_feature_prop_oxm));
+	    new_prop_o = (struct ofl_table_feature_prop_oxm*) ofl_malloc(sizeof(struct ofl_table_feature_prop_oxm));
 	    new_prop = (struct ofl_table_feature_prop_header *) new_prop_o;
 	    memcpy((char *) new_prop, (char *) old_prop, sizeof(struct ofl_table_feature_prop_oxm));
-	    new_prop_o->oxm_ids = (uint32_t*) malloc(sizeof(uint32_t) * old_prop_o->oxm_num);
+	    new_prop_o->oxm_ids = (uint32_t*) ofl_malloc(sizeof(uint32_t) * old_prop_o->oxm_num);
 	    memcpy((char *) new_prop_o->oxm_ids, (char *) old_prop_o->oxm_ids, sizeof(uint32_t) * old_prop_o->oxm_num);
 	    break;
 	  }
@@ -445,7 +459,7 @@ ofl_msg_merge_multipart_reply_flow(struct ofl_msg_multipart_reply_flow *orig, st
 
     for (i=0; i < merge->stats_num; i++) {
         j = orig->stats_num + i;
-        orig->stats[j] = (struct ofl_flow_stats *)malloc(sizeof(struct ofl_flow_stats));
+        orig->stats[j] = (struct ofl_flow_stats *)ofl_malloc(sizeof(struct ofl_flow_stats));
         memcpy(orig->stats[j], merge->stats[i], sizeof(struct ofl_flow_stats));
     }
 
@@ -465,7 +479,7 @@ ofl_msg_merge_multipart_reply_table(struct ofl_msg_multipart_reply_table *orig,
 
     for (i=0; i < merge->stats_num; i++) {
         j = orig->stats_num + i;
-        orig->stats[j] = (struct ofl_table_stats *)malloc(sizeof(struct ofl_table_stats));
+        orig->stats[j] = (struct ofl_table_stats *)ofl_malloc(sizeof(struct ofl_table_stats));
         memcpy(orig->stats[j], merge->stats[i], sizeof(struct ofl_table_stats));
     }
 
@@ -485,7 +499,7 @@ ofl_msg_merge_multipart_reply_port(struct ofl_msg_multipart_reply_port *orig, st
 
     for (i=0; i < merge->stats_num; i++) {
         j = orig->stats_num + i;
-        orig->stats[j] = (struct ofl_port_stats *)malloc(sizeof(struct ofl_port_stats));
+        orig->stats[j] = (struct ofl_port_stats *)ofl_malloc(sizeof(struct ofl_port_stats));
         memcpy(orig->stats[j], merge->stats[i], sizeof(struct ofl_port_stats));
     }
 
@@ -505,7 +519,7 @@ ofl_msg_merge_multipart_reply_queue(struct ofl_msg_multipart_reply_queue *orig,
 
     for (i=0; i < merge->stats_num; i++) {
         j = orig->stats_num + i;
-        orig->stats[j] = (struct ofl_queue_stats *)malloc(sizeof(struct ofl_queue_stats));
+        orig->stats[j] = (struct ofl_queue_stats *)ofl_malloc(sizeof(struct ofl_queue_stats));
         memcpy(orig->stats[j], merge->stats[i], sizeof(struct ofl_queue_stats));
     }
 
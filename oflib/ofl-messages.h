@@ -26,6 +26,7 @@
 #include "ofl.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
+#include "ofl-arena.h"
 
 
 /****************************************************************************
@@ -479,6 +480,13 @@ ofl_err
 ofl_msg_unpack(uint8_t *buf, size_t buf_len,
                struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp *exp);
 
+/* Same as ofl_msg_unpack(), but all memory of the message is taken from the
+ * given arena. The message must be released with ofl_msg_free_arena(); on
+ * error the arena is cleared. */
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_exp *exp, struct ofl_arena *arena);
+
 
 
 
@@ -491,6 +499,11 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len,
 int
 ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp);
 
+/* Frees a message unpacked with ofl_msg_unpack_arena(), and clears the
+ * arena. */
+int
+ofl_msg_free_arena(struct ofl_msg_header *msg, struct ofl_exp *exp, struct ofl_arena *arena);
+
 /* Calling this function frees the passed meter_mod message.*/
 int 
 ofl_msg_free_meter_mod(struct ofl_msg_meter_mod * msg, bool with_bands);
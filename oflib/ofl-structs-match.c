@@ -15,6 +15,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "lib/hash.h"
 #include "oxm-match.h"
@@ -30,11 +31,11 @@ ofl_structs_match_init(struct ofl_match *match){
 
 void
 ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint8_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -42,11 +43,11 @@ ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value){
 
 void
 ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value, uint8_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint8_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -55,11 +56,11 @@ ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value,
 
 void
 ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint16_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -68,11 +69,11 @@ ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value
 
 void
 ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t value, uint16_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint16_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -81,12 +82,12 @@ ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t valu
 
 void
 ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value){
-    struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
 
     int len = sizeof(uint32_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -95,11 +96,11 @@ ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value
 
 void
 ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t value, uint32_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint32_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -109,11 +110,11 @@ ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t valu
 
 void
 ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, &value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -122,11 +123,11 @@ ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value
 
 void
 ofl_structs_match_put64m(struct ofl_match *match, uint32_t header, uint64_t value, uint64_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, &value, len);
     memcpy(m->value + len, &mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -136,11 +137,11 @@ ofl_structs_match_put64m(struct ofl_match *match, uint32_t header, uint64_t valu
 
 void
 ofl_structs_match_put_pbb_isid(struct ofl_match *match, uint32_t header, uint8_t value[PBB_ISID_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = OXM_LENGTH(header);
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -149,11 +150,11 @@ ofl_structs_match_put_pbb_isid(struct ofl_match *match, uint32_t header, uint8_t
 
 void
 ofl_structs_match_put_pbb_isidm(struct ofl_match *match, uint32_t header, uint8_t value[PBB_ISID_LEN], uint8_t mask[PBB_ISID_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = OXM_LENGTH(header);
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, value, len);
     memcpy(m->value + len, mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -162,11 +163,11 @@ ofl_structs_match_put_pbb_isidm(struct ofl_match *match, uint32_t header, uint8_
 
 void
 ofl_structs_match_put_eth(struct ofl_match *match, uint32_t header, uint8_t value[ETH_ADDR_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = ETH_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -175,11 +176,11 @@ ofl_structs_match_put_eth(struct ofl_match *match, uint32_t header, uint8_t valu
 
 void
 ofl_structs_match_put_eth_m(struct ofl_match *match, uint32_t header, uint8_t value[ETH_ADDR_LEN], uint8_t mask[ETH_ADDR_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = ETH_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, value, len);
     memcpy(m->value + len, mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -190,11 +191,11 @@ ofl_structs_match_put_eth_m(struct ofl_match *match, uint32_t header, uint8_t va
 void
 ofl_structs_match_put_ipv6(struct ofl_match *match, uint32_t header, uint8_t value[IPv6_ADDR_LEN]){
 
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = IPv6_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, value, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -203,11 +204,11 @@ ofl_structs_match_put_ipv6(struct ofl_match *match, uint32_t header, uint8_t val
 
 void
 ofl_structs_match_put_ipv6m(struct ofl_match *match, uint32_t header, uint8_t value[IPv6_ADDR_LEN], uint8_t mask[IPv6_ADDR_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = IPv6_ADDR_LEN;
 
     m->header = header;
-    m->value = malloc(len*2);
+    m->value = ofl_malloc(len*2);
     memcpy(m->value, value, len);
     memcpy(m->value + len, mask, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
@@ -219,14 +220,14 @@ ofl_structs_match_put_ipv6m(struct ofl_match *match, uint32_t header, uint8_t va
 
 void
 ofl_structs_match_put_64_as_a_mac(struct ofl_match *match, uint32_t header, uint64_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint8_t)*6;
     uint64_t aux = value << 16; //desplazamos en dos octectos para dejar los ceros a la derecha
     uint8_t *mac_result = (uint8_t *)&aux;
 
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     memcpy(m->value, mac_result, len);
     hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
     match->header.length += len + 4;
@@ -242,12 +243,12 @@ static inline uint64_t ntoh642(uint64_t n) {
 
 void ofl_structs_match_put_macs(struct ofl_match *match, uint32_t header, uint64_t *  value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t)*EHDDP_MAX_ELEMENTS, index = 0;
     uint64_t dataaux=0;
     
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     
     for (index=0;index<EHDDP_MAX_ELEMENTS;index++)
     {
@@ -262,12 +263,12 @@ void ofl_structs_match_put_macs(struct ofl_match *match, uint32_t header, uint64
 
 void ofl_structs_match_put_port(struct ofl_match *match, uint32_t header, uint32_t *  value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
+    struct ofl_match_tlv *m = ofl_malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint32_t)*EHDDP_MAX_ELEMENTS, index=0;
     uint32_t dataaux=0;
 
     m->header = header;
-    m->value = malloc(len);
+    m->value = ofl_malloc(len);
     
     for (index=0;index<EHDDP_MAX_ELEMENTS;index++)
     {
@@ -24,6 +24,7 @@
 #include "ofl-utils.h"
 #include "ofl-log.h"
 #include "hmap.h"
+#include "oxm-match.h"
 #include "openflow/openflow.h"
 
 #define UNUSED __attribute__((__unused__))
@@ -343,7 +344,7 @@ void
 ofl_structs_free_packet_queue(struct ofl_packet_queue *queue) {
     OFL_UTILS_FREE_ARR(queue->properties, queue->properties_num);
     
-    free(queue);
+    ofl_free(queue);
 }
 
 void
@@ -373,18 +374,18 @@ ofl_structs_free_instruction(struct ofl_instruction_header *inst, struct ofl_exp
             }
         }
     }
-    free(inst);
+    ofl_free(inst);
 }
 
 void ofl_structs_free_meter_bands(struct ofl_meter_band_header *meter_band){
     
-    free(meter_band);
+    ofl_free(meter_band);
 }
 
 void
 ofl_structs_free_meter_band_stats(struct ofl_meter_band_stats* s){
     
-    free(s);
+    ofl_free(s);
  }
 
 void
@@ -392,7 +393,7 @@ ofl_structs_free_meter_stats(struct ofl_meter_stats *stats){
     
     OFL_UTILS_FREE_ARR_FUN(stats->band_stats, stats->meter_bands_num,
                             ofl_structs_free_meter_band_stats);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -400,13 +401,13 @@ ofl_structs_free_meter_config(struct ofl_meter_config *conf){
     
     OFL_UTILS_FREE_ARR_FUN(conf->bands, conf->meter_bands_num,
                             ofl_structs_free_meter_bands);
-    free(conf);
+    ofl_free(conf);
 }
 
 void
 ofl_structs_free_table_stats(struct ofl_table_stats *stats) {
     
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -414,7 +415,7 @@ ofl_structs_free_bucket(struct ofl_bucket *bucket, struct ofl_exp *exp) {
     
     OFL_UTILS_FREE_ARR_FUN2(bucket->actions, bucket->actions_num,
                             ofl_actions_free, exp);
-    free(bucket);
+    ofl_free(bucket);
 }
 
 
@@ -424,21 +425,21 @@ ofl_structs_free_flow_stats(struct ofl_flow_stats *stats, struct ofl_exp *exp) {
     OFL_UTILS_FREE_ARR_FUN2(stats->instructions, stats->instructions_num,
                             ofl_structs_free_instruction, exp);
     ofl_structs_free_match(stats->match, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_port(struct ofl_port *port) {
     
-    free(port->name);
-    free(port);
+    ofl_free(port->name);
+    ofl_free(port);
 }
 
 void
 ofl_structs_free_group_stats(struct ofl_group_stats *stats) {
     
     OFL_UTILS_FREE_ARR(stats->counters, stats->counters_num);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -446,7 +447,7 @@ ofl_structs_free_group_desc_stats(struct ofl_group_desc_stats *stats, struct ofl
     
     OFL_UTILS_FREE_ARR_FUN2(stats->buckets, stats->buckets_num,
                             ofl_structs_free_bucket, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -458,8 +459,8 @@ ofl_structs_free_table_features(struct ofl_table_features* features, struct ofl_
 
     OFL_UTILS_FREE_ARR_FUN2(features->properties, features->properties_num,
                             ofl_structs_free_table_properties, exp);
-    free(features->name);
-    free(features);
+    ofl_free(features->name);
+    ofl_free(features);
 }
 
 void
@@ -469,13 +470,13 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_INSTRUCTIONS):
         case (OFPTFPT_INSTRUCTIONS_MISS):{
             struct ofl_table_feature_prop_instructions *inst = (struct ofl_table_feature_prop_instructions *)prop;
-            free(inst->instruction_ids);
+            ofl_free(inst->instruction_ids);
             break;
         }
         case (OFPTFPT_NEXT_TABLES_MISS):
         case (OFPTFPT_NEXT_TABLES):{
             struct ofl_table_feature_prop_next_tables *tables = (struct ofl_table_feature_prop_next_tables *)prop ;
-            free(tables->next_table_ids);
+            ofl_free(tables->next_table_ids);
             break;
         }
         case (OFPTFPT_WRITE_ACTIONS):
@@ -483,7 +484,7 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_APPLY_ACTIONS):
         case (OFPTFPT_APPLY_ACTIONS_MISS):{
             struct ofl_table_feature_prop_actions *act = (struct ofl_table_feature_prop_actions *)prop;
-            free(act->action_ids);
+            ofl_free(act->action_ids);
             break;
         }
         case (OFPTFPT_APPLY_SETFIELD):
@@ -493,11 +494,11 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_WILDCARDS):
         case (OFPTFPT_MATCH):{
             struct ofl_table_feature_prop_oxm *oxm = (struct ofl_table_feature_prop_oxm *)prop;
-            free(oxm->oxm_ids);
+            ofl_free(oxm->oxm_ids);
             break;
         }
     }
-    free(prop);
+    ofl_free(prop);
 }
 
 void
@@ -509,20 +510,20 @@ ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp *exp) {
                 struct ofl_match *m = (struct ofl_match*) match;
                 struct ofl_match_tlv *tlv, *next;
                 HMAP_FOR_EACH_SAFE(tlv, next, struct ofl_match_tlv, hmap_node, &m->match_fields){
-                    free(tlv->value);
-                    free(tlv);
+                    ofl_free(tlv->value);
+                    ofl_free(tlv);
                 }
                 hmap_destroy(&m->match_fields);
-                free(m);
+                ofl_free(m);
             }
-            else free(match);
+            else ofl_free(match);
 
             break;
         }
         default: {
             if (exp == NULL || exp->match == NULL || exp->match->free == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free experimented instruction, but no callback was given.");
-                free(match);
+                ofl_free(match);
             } else {
                 exp->match->free(match);
             }
@@ -531,3 +532,119 @@ ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp *exp) {
 }
 
 
+
+ofl_err
+ofl_structs_match_clone(struct ofl_match_header *src, struct ofl_match_header **dst, struct ofl_exp *exp) {
+
+    switch (src->type) {
+        case (OFPMT_OXM): {
+            struct ofl_match *sm = (struct ofl_match *)src;
+            struct ofl_match *dm = (struct ofl_match *)ofl_malloc(sizeof(struct ofl_match));
+            struct ofl_match_tlv *tlv;
+
+            ofl_structs_match_init(dm);
+            hmap_reserve(&dm->match_fields, hmap_count(&sm->match_fields));
+            HMAP_FOR_EACH(tlv, struct ofl_match_tlv, hmap_node, &sm->match_fields) {
+                struct ofl_match_tlv *t = (struct ofl_match_tlv *)ofl_malloc(sizeof(struct ofl_match_tlv));
+                size_t len = OXM_LENGTH(tlv->header);
+
+                t->header = tlv->header;
+                t->value = (uint8_t *)ofl_malloc(len);
+                memcpy(t->value, tlv->value, len);
+                hmap_insert(&dm->match_fields, &t->hmap_node, tlv->hmap_node.hash);
+            }
+            dm->header.length = sm->header.length;
+            *dst = (struct ofl_match_header *)dm;
+            return 0;
+        }
+        default: {
+            struct ofp_match *buf;
+            size_t len;
+            ofl_err error;
+
+            if (exp == NULL || exp->match == NULL || exp->match->pack == NULL ||
+                exp->match->unpack == NULL || exp->match->ofp_len == NULL) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to clone experimenter match, but no callback was given.");
+                return ofl_error(OFPET_BAD_MATCH, OFPBMC_BAD_TYPE);
+            }
+            len = exp->match->ofp_len(src);
+            buf = (struct ofp_match *)malloc(len);
+            exp->match->pack(src, buf);
+            error = exp->match->unpack(buf, &len, dst);
+            free(buf);
+            return error;
+        }
+    }
+}
+
+ofl_err
+ofl_structs_instruction_clone(struct ofl_instruction_header *src, struct ofl_instruction_header **dst, struct ofl_exp *exp) {
+    size_t size;
+
+    switch (src->type) {
+        case OFPIT_GOTO_TABLE:
+            size = sizeof(struct ofl_instruction_goto_table);
+            break;
+        case OFPIT_WRITE_METADATA:
+            size = sizeof(struct ofl_instruction_write_metadata);
+            break;
+        case OFPIT_METER:
+            size = sizeof(struct ofl_instruction_meter);
+            break;
+        case OFPIT_CLEAR_ACTIONS:
+            size = sizeof(struct ofl_instruction_header);
+            break;
+        case OFPIT_WRITE_ACTIONS:
+        case OFPIT_APPLY_ACTIONS: {
+            struct ofl_instruction_actions *si = (struct ofl_instruction_actions *)src;
+            struct ofl_instruction_actions *di = (struct ofl_instruction_actions *)ofl_malloc(sizeof(struct ofl_instruction_actions));
+            size_t i;
+
+            di->header = si->header;
+            di->actions_num = 0;
+            di->actions = (struct ofl_action_header **)ofl_malloc(si->actions_num * sizeof(struct ofl_action_header *));
+            for (i = 0; i < si->actions_num; i++) {
+                ofl_err error = ofl_actions_clone(si->actions[i], &di->actions[i], exp);
+
+                if (error) {
+                    ofl_structs_free_instruction((struct ofl_instruction_header *)di, exp);
+                    return error;
+                }
+                di->actions_num++;
+            }
+            *dst = (struct ofl_instruction_header *)di;
+            return 0;
+        }
+        case OFPIT_EXPERIMENTER: {
+            struct ofp_instruction *buf;
+            size_t len;
+            ofl_err error;
+
+            /* The layout of experimenter instructions is only known to their
+             * callbacks, so go through the wire format. */
+            if (exp == NULL || exp->inst == NULL || exp->inst->pack == NULL ||
+                exp->inst->unpack == NULL || exp->inst->ofp_len == NULL) {
+                OFL_LOG_WARN(LOG_MODULE, "Trying to clone experimenter instruction, but no callback was given.");
+                return ofl_error(OFPET_BAD_INSTRUCTION, OFPBIC_UNSUP_INST);
+            }
+            len = exp->inst->ofp_len(src);
+            buf = (struct ofp_instruction *)malloc(len);
+            exp->inst->pack(src, buf);
+            error = exp->inst->unpack(buf, &len, dst);
+            free(buf);
+            if (error) {
+                return error;
+            }
+            (*dst)->type = src->type;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to clone unknown instruction type (%u).", src->type);
+            return ofl_error(OFPET_BAD_INSTRUCTION, OFPBIC_UNKNOWN_INST);
+        }
+    }
+
+    *dst = (struct ofl_instruction_header *)ofl_malloc(size);
+    memcpy(*dst, src, size);
+    return 0;
+}
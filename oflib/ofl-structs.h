@@ -620,6 +620,19 @@ ofl_structs_free_table_features(struct ofl_table_features* features, struct ofl_
 void
 ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, struct ofl_exp *exp);
 
+/****************************************************************************
+ * Functions for cloning structures
+ ****************************************************************************/
+
+/* Deep copies the structure in src to a new structure pointed at by dst. All
+ * memory is obtained through ofl_malloc(), so the copy can be placed in an
+ * arena. Returns zero on success. */
+ofl_err
+ofl_structs_match_clone(struct ofl_match_header *src, struct ofl_match_header **dst, struct ofl_exp *exp);
+
+ofl_err
+ofl_structs_instruction_clone(struct ofl_instruction_header *src, struct ofl_instruction_header **dst, struct ofl_exp *exp);
+
 /****************************************************************************
  * Utility functions
  ****************************************************************************/
@@ -20,6 +20,7 @@
 
 
 #include <netinet/in.h>
+#include "ofl-arena.h"
 
 
 /* Given an array of pointers _elem_, and the number of elements in the array
@@ -29,9 +30,9 @@
 {                                               \
      size_t _iter;                              \
      for (_iter=0; _iter<ELEM_NUM; _iter++) {   \
-         free(ELEMS[_iter]);                    \
+         ofl_free(ELEMS[_iter]);                \
      }                                          \
-     free(ELEMS);                               \
+     ofl_free(ELEMS);                           \
 }
 
  /* Given an array of pointers _elem_, and the number of elements in the array
@@ -43,7 +44,7 @@
      for (_iter=0; _iter<ELEM_NUM; _iter++) {   \
          FREE_FUN(ELEMS[_iter]);                \
      }                                          \
-     free(ELEMS);                               \
+     ofl_free(ELEMS);                           \
 }
 
 #define OFL_UTILS_FREE_ARR_FUN2(ELEMS, ELEM_NUM, FREE_FUN, ARG2) \
@@ -52,7 +53,7 @@
      for (_iter=0; _iter<ELEM_NUM; _iter++) {    \
          FREE_FUN(ELEMS[_iter], ARG2);           \
      }                                           \
-     free(ELEMS);                                \
+     ofl_free(ELEMS);                            \
 }
 
 
@@ -55,6 +55,42 @@ struct oxm_field {
 /* All the known fields. */
 extern struct oxm_field all_fields[NUM_OXM_FIELDS];
 
+/* A set of OXM fields of the OpenFlow basic class, indexed by OXM_FIELD().
+ * Fields of other classes are always considered members. */
+struct oxm_field_set {
+    uint64_t bits[2];
+};
+
+static inline void
+oxm_field_set_add(struct oxm_field_set *set, uint32_t header)
+{
+    if (OXM_VENDOR(header) == OFPXMC_OPENFLOW_BASIC) {
+        set->bits[OXM_FIELD(header) / 64] |= UINT64_C(1) << (OXM_FIELD(header) % 64);
+    }
+}
+
+static inline void
+oxm_field_set_remove(struct oxm_field_set *set, uint32_t header)
+{
+    if (OXM_VENDOR(header) == OFPXMC_OPENFLOW_BASIC) {
+        set->bits[OXM_FIELD(header) / 64] &= ~(UINT64_C(1) << (OXM_FIELD(header) % 64));
+    }
+}
+
+static inline bool
+oxm_field_set_contains(const struct oxm_field_set *set, uint32_t header)
+{
+    return (OXM_VENDOR(header) != OFPXMC_OPENFLOW_BASIC
+            || (set->bits[OXM_FIELD(header) / 64] & (UINT64_C(1) << (OXM_FIELD(header) % 64))) != 0);
+}
+
+/* Returns true if every field in 'b' is also in 'a'. */
+static inline bool
+oxm_field_set_covers(const struct oxm_field_set *a, const struct oxm_field_set *b)
+{
+    return (b->bits[0] & ~a->bits[0]) == 0 && (b->bits[1] & ~a->bits[1]) == 0;
+}
+
 bool 
 check_bad_wildcard(uint8_t value, uint8_t mask);
 
@@ -24,7 +24,6 @@
 #include "oflib/ofl-actions.h"
 #include "oflib/ofl-print.h"
 #include "packet.h"
-#include "list.h"
 #include "util.h"
 #include "vlog.h"
 
@@ -32,137 +31,77 @@
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
-struct action_set_entry;
-
-struct action_set {
-    struct list     actions;   /* the list of actions in the action set,
-+                                   stored in the order of precedence as defined
-+                                   by the specification. */
-    struct ofl_exp *exp;       /* experimenter callbacks */
-};
-
-struct action_set_entry {
-    struct list                node;
-
-    struct ofl_action_header  *action;  /* these actions point to actions in
-+                                        * flow table entry instructions */
-    int                        order;   /* order of the entry as defined */
-};
-
-
-
-
-/* Returns the priority of the action it should be executed in
- * according to the spec. Note, that the actions are already
- * stored in this order.
- */
-static int
-action_set_order(struct ofl_action_header *act) {
+/* Returns the slot of the action in the set. Slots are ordered by the
+ * priority the actions should be executed in according to the spec. */
+static enum action_set_slot
+action_set_slot(struct ofl_action_header *act) {
     switch (act->type) {
-        case (OFPAT_COPY_TTL_OUT):   return 40;
-        case (OFPAT_COPY_TTL_IN):    return 10;
-        case (OFPAT_SET_FIELD):      return 60;
-        case (OFPAT_SET_MPLS_TTL):   return 60;
-        case (OFPAT_DEC_MPLS_TTL):   return 50;
-        case (OFPAT_PUSH_PBB):       return 30;
-        case (OFPAT_POP_PBB):        return 20;
-        case (OFPAT_PUSH_VLAN):      return 30;
-        case (OFPAT_POP_VLAN):       return 20;
-        case (OFPAT_PUSH_MPLS):      return 30;
-        case (OFPAT_POP_MPLS):       return 20;
-        case (OFPAT_SET_QUEUE):      return 70;
-        case (OFPAT_GROUP):          return 80;
-        case (OFPAT_SET_NW_TTL):     return 60;
-        case (OFPAT_DEC_NW_TTL):     return 50;
-        case (OFPAT_OUTPUT):         return 90;
-        case (OFPAT_EXPERIMENTER):   return 75;
-        default:                     return 79;
+        case (OFPAT_COPY_TTL_IN):    return ACTION_SET_SLOT_COPY_TTL_IN;
+        case (OFPAT_POP_VLAN):       return ACTION_SET_SLOT_POP_VLAN;
+        case (OFPAT_POP_MPLS):       return ACTION_SET_SLOT_POP_MPLS;
+        case (OFPAT_POP_PBB):        return ACTION_SET_SLOT_POP_PBB;
+        case (OFPAT_PUSH_MPLS):      return ACTION_SET_SLOT_PUSH_MPLS;
+        case (OFPAT_PUSH_PBB):       return ACTION_SET_SLOT_PUSH_PBB;
+        case (OFPAT_PUSH_VLAN):      return ACTION_SET_SLOT_PUSH_VLAN;
+        case (OFPAT_COPY_TTL_OUT):   return ACTION_SET_SLOT_COPY_TTL_OUT;
+        case (OFPAT_DEC_MPLS_TTL):   return ACTION_SET_SLOT_DEC_MPLS_TTL;
+        case (OFPAT_DEC_NW_TTL):     return ACTION_SET_SLOT_DEC_NW_TTL;
+        case (OFPAT_SET_MPLS_TTL):   return ACTION_SET_SLOT_SET_MPLS_TTL;
+        case (OFPAT_SET_NW_TTL):     return ACTION_SET_SLOT_SET_NW_TTL;
+        case (OFPAT_SET_FIELD):      return ACTION_SET_SLOT_SET_FIELD;
+        case (OFPAT_SET_QUEUE):      return ACTION_SET_SLOT_SET_QUEUE;
+        case (OFPAT_EXPERIMENTER):   return ACTION_SET_SLOT_EXPERIMENTER;
+        case (OFPAT_GROUP):          return ACTION_SET_SLOT_GROUP;
+        case (OFPAT_OUTPUT):         return ACTION_SET_SLOT_OUTPUT;
+        default:                     return ACTION_SET_SLOT_OTHER;
     }
 }
 
 
-/* Creates a new set entry */
-struct action_set *
-action_set_create(struct ofl_exp *exp) {
-    struct action_set *set = xmalloc(sizeof(struct action_set));
-    list_init(&set->actions);
+void
+action_set_init(struct action_set *set, struct ofl_exp *exp) {
+    set->slots_used = 0;
+    set->set_fields_num = 0;
     set->exp = exp;
-
-    return set;
-}
-
-void action_set_destroy(struct action_set *set) {
-    action_set_clear_actions(set);
-    free(set);
-}
-
-static struct action_set_entry *
-action_set_create_entry(struct ofl_action_header *act) {
-    struct action_set_entry *entry;
-
-    entry = xmalloc(sizeof(struct action_set_entry));
-    entry->action = act;
-    entry->order = action_set_order(act);
-
-    return entry;
 }
 
-struct action_set *
-action_set_clone(struct action_set *set) {
-    struct action_set *s = xmalloc(sizeof(struct action_set));
-    struct action_set_entry *entry, *new_entry;
-
-    list_init(&s->actions);
-    s->exp = set->exp;
+/* Writes a set-field action to the action set. Overwrites an existing
+ * set-field action on the same field. */
+static void
+action_set_write_set_field(struct action_set *set,
+                           struct ofl_action_set_field *act) {
+    size_t i;
 
-    LIST_FOR_EACH(entry, struct action_set_entry, node, &set->actions) {
-        new_entry = action_set_create_entry(entry->action);
-        list_push_back(&s->actions, &new_entry->node);
+    for (i = 0; i < set->set_fields_num; i++) {
+        if (set->set_fields[i]->field->header == act->field->header) {
+            set->set_fields[i] = act;
+            return;
+        }
     }
-
-    return s;
+    if (set->set_fields_num == NUM_OXM_FIELDS) {
+        /* Cannot happen with valid OXM fields, as each one has a slot. */
+        VLOG_WARN_RL(LOG_MODULE, &rl, "Too many set-field actions in action set.");
+        return;
+    }
+    set->set_fields[set->set_fields_num++] = act;
+    set->slots_used |= 1u << ACTION_SET_SLOT_SET_FIELD;
 }
 
-
 /* Writes a single action to the action set. Overwrites existing actions with
- * the same type in the set. The list order is based on the precedence defined
- * in the specification. */
+ * the same type in the set. */
 static void
 action_set_write_action(struct action_set *set,
                         struct ofl_action_header *act) {
-    struct action_set_entry *entry, *new_entry;
+    enum action_set_slot slot = action_set_slot(act);
 
-    new_entry = action_set_create_entry(act);
-
-    LIST_FOR_EACH(entry, struct action_set_entry, node, &set->actions) {
-        if (entry->action->type == new_entry->action->type) {
-            if(entry->action->type == OFPAT_SET_FIELD){
-                struct ofl_action_set_field *new_act = 
-                        (struct ofl_action_set_field*) new_entry->action;
-                struct ofl_action_set_field *act = 
-                            (struct ofl_action_set_field *) entry->action;
-                if(act->field->header != new_act->field->header){
-                    continue;
-                }     
-            } 
-            /* replace same type of action */
-            list_replace(&new_entry->node, &entry->node);
-            /* NOTE: action in entry must not be freed, as it is owned by the
-             *       write instruction which added the action to the set */
-            free(entry);
-
-            return;
-        }
-        if (new_entry->order < entry->order) {
-            /* insert higher order action before */
-            list_insert(&entry->node, &new_entry->node);
-
-            return;
-        }
+    if (slot == ACTION_SET_SLOT_SET_FIELD) {
+        action_set_write_set_field(set, (struct ofl_action_set_field *)act);
+        return;
     }
-
-    /* add action to the end of set */
-    list_insert(&entry->node, &new_entry->node);
+    /* NOTE: a replaced action must not be freed, as it is owned by the
+     *       write instruction which added the action to the set */
+    set->slots[slot] = act;
+    set->slots_used |= 1u << slot;
 }
 
 
@@ -175,34 +114,42 @@ action_set_write_actions(struct action_set *set,
     for (i=0; i<actions_num; i++) {
         action_set_write_action(set, actions[i]);
     }
-    VLOG_DBG_RL(LOG_MODULE, &rl, "%s", action_set_to_string(set));
+    if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+        char *str = action_set_to_string(set);
+        VLOG_DBG_RL(LOG_MODULE, &rl, "%s", str);
+        free(str);
+    }
 }
 
 void
 action_set_clear_actions(struct action_set *set) {
-    struct action_set_entry *entry, *next;
-
-    LIST_FOR_EACH_SAFE(entry, next, struct action_set_entry, node, &set->actions) {
-        list_remove(&entry->node);
-        // NOTE: action in entry must not be freed, as it is owned by the write instruction
-        //       which added the action to the set
-        free(entry);
-    }
+    // NOTE: actions in the set must not be freed, as they are owned by the
+    //       write instruction which added the action to the set
+    set->slots_used = 0;
+    set->set_fields_num = 0;
 }
 
 void
 action_set_execute(struct action_set *set, struct packet *pkt, uint64_t cookie) {
-    struct action_set_entry *entry, *next;
+    uint32_t used = set->slots_used;
+    size_t i;
+
+    while (used != 0) {
+        enum action_set_slot slot = __builtin_ctz(used);
+        used &= used - 1;
 
-    LIST_FOR_EACH_SAFE(entry, next, struct action_set_entry, node, &set->actions) {
-        dp_execute_action(pkt, entry->action);
-        list_remove(&entry->node);
-        free(entry);
+        if (slot == ACTION_SET_SLOT_SET_FIELD) {
+            for (i = 0; i < set->set_fields_num; i++) {
+                dp_execute_action(pkt, (struct ofl_action_header *)set->set_fields[i]);
+            }
+        } else {
+            dp_execute_action(pkt, set->slots[slot]);
+        }
     }
 
     /* Clear the action set in any case. Group processing depend on
      * a clean action-set. Jean II */
-    action_set_clear_actions(pkt->action_set);
+    action_set_clear_actions(set);
 
         /* According to the spec. if there was a group action, the output
          * port action should be ignored */
@@ -245,15 +192,28 @@ action_set_to_string(struct action_set *set) {
 
 void
 action_set_print(FILE *stream, struct action_set *set) {
-    struct action_set_entry *entry;
+    uint32_t used = set->slots_used;
+    bool first = true;
+    size_t i;
 
     fprintf(stream, "[");
 
-    LIST_FOR_EACH(entry, struct action_set_entry, node, &set->actions) {
-        ofl_action_print(stream, entry->action, set->exp);
-        if (entry->node.next != &set->actions) { fprintf(stream, ", "); }
+    while (used != 0) {
+        enum action_set_slot slot = __builtin_ctz(used);
+        used &= used - 1;
+
+        if (slot == ACTION_SET_SLOT_SET_FIELD) {
+            for (i = 0; i < set->set_fields_num; i++) {
+                if (!first) { fprintf(stream, ", "); }
+                ofl_action_print(stream, (struct ofl_action_header *)set->set_fields[i], set->exp);
+                first = false;
+            }
+        } else {
+            if (!first) { fprintf(stream, ", "); }
+            ofl_action_print(stream, set->slots[slot], set->exp);
+            first = false;
+        }
     }
 
     fprintf(stream, "]");
 }
-
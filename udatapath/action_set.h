@@ -20,13 +20,13 @@
 
 #include <sys/types.h>
 #include <stdio.h>
-#include "datapath.h"
-#include "packet.h"
+#include <stdint.h>
+#include <stdbool.h>
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
 #include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
 
-struct action_set;
 struct datapath;
 struct packet;
 
@@ -35,17 +35,56 @@ struct packet;
  * Implementation of an action set associated with a datapath packet
  ****************************************************************************/
 
-struct action_set *
-action_set_create(struct ofl_exp *exp);
+/* Slots of the action set, listed in the order of execution defined by the
+ * specification. The set holds at most one action per slot, except for
+ * set-field actions, which are kept one per OXM field in set_fields. */
+enum action_set_slot {
+    ACTION_SET_SLOT_COPY_TTL_IN,
+    ACTION_SET_SLOT_POP_VLAN,
+    ACTION_SET_SLOT_POP_MPLS,
+    ACTION_SET_SLOT_POP_PBB,
+    ACTION_SET_SLOT_PUSH_MPLS,
+    ACTION_SET_SLOT_PUSH_PBB,
+    ACTION_SET_SLOT_PUSH_VLAN,
+    ACTION_SET_SLOT_COPY_TTL_OUT,
+    ACTION_SET_SLOT_DEC_MPLS_TTL,
+    ACTION_SET_SLOT_DEC_NW_TTL,
+    ACTION_SET_SLOT_SET_MPLS_TTL,
+    ACTION_SET_SLOT_SET_NW_TTL,
+    ACTION_SET_SLOT_SET_FIELD,
+    ACTION_SET_SLOT_SET_QUEUE,
+    ACTION_SET_SLOT_EXPERIMENTER,
+    ACTION_SET_SLOT_OTHER,
+    ACTION_SET_SLOT_GROUP,
+    ACTION_SET_SLOT_OUTPUT,
 
-/* Destroys an action set */
+    ACTION_SET_SLOTS_NUM
+};
+
+/* The action set is embedded in the packet, so writing, clearing and
+ * executing it never allocates. Slots are only valid if their bit is set
+ * in slots_used; set_fields is only valid up to set_fields_num. */
+struct action_set {
+    uint32_t                     slots_used;   /* bitmap of used slots */
+    struct ofl_action_header    *slots[ACTION_SET_SLOTS_NUM];
+                                               /* these actions point to
+                                                * actions in flow table entry
+                                                * instructions */
+    size_t                       set_fields_num;
+    struct ofl_action_set_field *set_fields[NUM_OXM_FIELDS];
+                                               /* stored in write order */
+    struct ofl_exp              *exp;          /* experimenter callbacks */
+};
+
+/* Initializes an empty action set. */
 void
-action_set_destroy(struct action_set *set);
+action_set_init(struct action_set *set, struct ofl_exp *exp);
 
-/* Creates a clone of an action set. Used when cloning a datapath packet in
- * groups. */
-struct action_set *
-action_set_clone(struct action_set *set);
+/* Returns true if the action set holds no actions. */
+static inline bool
+action_set_is_empty(const struct action_set *set) {
+    return set->slots_used == 0;
+}
 
 /* Writes the set of given actions to the set, overwriting existing types as
  * defined by the 1.1 spec. */
@@ -20,8 +20,22 @@ udatapath_ofdatapath_SOURCES = \
 	udatapath/dp_control.h \
 	udatapath/dp_exp.c \
 	udatapath/dp_exp.h \
+	udatapath/dp_latency.c \
+	udatapath/dp_latency.h \
 	udatapath/dp_ports.c \
 	udatapath/dp_ports.h \
+	udatapath/ehddp_coalesce.c \
+	udatapath/ehddp_coalesce.h \
+	udatapath/ehddp_seen.c \
+	udatapath/ehddp_seen.h \
+	udatapath/ehddp_stats.c \
+	udatapath/ehddp_stats.h \
+	udatapath/flow_cls_linear.c \
+	udatapath/flow_cls_linear.h \
+	udatapath/flow_cls_lpm.c \
+	udatapath/flow_cls_lpm.h \
+	udatapath/flow_cls_tree.c \
+	udatapath/flow_cls_tree.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
@@ -42,6 +56,8 @@ udatapath_ofdatapath_SOURCES = \
     udatapath/packet_handle_std.h \
 	udatapath/pipeline.c \
 	udatapath/pipeline.h \
+	udatapath/port_sched.c \
+	udatapath/port_sched.h \
 	udatapath/udatapath.c
 
 udatapath_ofdatapath_LDADD = lib/libopenflow.a oflib/liboflib.a oflib-exp/liboflib_exp.a nbee_link/libnbee_link.a $(SSL_LIBS) $(FAULT_LIBS)
@@ -51,6 +67,46 @@ nodist_EXTRA_udatapath_ofdatapath_SOURCES = dummy.cxx
 EXTRA_DIST += udatapath/ofdatapath.8.in
 DISTCLEANFILES += udatapath/ofdatapath.8
 
+#
+# In-process eHDDP discovery simulator
+#
+
+noinst_PROGRAMS += udatapath/ehddp-sim
+
+udatapath_ehddp_sim_SOURCES = \
+	$(udatapath_ofdatapath_SOURCES) \
+	udatapath/ehddp_sim.c
+
+udatapath_ehddp_sim_LDADD = $(udatapath_ofdatapath_LDADD)
+udatapath_ehddp_sim_CPPFLAGS = $(AM_CPPFLAGS) -DUDATAPATH_AS_LIB
+nodist_EXTRA_udatapath_ehddp_sim_SOURCES = dummy.cxx
+
+# Coalescing of the replies must cut the reply frames and the packet-ins.
+TESTS += udatapath/ehddp-coalesce-test.sh
+EXTRA_DIST += udatapath/ehddp-coalesce-test.sh
+
+# The replies must report the redundant links of meshy topologies.
+TESTS += udatapath/ehddp-links-test.sh
+EXTRA_DIST += udatapath/ehddp-links-test.sh
+
+#
+# Microbenchmarks of the datapath pipeline
+#
+
+noinst_PROGRAMS += udatapath/pipeline-bench
+
+udatapath_pipeline_bench_SOURCES = \
+	$(udatapath_ofdatapath_SOURCES) \
+	udatapath/pipeline_bench.c
+
+udatapath_pipeline_bench_LDADD = $(udatapath_ofdatapath_LDADD)
+udatapath_pipeline_bench_CPPFLAGS = $(AM_CPPFLAGS) -DUDATAPATH_AS_LIB
+nodist_EXTRA_udatapath_pipeline_bench_SOURCES = dummy.cxx
+
+# Every classifier must find the entries packet_match() finds.
+TESTS += udatapath/flow-cls-test.sh
+EXTRA_DIST += udatapath/flow-cls-test.sh
+
 if BUILD_HW_LIBS
 
 # Options for each platform
@@ -82,6 +138,20 @@ udatapath_libudatapath_a_SOURCES = \
 	udatapath/dp_control.h \
 	udatapath/dp_exp.c \
 	udatapath/dp_exp.h \
+	udatapath/dp_latency.c \
+	udatapath/dp_latency.h \
+	udatapath/ehddp_coalesce.c \
+	udatapath/ehddp_coalesce.h \
+	udatapath/ehddp_seen.c \
+	udatapath/ehddp_seen.h \
+	udatapath/ehddp_stats.c \
+	udatapath/ehddp_stats.h \
+	udatapath/flow_cls_linear.c \
+	udatapath/flow_cls_linear.h \
+	udatapath/flow_cls_lpm.c \
+	udatapath/flow_cls_lpm.h \
+	udatapath/flow_cls_tree.c \
+	udatapath/flow_cls_tree.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
@@ -98,6 +168,8 @@ udatapath_libudatapath_a_SOURCES = \
 	udatapath/packet_handle_std.h \
 	udatapath/pipeline.c \
 	udatapath/pipeline.h \
+	udatapath/port_sched.c \
+	udatapath/port_sched.h \
 	udatapath/udatapath.c
 
 udatapath_libudatapath_a_CPPFLAGS = $(AM_CPPFLAGS)
@@ -34,17 +34,28 @@
 #include "ofp.h"
 #include "ofpbuf.h"
 #include "group_table.h"
+#include "hash.h"
 #include "meter_table.h"
 #include "oflib/ofl.h"
 #include "oflib-exp/ofl-exp.h"
 #include "oflib-exp/ofl-exp-nicira.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-log.h"
+#include "oflib/ofl-utils.h"
+#include "oflib/oxm-match.h"
 #include "openflow/openflow.h"
 #include "openflow/nicira-ext.h"
 #include "openflow/private-ext.h"
 #include "openflow/openflow-ext.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "packets.h"
 #include "pipeline.h"
+#include "ehddp_coalesce.h"
+#include "port_sched.h"
+#include "ehddp_seen.h"
+#include "ehddp_stats.h"
+#include "dp_latency.h"
 #include "poll-loop.h"
 #include "rconn.h"
 #include "stp.h"
@@ -55,7 +66,7 @@
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
 
-static struct remote *remote_create(struct datapath *dp, struct rconn *rconn, struct rconn *rconn_aux);
+static struct remote *remote_create(struct datapath *dp, struct rconn *rconn, struct pvconn *listener);
 static void remote_run(struct datapath *, struct remote *);
 static void remote_rconn_run(struct datapath *, struct remote *, uint8_t);
 static void remote_wait(struct remote *);
@@ -68,8 +79,14 @@ static void remote_destroy(struct remote *);
 #define DP_DESC      "OpenFlow 1.3 Reference Userspace Switch Datapath"
 #define SERIAL_NUM   "1"
 
+/* Chunk size of the message arena; large enough for most flow mods. */
+#define MSG_ARENA_CHUNK 4096
+
+/* Connection ids of an outgoing message: the auxiliary_id of the connection
+ * it goes to, or any auxiliary connection, picked by the flow of the
+ * packet-in. */
 #define MAIN_CONNECTION 0
-#define PTIN_CONNECTION 1
+#define PTIN_CONNECTION 0xff
 
 
 /* Callbacks for processing experimenter messages in OFLib. */
@@ -79,11 +96,21 @@ static struct ofl_exp_msg dp_exp_msg =
          .free      = ofl_exp_msg_free,
          .to_string = ofl_exp_msg_to_string};
 
+static struct ofl_exp_stats dp_exp_mp =
+        {.req_pack          = ofl_exp_stats_req_pack,
+         .req_unpack        = ofl_exp_stats_req_unpack,
+         .req_free          = ofl_exp_stats_req_free,
+         .req_to_string     = ofl_exp_stats_req_to_string,
+         .reply_pack        = ofl_exp_stats_reply_pack,
+         .reply_unpack      = ofl_exp_stats_reply_unpack,
+         .reply_free        = ofl_exp_stats_reply_free,
+         .reply_to_string   = ofl_exp_stats_reply_to_string};
+
 static struct ofl_exp dp_exp =
         {.act   = NULL,
          .inst  = NULL,
          .match = NULL,
-         .stats = NULL,
+         .stats = &dp_exp_mp,
          .msg   = &dp_exp_msg};
 
 /* Generates and returns a random datapath id. */
@@ -121,12 +148,16 @@ dp_new(void) {
     dp->listeners = NULL;
     dp->n_listeners = 0;
     dp->listeners_aux = NULL;
-    dp->n_listeners_aux = 0;
+    dp->n_aux = 0;
 
     memset(dp->ports, 0x00, sizeof (dp->ports));
     dp->local_port = NULL;
 
     dp->buffers = dp_buffers_create(dp);
+    dp->ehddp_seen = ehddp_seen_create();
+    dp->ehddp_coalesce = ehddp_coalesce_create();
+    dp->ehddp_stats = ehddp_stats_create();
+    dp->latency = dp_latency_create();
     dp->pipeline = pipeline_create(dp);
     dp->groups = group_table_create(dp);
     dp->meters = meter_table_create(dp);
@@ -134,8 +165,10 @@ dp_new(void) {
     list_init(&dp->port_list);
     dp->ports_num = 0;
     dp->max_queues = NETDEV_MAX_QUEUES;
+    dp->queue_sched = false;
 
     dp->exp = &dp_exp;
+    ofl_arena_init(&dp->msg_arena, MSG_ARENA_CHUNK);
 
     dp->config.flags         = OFPC_FRAG_NORMAL;
     dp->config.miss_send_len = OFP_DEFAULT_MISS_SEND_LEN;
@@ -157,16 +190,88 @@ dp_new(void) {
     return dp;
 }
 
+void
+dp_destroy(struct datapath *dp) {
+    struct remote *r, *next;
+    struct sw_port *p;
+    size_t i;
+
+    LIST_FOR_EACH_SAFE (r, next, struct remote, node, &dp->remotes) {
+        remote_destroy(r);
+    }
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        port_sched_destroy(p->sched);
+        p->sched = NULL;
+    }
+    /* Flows first, as they hold references to groups and meters. */
+    pipeline_destroy(dp->pipeline);
+    group_table_destroy(dp->groups);
+    meter_table_destroy(dp->meters);
+    ehddp_seen_destroy(dp->ehddp_seen);
+    ehddp_coalesce_destroy(dp->ehddp_coalesce);
+    dp_buffers_destroy(dp->buffers);
+    ehddp_stats_destroy(dp->ehddp_stats);
+    dp_latency_destroy(dp->latency);
+    ofl_arena_destroy(&dp->msg_arena);
+    for (i = 0; i < dp->n_listeners; i++) {
+        pvconn_close(dp->listeners[i]);
+    }
+    for (i = 0; i < dp->n_listeners * dp->n_aux; i++) {
+        if (dp->listeners_aux[i] != NULL) {
+            pvconn_close(dp->listeners_aux[i]);
+        }
+    }
+    free(dp->listeners);
+    free(dp->listeners_aux);
+    free(dp->mfr_desc);
+    free(dp->hw_desc);
+    free(dp->sw_desc);
+    free(dp->dp_desc);
+    free(dp->serial_num);
+    free(dp);
+}
+
 
 void
-dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn, struct pvconn *pvconn_aux) {
+dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn, struct pvconn **pvconn_aux) {
     dp->listeners = xrealloc(dp->listeners,
                              sizeof *dp->listeners * (dp->n_listeners + 1));
+    dp->listeners_aux = xrealloc(dp->listeners_aux,
+                             sizeof *dp->listeners_aux * dp->n_aux * (dp->n_listeners + 1));
+    memcpy(&dp->listeners_aux[dp->n_listeners * dp->n_aux], pvconn_aux,
+           sizeof *dp->listeners_aux * dp->n_aux);
     dp->listeners[dp->n_listeners++] = pvconn;
+}
 
-    dp->listeners_aux = xrealloc(dp->listeners_aux,
-                             sizeof *dp->listeners_aux * (dp->n_listeners_aux + 1));
-    dp->listeners_aux[dp->n_listeners_aux++] = pvconn_aux;
+/* Hands the auxiliary connection 'rconn', accepted on the listener of
+ * auxiliary_id 'aux_id' paired with 'listener', to the newest controller of
+ * that listener. */
+static void
+remote_add_aux(struct datapath *dp, struct pvconn *listener, uint8_t aux_id,
+               struct rconn *rconn) {
+    struct remote *r, *newest = NULL;
+
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        if (r->listener == listener && r->conns[aux_id].rconn == NULL) {
+            newest = r;
+        }
+    }
+    newest->conns[aux_id].rconn = rconn;
+}
+
+/* Returns true if a controller of 'listener' misses its auxiliary connection
+ * 'aux_id'. Connections are only accepted then, so that an auxiliary
+ * connection arriving before its main one waits in the listener. */
+static bool
+remote_wants_aux(struct datapath *dp, struct pvconn *listener, uint8_t aux_id) {
+    struct remote *r;
+
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        if (r->listener == listener && r->conns[aux_id].rconn == NULL) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void
@@ -180,10 +285,12 @@ dp_run(struct datapath *dp) {
         meter_table_add_tokens(dp->meters);
         pipeline_timeout(dp->pipeline);
     }
+    pipeline_run(dp->pipeline);
 
 
     poll_timer_wait(100);
     dp_ports_run(dp);
+    ehddp_coalesce_run(dp->ehddp_coalesce);
 
     /* Talk to remotes. */
     LIST_FOR_EACH_SAFE (r, rn, struct remote, node, &dp->remotes) {
@@ -194,26 +301,33 @@ dp_run(struct datapath *dp) {
         struct pvconn *pvconn = dp->listeners[i];
         struct vconn *new_vconn;
 
+        struct pvconn **pvconn_aux = &dp->listeners_aux[i * dp->n_aux];
+        size_t j;
+
         int retval = pvconn_accept(pvconn, OFP_VERSION, &new_vconn);
         if (!retval) {
-            struct rconn * rconn_aux = NULL;
-            if (dp->n_listeners_aux && dp->listeners_aux[i] != NULL) {
-                struct pvconn *pvconn_aux = dp->listeners_aux[i];
-                struct vconn *new_vconn_aux;
-                int retval_aux = pvconn_accept(pvconn_aux, OFP_VERSION, &new_vconn_aux);
-                if (!retval_aux)
-                    rconn_aux = rconn_new_from_vconn("passive_aux", new_vconn_aux);
-            }
-            remote_create(dp, rconn_new_from_vconn("passive", new_vconn), rconn_aux);
+            remote_create(dp, rconn_new_from_vconn("passive", new_vconn), pvconn);
         }
         else if (retval != EAGAIN) {
             VLOG_WARN_RL(LOG_MODULE, &rl, "accept failed (%s)", strerror(retval));
             dp->listeners[i] = dp->listeners[--dp->n_listeners];
-            if (dp->n_listeners_aux) {
-                dp->listeners_aux[i] = dp->listeners_aux[--dp->n_listeners_aux];
-            }
+            memmove(pvconn_aux, &dp->listeners_aux[dp->n_listeners * dp->n_aux],
+                   sizeof *pvconn_aux * dp->n_aux);
             continue;
         }
+
+        for (j = 0; j < dp->n_aux; j++) {
+            if (pvconn_aux[j] != NULL && remote_wants_aux(dp, pvconn, j + 1)) {
+                retval = pvconn_accept(pvconn_aux[j], OFP_VERSION, &new_vconn);
+                if (!retval) {
+                    remote_add_aux(dp, pvconn, j + 1,
+                                   rconn_new_from_vconn("passive_aux", new_vconn));
+                } else if (retval != EAGAIN) {
+                    VLOG_WARN_RL(LOG_MODULE, &rl, "accept failed (%s)", strerror(retval));
+                    pvconn_aux[j] = NULL;
+                }
+            }
+        }
         i++;
     }
 }
@@ -221,29 +335,36 @@ dp_run(struct datapath *dp) {
 static void
 remote_run(struct datapath *dp, struct remote *r)
 {
+    size_t i;
+
     remote_rconn_run(dp, r, MAIN_CONNECTION);
 
-    if (!rconn_is_alive(r->rconn)) {
+    if (!rconn_is_alive(r->conns[MAIN_CONNECTION].rconn)) {
         remote_destroy(r);
         return;
     }
 
-    if (r->rconn_aux == NULL || !rconn_is_alive(r->rconn_aux))
-        return;
+    for (i = 1; i <= r->n_aux; i++) {
+        struct remote_conn *c = &r->conns[i];
 
-    remote_rconn_run(dp, r, PTIN_CONNECTION);
+        if (c->rconn == NULL) {
+            continue;
+        }
+        if (!rconn_is_alive(c->rconn)) {
+            /* Free the slot for the controller to reconnect. */
+            rconn_destroy(c->rconn);
+            c->rconn = NULL;
+            continue;
+        }
+        remote_rconn_run(dp, r, i);
+    }
 }
 
 static void
 remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
-    struct rconn *rconn = NULL;
+    struct rconn *rconn = r->conns[conn_id].rconn;
     ofl_err error;
     size_t i;
-    rconn = NULL;
-    if (conn_id == MAIN_CONNECTION)
-        rconn = r->rconn;
-    else if (conn_id == PTIN_CONNECTION)
-        rconn = r->rconn_aux;
 
     rconn_run(rconn);
     /* Do some remote processing, but cap it at a reasonable amount so that
@@ -257,15 +378,29 @@ remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
                 break;
             } else {
                 struct ofl_msg_header *msg;
+                bool in_arena;
 
                 struct sender sender = {.remote = r, .conn_id = conn_id};
 
-                error = ofl_msg_unpack(buffer->data, buffer->size, &msg, &(sender.xid), dp->exp);
+                /* Flow mods are the bulk of controller traffic, and the flow
+                 * entries copy what they keep, so they are unpacked into the
+                 * message arena and released in one go. */
+                in_arena = buffer->size >= sizeof(struct ofp_header) &&
+                           ((struct ofp_header *)buffer->data)->type == OFPT_FLOW_MOD;
+
+                if (in_arena) {
+                    error = ofl_msg_unpack_arena(buffer->data, buffer->size, &msg,
+                                                 &(sender.xid), dp->exp, &dp->msg_arena);
+                } else {
+                    error = ofl_msg_unpack(buffer->data, buffer->size, &msg, &(sender.xid), dp->exp);
+                }
 
                 if (!error) {
                     error = handle_control_msg(dp, msg, &sender);
 
-                    if (error) {
+                    if (in_arena) {
+                        ofl_msg_free_arena(msg, dp->exp, &dp->msg_arena);
+                    } else if (error) {
                         ofl_msg_free(msg, dp->exp);
                     }
                 }
@@ -283,7 +418,7 @@ remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
                 ofpbuf_delete(buffer);
             }
         } else {
-            if (r->n_txq < TXQ_LIMIT) {
+            if (r->conns[conn_id].n_txq < TXQ_LIMIT) {
                 int error = r->cb_dump(dp, r->cb_aux);
                 if (error <= 0) {
                     if (error) {
@@ -303,12 +438,13 @@ remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
 static void
 remote_wait(struct remote *r)
 {
-    rconn_run_wait(r->rconn);
-    rconn_recv_wait(r->rconn);
+    size_t i;
 
-    if (r->rconn_aux) {
-        rconn_run_wait(r->rconn_aux);
-        rconn_recv_wait(r->rconn_aux);
+    for (i = 0; i <= r->n_aux; i++) {
+        if (r->conns[i].rconn != NULL) {
+            rconn_run_wait(r->conns[i].rconn);
+            rconn_recv_wait(r->conns[i].rconn);
+        }
     }
 }
 
@@ -316,14 +452,15 @@ static void
 remote_destroy(struct remote *r)
 {
     if (r) {
+        size_t i;
+
         if (r->cb_dump && r->cb_done) {
              r->cb_done(r->cb_aux);
         }
         list_remove(&r->node);
-        if (r->rconn_aux != NULL) {
-            rconn_destroy(r->rconn_aux);
+        for (i = 0; i <= r->n_aux; i++) {
+            rconn_destroy(r->conns[i].rconn);
         }
-        rconn_destroy(r->rconn);
 	if(r->mp_req_msg != NULL) {
 	  ofl_msg_free((struct ofl_msg_header *) r->mp_req_msg, NULL);
 	}
@@ -332,15 +469,16 @@ remote_destroy(struct remote *r)
 }
 
 static struct remote *
-remote_create(struct datapath *dp, struct rconn *rconn, struct rconn *rconn_aux)
+remote_create(struct datapath *dp, struct rconn *rconn, struct pvconn *listener)
 {
     size_t i;
     struct remote *remote = xmalloc(sizeof *remote);
     list_push_back(&dp->remotes, &remote->node);
-    remote->rconn = rconn;
-    remote->rconn_aux = rconn_aux;
+    remote->listener = listener;
+    memset(remote->conns, 0, sizeof remote->conns);
+    remote->conns[MAIN_CONNECTION].rconn = rconn;
+    remote->n_aux = dp->n_aux;
     remote->cb_dump = NULL;
-    remote->n_txq = 0;
     remote->mp_req_msg = NULL;
     remote->mp_req_xid = 0;  /* Currently not needed. Jean II. */
     remote->role = OFPCR_ROLE_EQUAL;
@@ -366,6 +504,10 @@ dp_wait(struct datapath *dp)
             continue;
         }
         netdev_recv_wait(p->netdev);
+        netdev_link_state_wait(p->netdev);
+        if (p->sched != NULL) {
+            port_sched_wait(p->sched);
+        }
     }
     LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
         remote_wait(r);
@@ -373,6 +515,7 @@ dp_wait(struct datapath *dp)
     for (i = 0; i < dp->n_listeners; i++) {
         pvconn_wait(dp->listeners[i]);
     }
+    ehddp_coalesce_wait(dp->ehddp_coalesce);
 }
 
 void
@@ -415,36 +558,124 @@ dp_set_max_queues(struct datapath *dp, uint32_t max_queues) {
     dp->max_queues = max_queues;
 }
 
+void
+dp_set_buffers(struct datapath *dp, size_t buffers_num, size_t max_bytes) {
+    dp_buffers_set_limits(dp->buffers, buffers_num, max_bytes);
+}
+
+void
+dp_set_ehddp_coalesce(struct datapath *dp, unsigned int msec) {
+    ehddp_coalesce_set_window(dp->ehddp_coalesce, msec);
+}
+
+void
+dp_set_queue_sched(struct datapath *dp, bool enabled) {
+    dp->queue_sched = enabled;
+}
+
+void
+dp_set_aux_conns(struct datapath *dp, size_t n_aux) {
+    dp->n_aux = MIN(n_aux, DP_MAX_AUX_CONNS);
+}
+
+static inline bool
+remote_conn_is_up(const struct remote_conn *c) {
+    return c->rconn != NULL && rconn_is_connected(c->rconn);
+}
+
+ofl_err
+dp_handle_stats_request_connections(struct datapath *dp,
+                                    struct ofl_exp_openflow_mp_request_header *msg,
+                                    const struct sender *sender) {
+    struct ofl_exp_openflow_mp_reply_connections reply;
+    struct remote *r;
+    uint32_t remote = 0;
+    size_t i;
+
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.header.header.type = OFPMP_EXPERIMENTER;
+    reply.header.header.experimenter_id = OPENFLOW_VENDOR_ID;
+    reply.header.type = OFP_EXT_STATS_CONNECTIONS;
+
+    reply.conns = xmalloc(list_size(&dp->remotes) * (1 + dp->n_aux) * sizeof *reply.conns);
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        for (i = 0; i <= r->n_aux; i++) {
+            struct remote_conn *c = &r->conns[i];
+            struct ofl_exp_openflow_connection *conn = &reply.conns[reply.conns_num++];
+
+            conn->remote = remote;
+            conn->auxiliary_id = i;
+            conn->connected = remote_conn_is_up(c);
+            conn->txq = c->n_txq;
+            conn->txq_max = c->n_txq_max;
+            conn->packet_ins = c->packet_ins;
+            conn->dropped = c->dropped;
+        }
+        remote++;
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    free(reply.conns);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+/* Returns the connection of 'remote' for a message to connection 'conn_id'.
+ * A packet-in goes to the auxiliary connection picked by 'flow_hash', so
+ * that the packet-ins of a flow keep their order; if that one is down, to
+ * the next one up. Falls back on the main connection. */
+static struct remote_conn *
+remote_pick_conn(struct remote *remote, uint8_t conn_id, uint32_t flow_hash) {
+    if (conn_id == PTIN_CONNECTION) {
+        size_t i;
+
+        for (i = 0; i < remote->n_aux; i++) {
+            struct remote_conn *c = &remote->conns[1 + (flow_hash + i) % remote->n_aux];
+
+            if (remote_conn_is_up(c)) {
+                return c;
+            }
+        }
+    } else if (conn_id <= remote->n_aux && remote_conn_is_up(&remote->conns[conn_id])) {
+        return &remote->conns[conn_id];
+    }
+    return &remote->conns[MAIN_CONNECTION];
+}
 
 static int
-send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote) {
-    struct rconn* rconn = remote->rconn;
+send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote,
+                               uint32_t flow_hash) {
+    struct remote_conn *c = remote_pick_conn(remote, buffer->conn_id, flow_hash);
+    bool packet_in = ((struct ofp_header *)buffer->data)->type == OFPT_PACKET_IN;
     int retval;
-    if (buffer->conn_id == PTIN_CONNECTION &&
-        remote->rconn != NULL &&
-        remote->rconn_aux != NULL &&
-        rconn_is_connected(remote->rconn) &&
-        rconn_is_connected(remote->rconn_aux)) {
-            rconn = remote->rconn_aux;
-    }
-    retval = rconn_send_with_limit(rconn, buffer, &remote->n_txq,
-                                      TXQ_LIMIT);
+
+    retval = rconn_send_with_limit(c->rconn, buffer, &c->n_txq, TXQ_LIMIT);
+    c->n_txq_max = MAX(c->n_txq_max, c->n_txq);
 
     if (retval) {
+        if (retval == EAGAIN) {
+            c->dropped++;
+        }
         VLOG_WARN_RL(LOG_MODULE, &rl, "send to %s failed: %s",
-                     rconn_get_name(rconn), strerror(retval));
+                     rconn_get_name(c->rconn), strerror(retval));
+    } else if (packet_in) {
+        c->packet_ins++;
     }
 
     return retval;
 }
 
+/* Sends 'buffer' to the sender, or else to all remotes. 'flow_hash' picks
+ * the auxiliary connection of a packet-in. */
 static int
 send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
-                     const struct sender *sender) {
+                     const struct sender *sender, uint32_t flow_hash) {
     update_openflow_length(buffer);
     if (sender) {
         /* Send back to the sender. */
-        return send_openflow_buffer_to_remote(buffer, sender->remote);
+        return send_openflow_buffer_to_remote(buffer, sender->remote, flow_hash);
 
     } else {
         /* Broadcast to all remotes. */
@@ -509,12 +740,14 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
                 }
             }
             if (prev) {
-                send_openflow_buffer_to_remote(ofpbuf_clone(buffer), prev);
+                /* The message is not modified anymore, so all remotes can
+                 * send the same data. */
+                send_openflow_buffer_to_remote(ofpbuf_share(buffer), prev, flow_hash);
             }
             prev = r;
         }
         if (prev) {
-            send_openflow_buffer_to_remote(buffer, prev);
+            send_openflow_buffer_to_remote(buffer, prev, flow_hash);
         } else {
             ofpbuf_delete(buffer);
         }
@@ -549,7 +782,7 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
        1) By default, we send it to the main connection
        2) If there's an associated sender, send the response to the same
           connection the request came from
-       3) If it's a packet in, use the auxiliary connection
+       3) If it's a packet in, use an auxiliary connection
     */
     ofpbuf->conn_id = MAIN_CONNECTION;
     if (sender != NULL)
@@ -557,7 +790,7 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
     if (msg->type == OFPT_PACKET_IN)
         ofpbuf->conn_id = PTIN_CONNECTION;
 
-    error = send_openflow_buffer(dp, ofpbuf, sender);
+    error = send_openflow_buffer(dp, ofpbuf, sender, 0);
     if (error) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error sending the message!");
         return error;
@@ -565,6 +798,134 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
     return 0;
 }
 
+/* Hashes the flow of 'pkt': its in port and addresses. */
+static uint32_t
+packet_in_hash(struct packet *pkt) {
+    struct protocols_std *proto;
+    uint32_t hash = hash_int(pkt->in_port, 0);
+
+    packet_handle_std_validate(pkt->handle_std);
+    proto = pkt->handle_std->proto;
+
+    if (proto->eth != NULL) {
+        hash = hash_bytes(proto->eth, 2 * ETH_ADDR_LEN, hash);
+    }
+    if (proto->ipv4 != NULL) {
+        hash = hash_bytes(&proto->ipv4->ip_src, 2 * sizeof(uint32_t), hash);
+    } else if (proto->ipv6 != NULL) {
+        hash = hash_bytes(&proto->ipv6->ipv6_src, 2 * sizeof(struct in6_addr), hash);
+    }
+    if (proto->tcp != NULL) {
+        hash = hash_bytes(&proto->tcp->tcp_src, 2 * sizeof(uint16_t), hash);
+    } else if (proto->udp != NULL) {
+        hash = hash_bytes(&proto->udp->udp_src, 2 * sizeof(uint16_t), hash);
+    } else if (proto->sctp != NULL) {
+        hash = hash_bytes(&proto->sctp->sctp_src, 2 * sizeof(uint16_t), hash);
+    }
+    return hash;
+}
+
+/* Appends an OXM TLV with a 32 or 64 bit value in network byte order. */
+static void
+put_oxm_tlv(struct ofpbuf *buf, uint32_t header, const void *value) {
+    uint32_t oxm_header = htonl(header);
+
+    ofpbuf_put(buf, &oxm_header, sizeof oxm_header);
+    ofpbuf_put(buf, value, OXM_LENGTH(header));
+}
+
+int
+dp_send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+                  uint8_t reason, uint64_t cookie, uint16_t max_len) {
+    struct ofp_packet_in *pi;
+    struct ofl_match_tlv *f;
+    struct ofpbuf *buf;
+    uint64_t metadata = 0, tunnel_id = 0;
+    uint32_t buffer_id = OFP_NO_BUFFER;
+    size_t match_len, data_len;
+    uint16_t match_type = htons(OFPMT_OXM);
+    uint16_t match_len_n;
+    uint64_t start = dp_latency_start(dp->latency);
+    int error;
+
+    /* A miss_send_len of OFPCML_NO_BUFFER means that the complete
+     * packet should be sent, and it should not be buffered. If the packet
+     * cannot be buffered, the complete packet is sent as well. */
+    data_len = pkt->buffer->size;
+    if (dp->config.miss_send_len != OFPCML_NO_BUFFER) {
+        buffer_id = dp_buffers_save(dp->buffers, pkt);
+        if (buffer_id != NO_BUFFER) {
+            data_len = MIN(max_len, pkt->buffer->size);
+        } else {
+            buffer_id = OFP_NO_BUFFER;
+        }
+    }
+
+    /* Only the pipeline fields are reported; the controller can find
+     * the header fields in the packet data. */
+    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv, hmap_node,
+                            hash_int(OXM_OF_METADATA, 0), &pkt->handle_std->match.match_fields) {
+        metadata = *((uint64_t *) f->value);
+    }
+    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv, hmap_node,
+                            hash_int(OXM_OF_TUNNEL_ID, 0), &pkt->handle_std->match.match_fields) {
+        tunnel_id = *((uint64_t *) f->value);
+    }
+
+    match_len = sizeof(struct ofp_match) - 4 + 4 + OXM_LENGTH(OXM_OF_IN_PORT);
+    if (metadata != 0) {
+        match_len += 4 + OXM_LENGTH(OXM_OF_METADATA);
+    }
+    if (tunnel_id != 0) {
+        match_len += 4 + OXM_LENGTH(OXM_OF_TUNNEL_ID);
+    }
+
+    /* The whole message is written into a single buffer. */
+    buf = ofpbuf_new(offsetof(struct ofp_packet_in, match)
+                     + ROUND_UP(match_len, 8) + 2 + data_len);
+
+    pi = ofpbuf_put_uninit(buf, offsetof(struct ofp_packet_in, match));
+    pi->header.version = OFP_VERSION;
+    pi->header.type    = OFPT_PACKET_IN;
+    pi->header.xid     = 0;
+    pi->buffer_id      = htonl(buffer_id);
+    pi->total_len      = htons(pkt->buffer->size);
+    pi->reason         = reason;
+    pi->table_id       = table_id;
+    pi->cookie         = hton64(cookie);
+
+    match_len_n = htons(match_len);
+    ofpbuf_put(buf, &match_type, sizeof match_type);
+    ofpbuf_put(buf, &match_len_n, sizeof match_len_n);
+    {
+        uint32_t in_port = htonl(pkt->in_port);
+        put_oxm_tlv(buf, OXM_OF_IN_PORT, &in_port);
+    }
+    if (metadata != 0) {
+        uint64_t value = hton64(metadata);
+        put_oxm_tlv(buf, OXM_OF_METADATA, &value);
+    }
+    if (tunnel_id != 0) {
+        uint64_t value = hton64(tunnel_id);
+        put_oxm_tlv(buf, OXM_OF_TUNNEL_ID, &value);
+    }
+    /* Match padding, plus the two bytes of padding before the frame. */
+    ofpbuf_put_zeros(buf, ROUND_UP(match_len, 8) - match_len + 2);
+    ofpbuf_put(buf, pkt->buffer->data, data_len);
+
+    VLOG_DBG_RL(LOG_MODULE, &rl, "sending: packet_in{buffer=\"%u\", tlen=\"%zu\", "
+                "reas=\"%u\", tbl=\"%u\", in_port=\"%u\", dlen=\"%zu\"}",
+                buffer_id, pkt->buffer->size, reason, table_id, pkt->in_port, data_len);
+
+    buf->conn_id = PTIN_CONNECTION;
+    error = send_openflow_buffer(dp, buf, NULL, dp->n_aux > 0 ? packet_in_hash(pkt) : 0);
+    if (error) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error sending the message!");
+    }
+    dp_latency_stop(dp->latency, OFP_EXT_LATENCY_PACKET_IN, start);
+    return error;
+}
+
 ofl_err
 dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc *msg,
                                             const struct sender *sender UNUSED) {
@@ -707,5 +1068,5 @@ char * quitar_espacios(char * optarg){
 
 int send_openflow_buffer_uah(struct datapath *dp, struct ofpbuf *buffer,
                      const struct sender *sender){
-    return send_openflow_buffer(dp, buffer, sender);
+    return send_openflow_buffer(dp, buffer, sender, 0);
 }
\ No newline at end of file
@@ -44,6 +44,7 @@
 struct rconn;
 struct pvconn;
 struct sender;
+struct packet;
 
 /****************************************************************************
  * The datapath
@@ -68,13 +69,19 @@ struct datapath {
     /* Listeners. */
     struct pvconn **listeners;
     size_t n_listeners;
-    struct pvconn **listeners_aux;
-    size_t n_listeners_aux;
+    struct pvconn **listeners_aux; /* n_aux per listener, NULL if failed. */
+    size_t n_aux;               /* Auxiliary connections per controller. */
     
     time_t last_timeout;
 
     struct dp_buffers *buffers;
 
+    struct ehddp_seen *ehddp_seen; /* Recently seen eHDDP requests. */
+    struct ehddp_coalesce *ehddp_coalesce; /* Replies held for merging. */
+    struct ehddp_stats *ehddp_stats; /* Discovery counters and timing. */
+
+    struct dp_latency *latency; /* Per-stage latency histograms. */
+
     struct pipeline *pipeline;  /* Pipeline with multi-tables. */
 
     struct group_table *groups; /* Group tables */
@@ -86,6 +93,7 @@ struct datapath {
     /* Switch ports. */
     /* NOTE: ports are numbered starting at 1 in OF 1.1 */
     uint32_t         max_queues; /* used when creating ports */
+    bool             queue_sched; /* queues scheduled in userspace, not tc */
     struct sw_port   ports[DP_MAX_PORTS + 1];
     struct sw_port  *local_port;  /* OFPP_LOCAL port, if any. */
     struct list      port_list; /* All ports, including local_port. */
@@ -94,6 +102,8 @@ struct datapath {
     /* Experimenter handling. */
     struct ofl_exp  *exp;
 
+    struct ofl_arena msg_arena; /* Storage of the flow mod being handled. */
+
 #if defined(OF_HW_PLAT)
     /* Although the chain maintains the pointer to the HW driver
      * for flow operations, the datapath needs the port functions
@@ -111,14 +121,27 @@ struct sender {
     uint32_t xid;               /* The OpenFlow transaction ID. */
 };
 
+/* Most auxiliary connections of a controller. */
+#define DP_MAX_AUX_CONNS 8
+
+/* One of the connections of a remote: the main one, or an auxiliary one. */
+struct remote_conn {
+    struct rconn *rconn;        /* NULL until accepted. */
+    int n_txq;                  /* Number of packets queued for tx on rconn. */
+    int n_txq_max;              /* Largest n_txq seen. */
+    uint64_t packet_ins;        /* Packet-ins sent. */
+    uint64_t dropped;           /* Messages dropped, tx queue full. */
+};
+
 /* A connection to a secure channel. */
 struct remote {
     struct list node;
-    struct rconn *rconn;
-    struct rconn *rconn_aux;
-    
+    struct pvconn *listener;    /* Listener the main connection came from. */
+
 #define TXQ_LIMIT 128           /* Max number of packets to queue for tx. */
-    int n_txq;                  /* Number of packets queued for tx on rconn. */
+    /* The main connection, then the auxiliary ones by auxiliary_id. */
+    struct remote_conn conns[1 + DP_MAX_AUX_CONNS];
+    size_t n_aux;               /* Auxiliary connections expected. */
 
     /* Support for reliable, multi-message replies to requests.
      *
@@ -142,8 +165,17 @@ struct remote {
 struct datapath *
 dp_new(void);
 
+/* Destroys a datapath that is not run anymore: its controllers and listeners,
+ * tables, port schedulers, packet buffers, counters and eHDDP state. The
+ * network devices of the ports are left to the exit of the process. */
+void
+dp_destroy(struct datapath *dp);
+
+/* Listens for controllers on 'pvconn'. 'pvconn_aux' has the listeners of
+ * their auxiliary connections, as many as set by dp_set_aux_conns(); any of
+ * them may be NULL. */
 void
-dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn, struct pvconn *pvconn_aux);
+dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn, struct pvconn **pvconn_aux);
 
 /* Executes the datapath. The datapath works if this function is run
  * repeatedly. */
@@ -179,6 +211,22 @@ dp_set_serial_num(struct datapath *dp, char *serial_num);
 void
 dp_set_max_queues(struct datapath *dp, uint32_t max_queues);
 
+void
+dp_set_buffers(struct datapath *dp, size_t buffers_num, size_t max_bytes);
+
+void
+dp_set_ehddp_coalesce(struct datapath *dp, unsigned int msec);
+
+/* Makes the ports created afterwards schedule their queues in userspace
+ * instead of with tc classes. */
+void
+dp_set_queue_sched(struct datapath *dp, bool enabled);
+
+/* Sets the number of auxiliary connections each controller opens, before any
+ * listener is added. Packet-ins are spread across them by flow. */
+void
+dp_set_aux_conns(struct datapath *dp, size_t n_aux);
+
 
 /* Sends the given OFLib message to the connection represented by sender,
  * or to all open connections, if sender is null. */
@@ -186,6 +234,15 @@ int
 dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender);
 
+/* Sends the packet to all controllers in a packet_in message. The message is
+ * encoded directly from the packet, without building an OFLib message, and
+ * carries the pipeline fields of the packet in its match. The packet is
+ * buffered unless miss_send_len is OFPCML_NO_BUFFER, in which case max_len
+ * is ignored and the whole frame is sent. */
+int
+dp_send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t table_id,
+                  uint8_t reason, uint64_t cookie, uint16_t max_len);
+
 /* Handles a set description (openflow experimenter) message */
 ofl_err
 dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc *msg,
@@ -201,6 +258,13 @@ ofl_err
 dp_handle_async_request(struct datapath *dp, struct ofl_msg_async_config *msg,
                                             const struct sender *sender);
 
+/* Handles a connections experimenter multipart request: replies with the
+ * counters of every connection of every controller. */
+ofl_err
+dp_handle_stats_request_connections(struct datapath *dp,
+                                    struct ofl_exp_openflow_mp_request_header *msg,
+                                    const struct sender *sender);
+
 /*Modificacion UAH*/
 uint32_t get_dp_local_port_number_UAH(struct datapath *dp);
 uint32_t dp_set_ip_addr(char * ip_aux);
@@ -66,7 +66,6 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
     {
         /*Field existence is guaranteed by the
         field pre-requisite on matching */
-        fprintf(stderr, "Header %d\n", OXM_FIELD(act->field->header));
         switch(act->field->header){
             case OXM_OF_ETH_DST:{
                 memcpy(pkt->handle_std->proto->eth->eth_dst,
@@ -1142,32 +1141,15 @@ dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue
             break;
         }
         case (OFPP_CONTROLLER): {
-            struct ofl_msg_packet_in msg;
-            msg.header.type = OFPT_PACKET_IN;
-            msg.total_len   = pkt->buffer->size;
-            msg.reason = pkt->handle_std->table_miss? OFPR_NO_MATCH:OFPR_ACTION;
-            msg.table_id = pkt->table_id;
-            msg.data        = pkt->buffer->data;
-            msg.cookie = cookie;
-
-            if (pkt->dp->config.miss_send_len != OFPCML_NO_BUFFER){
-                dp_buffers_save(pkt->dp->buffers, pkt);
-                msg.buffer_id = pkt->buffer_id;
-                msg.data_length = MIN(max_len, pkt->buffer->size);
-            }
-            else {
-                msg.buffer_id = OFP_NO_BUFFER;
-                msg.data_length =  pkt->buffer->size;
-            }
-
             if (!pkt->handle_std->valid){
                 packet_handle_std_validate(pkt->handle_std);
             }
             /* In this implementation the fields in_port and in_phy_port
                 always will be the same, because we are not considering logical
                 ports*/
-            msg.match = (struct ofl_match_header*) &pkt->handle_std->match;
-            dp_send_message(pkt->dp, (struct ofl_msg_header *)&msg, NULL);
+            dp_send_packet_in(pkt->dp, pkt, pkt->table_id,
+                              pkt->handle_std->table_miss ? OFPR_NO_MATCH : OFPR_ACTION,
+                              cookie, max_len);
             break;
         }
         case (OFPP_FLOOD):
@@ -1272,41 +1254,18 @@ dp_actions_check_set_field_req(struct ofl_msg_flow_mod *msg, size_t actions_num,
 }
 
 size_t size_data_to_read(uint8_t config, int type_read){
-    int size; 
-
-    
     switch (type_read)
     {
         case 1: /* Type device case */
-            size = ((config | 0b11000000) << 6) + 1;
-            break;
-        
+            return EHDDP_CONF_TYPE_LEN(config);
+
         case 2: /* ID device case */
-            size = ((config | 0b00111000) << 3) + 1;
-            break;
+            return EHDDP_CONF_ID_LEN(config);
 
         case 3: /* Port case */
-            size = ((config | 0b00000110) << 1) + 1;
-            break;
-        default:
-            size = 1;
-            break;
-    }
+            return EHDDP_CONF_PORT_LEN(config);
 
-    switch (size)
-    {
-    case 1:
-        return sizeof (uint8_t);
-   
-    case 2:
-        return sizeof (uint16_t);
-    
-    case 4:
-        return sizeof (uint32_t);
-
-    case 8:
-        return sizeof (uint64_t);
+        default:
+            return sizeof (uint8_t);
     }
-    
-    return sizeof (u_int8_t);
 }
\ No newline at end of file
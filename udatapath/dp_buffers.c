@@ -23,10 +23,17 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "dp_buffers.h"
+#include "datapath.h"
+#include "list.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow-ext.h"
 #include "timeval.h"
 #include "packet.h"
+#include "util.h"
 #include "vlog.h"
 
 #define LOG_MODULE VLM_dp_buf
@@ -38,20 +45,26 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
  * into a buffer number (low bits) and a cookie (high bits).  The buffer number
  * is an index into an array of buffers.  The cookie distinguishes between
  * different packets that have occupied a single buffer.  Thus, the more
- * buffers we have, the lower-quality the cookie... */
-#define PKT_BUFFER_BITS 8
-#define PKT_COOKIE_BITS (32 - PKT_BUFFER_BITS)
+ * buffers we have, the lower-quality the cookie...
+ *
+ * The number of buffer bits depends on the configured number of buffers,
+ * which is always rounded up to a power of two. */
+#define PKT_BUFFER_BITS_DEFAULT 12
+#define PKT_BUFFER_BITS_MAX     20
 
-#define N_PKT_BUFFERS (1 << PKT_BUFFER_BITS)
-#define PKT_BUFFER_MASK (N_PKT_BUFFERS - 1)
+BUILD_ASSERT_DECL(DP_BUFFERS_MAX == 1 << PKT_BUFFER_BITS_MAX);
 
+/* Default memory budget for resident packets. */
+#define PKT_BUFFER_BYTES_DEFAULT (64 * 1024 * 1024)
 
 #define OVERWRITE_SECS  1
 
 struct packet_buffer {
+    struct list    node;    /* in dp_buffers.age_list while in use */
     struct packet *pkt;
     uint32_t       cookie;
     time_t         timeout;
+    size_t         bytes;   /* memory accounted for the packet */
 };
 
 
@@ -62,38 +75,178 @@ struct packet_buffer {
 
 struct dp_buffers {
     struct datapath       *dp;
-    size_t                 buffer_idx;
+    size_t                 buffer_bits;
     size_t                 buffers_num;
-    struct packet_buffer   buffers[N_PKT_BUFFERS];
-};
+    struct packet_buffer  *buffers;
 
+    struct list            age_list;   /* used buffers, oldest first */
+    uint32_t              *free_idx;   /* stack of unused buffer indexes */
+    size_t                 free_num;
 
-struct dp_buffers *
-dp_buffers_create(struct datapath *dp) {
-    struct dp_buffers *dpb = xmalloc(sizeof(struct dp_buffers));
+    size_t                 max_bytes;  /* memory budget for resident packets */
+    size_t                 bytes;      /* memory used by resident packets */
+
+    struct dp_buffers_stats stats;
+};
+
+static void
+dp_buffers_init(struct dp_buffers *dpb, size_t buffer_bits) {
     size_t i;
 
-    dpb->dp          = dp;
-    dpb->buffer_idx  = (size_t)-1;
-    dpb->buffers_num = N_PKT_BUFFERS;
+    dpb->buffer_bits = buffer_bits;
+    dpb->buffers_num = (size_t)1 << buffer_bits;
+    dpb->buffers     = xmalloc(dpb->buffers_num * sizeof(struct packet_buffer));
+    dpb->free_idx    = xmalloc(dpb->buffers_num * sizeof(uint32_t));
+    dpb->free_num    = dpb->buffers_num;
+    dpb->bytes       = 0;
+    list_init(&dpb->age_list);
 
-    for (i=0; i<N_PKT_BUFFERS; i++) {
+    for (i=0; i<dpb->buffers_num; i++) {
         dpb->buffers[i].pkt     = NULL;
         dpb->buffers[i].cookie  = UINT32_MAX;
         dpb->buffers[i].timeout = 0;
+        dpb->buffers[i].bytes   = 0;
+        /* Hand out low indexes first. */
+        dpb->free_idx[i] = dpb->buffers_num - 1 - i;
     }
+}
+
+struct dp_buffers *
+dp_buffers_create(struct datapath *dp) {
+    struct dp_buffers *dpb = xmalloc(sizeof(struct dp_buffers));
+
+    dpb->dp        = dp;
+    dpb->max_bytes = PKT_BUFFER_BYTES_DEFAULT;
+    memset(&dpb->stats, 0, sizeof(struct dp_buffers_stats));
+    dp_buffers_init(dpb, PKT_BUFFER_BITS_DEFAULT);
 
     return dpb;
 }
 
+void
+dp_buffers_destroy(struct dp_buffers *dpb) {
+    struct packet_buffer *p, *next;
+
+    if (dpb == NULL) {
+        return;
+    }
+    LIST_FOR_EACH_SAFE (p, next, struct packet_buffer, node, &dpb->age_list) {
+        packet_destroy(p->pkt);
+    }
+    free(dpb->buffers);
+    free(dpb->free_idx);
+    free(dpb);
+}
+
+void
+dp_buffers_set_limits(struct dp_buffers *dpb, size_t buffers_num, size_t max_bytes) {
+    size_t bits = 0;
+
+    if (!list_is_empty(&dpb->age_list)) {
+        VLOG_WARN(LOG_MODULE, "Cannot resize packet buffers while packets are buffered.");
+        return;
+    }
+
+    while (bits < PKT_BUFFER_BITS_MAX && ((size_t)1 << bits) < buffers_num) {
+        bits++;
+    }
+
+    free(dpb->buffers);
+    free(dpb->free_idx);
+    dp_buffers_init(dpb, bits);
+    if (max_bytes != 0) {
+        dpb->max_bytes = max_bytes;
+    }
+}
+
 size_t
 dp_buffers_size(struct dp_buffers *dpb) {
     return dpb->buffers_num;
 }
 
+void
+dp_buffers_get_stats(struct dp_buffers *dpb, struct dp_buffers_stats *stats) {
+    *stats = dpb->stats;
+    stats->buffered = dpb->buffers_num - dpb->free_num;
+    stats->bytes    = dpb->bytes;
+}
+
+ofl_err
+dp_buffers_handle_stats_request(struct datapath *dp,
+                                struct ofl_exp_openflow_mp_request_header *msg,
+                                const struct sender *sender) {
+    struct dp_buffers *dpb = dp->buffers;
+    struct ofl_exp_openflow_mp_reply_buffers reply;
+    struct dp_buffers_stats stats;
+
+    dp_buffers_get_stats(dpb, &stats);
+
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.header.header.type = OFPMP_EXPERIMENTER;
+    reply.header.header.experimenter_id = OPENFLOW_VENDOR_ID;
+    reply.header.type = OFP_EXT_STATS_BUFFERS;
+    reply.buffers = dpb->buffers_num;
+    reply.buffered = stats.buffered;
+    reply.bytes = stats.bytes;
+    reply.max_bytes = dpb->max_bytes;
+    reply.saves = stats.saves;
+    reply.save_failures = stats.save_failures;
+    reply.hits = stats.hits;
+    reply.misses = stats.misses;
+    reply.evictions = stats.evictions;
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+static inline struct packet_buffer *
+dp_buffers_lookup(struct dp_buffers *dpb, uint32_t id) {
+    return &dpb->buffers[id & (dpb->buffers_num - 1)];
+}
+
+/* Releases a used buffer, without destroying its packet. */
+static void
+dp_buffers_release(struct dp_buffers *dpb, struct packet_buffer *p) {
+    list_remove(&p->node);
+    dpb->bytes -= p->bytes;
+    dpb->free_idx[dpb->free_num++] = p - dpb->buffers;
+    p->pkt = NULL;
+    p->bytes = 0;
+}
+
+/* Evicts the packet which has been buffered the longest. Packets are not
+ * evicted before OVERWRITE_SECS, as they may still be processed by the
+ * pipeline or referenced by a packet-in in flight. Returns false if nothing
+ * could be evicted. */
+static bool
+dp_buffers_evict_oldest(struct dp_buffers *dpb) {
+    struct packet_buffer *p;
+    struct packet *pkt;
+
+    if (list_is_empty(&dpb->age_list)) {
+        return false;
+    }
+    p = CONTAINER_OF(list_front(&dpb->age_list), struct packet_buffer, node);
+    if (time_now() < p->timeout) {
+        return false;
+    }
+
+    pkt = p->pkt;
+    dp_buffers_release(dpb, p);
+    dpb->stats.evictions++;
+
+    pkt->buffer_id = NO_BUFFER;
+    packet_destroy(pkt);
+    return true;
+}
+
 uint32_t
 dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt) {
     struct packet_buffer *p;
+    size_t bytes;
     uint32_t id;
 
     /* if packet is already in buffer, do not save again */
@@ -103,24 +256,33 @@ dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt) {
         }
     }
 
-    dpb->buffer_idx = (dpb->buffer_idx + 1) & PKT_BUFFER_MASK;
+    bytes = sizeof(struct packet) + pkt->buffer->allocated;
+    if (bytes > dpb->max_bytes) {
+        dpb->stats.save_failures++;
+        return NO_BUFFER;
+    }
 
-    p = &dpb->buffers[dpb->buffer_idx];
-    if (p->pkt != NULL) {
-        if (time_now() < p->timeout) {
+    while (dpb->free_num == 0 || dpb->bytes + bytes > dpb->max_bytes) {
+        if (!dp_buffers_evict_oldest(dpb)) {
+            dpb->stats.save_failures++;
             return NO_BUFFER;
-        } else {
-            p->pkt->buffer_id = NO_BUFFER;
-            packet_destroy(p->pkt);
         }
     }
+
+    p = &dpb->buffers[dpb->free_idx[--dpb->free_num]];
+
     /* Don't use maximum cookie value since the all-bits-1 id is
      * special. */
-    if (++p->cookie >= (1u << PKT_COOKIE_BITS) - 1)
+    if (++p->cookie >= ((uint64_t)1 << (32 - dpb->buffer_bits)) - 1)
         p->cookie = 0;
     p->pkt = pkt;
     p->timeout = time_now() + OVERWRITE_SECS;
-    id = dpb->buffer_idx | (p->cookie << PKT_BUFFER_BITS);
+    p->bytes = bytes;
+    list_push_back(&dpb->age_list, &p->node);
+    dpb->bytes += bytes;
+    dpb->stats.saves++;
+
+    id = (p - dpb->buffers) | (p->cookie << dpb->buffer_bits);
 
     pkt->buffer_id  = id;
 
@@ -132,16 +294,18 @@ dp_buffers_retrieve(struct dp_buffers *dpb, uint32_t id) {
     struct packet *pkt = NULL;
     struct packet_buffer *p;
 
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
-    if (p->cookie == id >> PKT_BUFFER_BITS && p->pkt != NULL) {
+    p = dp_buffers_lookup(dpb, id);
+    if (p->cookie == id >> dpb->buffer_bits && p->pkt != NULL) {
         pkt = p->pkt;
         pkt->buffer_id = NO_BUFFER;
         pkt->packet_out = false;
 
-        p->pkt = NULL;
+        dp_buffers_release(dpb, p);
+        dpb->stats.hits++;
     } else {
+        dpb->stats.misses++;
         VLOG_WARN_RL(LOG_MODULE, &rl, "cookie mismatch: %x != %x\n",
-                          id >> PKT_BUFFER_BITS, p->cookie);
+                          id >> dpb->buffer_bits, p->cookie);
     }
 
     return pkt;
@@ -151,8 +315,9 @@ bool
 dp_buffers_is_alive(struct dp_buffers *dpb, uint32_t id) {
     struct packet_buffer *p;
 
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
-    return ((p->cookie == id >> PKT_BUFFER_BITS) &&
+    p = dp_buffers_lookup(dpb, id);
+    return ((p->cookie == id >> dpb->buffer_bits) &&
+            (p->pkt != NULL) &&
             (time_now() < p->timeout));
 }
 
@@ -161,13 +326,15 @@ void
 dp_buffers_discard(struct dp_buffers *dpb, uint32_t id, bool destroy) {
     struct packet_buffer *p;
 
-    p = &dpb->buffers[id & PKT_BUFFER_MASK];
+    p = dp_buffers_lookup(dpb, id);
+
+    if (p->cookie == id >> dpb->buffer_bits && p->pkt != NULL) {
+        struct packet *pkt = p->pkt;
 
-    if (p->cookie == id >> PKT_BUFFER_BITS) {
+        dp_buffers_release(dpb, p);
         if (destroy) {
-            p->pkt->buffer_id = NO_BUFFER;
-            packet_destroy(p->pkt);
+            pkt->buffer_id = NO_BUFFER;
+            packet_destroy(pkt);
         }
-        p->pkt = NULL;
     }
 }
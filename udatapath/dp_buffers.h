@@ -27,28 +27,66 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "ofpbuf.h"
+#include "oflib/ofl.h"
 
 
 /* Constant for representing "no buffer" */
 #define NO_BUFFER 0xffffffff
 
+/* Largest number of buffers a datapath can have. */
+#define DP_BUFFERS_MAX (1 << 20)
+
 /****************************************************************************
  * Datapath buffers for storing packets for packet in messages.
  ****************************************************************************/
 
 struct datapath;
 struct packet;
+struct sender;
+struct ofl_exp_openflow_mp_request_header;
+
+/* Counters of the packet buffer store. */
+struct dp_buffers_stats {
+    uint64_t saves;         /* packets saved to a buffer */
+    uint64_t save_failures; /* packets not saved for lack of room */
+    uint64_t hits;          /* buffered packets retrieved by the controller */
+    uint64_t misses;        /* retrievals of unknown or overwritten buffers */
+    uint64_t evictions;     /* packets evicted to make room for newer ones */
+    size_t   buffered;      /* packets currently buffered */
+    size_t   bytes;         /* memory used by the buffered packets */
+};
 
 /* Creates a set of buffers */
 struct dp_buffers *
 dp_buffers_create(struct datapath *dp);
 
+/* Destroys the buffers and the packets they hold. */
+void
+dp_buffers_destroy(struct dp_buffers *dpb);
+
+/* Sets the number of buffers (rounded up to a power of two) and the memory
+ * budget for buffered packets in bytes; a zero budget keeps the current one.
+ * Must be called before any packet is buffered. */
+void
+dp_buffers_set_limits(struct dp_buffers *dpb, size_t buffers_num, size_t max_bytes);
+
 /* Returns the number of buffers */
 size_t
 dp_buffers_size(struct dp_buffers *dpb);
 
-/* Saves the packet into the buffer. Returns the saved buffer ID, or NO_BUFFER
- * if saving was not possible. */
+/* Fills stats with the current counters of the buffers. */
+void
+dp_buffers_get_stats(struct dp_buffers *dpb, struct dp_buffers_stats *stats);
+
+/* Handles a buffers experimenter multipart request. */
+ofl_err
+dp_buffers_handle_stats_request(struct datapath *dp,
+                                struct ofl_exp_openflow_mp_request_header *msg,
+                                const struct sender *sender);
+
+/* Saves the packet into the buffer, evicting the oldest timed out packets if
+ * there is no free buffer or the memory budget would be exceeded. Returns the
+ * saved buffer ID, or NO_BUFFER if saving was not possible. */
 uint32_t
 dp_buffers_save(struct dp_buffers *dpb, struct packet *pkt);
 
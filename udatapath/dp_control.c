@@ -21,6 +21,7 @@
 #include "dp_actions.h"
 #include "dp_buffers.h"
 #include "dp_ports.h"
+#include "ehddp_stats.h"
 #include "group_table.h"
 #include "meter_table.h"
 #include "packets.h"
@@ -135,12 +136,13 @@ handle_control_packet_out(struct datapath *dp, struct ofl_msg_packet_out *msg,
     }
     if (msg->data_length == sizeof(uint64_t)) //si tenemos un mensaje del tamaño de un uint64_t es nuestra marca temporal
     {
+        uint64_t time_connect_to_contoller;
+
         memcpy(&time_connect_to_contoller, msg->data, sizeof(uint64_t));
         controller_connected = true;
         ofl_msg_free_packet_out(msg, false, dp->exp);
         VLOG_WARN(LOG_MODULE, "Instante de Conexion al controlador >> %lu <<", time_connect_to_contoller);
-        if (dp->id > 1)
-            log_uah_estadisticos(dp);
+        ehddp_stats_controller_connect(dp->ehddp_stats, time_connect_to_contoller);
         //if (Reply_ON)
         //    send_reply_to_controller(dp);
         return 0;
@@ -174,13 +176,11 @@ handle_control_packet_out(struct datapath *dp, struct ofl_msg_packet_out *msg,
     }
 
     //Si detectamos que es un eHDDP packet (el primero marcamos el instante de llegada)
-    if (log_escrito == 0 && dp->id == 1 && 
+    if (time_start == 0 && dp->id == 1 && 
         (pkt->handle_std->proto->eth->eth_type == ETH_TYPE_EHDDP || pkt->handle_std->proto->eth->eth_type == ETH_TYPE_EHDDP_INV)){
-        //time_start = time_msec();
         time_start = current_timestamp();
-        log_uah_estadisticos(pkt->dp);
-        VLOG_WARN(LOG_MODULE, "He escrito el fichero del dp->id = 1 >> %lu <<", time_start);
-        log_escrito = 1;
+        ehddp_stats_exploration(dp->ehddp_stats, time_start);
+        VLOG_DBG(LOG_MODULE, "First eHDDP request sent at %"PRIu64".", time_start);
     }
 
     dp_execute_action_list(pkt, msg->actions_num, msg->actions, 0xffffffffffffffff);
@@ -307,7 +307,9 @@ handle_control_msg(struct datapath *dp, struct ofl_msg_header *msg,
     /* NOTE: It is assumed that if a handler returns with error, it did not use
              any part of the control message, thus it can be freed up.
              If no error is returned however, the message must be freed inside
-             the handler (because the handler might keep parts of the message) */
+             the handler (because the handler might keep parts of the message).
+             The exception is FLOW_MOD, which is always freed by the caller,
+             as it is unpacked into the datapath's message arena. */
     switch (msg->type) {
         case OFPT_HELLO: {
             ofl_msg_free(msg, dp->exp);
@@ -448,23 +450,3 @@ void mod_local_port_change_connection_uah(struct datapath * dp){
 
     }
 }
-
-void log_uah_estadisticos(struct datapath * dp){
-    FILE * file;
-	char nombre[100], Mensaje[1000];
-
-	VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Entro a Crear estadisticos");
-	sprintf(nombre,"/tmp/Estadisticos_switch.log");
-    file=fopen(nombre,"a");
-
-    sprintf(Mensaje,"%d\t%lu\t%lu\t%d\t%d\t%d\t%d\t%lu\t%lu\n ",(int)dp->id, time_connect_to_contoller, convergence_time, 
-        num_pkt_ehddp_req, num_pkt_ehddp_rep, num_pkt_arp_req, num_pkt_arp_rep, time_exploration, time_start);
-
-	if(file != NULL)
-	{
-        fseek(file, 0L, SEEK_END);
-        file = fopen( nombre , "a" );
-		fputs(Mensaje, file);
-		fclose(file);
-    }
-}
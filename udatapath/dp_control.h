@@ -29,19 +29,11 @@
 
 /*Modificación UAH*/
 extern uint8_t conection_status_ofp_controller;
-extern uint64_t time_connect_to_contoller;
-extern uint64_t time_exploration;
-extern uint64_t convergence_time;
 extern uint64_t time_start;
-extern uint8_t log_escrito;
 extern struct in_addr ip_if;
 extern uint32_t old_local_port;
 extern struct mac_to_port bt_table, learning_table;
 extern bool Reply_ON;
-extern int num_pkt_ehddp_req;
-extern int num_pkt_ehddp_rep;
-extern int num_pkt_arp_rep;
-extern int num_pkt_arp_req;
 extern bool controller_connected;
 
 /*Fin modificación UAH*/
@@ -55,7 +47,6 @@ handle_control_msg(struct datapath *dp, struct ofl_msg_header *msg,
 
 /*modificacion UAH*/
 void mod_local_port_change_connection_uah(struct datapath * dp);
-void log_uah_estadisticos(struct datapath * dp);
 
 /*Fin modificacion UAH*/
 
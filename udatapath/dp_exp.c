@@ -18,7 +18,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "datapath.h"
+#include "dp_buffers.h"
 #include "dp_exp.h"
+#include "dp_latency.h"
+#include "dp_ports.h"
+#include "ehddp_stats.h"
 #include "packet.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
@@ -46,11 +50,41 @@ dp_exp_inst(struct packet *pkt UNUSED, struct ofl_instruction_experimenter *inst
 }
 
 ofl_err
-dp_exp_stats(struct datapath *dp UNUSED,
+dp_exp_stats(struct datapath *dp,
                                   struct ofl_msg_multipart_request_experimenter *msg,
-                                  const struct sender *sender UNUSED) {
-	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter stats (%u).", msg->experimenter_id);
-    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+                                  const struct sender *sender) {
+
+    switch (msg->experimenter_id) {
+        case (OPENFLOW_VENDOR_ID): {
+            struct ofl_exp_openflow_mp_request_header *exp = (struct ofl_exp_openflow_mp_request_header *)msg;
+
+            switch(exp->type) {
+                case (OFP_EXT_STATS_LATENCY): {
+                    return dp_latency_handle_stats_request(dp, (struct ofl_exp_openflow_mp_request_latency *)msg, sender);
+                }
+                case (OFP_EXT_STATS_DISCOVERY): {
+                    return ehddp_stats_handle_stats_request(dp, exp, sender);
+                }
+                case (OFP_EXT_STATS_CONNECTIONS): {
+                    return dp_handle_stats_request_connections(dp, exp, sender);
+                }
+                case (OFP_EXT_STATS_BUFFERS): {
+                    return dp_buffers_handle_stats_request(dp, exp, sender);
+                }
+                case (OFP_EXT_STATS_QUEUES): {
+                    return dp_ports_handle_stats_request_sched(dp, exp, sender);
+                }
+                default: {
+                	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter stats type (%u).", exp->type);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+                }
+            }
+        }
+        default: {
+        	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter stats (%u).", msg->experimenter_id);
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+        }
+    }
 }
 
 
@@ -0,0 +1,210 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "datapath.h"
+#include "dp_latency.h"
+#include "histogram.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow-ext.h"
+#include "util.h"
+#include "vlog.h"
+
+#define LOG_MODULE VLM_dp_lat
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+/* A reply must fit in a single message, as dpctl only keeps the last part of
+ * a multipart reply. */
+#define MAX_REPLY_LEN 65535
+
+/* Time over which ticks are counted to convert them to nanoseconds. */
+#define CALIBRATION_NS 10000000
+
+static long long
+monotonic_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct dp_latency *
+dp_latency_create(void) {
+    return xcalloc(1, sizeof(struct dp_latency));
+}
+
+void
+dp_latency_destroy(struct dp_latency *lat) {
+    if (lat != NULL) {
+        free(lat->hists);
+        free(lat);
+    }
+}
+
+void
+dp_latency_enable(struct dp_latency *lat) {
+    if (lat->hists == NULL) {
+        lat->hists = xcalloc(DP_LATENCY_HISTS, sizeof *lat->hists);
+    }
+    if (!lat->enabled) {
+        lat->base_ticks = dp_latency_now();
+        lat->base_ns = monotonic_ns();
+        lat->enabled = true;
+    }
+}
+
+void
+dp_latency_disable(struct dp_latency *lat) {
+    lat->enabled = false;
+}
+
+void
+dp_latency_clear(struct dp_latency *lat) {
+    if (lat->hists != NULL) {
+        memset(lat->hists, 0, DP_LATENCY_HISTS * sizeof *lat->hists);
+    }
+}
+
+/* Returns the nanoseconds per tick of dp_latency_now(), measured since the
+ * histograms were last enabled. */
+static double
+ns_per_tick(struct dp_latency *lat) {
+#if defined(__x86_64__) || defined(__i386__)
+    long long ns;
+    uint64_t ticks;
+
+    do {
+        ns = monotonic_ns() - lat->base_ns;
+        ticks = dp_latency_now() - lat->base_ticks;
+    } while (ns < CALIBRATION_NS);
+    return ticks ? (double)ns / ticks : 1;
+#else
+    return 1;
+#endif
+}
+
+ofl_err
+dp_latency_handle_stats_request(struct datapath *dp,
+                                struct ofl_exp_openflow_mp_request_latency *msg,
+                                const struct sender *sender) {
+    struct dp_latency *lat = dp->latency;
+    struct ofl_exp_openflow_mp_reply_latency reply;
+    size_t len, i;
+    double scale;
+
+    switch (msg->command) {
+        case (OFP_EXT_LATENCY_GET): {
+            break;
+        }
+        case (OFP_EXT_LATENCY_ENABLE): {
+            dp_latency_enable(lat);
+            break;
+        }
+        case (OFP_EXT_LATENCY_DISABLE): {
+            dp_latency_disable(lat);
+            break;
+        }
+        case (OFP_EXT_LATENCY_CLEAR): {
+            dp_latency_clear(lat);
+            break;
+        }
+        default: {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "Received latency request with unknown command (%u).", msg->command);
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+        }
+    }
+
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.header.header.type = OFPMP_EXPERIMENTER;
+    reply.header.header.experimenter_id = OPENFLOW_VENDOR_ID;
+    reply.header.type = OFP_EXT_STATS_LATENCY;
+    reply.flags = lat->enabled ? OFP_EXT_LATENCY_ENABLED : 0;
+
+    if (lat->hists != NULL) {
+        reply.stages = xmalloc(DP_LATENCY_HISTS * sizeof *reply.stages);
+        scale = ns_per_tick(lat);
+
+        /* Every stage with samples is sent; its buckets only while they fit. */
+        len = sizeof(struct ofp_multipart_reply) + sizeof(struct openflow_ext_latency_reply);
+        for (i = 0; i < DP_LATENCY_HISTS; i++) {
+            if (lat->hists[i].count > 0) {
+                len += sizeof(struct openflow_ext_latency_stage);
+            }
+        }
+
+        for (i = 0; i < DP_LATENCY_HISTS; i++) {
+            struct histogram *h = &lat->hists[i];
+            struct ofl_exp_openflow_latency_stage *s;
+            size_t buckets = 0;
+            int b;
+
+            if (h->count == 0 || i == OFP_EXT_LATENCY_LOOKUP) {
+                continue;
+            }
+            s = &reply.stages[reply.stages_num++];
+            if (i < OFP_EXT_LATENCY_N_STAGES) {
+                s->stage = i;
+                s->table_id = 0xff;
+            } else {
+                s->stage = OFP_EXT_LATENCY_LOOKUP;
+                s->table_id = i - OFP_EXT_LATENCY_N_STAGES;
+            }
+            s->count = h->count;
+            s->sum_ns = h->sum * scale;
+            s->max_ns = h->max * scale;
+
+            for (b = 0; b < HISTOGRAM_BUCKETS; b++) {
+                if (h->buckets[b] > 0) {
+                    buckets++;
+                }
+            }
+            if (len + buckets * sizeof(struct openflow_ext_latency_bucket) > MAX_REPLY_LEN) {
+                reply.flags |= OFP_EXT_LATENCY_TRUNCATED;
+                s->buckets_num = 0;
+                s->buckets = NULL;
+                continue;
+            }
+            len += buckets * sizeof(struct openflow_ext_latency_bucket);
+
+            s->buckets_num = 0;
+            s->buckets = xmalloc(buckets * sizeof *s->buckets);
+            for (b = 0; b < HISTOGRAM_BUCKETS; b++) {
+                if (h->buckets[b] > 0) {
+                    s->buckets[s->buckets_num].ns = histogram_bucket_floor(b) * scale;
+                    s->buckets[s->buckets_num].count = h->buckets[b];
+                    s->buckets_num++;
+                }
+            }
+        }
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    for (i = 0; i < reply.stages_num; i++) {
+        free(reply.stages[i].buckets);
+    }
+    free(reply.stages);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DP_LATENCY_H
+#define DP_LATENCY_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "histogram.h"
+#include "oflib/ofl.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+
+/****************************************************************************
+ * Latency histograms of the stages a packet goes through in the datapath.
+ * Stages are only timed while enabled, so a disabled datapath pays a single
+ * branch per stage.
+ ****************************************************************************/
+
+struct datapath;
+struct sender;
+struct ofl_exp_openflow_mp_request_latency;
+
+/* Histograms are kept in the units of dp_latency_now(); the lookup stage has
+ * one per flow table, after the other stages. */
+#define DP_LATENCY_HISTS (OFP_EXT_LATENCY_N_STAGES + PIPELINE_TABLES)
+
+struct dp_latency {
+    bool enabled;
+    uint64_t base_ticks;        /* dp_latency_now() when last enabled. */
+    long long base_ns;          /* Monotonic time when last enabled. */
+    struct histogram *hists;    /* DP_LATENCY_HISTS, NULL until enabled. */
+};
+
+/* Returns the current time in ticks of the cheapest counter available: the
+ * time stamp counter on x86, nanoseconds otherwise. */
+static inline uint64_t
+dp_latency_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* Returns the start time of a stage to pass to dp_latency_stop(), or 0 if
+ * the stages are not being timed. */
+static inline uint64_t
+dp_latency_start(const struct dp_latency *lat) {
+    return lat->enabled ? dp_latency_now() : 0;
+}
+
+/* Records the time since 'start' in the histogram of 'stage'. */
+static inline void
+dp_latency_stop(struct dp_latency *lat, enum openflow_ext_latency_stages stage,
+                uint64_t start) {
+    if (start != 0) {
+        histogram_add(&lat->hists[stage], dp_latency_now() - start);
+    }
+}
+
+/* Records the time since 'start' in the histogram of the lookup of
+ * 'table_id'. */
+static inline void
+dp_latency_stop_lookup(struct dp_latency *lat, uint8_t table_id, uint64_t start) {
+    if (start != 0) {
+        histogram_add(&lat->hists[OFP_EXT_LATENCY_N_STAGES + table_id],
+                      dp_latency_now() - start);
+    }
+}
+
+/* Creates the histograms of a datapath, disabled. */
+struct dp_latency *
+dp_latency_create(void);
+
+/* Destroys the histograms. */
+void
+dp_latency_destroy(struct dp_latency *lat);
+
+/* Starts timing the stages. */
+void
+dp_latency_enable(struct dp_latency *lat);
+
+/* Stops timing the stages; the histograms are kept. */
+void
+dp_latency_disable(struct dp_latency *lat);
+
+/* Empties the histograms. */
+void
+dp_latency_clear(struct dp_latency *lat);
+
+/* Handles a latency experimenter multipart request: runs its command and
+ * replies with the histograms of the stages with samples. */
+ofl_err
+dp_latency_handle_stats_request(struct datapath *dp,
+                                struct ofl_exp_openflow_mp_request_latency *msg,
+                                const struct sender *sender);
+
+#endif /* DP_LATENCY_H */
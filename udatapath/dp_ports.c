@@ -26,14 +26,18 @@
 #include <errno.h>
 #include <inttypes.h>
 #include "dp_exp.h"
+#include "dp_latency.h"
+#include "ehddp_stats.h"
 #include "dp_ports.h"
 #include "datapath.h"
 #include "packets.h"
 #include "pipeline.h"
+#include "port_sched.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-messages.h"
 #include "oflib-exp/ofl-exp-openflow.h"
 #include "oflib/ofl-log.h"
+#include "trace.h"
 #include "util.h"
 
 #include "vlog.h"
@@ -130,8 +134,7 @@ hw_packet_in(of_port_t port_no, of_packet_t *packet, int reason,
     const int hard_header = VLAN_ETH_HEADER_LEN;
     const int tail_room = sizeof(uint32_t);  /* For crc if needed later */
 
-    VLOG_INFO(LOG_MODULE, "dp rcv packet on port %d, size %d\n",
-              port_no, packet->length);
+    TRACE(HW_PKT_RCV, port_no, packet->length);
     if ((port_no < 1) || port_no > DP_MAX_PORTS) {
         VLOG_ERR(LOG_MODULE, "Bad receive port %d\n", port_no);
         /* TODO increment error counter */
@@ -198,6 +201,7 @@ dp_hw_drv_init(struct datapath *dp)
 static void
 process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer) {
     struct packet *pkt;
+    uint64_t start;
 
     if ((p->conf->config & (OFPPC_NO_RECV | OFPPC_PORT_DOWN)) != 0) {
         ofpbuf_delete(buffer);
@@ -205,7 +209,9 @@ process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer) {
     }
 
     // packet takes ownership of ofpbuf buffer
+    start = dp_latency_start(dp->latency);
     pkt = packet_create(dp, p->stats->port_no, buffer, false);
+    dp_latency_stop(dp->latency, OFP_EXT_LATENCY_PARSE, start);
     pipeline_process_packet(dp->pipeline, pkt);
 }
 
@@ -243,6 +249,7 @@ dp_ports_run(struct datapath *dp) {
     }
 
     LIST_FOR_EACH_SAFE (p, pn, struct sw_port, node, &dp->port_list) {
+        uint64_t start;
         int error;
         /* Check for interface state change */
         enum netdev_link_state link_state = netdev_link_state(p->netdev);
@@ -274,8 +281,10 @@ dp_ports_run(struct datapath *dp) {
             const int headroom = 128 + 2;
             buffer = ofpbuf_new_with_headroom(VLAN_ETH_HEADER_LEN + max_mtu, headroom);
         }
+        start = dp_latency_start(dp->latency);
         error = netdev_recv(p->netdev, buffer, VLAN_ETH_HEADER_LEN + max_mtu);
         if (!error) {
+            dp_latency_stop(dp->latency, OFP_EXT_LATENCY_RX, start);
             p->stats->rx_packets++;
             p->stats->rx_bytes += buffer->size;
             // process_buffer takes ownership of ofpbuf buffer
@@ -296,6 +305,7 @@ dp_ports_run(struct datapath *dp) {
                     /*Si se ha recibido paquetes a través de la interfaz configurada como nuevo puerto local
                     se considera que ha finalizado la configuración del nuevo puerto local*/
                     local_port_ok = true; 
+                    ehddp_stats_local_port_ready(dp->ehddp_stats);
                 }
             }
             /*+++FIN+++*/
@@ -306,6 +316,12 @@ dp_ports_run(struct datapath *dp) {
         }
     }
 
+    /* Send what the frames just received left in the port queues. */
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (p->sched != NULL) {
+            port_sched_run(p->sched);
+        }
+    }
 }
 
 /* Returns the speed value in kbps of the highest bit set in the bitfield. */
@@ -381,7 +397,8 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
                  netdev_name, in6_name);
     }
 
-    if (max_queues > 0) {
+    /* The userspace scheduler replaces the tc classes. */
+    if (max_queues > 0 && !dp->queue_sched) {
         error = netdev_setup_slicing(netdev, max_queues);
         if (error) {
             VLOG_ERR(LOG_MODULE, "failed to configure slicing on %s device: "\
@@ -465,10 +482,16 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     port->created = now;
 
     memset(port->queues, 0x00, sizeof(port->queues));
+    if (max_queues > 0 && dp->queue_sched) {
+        port->sched = port_sched_create(port);
+    }
 
     list_push_back(&dp->port_list, &port->node);
     dp->ports_num++;
 
+    /* Groups may already watch the port number. */
+    group_table_port_live_changed(dp->groups, port_no);
+
     {
     /* Notify the controllers that this port has been added */
     struct ofl_msg_port_status msg =
@@ -613,6 +636,27 @@ dp_ports_lookup_queue(struct sw_port *p, uint32_t queue_id)
     return NULL;
 }
 
+int
+dp_ports_send(struct sw_port *p, struct sw_queue *q, const struct ofpbuf *buffer,
+              uint16_t class_id)
+{
+    uint64_t start;
+    int error;
+
+    start = dp_latency_start(p->dp->latency);
+    error = netdev_send(p->netdev, buffer, class_id);
+    dp_latency_stop(p->dp->latency, OFP_EXT_LATENCY_TX, start);
+    if (!error) {
+        p->stats->tx_packets++;
+        p->stats->tx_bytes += buffer->size;
+        if (q != NULL) {
+            q->stats->tx_packets++;
+            q->stats->tx_bytes += buffer->size;
+        }
+    }
+    return error;
+}
+
 void
 dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
               uint32_t queue_id)
@@ -665,14 +709,9 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
                 }
             }
 
-            if (!netdev_send(p->netdev, buffer, class_id)) {
-                p->stats->tx_packets++;
-                p->stats->tx_bytes += buffer->size;
-                if (q != NULL) {
-                    q->stats->tx_packets++;
-                    q->stats->tx_bytes += buffer->size;
-                }
-            } else {
+            if (p->sched != NULL) {
+                port_sched_enqueue(p->sched, class_id, buffer);
+            } else if (dp_ports_send(p, q, buffer, class_id)) {
                 p->stats->tx_dropped++;
             }
         }
@@ -811,6 +850,7 @@ dp_port_stats_update(struct sw_port *port) {
 
 void
 dp_port_live_update(struct sw_port *p) {
+  uint32_t old_state = p->conf->state;
 
   if((p->conf->state & OFPPS_LINK_DOWN)
      || (p->conf->config & OFPPC_PORT_DOWN)) {
@@ -820,6 +860,12 @@ dp_port_live_update(struct sw_port *p) {
       /* Port is live */
       p->conf->state |= OFPPS_LIVE;
   }
+
+  /* Groups keep their live buckets; only tell them about real changes, as
+   * link state is refreshed on every event. */
+  if ((old_state ^ p->conf->state) & OFPPS_LIVE) {
+      group_table_port_live_changed(p->dp->groups, p->conf->port_no);
+  }
 }
 
 ofl_err
@@ -989,6 +1035,59 @@ dp_ports_handle_stats_request_queue(struct datapath *dp,
     return 0;
 }
 
+ofl_err
+dp_ports_handle_stats_request_sched(struct datapath *dp,
+                                    struct ofl_exp_openflow_mp_request_header *msg,
+                                    const struct sender *sender) {
+    struct ofl_exp_openflow_mp_reply_queues reply;
+    struct sw_port *p;
+    size_t i, num = 0;
+
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.header.header.type = OFPMP_EXPERIMENTER;
+    reply.header.header.experimenter_id = OPENFLOW_VENDOR_ID;
+    reply.header.type = OFP_EXT_STATS_QUEUES;
+
+    LIST_FOR_EACH(p, struct sw_port, node, &dp->port_list) {
+        if (p->sched != NULL) {
+            num += p->num_queues;
+        }
+    }
+    reply.queues = xmalloc(MAX(num, 1) * sizeof *reply.queues);
+
+    LIST_FOR_EACH(p, struct sw_port, node, &dp->port_list) {
+        if (p->sched == NULL) {
+            continue;
+        }
+        for (i = 0; i < p->max_queues && reply.queues_num < num; i++) {
+            struct sw_queue *q = &p->queues[i];
+            struct ofl_exp_openflow_queue *dst;
+            struct port_sched_queue_stats stats;
+
+            if (q->port == NULL) {
+                continue;
+            }
+            port_sched_get_queue_stats(p->sched, q->class_id, &stats);
+            dst = &reply.queues[reply.queues_num++];
+            dst->port_no          = p->conf->port_no;
+            dst->queue_id         = q->stats->queue_id;
+            dst->backlog_packets  = stats.backlog_packets;
+            dst->backlog_bytes    = stats.backlog_bytes;
+            dst->sent             = stats.sent;
+            dst->dropped          = stats.dropped;
+            dst->sojourn_msec     = stats.sojourn_msec;
+            dst->sojourn_max_msec = stats.sojourn_max_msec;
+        }
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    free(reply.queues);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
 ofl_err
 dp_ports_handle_queue_get_config_request(struct datapath *dp,
                               struct ofl_msg_queue_get_config_request *msg,
@@ -1052,6 +1151,58 @@ dp_ports_handle_queue_get_config_request(struct datapath *dp,
  * Queue handling
  */
 
+/* Returns the property of 'type' of 'queue', or NULL if it has none. */
+static struct ofl_queue_prop_header *
+queue_get_prop(struct ofl_packet_queue *queue, enum ofp_queue_properties type)
+{
+    size_t i;
+
+    for (i = 0; i < queue->properties_num; i++) {
+        if (queue->properties[i]->type == type) {
+            return queue->properties[i];
+        }
+    }
+    return NULL;
+}
+
+/* Returns the maximum rate of 'queue' in .1% of the link speed, or
+ * OFPQ_MAX_RATE_UNCFG. */
+static uint16_t
+queue_max_rate(struct ofl_packet_queue *queue)
+{
+    struct ofl_queue_prop_max_rate *mx;
+
+    mx = (struct ofl_queue_prop_max_rate *)queue_get_prop(queue, OFPQT_MAX_RATE);
+    return mx != NULL ? mx->rate : OFPQ_MAX_RATE_UNCFG;
+}
+
+/* Sets the maximum rate of 'queue', kept as its second property; the first
+ * one is always the minimum rate. */
+static void
+queue_set_max_rate(struct sw_queue *queue, uint16_t rate)
+{
+    struct ofl_packet_queue *props = queue->props;
+    struct ofl_queue_prop_max_rate *mx;
+
+    if (rate > 1000) {
+        if (props->properties_num > 1) {
+            free(props->properties[1]);
+            props->properties_num = 1;
+        }
+        return;
+    }
+
+    if (props->properties_num == 1) {
+        props->properties = xrealloc(props->properties,
+                                     2 * sizeof(struct ofl_queue_prop_header *));
+        props->properties[1] = xmalloc(sizeof(struct ofl_queue_prop_max_rate));
+        props->properties[1]->type = OFPQT_MAX_RATE;
+        props->properties_num = 2;
+    }
+    mx = (struct ofl_queue_prop_max_rate *)props->properties[1];
+    mx->rate = rate;
+}
+
 static int
 new_queue(struct sw_port * port, struct sw_queue * queue,
           uint32_t queue_id, uint16_t class_id,
@@ -1109,6 +1260,9 @@ port_add_queue(struct sw_port *p, uint32_t queue_id,
 static int
 port_delete_queue(struct sw_port *p, struct sw_queue *q)
 {
+    if (p->sched != NULL) {
+        port_sched_clear_queue(p->sched, q->class_id);
+    }
     memset(q,'\0', sizeof *q);
     p->num_queues--;
     return 0;
@@ -1128,8 +1282,10 @@ dp_ports_handle_queue_modify(struct datapath *dp, struct ofl_exp_openflow_msg_qu
         q = dp_ports_lookup_queue(p, msg->queue->queue_id);
         if (q != NULL) {
             /* queue exists - modify it */
-            error = netdev_change_class(p->netdev,q->class_id,
+            if (p->sched == NULL) {
+                error = netdev_change_class(p->netdev,q->class_id,
                                  ((struct ofl_queue_prop_min_rate *)msg->queue->properties[0])->rate);
+            }
              if (error) {
                  VLOG_ERR(LOG_MODULE, "Failed to update queue %d", msg->queue->queue_id);
                  return ofl_error(OFPET_QUEUE_OP_FAILED, OFPQOFC_EPERM);
@@ -1148,12 +1304,22 @@ dp_ports_handle_queue_modify(struct datapath *dp, struct ofl_exp_openflow_msg_qu
             }
 
             q = dp_ports_lookup_queue(p, msg->queue->queue_id);
+            if (p->sched == NULL) {
                 error = netdev_setup_class(p->netdev,q->class_id,
                                 ((struct ofl_queue_prop_min_rate *)msg->queue->properties[0])->rate);
                 if (error) {
                     VLOG_ERR(LOG_MODULE, "Failed to configure queue %d", msg->queue->queue_id);
                     return ofl_error(OFPET_QUEUE_OP_FAILED, OFPQOFC_BAD_QUEUE);
                 }
+            }
+        }
+
+        if (p->sched != NULL) {
+            /* Only the userspace scheduler enforces a maximum rate. */
+            queue_set_max_rate(q, queue_max_rate(msg->queue));
+            port_sched_set_rates(p->sched, q->class_id,
+                                 ((struct ofl_queue_prop_min_rate *)q->props->properties[0])->rate,
+                                 queue_max_rate(q->props));
         }
 
     } else {
@@ -1187,7 +1353,9 @@ dp_ports_handle_queue_delete(struct datapath *dp, struct ofl_exp_openflow_msg_qu
     if (p != NULL && p->netdev != NULL) {
         q = dp_ports_lookup_queue(p, msg->queue->queue_id);
         if (q != NULL) {
-            netdev_delete_class(p->netdev,q->class_id);
+            if (p->sched == NULL) {
+                netdev_delete_class(p->netdev,q->class_id);
+            }
             port_delete_queue(p, q);
 
             ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
@@ -1388,13 +1556,14 @@ int mac_to_port_found_mac_position(struct mac_to_port *mac_port, uint64_t positi
         {
             if (pos == position-1) {
                 if (marca_tiempo_msec <= aux->valid_time_entry){
-                    VLOG_INFO(LOG_MODULE, "MAC encontrada en posicion localizada devolvemos 1");
                     memcpy(Mac, aux->Mac, ETH_ADDR_LEN);
+                    TRACE(BT_MAC_POSITION, position, pos);
                     return pos;
                 }
                 else 
                 {
-                    VLOG_INFO(LOG_MODULE, "MAC encontrada pero caducada devolvemos 0");
+                    /* Found, but expired. */
+                    TRACE(BT_MAC_POSITION, position, 0);
                     return 0; //puerto 0 -> puerto encontrado pero caducado
                 }
             }
@@ -1403,7 +1572,7 @@ int mac_to_port_found_mac_position(struct mac_to_port *mac_port, uint64_t positi
             pos++;
         }
     }
-    VLOG_INFO(LOG_MODULE, "MAC NO encontrada devolvemos -1");
+    TRACE(BT_MAC_POSITION, position, -1);
     return -1; //si no existe tal puerto
 }
 
@@ -1640,36 +1809,10 @@ void visualizar_tabla(struct mac_to_port *mac_port, int64_t id_datapath)
 	VLOG_INFO(LOG_MODULE, "%s\n", mac_tabla);
 }
 
-void log_uah(const void *Mensaje, int64_t id)
-{
-
-	FILE * file;
-	char nombre[90], nombre2[90];
-
-	VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Entro a Crear Log");
-	sprintf(nombre,"/tmp/DHT_switch_%d.log",(int)id);
-	
-	file=fopen(nombre,"a");
-	if(file != NULL)
-	{
-		fseek(file, 0L, SEEK_END);
-		if(ftell(file) > 16000)
-		{
-			fclose(file);
-			sprintf(nombre2,"/tmp/ehddp_switch_%d-%lu.log",(int)id,(long)time_msec());
-			rename(nombre,nombre2);
-		}
-		file = fopen( nombre , "a" );
-		fputs(Mensaje, file);
-		fclose(file);
-	}
-	else
-		VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Archivo no abierto");
-}
-
 struct in_addr remove_local_port_UAH(struct datapath *dp)
 {
     int error;
+    struct sw_port *port;
     struct in_addr ip_0 = {INADDR_ANY}, ip_if;                                //Para poner a 0 la ip de la interfaz a eliminar
     
     netdev_get_in4(dp->local_port->netdev, &ip_if);                           //Se obtiene la ip de la interfaz  
@@ -1683,12 +1826,18 @@ struct in_addr remove_local_port_UAH(struct datapath *dp)
 
     list_pop_back(&dp->port_list); //Se elimina el último puerto (puerto_local) de la lista
 
-    free(dp->local_port->conf);
-    free(dp->local_port->stats);
-    free(dp->local_port); //Se libera la memoria del peurto local
-
+    port = dp->local_port;
     dp->ports_num--; //Se decrementa el número de puertos
     dp->local_port = NULL;
+    port_sched_destroy(port->sched);
+
+    /* Buckets watching the local port are no longer live; the groups must
+     * drop them before the port goes away. */
+    group_table_port_live_changed(dp->groups, OFPP_LOCAL);
+
+    free(port->conf);
+    free(port->stats);
+    free(port); //Se libera la memoria del peurto local
 
     if (ip_if.s_addr == INADDR_ANY)                                           //Si la IP es 0.0.0.0 es decir no hay
         ip_if.s_addr = ip_de_control_in_band.s_addr;                                     //le asignamos la definida en la configuración incial
@@ -46,6 +46,7 @@
 
 
 struct sender;
+struct port_sched;
 
 struct sw_queue {
     struct sw_port *port; /* reference to the parent port */
@@ -82,6 +83,7 @@ struct sw_port {
     uint16_t num_queues;
     uint64_t created;
     struct sw_queue queues[NETDEV_MAX_QUEUES];
+    struct port_sched *sched; /* userspace queue scheduler, or NULL */
 };
 
 
@@ -152,6 +154,13 @@ void
 dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
               uint32_t queue_id);
 
+/* Sends the frame in 'buffer' through port 'p' in tc class 'class_id', and
+ * accounts it to the port and to queue 'q', if not null. Returns 0 or a
+ * positive errno; failures are left for the caller to count. */
+int
+dp_ports_send(struct sw_port *p, struct sw_queue *q, const struct ofpbuf *buffer,
+              uint16_t class_id);
+
 /* Outputs a datapath packet on all ports except for in_port. If flood is set,
  * packet is not sent out on ports with flooding disabled. */
 int
@@ -184,6 +193,13 @@ dp_ports_handle_stats_request_queue(struct datapath *dp,
                                   struct ofl_msg_multipart_request_queue *msg,
                                   const struct sender *sender);
 
+/* Handles an experimenter request for the counters of the queues served by
+ * the userspace port schedulers. */
+ofl_err
+dp_ports_handle_stats_request_sched(struct datapath *dp,
+                                    struct ofl_exp_openflow_mp_request_header *msg,
+                                    const struct sender *sender);
+
 /* Handles a queue get config request message. */
 ofl_err
 dp_ports_handle_queue_get_config_request(struct datapath *dp,
@@ -242,7 +258,6 @@ int mac_to_port_delete_position(struct mac_to_port *mac_port, int position);
 /*Debug function */
 //show new table
 void visualizar_tabla(struct mac_to_port *mac_port, int64_t id_datapath);
-void log_uah(const void *Mensaje, int64_t id);
 
 struct in_addr remove_local_port_UAH(struct datapath *dp);
 int configure_new_local_port_ehddp_UAH(struct datapath *dp, uint8_t *mac, uint32_t old_local_port, uint64_t time_start_process);
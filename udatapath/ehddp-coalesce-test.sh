@@ -0,0 +1,26 @@
+#! /bin/sh
+
+# Runs the same eHDDP exploration of a tree with and without coalescing of the
+# replies, and checks that coalescing discovers every switch with fewer reply
+# frames on the links and fewer packet-ins at the controller.
+
+sim=${EHDDP_SIM:-./udatapath/ehddp-sim}
+args="--topology=tree --nodes=63 --fanout=2 --latency=1"
+
+counter() {
+    sed -n "s/^$1: *\([0-9]*\).*/\1/p"
+}
+
+plain=`$sim $args` || { echo "exploration without coalescing did not converge"; exit 1; }
+merged=`$sim $args --coalesce=10` || { echo "exploration with coalescing did not converge"; exit 1; }
+
+for name in "reply frames" "packet-ins"; do
+    before=`echo "$plain" | counter "$name"`
+    after=`echo "$merged" | counter "$name"`
+    echo "$name: $before without coalescing, $after with it"
+    if test -z "$before" || test -z "$after" || test "$after" -ge "$before"; then
+        echo "coalescing did not reduce the $name"
+        exit 1
+    fi
+done
+exit 0
@@ -0,0 +1,23 @@
+#! /bin/sh
+
+# Runs eHDDP explorations of topologies with redundant links, and checks that
+# the replies reaching the controller report every link, not only those of
+# the spanning tree the requests were flooded along.
+
+sim=${EHDDP_SIM:-./udatapath/ehddp-sim}
+
+counter() {
+    sed -n "s/^$1: *\([0-9]*\).*/\1/p"
+}
+
+for args in "--topology=ring --nodes=12" "--topology=random --nodes=30 --degree=3"; do
+    out=`$sim $args` || { echo "$args: exploration did not converge"; exit 1; }
+    links=`echo "$out" | counter "links"`
+    found=`echo "$out" | counter "links found"`
+    echo "$args: $found of $links links found"
+    if test -z "$links" || test "$found" != "$links"; then
+        echo "$args: the replies did not report every link"
+        exit 1
+    fi
+done
+exit 0
@@ -0,0 +1,166 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ehddp_coalesce.h"
+#include "dp_actions.h"
+#include "list.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "packets.h"
+#include "poll-loop.h"
+#include "timeval.h"
+#include "util.h"
+
+/* A frame waiting for more replies to the same request. */
+struct pending_reply {
+    struct list    node;      /* in ehddp_coalesce.pending, oldest first */
+    struct packet *pkt;       /* the frame, owned by the stage */
+    uint32_t       out_port;
+    uint64_t       num_sec;
+    uint8_t        nxt_mac[ETH_ADDR_LEN];
+    long long      deadline;  /* time_msec() at which the frame is sent */
+};
+
+struct ehddp_coalesce {
+    unsigned int window;      /* msec replies are held, 0 if disabled */
+    struct list  pending;     /* pending frames; all share the window, so
+                                 they are also in deadline order */
+    struct ehddp_coalesce_stats stats;
+};
+
+struct ehddp_coalesce *
+ehddp_coalesce_create(void) {
+    struct ehddp_coalesce *ec = xcalloc(1, sizeof(struct ehddp_coalesce));
+
+    list_init(&ec->pending);
+    return ec;
+}
+
+static void
+send_pending(struct ehddp_coalesce *ec, struct pending_reply *p) {
+    struct packet *pkt = p->pkt;
+
+    dp_actions_output_port(pkt, p->out_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
+    ec->stats.frames++;
+
+    list_remove(&p->node);
+    packet_destroy(pkt);
+    free(p);
+}
+
+void
+ehddp_coalesce_set_window(struct ehddp_coalesce *ec, unsigned int msec) {
+    ec->window = msec;
+    if (msec == 0) {
+        struct pending_reply *p, *next;
+
+        LIST_FOR_EACH_SAFE (p, next, struct pending_reply, node, &ec->pending) {
+            send_pending(ec, p);
+        }
+    }
+}
+
+void
+ehddp_coalesce_output(struct ehddp_coalesce *ec, struct packet *pkt, uint32_t out_port) {
+    struct ehddp_header *ehddp = pkt->handle_std->proto->ehddp;
+    struct pending_reply *p;
+
+    ec->stats.replies++;
+    if (ec->window == 0) {
+        dp_actions_output_port(pkt, out_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
+        ec->stats.frames++;
+        return;
+    }
+
+    LIST_FOR_EACH (p, struct pending_reply, node, &ec->pending) {
+        if (p->out_port == out_port && p->num_sec == ehddp->num_sec
+            && !memcmp(p->nxt_mac, ehddp->nxt_mac, ETH_ADDR_LEN)) {
+            if (ehddp_merge_reply(p->pkt, pkt) == 0) {
+                ec->stats.merged++;
+                return;
+            }
+            /* The frame is full; send it and start a new one. */
+            send_pending(ec, p);
+            break;
+        }
+    }
+
+    p = xmalloc(sizeof *p);
+    p->pkt = packet_clone(pkt);
+    p->out_port = out_port;
+    p->num_sec = ehddp->num_sec;
+    memcpy(p->nxt_mac, ehddp->nxt_mac, ETH_ADDR_LEN);
+    p->deadline = time_msec() + ec->window;
+    list_push_back(&ec->pending, &p->node);
+}
+
+void
+ehddp_coalesce_run(struct ehddp_coalesce *ec) {
+    long long now = time_msec();
+
+    while (!list_is_empty(&ec->pending)) {
+        struct pending_reply *p = CONTAINER_OF(list_front(&ec->pending),
+                                               struct pending_reply, node);
+        if (p->deadline > now) {
+            break;
+        }
+        send_pending(ec, p);
+    }
+}
+
+void
+ehddp_coalesce_wait(struct ehddp_coalesce *ec) {
+    if (!list_is_empty(&ec->pending)) {
+        struct pending_reply *p = CONTAINER_OF(list_front(&ec->pending),
+                                               struct pending_reply, node);
+        long long delay = p->deadline - time_msec();
+
+        poll_timer_wait(delay > 0 ? delay : 0);
+    }
+}
+
+long long
+ehddp_coalesce_next_deadline(struct ehddp_coalesce *ec) {
+    if (list_is_empty(&ec->pending)) {
+        return -1;
+    }
+    return CONTAINER_OF(list_front(&ec->pending), struct pending_reply, node)->deadline;
+}
+
+void
+ehddp_coalesce_get_stats(struct ehddp_coalesce *ec, struct ehddp_coalesce_stats *stats) {
+    *stats = ec->stats;
+}
+
+void
+ehddp_coalesce_destroy(struct ehddp_coalesce *ec) {
+    struct pending_reply *p, *next;
+
+    if (ec == NULL) {
+        return;
+    }
+    LIST_FOR_EACH_SAFE (p, next, struct pending_reply, node, &ec->pending) {
+        list_remove(&p->node);
+        packet_destroy(p->pkt);
+        free(p);
+    }
+    free(ec);
+}
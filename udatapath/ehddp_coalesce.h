@@ -0,0 +1,75 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EHDDP_COALESCE_H
+#define EHDDP_COALESCE_H 1
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Coalescing of the eHDDP replies forwarded towards the controller. Replies
+ * to the same request leaving through the same port are held for a short
+ * window and sent as a single frame carrying all their device lists.
+ ****************************************************************************/
+
+struct packet;
+
+/* Counters of the coalescing stage. */
+struct ehddp_coalesce_stats {
+    uint64_t replies; /* replies handed to the stage */
+    uint64_t merged;  /* replies merged into a pending frame */
+    uint64_t frames;  /* frames sent */
+};
+
+/* Creates the coalescing stage, disabled. */
+struct ehddp_coalesce *
+ehddp_coalesce_create(void);
+
+/* Sets the window during which replies are held, in milliseconds. A zero
+ * window disables coalescing; pending frames are sent right away. */
+void
+ehddp_coalesce_set_window(struct ehddp_coalesce *ec, unsigned int msec);
+
+/* Sends the reply in 'pkt' through 'out_port', merging it into a pending
+ * frame for the same request and port when coalescing is enabled. The caller
+ * keeps the ownership of 'pkt'. */
+void
+ehddp_coalesce_output(struct ehddp_coalesce *ec, struct packet *pkt, uint32_t out_port);
+
+/* Sends the pending frames whose window is over. */
+void
+ehddp_coalesce_run(struct ehddp_coalesce *ec);
+
+/* Arranges for the poll loop to wake up when the next window is over. */
+void
+ehddp_coalesce_wait(struct ehddp_coalesce *ec);
+
+/* Returns the time_msec() at which the next window is over, or -1 if no
+ * frame is pending. */
+long long
+ehddp_coalesce_next_deadline(struct ehddp_coalesce *ec);
+
+/* Fills stats with the current counters of the stage. */
+void
+ehddp_coalesce_get_stats(struct ehddp_coalesce *ec, struct ehddp_coalesce_stats *stats);
+
+/* Destroys the stage. The pending frames are dropped, as their ports may
+ * already be gone. */
+void
+ehddp_coalesce_destroy(struct ehddp_coalesce *ec);
+
+#endif /* EHDDP_COALESCE_H */
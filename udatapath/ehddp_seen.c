@@ -0,0 +1,129 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ehddp_seen.h"
+#include "hash.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "packets.h"
+#include "timeval.h"
+#include "util.h"
+
+/* The set is a table of buckets of a few slots each. A slot keeps a 64-bit
+ * fingerprint of the request instead of the request itself, so that the
+ * whole set fits in a handful of cache lines. */
+#define SEEN_BUCKET_BITS 8
+#define SEEN_BUCKETS     (1 << SEEN_BUCKET_BITS)
+#define SEEN_WAYS        4
+
+/* Lifetime of an entry. Requests of a new exploration carry a new sequence
+ * number, so this only bounds how long stale entries take up room. */
+#define SEEN_MSEC 10000
+
+struct seen_slot {
+    uint64_t fp;        /* fingerprint, 0 if the slot is free */
+    long long expires;  /* time_msec() after which the slot is free */
+};
+
+struct ehddp_seen {
+    struct seen_slot slots[SEEN_BUCKETS][SEEN_WAYS];
+    struct ehddp_seen_stats stats;
+};
+
+/* The fields telling apart two copies of a request: its origin and sequence
+ * number, and the link and neighbour it arrived from. The devices the request
+ * went through are hashed after the key. Copies over other links or paths
+ * differ, since their replies are what report redundant links and better
+ * paths. */
+struct seen_key {
+    uint8_t  src_mac[ETH_ADDR_LEN];
+    uint8_t  hop_mac[ETH_ADDR_LEN];
+    uint64_t num_sec;
+    uint32_t in_port;
+    uint32_t num_devices;
+};
+
+struct ehddp_seen *
+ehddp_seen_create(void) {
+    return xcalloc(1, sizeof(struct ehddp_seen));
+}
+
+void
+ehddp_seen_destroy(struct ehddp_seen *seen) {
+    free(seen);
+}
+
+bool
+ehddp_seen_check(struct ehddp_seen *seen, struct packet *pkt) {
+    struct ehddp_header *ehddp = pkt->handle_std->proto->ehddp;
+    struct seen_slot *bucket, *victim;
+    struct seen_key key;
+    long long now = time_msec();
+    const uint8_t *devices;
+    uint32_t h1, h2;
+    size_t len, i;
+    uint64_t fp;
+
+    memset(&key, 0, sizeof key);
+    memcpy(key.src_mac, ehddp->src_mac, ETH_ADDR_LEN);
+    memcpy(key.hop_mac, pkt->handle_std->proto->eth->eth_src, ETH_ADDR_LEN);
+    key.num_sec = ehddp->num_sec;
+    key.in_port = pkt->in_port;
+    key.num_devices = ehddp->num_devices;
+
+    devices = ehddp_elements(pkt, &len);
+    h1 = hash_bytes(&key, sizeof key, 0);
+    h1 = hash_bytes(devices, len, h1);
+    h2 = hash_bytes(&key, sizeof key, h1);
+    h2 = hash_bytes(devices, len, h2);
+    fp = ((uint64_t)h1 << 32) | h2;
+    if (fp == 0) {
+        fp = 1;
+    }
+
+    seen->stats.checked++;
+    bucket = seen->slots[h1 & (SEEN_BUCKETS - 1)];
+    victim = &bucket[0];
+    for (i = 0; i < SEEN_WAYS; i++) {
+        struct seen_slot *slot = &bucket[i];
+
+        if (slot->fp == fp && slot->expires > now) {
+            seen->stats.suppressed++;
+            return true;
+        }
+        if (slot->expires < victim->expires) {
+            victim = slot;
+        }
+    }
+
+    if (victim->fp != 0 && victim->expires > now) {
+        seen->stats.evictions++;
+    }
+    victim->fp = fp;
+    victim->expires = now + SEEN_MSEC;
+    return false;
+}
+
+void
+ehddp_seen_get_stats(struct ehddp_seen *seen, struct ehddp_seen_stats *stats) {
+    *stats = seen->stats;
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EHDDP_SEEN_H
+#define EHDDP_SEEN_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Set of recently seen eHDDP requests, used to drop the copies of a request
+ * that reach the switch more than once over the same link along the same
+ * path. Copies over redundant links or paths are not repeats: their replies
+ * report the redundant links, and they let the switch adopt a better path.
+ ****************************************************************************/
+
+struct packet;
+
+/* Counters of the seen-set. */
+struct ehddp_seen_stats {
+    uint64_t checked;    /* requests looked up */
+    uint64_t suppressed; /* requests dropped as duplicates */
+    uint64_t evictions;  /* live entries overwritten for lack of room */
+};
+
+/* Creates an empty seen-set. */
+struct ehddp_seen *
+ehddp_seen_create(void);
+
+/* Destroys a seen-set. */
+void
+ehddp_seen_destroy(struct ehddp_seen *seen);
+
+/* Returns true if a copy of the eHDDP request in 'pkt', with the same origin,
+ * sequence number, input port, neighbour and device list, was already seen
+ * within the lifetime of an entry. Otherwise records the request and returns
+ * false. */
+bool
+ehddp_seen_check(struct ehddp_seen *seen, struct packet *pkt);
+
+/* Fills stats with the current counters of the seen-set. */
+void
+ehddp_seen_get_stats(struct ehddp_seen *seen, struct ehddp_seen_stats *stats);
+
+#endif /* EHDDP_SEEN_H */
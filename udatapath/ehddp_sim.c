@@ -0,0 +1,866 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* In-process eHDDP discovery simulator.
+ *
+ * Runs a whole topology of datapaths in a single process. Their ports are
+ * "sim:" network devices joined by in-memory links with a fixed latency and a
+ * loss probability, and time is a virtual clock that jumps from one frame
+ * delivery to the next, so that a run only depends on its options and seed.
+ *
+ * Datapath 1 stands for the switch of the controller: the stub controller
+ * starts an exploration with a packet-out of an eHDDP request through it, and
+ * every reply reaching it is taken as a packet-in. The simulated switches get
+ * the ids 2 to N+1, since the switches only take part in eHDDP with ids from 2
+ * to 999. */
+
+#include <config.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "command-line.h"
+#include "datapath.h"
+#include "dp_control.h"
+#include "dp_ports.h"
+#include "ehddp_coalesce.h"
+#include "ehddp_stats.h"
+#include "list.h"
+#include "netdev.h"
+#include "ofpbuf.h"
+#include "openflow/openflow.h"
+#include "packet.h"
+#include "packets.h"
+#include "pipeline.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+#include "xtoxll.h"
+#include "oflib/ofl-actions.h"
+#include "oflib/ofl-messages.h"
+#include "oflib/ofl-packets.h"
+
+/* Switches in eHDDP have ids below 1000, and id 1 is the controller's. */
+#define SIM_MAX_NODES 998
+
+/* Sequence number of the exploration, as the controller would take it from
+ * its clock. */
+#define SIM_NUM_SEC 1
+
+enum sim_topology {
+    TOPO_LINE,
+    TOPO_RING,
+    TOPO_TREE,
+    TOPO_FAT_TREE,
+    TOPO_RANDOM
+};
+
+static const char *topology_names[] = {"line", "ring", "tree", "fat-tree", "random"};
+
+/* Options. */
+static enum sim_topology topology = TOPO_LINE;
+static int n_nodes = 10;
+static int fanout = 2;
+static int degree = 3;
+static long long latency = 1;
+static double loss;
+static uint64_t seed = 1;
+static long long timeout = 60000;
+static unsigned int coalesce;
+
+/* A frame on its way through a link. */
+struct sim_frame {
+    struct list node;         /* in sim_port.rx, oldest first */
+    long long deliver_at;     /* time_msec() at which it can be received */
+    struct ofpbuf *buf;
+};
+
+/* One end of a link. */
+struct sim_port {
+    int owner;                /* index in 'switches' */
+    int peer;                 /* index of the other end, -1 if not linked */
+    struct list rx;           /* frames to receive, in delivery order */
+};
+
+/* A datapath and its copy of the eHDDP state that the datapath code keeps in
+ * globals. */
+struct sim_switch {
+    struct datapath *dp;
+    struct mac_to_port bt_table;
+    struct mac_to_port learning_table;
+    int port_to_controller;
+    uint64_t time_start;
+    uint64_t time_no_move_local_port;
+    uint32_t old_local_port;
+    bool local_port_ok;
+
+    long long cpu_ns;         /* CPU time spent in dp_run() */
+};
+
+static struct sim_switch *switches;  /* the controller's first, then nodes */
+static int n_switches;
+static struct sim_port *ports;
+static int n_ports, allocated_ports;
+static int n_links;
+
+/* Counters of the run. */
+static uint64_t frames_sent;
+static uint64_t frames_lost;
+static uint64_t packet_ins;
+static bool *discovered;
+static int n_discovered;
+static int (*found_links)[2];        /* links reported, as pairs of ids */
+static int n_found_links, allocated_found_links;
+static long long converged_at = -1;
+
+static void parse_options(int argc, char *argv[]);
+static void usage(void) NO_RETURN;
+
+/* Deterministic xorshift generator, so that the same seed gives the same
+ * topology and losses. */
+static uint64_t
+sim_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+static int
+sim_random_range(int n) {
+    return sim_random() % n;
+}
+
+/* Network devices of the simulator. */
+
+static int
+sim_open(const char *name, uint8_t etheraddr[6], void **aux) {
+    char *end;
+    unsigned long idx = strtoul(name, &end, 10);
+
+    if (*end != '\0' || idx >= (unsigned long)n_ports) {
+        return ENODEV;
+    }
+    etheraddr[0] = 0x02;
+    etheraddr[1] = 0x00;
+    etheraddr[2] = idx >> 24;
+    etheraddr[3] = idx >> 16;
+    etheraddr[4] = idx >> 8;
+    etheraddr[5] = idx;
+    *aux = &ports[idx];
+    return 0;
+}
+
+static void
+sim_close(void *aux UNUSED) {
+}
+
+/* Records the link between the devices 'a' and 'b', as the controller infers
+ * it from two devices next to each other in a reply. */
+static void
+found_link(uint64_t a, uint64_t b) {
+    int lo = MIN(a, b), hi = MAX(a, b);
+    int i;
+
+    for (i = 0; i < n_found_links; i++) {
+        if (found_links[i][0] == lo && found_links[i][1] == hi) {
+            return;
+        }
+    }
+    if (n_found_links >= allocated_found_links) {
+        allocated_found_links = allocated_found_links ? allocated_found_links * 2 : 64;
+        found_links = xrealloc(found_links, allocated_found_links * sizeof *found_links);
+    }
+    found_links[n_found_links][0] = lo;
+    found_links[n_found_links][1] = hi;
+    n_found_links++;
+}
+
+/* Takes the reply in 'buf', which reached the controller's switch, as a
+ * packet-in, and marks the devices it lists as discovered and the links
+ * between them as found. */
+static void
+controller_receive(const struct ofpbuf *buf) {
+    const struct ehddp_header *ehddp;
+    uint64_t prev = 0;
+    const uint8_t *p;
+    size_t len;
+    int i;
+
+    if (buf->size < sizeof(struct eth_header) + sizeof(struct ehddp_header)) {
+        return;
+    }
+    ehddp = (const struct ehddp_header *)((const uint8_t *)buf->data + sizeof(struct eth_header));
+    packet_ins++;
+
+    p = (const uint8_t *)(ehddp + 1);
+    len = buf->size - sizeof(struct eth_header) - sizeof(struct ehddp_header);
+    for (i = 0; i < ehddp->num_devices; i++) {
+        struct ehddp_element element;
+        size_t n = ehddp_get_element(p, len, &element);
+
+        if (n == 0) {
+            break;
+        }
+        if (element.id < 2 || element.id >= (uint64_t)n_nodes + 2) {
+            prev = 0;
+        } else {
+            /* A null input port starts a new path. */
+            if (prev != 0 && element.in_port != 0 && prev != element.id) {
+                found_link(prev, element.id);
+            }
+            prev = element.id;
+            if (!discovered[element.id - 2]) {
+                discovered[element.id - 2] = true;
+                if (++n_discovered == n_nodes) {
+                    converged_at = time_msec();
+                }
+            }
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+static bool
+is_ehddp_reply(const struct ofpbuf *buf) {
+    const struct eth_header *eth = buf->data;
+    const struct ehddp_header *ehddp;
+
+    if (buf->size < sizeof *eth + sizeof *ehddp
+        || (eth->eth_type != ETH_TYPE_EHDDP && eth->eth_type != ETH_TYPE_EHDDP_INV)) {
+        return false;
+    }
+    ehddp = (const struct ehddp_header *)(eth + 1);
+    return ehddp->opcode == 2;
+}
+
+static int
+sim_recv(void *aux, struct ofpbuf *buffer) {
+    struct sim_port *port = aux;
+
+    while (!list_is_empty(&port->rx)) {
+        struct sim_frame *f = CONTAINER_OF(list_front(&port->rx), struct sim_frame, node);
+        bool to_controller;
+
+        if (f->deliver_at > time_msec()) {
+            break;
+        }
+        list_remove(&f->node);
+
+        /* The controller has its switch send it every eHDDP reply. */
+        to_controller = port->owner == 0 && is_ehddp_reply(f->buf);
+        if (to_controller) {
+            controller_receive(f->buf);
+        } else {
+            ofpbuf_put(buffer, f->buf->data, f->buf->size);
+        }
+        ofpbuf_delete(f->buf);
+        free(f);
+        if (!to_controller) {
+            return 0;
+        }
+    }
+    return EAGAIN;
+}
+
+static void
+sim_recv_wait(void *aux UNUSED) {
+}
+
+static int
+sim_send(void *aux, const struct ofpbuf *buffer) {
+    struct sim_port *port = aux;
+    struct sim_frame *f;
+
+    if (port->peer < 0) {
+        return 0;
+    }
+    frames_sent++;
+    if (loss > 0 && (double)(sim_random() >> 11) / (1ULL << 53) < loss) {
+        frames_lost++;
+        return 0;
+    }
+
+    f = xmalloc(sizeof *f);
+    f->deliver_at = time_msec() + latency;
+    f->buf = ofpbuf_clone(buffer);
+    list_push_back(&ports[port->peer].rx, &f->node);
+    return 0;
+}
+
+static const struct netdev_class sim_netdev_class = {
+    "sim",
+    sim_open,
+    sim_close,
+    sim_recv,
+    sim_recv_wait,
+    sim_send,
+};
+
+/* Topologies. */
+
+static int
+add_port(int owner) {
+    if (n_ports >= allocated_ports) {
+        allocated_ports = allocated_ports ? allocated_ports * 2 : 64;
+        ports = xrealloc(ports, allocated_ports * sizeof *ports);
+    }
+    ports[n_ports].owner = owner;
+    ports[n_ports].peer = -1;
+    return n_ports++;
+}
+
+/* Links the switches 'a' and 'b', given as indexes in 'switches'. The two
+ * ends of a link take consecutive ports. */
+static void
+add_link(int a, int b) {
+    int pa = add_port(a);
+    int pb = add_port(b);
+
+    ports[pa].peer = pb;
+    ports[pb].peer = pa;
+    n_links++;
+}
+
+static bool
+linked(int a, int b) {
+    int i;
+
+    for (i = 0; i < n_ports; i += 2) {
+        if ((ports[i].owner == a && ports[i + 1].owner == b)
+            || (ports[i].owner == b && ports[i + 1].owner == a)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Builds the topology among nodes 1 to 'n_nodes' of 'switches', and links
+ * the controller's switch, node 0, to node 1. */
+static void
+build_topology(void) {
+    int i, j, k;
+
+    switch (topology) {
+    case TOPO_LINE:
+        for (i = 2; i <= n_nodes; i++) {
+            add_link(i - 1, i);
+        }
+        break;
+
+    case TOPO_RING:
+        for (i = 2; i <= n_nodes; i++) {
+            add_link(i - 1, i);
+        }
+        if (n_nodes > 2) {
+            add_link(n_nodes, 1);
+        }
+        break;
+
+    case TOPO_TREE:
+        for (i = 2; i <= n_nodes; i++) {
+            add_link((i - 2) / fanout + 1, i);
+        }
+        break;
+
+    case TOPO_FAT_TREE: {
+        /* k pods of k/2 edge and k/2 aggregation switches, below (k/2)^2 core
+         * switches: nodes are cores first, then each pod's aggregation and
+         * edge switches. */
+        int half, cores, pod;
+
+        for (k = 2; 5 * (k + 2) * (k + 2) / 4 <= n_nodes; k += 2) {
+        }
+        half = k / 2;
+        cores = half * half;
+        n_nodes = 5 * k * k / 4;
+        for (pod = 0; pod < k; pod++) {
+            int aggr = 1 + cores + pod * k;
+            int edge = aggr + half;
+
+            for (i = 0; i < half; i++) {
+                for (j = 0; j < half; j++) {
+                    add_link(1 + i * half + j, aggr + i);
+                    add_link(aggr + i, edge + j);
+                }
+            }
+        }
+        break;
+    }
+
+    case TOPO_RANDOM: {
+        int wanted = n_nodes * degree / 2;
+        int tries;
+
+        for (i = 2; i <= n_nodes; i++) {
+            add_link(1 + sim_random_range(i - 1), i);
+        }
+        for (tries = 0; n_links < wanted && tries < 100 * wanted; tries++) {
+            int a = 1 + sim_random_range(n_nodes);
+            int b = 1 + sim_random_range(n_nodes);
+
+            if (a != b && !linked(a, b)) {
+                add_link(a, b);
+            }
+        }
+        break;
+    }
+    }
+
+    add_link(0, 1);
+}
+
+/* Saving and restoring the eHDDP globals of each switch. */
+
+static void
+switch_enter(struct sim_switch *s) {
+    bt_table = s->bt_table;
+    learning_table = s->learning_table;
+    port_to_controller = s->port_to_controller;
+    time_start = s->time_start;
+    time_no_move_local_port = s->time_no_move_local_port;
+    old_local_port = s->old_local_port;
+    local_port_ok = s->local_port_ok;
+}
+
+static void
+switch_leave(struct sim_switch *s) {
+    s->bt_table = bt_table;
+    s->learning_table = learning_table;
+    s->port_to_controller = port_to_controller;
+    s->time_start = time_start;
+    s->time_no_move_local_port = time_no_move_local_port;
+    s->old_local_port = old_local_port;
+    s->local_port_ok = local_port_ok;
+}
+
+static long long
+thread_cpu_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void
+switch_run(struct sim_switch *s) {
+    long long start;
+
+    switch_enter(s);
+    start = thread_cpu_ns();
+    dp_run(s->dp);
+    s->cpu_ns += thread_cpu_ns() - start;
+    switch_leave(s);
+}
+
+/* Sends an eHDDP request through every port of the controller's switch, as
+ * the controller does with a packet-out. The request is built as the
+ * controller application builds it: the controller is device 1. */
+static void
+controller_explore(void) {
+    static const uint8_t ctrl_mac[ETH_ADDR_LEN] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+    struct sim_switch *s = &switches[0];
+    struct ofl_msg_packet_out *msg;
+    struct ofl_action_output *output;
+    struct remote remote;
+    struct sender sender;
+    struct ofpbuf *buf;
+    struct eth_header *eth;
+    struct ehddp_header *ehddp;
+    ofl_err error;
+
+    buf = ofpbuf_new(sizeof *eth + sizeof *ehddp + EHDDP_ELEMENT_MAX_LEN);
+    eth = ofpbuf_put_zeros(buf, sizeof *eth);
+    memset(eth->eth_dst, 0xff, ETH_ADDR_LEN);
+    memcpy(eth->eth_src, ctrl_mac, ETH_ADDR_LEN);
+    eth->eth_type = htons(ETH_TYPE_EHDDP);
+
+    ehddp = ofpbuf_put_zeros(buf, sizeof *ehddp);
+    ehddp->flags = 0x01;
+    ehddp->opcode = 1;
+    ehddp->num_devices = 1;
+    ehddp->num_sec = htonll(SIM_NUM_SEC);
+    ehddp->previous_size_mac = ETH_ADDR_LEN;
+    memcpy(ehddp->src_mac, ctrl_mac, ETH_ADDR_LEN);
+    ehddp->num_ack = htonll(sim_random());
+    ehddp->time_block = htonl(3000);
+    ehddp_put_element(buf, ehddp_element_conf(NODO_SDN, 1, 255, 255),
+                      NODO_SDN, 1, 255, 255);
+
+    output = xmalloc(sizeof *output);
+    output->header.type = OFPAT_OUTPUT;
+    output->header.len = sizeof(struct ofp_action_output);
+    output->port = OFPP_FLOOD;
+    output->max_len = 0;
+
+    msg = xmalloc(sizeof *msg);
+    msg->header.type = OFPT_PACKET_OUT;
+    msg->buffer_id = OFP_NO_BUFFER;
+    msg->in_port = OFPP_CONTROLLER;
+    msg->actions_num = 1;
+    msg->actions = xmalloc(sizeof *msg->actions);
+    msg->actions[0] = &output->header;
+    msg->data_length = buf->size;
+    msg->data = xmemdup(buf->data, buf->size);
+    ofpbuf_delete(buf);
+
+    memset(&remote, 0, sizeof remote);
+    remote.role = OFPCR_ROLE_EQUAL;
+    memset(&sender, 0, sizeof sender);
+    sender.remote = &remote;
+
+    switch_enter(s);
+    error = handle_control_msg(s->dp, &msg->header, &sender);
+    switch_leave(s);
+    if (error) {
+        ofp_fatal(0, "the controller's switch refused the request");
+    }
+}
+
+/* Returns true if some port of switch 'idx' has a frame to receive, or the
+ * window of one of its held replies is over. */
+static bool
+switch_is_ready(int idx) {
+    long long deadline = ehddp_coalesce_next_deadline(switches[idx].dp->ehddp_coalesce);
+    int i;
+
+    if (deadline >= 0 && deadline <= time_msec()) {
+        return true;
+    }
+    for (i = 0; i < n_ports; i++) {
+        if (ports[i].owner == idx && !list_is_empty(&ports[i].rx)) {
+            struct sim_frame *f = CONTAINER_OF(list_front(&ports[i].rx), struct sim_frame, node);
+            if (f->deliver_at <= time_msec()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Returns the time of the next delivery or end of a coalescing window, or -1
+ * if no frame is on its way or held. */
+static long long
+next_event(void) {
+    long long next = -1;
+    int i;
+
+    for (i = 0; i < n_ports; i++) {
+        if (!list_is_empty(&ports[i].rx)) {
+            struct sim_frame *f = CONTAINER_OF(list_front(&ports[i].rx), struct sim_frame, node);
+            if (next < 0 || f->deliver_at < next) {
+                next = f->deliver_at;
+            }
+        }
+    }
+    for (i = 0; i < n_switches; i++) {
+        long long deadline = ehddp_coalesce_next_deadline(switches[i].dp->ehddp_coalesce);
+        if (deadline >= 0 && (next < 0 || deadline < next)) {
+            next = deadline;
+        }
+    }
+    return next;
+}
+
+/* Creates the datapaths and attaches them their ports. 'ports' does not
+ * move any more once the ports are open. */
+static void
+create_switches(void) {
+    int n_linked = n_ports;
+    int i;
+
+    /* Each switch also gets an unlinked local port, as the daemon opens one
+     * by default. */
+    n_switches = n_nodes + 1;
+    for (i = 0; i < n_switches; i++) {
+        add_port(i);
+    }
+    for (i = 0; i < n_ports; i++) {
+        list_init(&ports[i].rx);
+    }
+
+    switches = xcalloc(n_switches, sizeof *switches);
+    for (i = 0; i < n_switches; i++) {
+        struct sim_switch *s = &switches[i];
+
+        s->dp = dp_new();
+        dp_set_dpid(s->dp, i + 1);
+        dp_set_max_queues(s->dp, 0);
+        dp_set_ehddp_coalesce(s->dp, coalesce);
+        s->dp->config.miss_send_len = OFPCML_NO_BUFFER;
+    }
+
+    for (i = 0; i < n_ports; i++) {
+        struct sim_switch *s = &switches[ports[i].owner];
+        char name[32];
+        int error;
+
+        snprintf(name, sizeof name, "sim:%d", i);
+        switch_enter(s);
+        error = i < n_linked ? dp_ports_add(s->dp, name) : dp_ports_add_local(s->dp, name);
+        switch_leave(s);
+        if (error) {
+            ofp_fatal(error, "failed to add port %s", name);
+        }
+    }
+}
+
+static void
+report(void) {
+    struct ehddp_coalesce_stats coalesce_stats;
+    long long cpu_total = 0, cpu_max = 0;
+    uint64_t requests = 0, replies = 0, reply_frames = 0, merged = 0;
+    int i;
+
+    for (i = 1; i < n_switches; i++) {
+        cpu_total += switches[i].cpu_ns;
+        if (switches[i].cpu_ns > cpu_max) {
+            cpu_max = switches[i].cpu_ns;
+        }
+        requests += ehddp_stats_total(switches[i].dp->ehddp_stats, OFP_EXT_DISCOVERY_REQUEST_IN);
+        replies += ehddp_stats_total(switches[i].dp->ehddp_stats, OFP_EXT_DISCOVERY_REPLY_CREATE)
+                   + ehddp_stats_total(switches[i].dp->ehddp_stats, OFP_EXT_DISCOVERY_REPLY_FORWARD)
+                   + ehddp_stats_total(switches[i].dp->ehddp_stats, OFP_EXT_DISCOVERY_REPLY_CONTINUE);
+        ehddp_coalesce_get_stats(switches[i].dp->ehddp_coalesce, &coalesce_stats);
+        reply_frames += coalesce_stats.frames;
+        merged += coalesce_stats.merged;
+    }
+
+    printf("topology:      %s\n", topology_names[topology]);
+    printf("nodes:         %d\n", n_nodes);
+    printf("links:         %d\n", n_links - 1);
+    printf("converged:     %s\n", converged_at >= 0 ? "yes" : "no");
+    if (converged_at >= 0) {
+        printf("convergence:   %lld ms\n", converged_at);
+    }
+    printf("discovered:    %d\n", n_discovered);
+    printf("links found:   %d\n", n_found_links);
+    printf("frames sent:   %"PRIu64"\n", frames_sent);
+    printf("frames lost:   %"PRIu64"\n", frames_lost);
+    printf("requests:      %"PRIu64"\n", requests);
+    printf("replies:       %"PRIu64"\n", replies);
+    printf("reply frames:  %"PRIu64"\n", reply_frames);
+    printf("merged:        %"PRIu64"\n", merged);
+    printf("packet-ins:    %"PRIu64"\n", packet_ins);
+    printf("cpu total:     %lld us\n", cpu_total / 1000);
+    printf("cpu per node:  %lld us avg, %lld us max\n",
+           cpu_total / 1000 / n_nodes, cpu_max / 1000);
+}
+
+int
+main(int argc, char *argv[]) {
+    int i;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+    vlog_set_levels(VLM_ANY_MODULE, VLF_ANY_FACILITY, VLL_EMER);
+    parse_options(argc, argv);
+
+    /* The virtual clock starts at 0: the exploration begins at time 0. */
+    time_set_virtual(0);
+    netdev_register_class(&sim_netdev_class);
+
+    /* Not an SDN switch: no in-band connection through the discovered
+     * ports. */
+    type_device_general = 2;
+
+    build_topology();
+    discovered = xcalloc(n_nodes, sizeof *discovered);
+    create_switches();
+
+    controller_explore();
+    for (;;) {
+        long long next;
+        bool progress;
+
+        do {
+            progress = false;
+            for (i = 0; i < n_switches; i++) {
+                if (switch_is_ready(i)) {
+                    switch_run(&switches[i]);
+                    progress = true;
+                }
+            }
+        } while (progress);
+
+        next = next_event();
+        if (next < 0 || next > timeout) {
+            break;
+        }
+        time_set_virtual(next);
+    }
+
+    report();
+    for (i = 0; i < n_switches; i++) {
+        dp_destroy(switches[i].dp);
+    }
+    return converged_at >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void
+parse_options(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"topology",  required_argument, 0, 't'},
+        {"nodes",     required_argument, 0, 'n'},
+        {"fanout",    required_argument, 0, 'f'},
+        {"degree",    required_argument, 0, 'd'},
+        {"latency",   required_argument, 0, 'l'},
+        {"loss",      required_argument, 0, 'p'},
+        {"seed",      required_argument, 0, 's'},
+        {"timeout",   required_argument, 0, 'T'},
+        {"coalesce",  required_argument, 0, 'c'},
+        {"help",      no_argument, 0, 'h'},
+        {"version",   no_argument, 0, 'V'},
+        {0, 0, 0, 0},
+    };
+    char *short_options = long_options_to_short_options(long_options);
+
+    for (;;) {
+        int c = getopt_long(argc, argv, short_options, long_options, NULL);
+        size_t i;
+
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 't':
+            for (i = 0; i < ARRAY_SIZE(topology_names); i++) {
+                if (!strcmp(optarg, topology_names[i])) {
+                    topology = i;
+                    break;
+                }
+            }
+            if (i == ARRAY_SIZE(topology_names)) {
+                ofp_fatal(0, "unknown topology \"%s\"", optarg);
+            }
+            break;
+
+        case 'n':
+            n_nodes = atoi(optarg);
+            if (n_nodes < 1 || n_nodes > SIM_MAX_NODES) {
+                ofp_fatal(0, "--nodes must be between 1 and %d", SIM_MAX_NODES);
+            }
+            break;
+
+        case 'f':
+            fanout = atoi(optarg);
+            if (fanout < 1) {
+                ofp_fatal(0, "--fanout must be positive");
+            }
+            break;
+
+        case 'd':
+            degree = atoi(optarg);
+            if (degree < 2) {
+                ofp_fatal(0, "--degree must be at least 2");
+            }
+            break;
+
+        case 'l':
+            latency = atoll(optarg);
+            if (latency < 0) {
+                ofp_fatal(0, "--latency must not be negative");
+            }
+            break;
+
+        case 'p':
+            loss = atof(optarg) / 100;
+            if (loss < 0 || loss >= 1) {
+                ofp_fatal(0, "--loss must be a percentage below 100");
+            }
+            break;
+
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            if (seed == 0) {
+                ofp_fatal(0, "--seed must be nonzero");
+            }
+            break;
+
+        case 'T':
+            timeout = atoll(optarg);
+            break;
+
+        case 'c': {
+            char *end;
+            unsigned long msec;
+
+            errno = 0;
+            msec = strtoul(optarg, &end, 10);
+            if (errno || end == optarg || *end != '\0' || msec > UINT_MAX) {
+                ofp_fatal(0, "--coalesce must be a number of milliseconds");
+            }
+            coalesce = msec;
+            break;
+        }
+
+        case 'h':
+            usage();
+
+        case 'V':
+            printf("%s %s compiled "__DATE__" "__TIME__"\n",
+                   program_name, VERSION BUILDNR);
+            exit(EXIT_SUCCESS);
+
+        case '?':
+            exit(EXIT_FAILURE);
+
+        default:
+            abort();
+        }
+    }
+    free(short_options);
+
+    if (topology == TOPO_FAT_TREE && n_nodes < 5) {
+        ofp_fatal(0, "a fat-tree needs at least 5 nodes");
+    }
+}
+
+static void
+usage(void) {
+    printf("%s: in-process eHDDP discovery simulator\n"
+           "usage: %s [OPTIONS]\n"
+           "Runs one eHDDP exploration over a generated topology and reports\n"
+           "its convergence time and message counts.\n"
+           "\nOptions:\n"
+           "  -t, --topology=TOPO     line, ring, tree, fat-tree or random\n"
+           "                          (default: line)\n"
+           "  -n, --nodes=N           number of switches, up to %d (default: 10);\n"
+           "                          a fat-tree takes the largest that fits\n"
+           "  -f, --fanout=N          children per switch of a tree (default: 2)\n"
+           "  -d, --degree=N          average degree of a random topology (default: 3)\n"
+           "  -l, --latency=MSEC      latency of every link (default: 1)\n"
+           "  -p, --loss=PERCENT      probability of losing a frame (default: 0)\n"
+           "  -s, --seed=N            seed of the topology and the losses (default: 1)\n"
+           "  -T, --timeout=MSEC      virtual time the run may take (default: 60000)\n"
+           "  -c, --coalesce=MSEC     hold eHDDP replies MSEC ms to merge them\n"
+           "                          (default: 0, disabled)\n"
+           "  -h, --help              display this help message\n"
+           "  -V, --version           display version information\n",
+           program_name, program_name, SIM_MAX_NODES);
+    exit(EXIT_SUCCESS);
+}
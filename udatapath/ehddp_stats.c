@@ -0,0 +1,144 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "datapath.h"
+#include "dp_ports.h"
+#include "ehddp_coalesce.h"
+#include "ehddp_seen.h"
+#include "ehddp_stats.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow-ext.h"
+#include "timeval.h"
+#include "util.h"
+
+/* Port 0 is not a valid port number; its entry takes the counts of the
+ * ports out of range, such as OFPP_LOCAL. */
+#define OTHER_PORT 0
+
+struct ehddp_stats {
+    uint64_t counters[DP_MAX_PORTS + 1][OFP_EXT_DISCOVERY_N_COUNTERS];
+    uint64_t exploration;
+    uint64_t first_request;
+    uint64_t convergence;
+    uint64_t controller_connect;
+    uint64_t local_port_ready;
+};
+
+struct ehddp_stats *
+ehddp_stats_create(void) {
+    return xcalloc(1, sizeof(struct ehddp_stats));
+}
+
+void
+ehddp_stats_destroy(struct ehddp_stats *stats) {
+    free(stats);
+}
+
+void
+ehddp_stats_count(struct ehddp_stats *stats, uint32_t port_no,
+                  enum openflow_ext_discovery_counters counter) {
+    if (port_no > DP_MAX_PORTS) {
+        port_no = OTHER_PORT;
+    }
+    stats->counters[port_no][counter]++;
+}
+
+uint64_t
+ehddp_stats_total(const struct ehddp_stats *stats,
+                  enum openflow_ext_discovery_counters counter) {
+    uint64_t total = 0;
+    size_t i;
+
+    for (i = 0; i <= DP_MAX_PORTS; i++) {
+        total += stats->counters[i][counter];
+    }
+    return total;
+}
+
+void
+ehddp_stats_exploration(struct ehddp_stats *stats, uint64_t exploration) {
+    long long now = current_timestamp();
+
+    stats->exploration = exploration;
+    stats->first_request = now;
+    /* 0 when the clocks are too close to measure it. */
+    stats->convergence = now > (long long)exploration ? now - exploration : 0;
+}
+
+void
+ehddp_stats_controller_connect(struct ehddp_stats *stats, uint64_t timestamp) {
+    stats->controller_connect = timestamp;
+}
+
+void
+ehddp_stats_local_port_ready(struct ehddp_stats *stats) {
+    stats->local_port_ready = current_timestamp();
+}
+
+ofl_err
+ehddp_stats_handle_stats_request(struct datapath *dp,
+                                 struct ofl_exp_openflow_mp_request_header *msg,
+                                 const struct sender *sender) {
+    struct ehddp_stats *stats = dp->ehddp_stats;
+    struct ofl_exp_openflow_mp_reply_discovery reply;
+    struct ehddp_seen_stats seen;
+    struct ehddp_coalesce_stats coalesce;
+    size_t i, j;
+
+    ehddp_seen_get_stats(dp->ehddp_seen, &seen);
+    ehddp_coalesce_get_stats(dp->ehddp_coalesce, &coalesce);
+
+    memset(&reply, 0, sizeof reply);
+    reply.header.header.header.header.type = OFPT_MULTIPART_REPLY;
+    reply.header.header.header.type = OFPMP_EXPERIMENTER;
+    reply.header.header.experimenter_id = OPENFLOW_VENDOR_ID;
+    reply.header.type = OFP_EXT_STATS_DISCOVERY;
+    reply.exploration = stats->exploration;
+    reply.first_request = stats->first_request;
+    reply.convergence = stats->convergence;
+    reply.controller_connect = stats->controller_connect;
+    reply.local_port_ready = stats->local_port_ready;
+    reply.replies_merged = coalesce.merged;
+    reply.seen_evictions = seen.evictions;
+
+    /* Only the ports with any counter set are sent. */
+    reply.ports = xmalloc((DP_MAX_PORTS + 1) * sizeof *reply.ports);
+    for (i = 0; i <= DP_MAX_PORTS; i++) {
+        for (j = 0; j < OFP_EXT_DISCOVERY_N_COUNTERS; j++) {
+            if (stats->counters[i][j] != 0) {
+                break;
+            }
+        }
+        if (j == OFP_EXT_DISCOVERY_N_COUNTERS) {
+            continue;
+        }
+        reply.ports[reply.ports_num].port_no = i == OTHER_PORT ? OFPP_ANY : i;
+        memcpy(reply.ports[reply.ports_num].counters, stats->counters[i],
+               sizeof stats->counters[i]);
+        reply.ports_num++;
+    }
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    free(reply.ports);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EHDDP_STATS_H
+#define EHDDP_STATS_H 1
+
+#include <stdint.h>
+
+#include "oflib/ofl.h"
+#include "openflow/openflow-ext.h"
+
+/****************************************************************************
+ * Counters and timing of the eHDDP discovery and of the ARP path, read by
+ * the controller or dpctl through an experimenter multipart.
+ ****************************************************************************/
+
+struct datapath;
+struct sender;
+struct ofl_exp_openflow_mp_request_header;
+
+/* Creates a counter set with everything at 0. */
+struct ehddp_stats *
+ehddp_stats_create(void);
+
+/* Destroys the counters. */
+void
+ehddp_stats_destroy(struct ehddp_stats *stats);
+
+/* Adds one to 'counter' of 'port_no'. Ports out of the range of the datapath
+ * share a single entry, reported as OFPP_ANY. */
+void
+ehddp_stats_count(struct ehddp_stats *stats, uint32_t port_no,
+                  enum openflow_ext_discovery_counters counter);
+
+/* Returns the sum of 'counter' over all the ports. */
+uint64_t
+ehddp_stats_total(const struct ehddp_stats *stats,
+                  enum openflow_ext_discovery_counters counter);
+
+/* Records that the first request of the exploration started by the
+ * controller at 'exploration' has been seen now. */
+void
+ehddp_stats_exploration(struct ehddp_stats *stats, uint64_t exploration);
+
+/* Records the time at which the controller reported the connection. */
+void
+ehddp_stats_controller_connect(struct ehddp_stats *stats, uint64_t timestamp);
+
+/* Records that the in-band local port is now up. */
+void
+ehddp_stats_local_port_ready(struct ehddp_stats *stats);
+
+/* Handles a discovery experimenter multipart request. */
+ofl_err
+ehddp_stats_handle_stats_request(struct datapath *dp,
+                                 struct ofl_exp_openflow_mp_request_header *msg,
+                                 const struct sender *sender);
+
+#endif /* EHDDP_STATS_H */
@@ -0,0 +1,8 @@
+#! /bin/sh
+
+# Checks that the list, linear, tree and prefix classifiers of the flow table
+# find the same entries as packet_match() for random flows and packets.  Half
+# of the rounds hold routes only, which the prefix index must take, and delete
+# and add routes between lookups.
+
+exec ${PIPELINE_BENCH:-./udatapath/pipeline-bench} --check=200
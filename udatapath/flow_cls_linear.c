@@ -0,0 +1,411 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "flow_cls_linear.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "list.h"
+#include "match_std.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "util.h"
+#include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
+#include "openflow/openflow.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LINEAR_X86 1
+#include <immintrin.h>
+#else
+#define LINEAR_X86 0
+#endif
+
+/* A compiled key is a word of presence bits, one per field the table matches
+ * on, followed by the values of those fields packed back to back. A rule
+ * matches a key if (key & mask) == value in every word. */
+#define LINEAR_KEY_WORDS  8
+#define LINEAR_KEY_BYTES  ((LINEAR_KEY_WORDS - 1) * sizeof(uint64_t))
+#define LINEAR_MAX_FIELDS 64
+
+/* Rules are compared in groups of this many, the width of the widest
+ * vectors; the arrays are padded with rules that never match. */
+#define LINEAR_LANES 4
+
+/* Below this many entries, building the key of the packet costs about as
+ * much as walking the list. */
+#define LINEAR_MIN_ENTRIES 4
+
+/* The scan compares every word of every rule ahead of the one that matches,
+ * so tables with many entries or matching on many fields are left to the
+ * list walk past this many words. */
+#define LINEAR_MAX_WORDS 8192
+
+struct linear_field {
+    uint32_t header;   /* OXM header of the packet field */
+    uint8_t  offset;   /* in the packed bytes after the presence word */
+    uint8_t  len;
+};
+
+typedef size_t linear_scan_func(const struct flow_cls_linear *, const uint64_t *key,
+                                size_t start);
+
+struct flow_cls_linear {
+    struct flow_table *table;
+    bool               dirty;      /* entries changed since the last compile */
+    bool               usable;     /* worth scanning unless forced */
+
+    struct linear_field fields[LINEAR_MAX_FIELDS];
+    size_t             n_fields;
+    size_t             key_bytes;  /* packed bytes in use */
+    size_t             n_words;    /* key words in use, presence word included */
+
+    size_t             n;          /* rules, in priority order */
+    size_t             cap;        /* allocated rules, a multiple of LINEAR_LANES */
+    struct flow_entry **entries;
+    uint8_t           *verify;     /* true if the rule is a prefilter only, and
+                                      the entry must be matched in full */
+    uint64_t          *values;     /* word w of rule i is at [w * cap + i] */
+    uint64_t          *masks;
+};
+
+static linear_scan_func *linear_scan;
+static const char *linear_isa;
+
+static size_t
+scan_scalar(const struct flow_cls_linear *lin, const uint64_t *key, size_t start) {
+    size_t i, w;
+
+    for (i = start; i < lin->n; i++) {
+        for (w = 0; w < lin->n_words; w++) {
+            size_t at = w * lin->cap + i;
+
+            if ((key[w] & lin->masks[at]) != lin->values[at]) {
+                break;
+            }
+        }
+        if (w == lin->n_words) {
+            return i;
+        }
+    }
+    return lin->n;
+}
+
+#if LINEAR_X86
+__attribute__((target("sse4.1")))
+static size_t
+scan_sse41(const struct flow_cls_linear *lin, const uint64_t *key, size_t start) {
+    __m128i keys[LINEAR_KEY_WORDS];
+    size_t i, w;
+
+    for (w = 0; w < lin->n_words; w++) {
+        keys[w] = _mm_set1_epi64x(key[w]);
+    }
+    for (i = start & ~(size_t)1; i < lin->n; i += 2) {
+        __m128i acc = _mm_set1_epi64x(-1);
+        int bits;
+
+        for (w = 0; w < lin->n_words; w++) {
+            size_t at = w * lin->cap + i;
+            __m128i m = _mm_loadu_si128((const __m128i *)&lin->masks[at]);
+            __m128i v = _mm_loadu_si128((const __m128i *)&lin->values[at]);
+
+            acc = _mm_and_si128(acc, _mm_cmpeq_epi64(_mm_and_si128(keys[w], m), v));
+        }
+        bits = _mm_movemask_pd(_mm_castsi128_pd(acc));
+        if (i < start) {
+            bits &= ~0u << (start - i);
+        }
+        if (bits) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+    return lin->n;
+}
+
+__attribute__((target("avx2")))
+static size_t
+scan_avx2(const struct flow_cls_linear *lin, const uint64_t *key, size_t start) {
+    __m256i keys[LINEAR_KEY_WORDS];
+    size_t i, w;
+
+    for (w = 0; w < lin->n_words; w++) {
+        keys[w] = _mm256_set1_epi64x(key[w]);
+    }
+    for (i = start & ~(size_t)(LINEAR_LANES - 1); i < lin->n; i += LINEAR_LANES) {
+        __m256i acc = _mm256_set1_epi64x(-1);
+        int bits;
+
+        for (w = 0; w < lin->n_words; w++) {
+            size_t at = w * lin->cap + i;
+            __m256i m = _mm256_loadu_si256((const __m256i *)&lin->masks[at]);
+            __m256i v = _mm256_loadu_si256((const __m256i *)&lin->values[at]);
+
+            acc = _mm256_and_si256(acc, _mm256_cmpeq_epi64(_mm256_and_si256(keys[w], m), v));
+        }
+        bits = _mm256_movemask_pd(_mm256_castsi256_pd(acc));
+        if (i < start) {
+            bits &= ~0u << (start - i);
+        }
+        if (bits) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+    return lin->n;
+}
+#endif
+
+static void
+select_scan(void) {
+    if (linear_scan != NULL) {
+        return;
+    }
+#if LINEAR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        linear_scan = scan_avx2;
+        linear_isa = "avx2";
+        return;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        linear_scan = scan_sse41;
+        linear_isa = "sse4.1";
+        return;
+    }
+#endif
+    linear_scan = scan_scalar;
+    linear_isa = "scalar";
+}
+
+const char *
+flow_cls_linear_isa(void) {
+    select_scan();
+    return linear_isa;
+}
+
+struct flow_cls_linear *
+flow_cls_linear_create(struct flow_table *table) {
+    struct flow_cls_linear *lin = xcalloc(1, sizeof(struct flow_cls_linear));
+
+    select_scan();
+    lin->table = table;
+    lin->dirty = true;
+    return lin;
+}
+
+static void
+free_rules(struct flow_cls_linear *lin) {
+    free(lin->entries);
+    free(lin->verify);
+    free(lin->values);
+    free(lin->masks);
+    lin->entries = NULL;
+    lin->verify = NULL;
+    lin->values = NULL;
+    lin->masks = NULL;
+    lin->n = lin->cap = 0;
+}
+
+void
+flow_cls_linear_destroy(struct flow_cls_linear *lin) {
+    free_rules(lin);
+    free(lin);
+}
+
+void
+flow_cls_linear_invalidate(struct flow_cls_linear *lin) {
+    lin->dirty = true;
+}
+
+/* Returns the index of the field with the given header, adding it to the
+ * key if there is room, or -1. */
+static int
+find_field(struct flow_cls_linear *lin, uint32_t header, size_t len) {
+    size_t i;
+
+    for (i = 0; i < lin->n_fields; i++) {
+        if (lin->fields[i].header == header) {
+            return i;
+        }
+    }
+    if (lin->n_fields == LINEAR_MAX_FIELDS || lin->key_bytes + len > LINEAR_KEY_BYTES) {
+        return -1;
+    }
+    lin->fields[i].header = header;
+    lin->fields[i].offset = lin->key_bytes;
+    lin->fields[i].len = len;
+    lin->key_bytes += len;
+    lin->n_fields++;
+    return i;
+}
+
+/* Packs the match of 'entry' as rule 'i'. The VLAN ID and IPv6 extension
+ * header fields do not match bit for bit, and some eHDDP fields are too wide
+ * to pack; entries using them, or fields past the width of the key, are
+ * packed without them and marked for a full match. */
+static void
+compile_entry(struct flow_cls_linear *lin, size_t i, struct flow_entry *entry) {
+    struct ofl_match_header *m = entry->match == NULL ? entry->stats->match : entry->match;
+    uint64_t value[LINEAR_KEY_WORDS], mask[LINEAR_KEY_WORDS];
+    uint8_t *vbytes = (uint8_t *)&value[1];
+    uint8_t *mbytes = (uint8_t *)&mask[1];
+    struct ofl_match_tlv *f;
+    size_t w;
+
+    memset(value, 0, sizeof value);
+    memset(mask, 0, sizeof mask);
+    lin->entries[i] = entry;
+    lin->verify[i] = false;
+
+    if (m->type != OFPMT_OXM) {
+        lin->verify[i] = true;
+        goto store;
+    }
+
+    HMAP_FOR_EACH (f, struct ofl_match_tlv, hmap_node, &((struct ofl_match *)m)->match_fields) {
+        bool has_mask = OXM_HASMASK(f->header);
+        size_t len = OXM_LENGTH(f->header);
+        uint32_t header = f->header;
+        size_t b;
+        int field;
+
+        if (has_mask) {
+            len /= 2;
+            header = (header & 0xfffffe00) | len;
+        }
+        if (header == OXM_OF_VLAN_VID || header == OXM_OF_IPV6_EXTHDR || len > 16) {
+            lin->verify[i] = true;
+            continue;
+        }
+        field = find_field(lin, header, len);
+        if (field < 0) {
+            lin->verify[i] = true;
+            continue;
+        }
+
+        value[0] |= 1ULL << field;
+        mask[0] |= 1ULL << field;
+        for (b = 0; b < len; b++) {
+            uint8_t bm = has_mask ? f->value[len + b] : 0xff;
+
+            vbytes[lin->fields[field].offset + b] = f->value[b] & bm;
+            mbytes[lin->fields[field].offset + b] = bm;
+        }
+    }
+
+store:
+    for (w = 0; w < LINEAR_KEY_WORDS; w++) {
+        lin->values[w * lin->cap + i] = value[w];
+        lin->masks[w * lin->cap + i] = mask[w];
+    }
+}
+
+static void
+compile(struct flow_cls_linear *lin) {
+    struct flow_entry *entry;
+    size_t n = lin->table->stats->active_count;
+    size_t i, w, n_verify;
+
+    free_rules(lin);
+    lin->n_fields = 0;
+    lin->key_bytes = 0;
+    lin->cap = ROUND_UP(MAX(n, 1), LINEAR_LANES);
+    lin->entries = xmalloc(lin->cap * sizeof *lin->entries);
+    lin->verify = xmalloc(lin->cap);
+    lin->values = xmalloc(LINEAR_KEY_WORDS * lin->cap * sizeof *lin->values);
+    lin->masks = xmalloc(LINEAR_KEY_WORDS * lin->cap * sizeof *lin->masks);
+
+    i = 0;
+    n_verify = 0;
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &lin->table->match_entries) {
+        compile_entry(lin, i, entry);
+        n_verify += lin->verify[i];
+        i++;
+    }
+    lin->n = i;
+
+    /* The padding never matches: no key has all bits of a zero mask set. */
+    for (; i < lin->cap; i++) {
+        for (w = 0; w < LINEAR_KEY_WORDS; w++) {
+            lin->values[w * lin->cap + i] = UINT64_MAX;
+            lin->masks[w * lin->cap + i] = 0;
+        }
+    }
+
+    lin->n_words = 1 + ROUND_UP(lin->key_bytes, sizeof(uint64_t)) / sizeof(uint64_t);
+    lin->usable = (lin->n >= LINEAR_MIN_ENTRIES
+                   && lin->n * lin->n_words <= LINEAR_MAX_WORDS
+                   && n_verify * 4 <= lin->n);
+    lin->dirty = false;
+}
+
+bool
+flow_cls_linear_ready(struct flow_cls_linear *lin, bool force) {
+    if (lin->dirty) {
+        size_t n = lin->table->stats->active_count;
+
+        /* Spare the compile of tables that would not use it anyway. */
+        if (!force && (n < LINEAR_MIN_ENTRIES || n > LINEAR_MAX_WORDS / 2)) {
+            return false;
+        }
+        compile(lin);
+    }
+    return force || lin->usable;
+}
+
+struct flow_entry *
+flow_cls_linear_lookup(struct flow_cls_linear *lin, struct packet *pkt) {
+    struct packet_handle_std *handle = pkt->handle_std;
+    uint64_t key[LINEAR_KEY_WORDS];
+    uint8_t *kbytes = (uint8_t *)&key[1];
+    size_t i;
+
+    if (!handle->valid) {
+        packet_handle_std_validate(handle);
+        if (!handle->valid) {
+            return NULL;
+        }
+    }
+
+    memset(key, 0, sizeof key);
+    for (i = 0; i < lin->n_fields; i++) {
+        const struct linear_field *field = &lin->fields[i];
+        struct ofl_match_tlv *f = oxm_match_lookup(field->header, &handle->match);
+
+        if (f != NULL) {
+            key[0] |= 1ULL << i;
+            memcpy(&kbytes[field->offset], f->value, field->len);
+        }
+    }
+
+    for (i = linear_scan(lin, key, 0); i < lin->n; i = linear_scan(lin, key, i + 1)) {
+        struct flow_entry *entry = lin->entries[i];
+        struct ofl_match_header *m;
+
+        if (!lin->verify[i]) {
+            return entry;
+        }
+        m = entry->match == NULL ? entry->stats->match : entry->match;
+        if (m->type == OFPMT_OXM && packet_match((struct ofl_match *)m, &handle->match)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOW_CLS_LINEAR_H
+#define FLOW_CLS_LINEAR_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/****************************************************************************
+ * Linear classifier for flow tables of a few dozen to a few hundred entries.
+ * The entries of a table are compiled into packed (value, mask) key words,
+ * in priority order, and a packet is compared against several of them at
+ * once with vector instructions where the CPU has them.
+ ****************************************************************************/
+
+struct flow_entry;
+struct flow_table;
+struct packet;
+
+/* Creates an empty classifier for the entries of 'table'. */
+struct flow_cls_linear *
+flow_cls_linear_create(struct flow_table *table);
+
+/* Destroys the classifier. The entries are not touched. */
+void
+flow_cls_linear_destroy(struct flow_cls_linear *lin);
+
+/* Tells the classifier that entries were added to or removed from the table.
+ * The entries are compiled again before the next lookup. */
+void
+flow_cls_linear_invalidate(struct flow_cls_linear *lin);
+
+/* Compiles the entries of the table if they changed, and returns true if
+ * the classifier should serve the lookups of the table. Unless 'force' is
+ * set, that is only the case for tables of a size and key width where a
+ * scan beats walking the entry list. */
+bool
+flow_cls_linear_ready(struct flow_cls_linear *lin, bool force);
+
+/* Returns the entry of highest priority matching the packet, or NULL. The
+ * classifier must be ready. Statistics are left to the caller. */
+struct flow_entry *
+flow_cls_linear_lookup(struct flow_cls_linear *lin, struct packet *pkt);
+
+/* Returns the name of the instructions the classifier compares rules with:
+ * "avx2", "sse4.1" or "scalar". */
+const char *
+flow_cls_linear_isa(void);
+
+#endif /* FLOW_CLS_LINEAR_H */
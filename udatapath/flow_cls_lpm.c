@@ -0,0 +1,572 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "flow_cls_lpm.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "hash.h"
+#include "hmap.h"
+#include "list.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "packets.h"
+#include "util.h"
+#include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
+#include "openflow/openflow.h"
+
+/* The root of a trie covers the first 16 bits of the address, every level
+ * below it 8 more. A slot keeps the longest prefix ending at its level that
+ * covers it; a lookup goes down as far as the address leads, and returns the
+ * last prefix it came across. */
+#define LPM_ROOT_SLOTS (1 << 16)
+#define LPM_NODE_SLOTS (1 << 8)
+
+#define LPM_MAX_ADDR 16
+
+enum {
+    LPM_IPV4,
+    LPM_IPV6,
+    LPM_N_FAMILIES
+};
+
+struct lpm_prefix {
+    struct hmap_node   node;     /* in flow_cls_lpm.prefixes */
+    struct flow_entry *entry;
+    uint8_t            family;
+    uint8_t            len;      /* in bits */
+    uint8_t            addr[LPM_MAX_ADDR]; /* masked to 'len' */
+};
+
+struct lpm_node;
+
+struct lpm_slot {
+    struct lpm_prefix *best;
+    struct lpm_node   *child;
+};
+
+struct lpm_node {
+    struct lpm_slot slots[LPM_NODE_SLOTS];
+};
+
+struct lpm_family {
+    uint16_t           eth_type;
+    uint32_t           dst_header;    /* OXM header of the exact field */
+    uint32_t           dst_header_w;  /* OXM header of the masked field */
+    size_t             addr_len;      /* in bytes */
+
+    struct lpm_slot   *root;          /* NULL until the first prefix */
+    struct lpm_prefix *dflt;          /* the /0 prefix, if any */
+    size_t             n_prefixes;
+    uint32_t           count[LPM_MAX_ADDR * 8 + 1];    /* prefixes by length */
+    uint16_t           priority[LPM_MAX_ADDR * 8 + 1]; /* their priority */
+};
+
+struct flow_cls_lpm {
+    struct flow_table *table;
+    bool               broken;   /* an entry does not fit; not used */
+    bool               dirty;    /* the table changed since it broke */
+    struct hmap        prefixes;
+    struct flow_entry *miss;     /* the entry with an empty match, if any */
+    struct lpm_family  families[LPM_N_FAMILIES];
+};
+
+struct flow_cls_lpm *
+flow_cls_lpm_create(struct flow_table *table) {
+    struct flow_cls_lpm *lpm = xcalloc(1, sizeof(struct flow_cls_lpm));
+    struct lpm_family *fam;
+
+    lpm->table = table;
+    hmap_init(&lpm->prefixes);
+
+    fam = &lpm->families[LPM_IPV4];
+    fam->eth_type = ETH_TYPE_IP;
+    fam->dst_header = OXM_OF_IPV4_DST;
+    fam->dst_header_w = OXM_OF_IPV4_DST_W;
+    fam->addr_len = 4;
+
+    fam = &lpm->families[LPM_IPV6];
+    fam->eth_type = ETH_TYPE_IPV6;
+    fam->dst_header = OXM_OF_IPV6_DST;
+    fam->dst_header_w = OXM_OF_IPV6_DST_W;
+    fam->addr_len = 16;
+    return lpm;
+}
+
+static void
+free_node(struct lpm_slot *slots, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if (slots[i].child != NULL) {
+            free_node(slots[i].child->slots, LPM_NODE_SLOTS);
+            free(slots[i].child);
+        }
+    }
+}
+
+/* Empties the index. */
+static void
+clear(struct flow_cls_lpm *lpm) {
+    struct lpm_prefix *p, *next;
+    size_t i;
+
+    HMAP_FOR_EACH_SAFE (p, next, struct lpm_prefix, node, &lpm->prefixes) {
+        hmap_remove(&lpm->prefixes, &p->node);
+        free(p);
+    }
+    for (i = 0; i < LPM_N_FAMILIES; i++) {
+        struct lpm_family *fam = &lpm->families[i];
+
+        if (fam->root != NULL) {
+            free_node(fam->root, LPM_ROOT_SLOTS);
+            free(fam->root);
+            fam->root = NULL;
+        }
+        fam->dflt = NULL;
+        fam->n_prefixes = 0;
+        memset(fam->count, 0, sizeof fam->count);
+    }
+    lpm->miss = NULL;
+}
+
+void
+flow_cls_lpm_destroy(struct flow_cls_lpm *lpm) {
+    clear(lpm);
+    hmap_destroy(&lpm->prefixes);
+    free(lpm);
+}
+
+/* Returns the length of the prefix 'mask' is the mask of, or -1 if it is
+ * not a prefix mask. */
+static int
+prefix_len(const uint8_t *mask, size_t n) {
+    size_t i = 0;
+    int len = 0;
+
+    while (i < n && mask[i] == 0xff) {
+        len += 8;
+        i++;
+    }
+    if (i < n) {
+        uint8_t inv = ~mask[i];
+
+        if ((inv & (inv + 1)) != 0) {
+            return -1;
+        }
+        len += 8 - __builtin_popcount(inv);
+        for (i++; i < n; i++) {
+            if (mask[i] != 0) {
+                return -1;
+            }
+        }
+    }
+    return len;
+}
+
+/* Reads the shape of the match of 'entry' into 'p'. Sets '*miss' if the match
+ * is empty. Returns false if the index cannot hold the entry. */
+static bool
+parse_entry(const struct flow_cls_lpm *lpm, struct flow_entry *entry,
+            struct lpm_prefix *p, bool *miss) {
+    struct ofl_match_header *m = entry->match == NULL ? entry->stats->match : entry->match;
+    const struct lpm_family *fam = NULL;
+    struct ofl_match_tlv *f;
+    bool has_eth_type = false;
+    uint16_t eth_type = 0;
+    size_t i, b;
+
+    memset(p, 0, sizeof *p);
+    p->entry = entry;
+    *miss = false;
+    if (m->type != OFPMT_OXM) {
+        return false;
+    }
+
+    HMAP_FOR_EACH (f, struct ofl_match_tlv, hmap_node, &((struct ofl_match *)m)->match_fields) {
+        if (f->header == OXM_OF_ETH_TYPE) {
+            has_eth_type = true;
+            memcpy(&eth_type, f->value, sizeof eth_type);
+            continue;
+        }
+        if (fam != NULL) {
+            return false;
+        }
+        for (i = 0; i < LPM_N_FAMILIES; i++) {
+            const struct lpm_family *cand = &lpm->families[i];
+            int len;
+
+            if (f->header == cand->dst_header) {
+                len = cand->addr_len * 8;
+            } else if (f->header == cand->dst_header_w) {
+                len = prefix_len(f->value + cand->addr_len, cand->addr_len);
+                /* A zero mask still needs the field in the packet, which
+                 * the /0 prefix does not check. */
+                if (len <= 0) {
+                    return false;
+                }
+            } else {
+                continue;
+            }
+            fam = cand;
+            p->family = i;
+            p->len = len;
+            for (b = 0; b < cand->addr_len; b++) {
+                int bits = MIN(MAX(len - 8 * (int)b, 0), 8);
+
+                p->addr[b] = f->value[b] & (uint8_t)(0xff00 >> bits);
+            }
+            break;
+        }
+        if (fam == NULL) {
+            return false;
+        }
+    }
+
+    if (fam == NULL) {
+        if (!has_eth_type) {
+            *miss = true;
+            return true;
+        }
+        /* Matches on the Ethernet type alone: the /0 prefix of its family. */
+        for (i = 0; i < LPM_N_FAMILIES; i++) {
+            if (lpm->families[i].eth_type == eth_type) {
+                p->family = i;
+                p->len = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+    return !has_eth_type || eth_type == fam->eth_type;
+}
+
+static uint32_t
+hash_prefix(const struct lpm_prefix *p, size_t addr_len) {
+    return hash_bytes(p->addr, addr_len, hash_int(p->family << 8 | p->len, 0));
+}
+
+static struct lpm_prefix *
+find_prefix(const struct flow_cls_lpm *lpm, const struct lpm_prefix *key) {
+    size_t addr_len = lpm->families[key->family].addr_len;
+    struct lpm_prefix *p;
+
+    HMAP_FOR_EACH_WITH_HASH (p, struct lpm_prefix, node, hash_prefix(key, addr_len),
+                             &lpm->prefixes) {
+        if (p->family == key->family && p->len == key->len
+            && !memcmp(p->addr, key->addr, addr_len)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* Returns true if an entry of the given prefix length and priority keeps the
+ * longest prefix the one of highest priority. */
+static bool
+priority_fits(const struct flow_cls_lpm *lpm, const struct lpm_family *fam,
+              size_t len, uint16_t priority) {
+    size_t l;
+
+    if (lpm->miss != NULL && lpm->miss->stats->priority >= priority) {
+        return false;
+    }
+    for (l = 0; l <= fam->addr_len * 8; l++) {
+        if (fam->count[l] == 0) {
+            continue;
+        }
+        if ((l < len && fam->priority[l] >= priority)
+            || (l == len && fam->priority[l] != priority)
+            || (l > len && fam->priority[l] <= priority)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns the slots of the level the prefix ends at, and in '*start' and
+ * '*span' those it covers. Creates the missing levels if 'create' is set;
+ * otherwise returns NULL if they are missing. The prefix may not be /0. */
+static struct lpm_slot *
+prefix_slots(struct lpm_family *fam, const struct lpm_prefix *p, bool create,
+             size_t *start, size_t *span) {
+    struct lpm_slot *slots;
+    size_t i;
+
+    if (fam->root == NULL) {
+        if (!create) {
+            return NULL;
+        }
+        fam->root = xcalloc(LPM_ROOT_SLOTS, sizeof *fam->root);
+    }
+    slots = fam->root;
+    *start = p->addr[0] << 8 | p->addr[1];
+    if (p->len <= 16) {
+        *span = 1 << (16 - p->len);
+        return slots;
+    }
+    for (i = 2; i * 8 < p->len; i++) {
+        struct lpm_slot *slot = &slots[*start];
+
+        if (slot->child == NULL) {
+            if (!create) {
+                return NULL;
+            }
+            slot->child = xcalloc(1, sizeof *slot->child);
+        }
+        slots = slot->child->slots;
+        *start = p->addr[i];
+    }
+    *span = 1 << (8 * i - p->len);
+    return slots;
+}
+
+/* Returns the longest prefix covering 'p' that ends at the same level, or
+ * NULL. */
+static struct lpm_prefix *
+covering_prefix(const struct flow_cls_lpm *lpm, const struct lpm_prefix *p) {
+    struct lpm_prefix key = *p;
+    int level = p->len <= 16 ? 0 : (p->len - 1) / 8 * 8;
+
+    for (key.len = p->len - 1; key.len > level; key.len--) {
+        struct lpm_prefix *q;
+
+        key.addr[key.len / 8] &= (uint8_t)(0xff00 >> (key.len % 8));
+        q = find_prefix(lpm, &key);
+        if (q != NULL) {
+            return q;
+        }
+    }
+    return NULL;
+}
+
+/* Adds 'entry' to the index. Returns false if it does not fit. */
+static bool
+index_entry(struct flow_cls_lpm *lpm, struct flow_entry *entry) {
+    uint16_t priority = entry->stats->priority;
+    struct lpm_family *fam;
+    struct lpm_prefix key, *p;
+    struct lpm_slot *slots;
+    size_t start, span, i;
+    bool miss;
+
+    if (!parse_entry(lpm, entry, &key, &miss)) {
+        return false;
+    }
+    if (miss) {
+        if (lpm->miss != NULL) {
+            return false;
+        }
+        for (i = 0; i < LPM_N_FAMILIES; i++) {
+            size_t l;
+
+            fam = &lpm->families[i];
+            for (l = 0; l <= fam->addr_len * 8; l++) {
+                if (fam->count[l] > 0 && fam->priority[l] <= priority) {
+                    return false;
+                }
+            }
+        }
+        lpm->miss = entry;
+        return true;
+    }
+
+    fam = &lpm->families[key.family];
+    if (!priority_fits(lpm, fam, key.len, priority) || find_prefix(lpm, &key) != NULL) {
+        return false;
+    }
+
+    p = xmemdup(&key, sizeof key);
+    hmap_insert(&lpm->prefixes, &p->node, hash_prefix(p, fam->addr_len));
+    fam->count[p->len]++;
+    fam->priority[p->len] = priority;
+    fam->n_prefixes++;
+
+    if (p->len == 0) {
+        fam->dflt = p;
+        return true;
+    }
+    slots = prefix_slots(fam, p, true, &start, &span);
+    for (i = start; i < start + span; i++) {
+        if (slots[i].best == NULL || slots[i].best->len < p->len) {
+            slots[i].best = p;
+        }
+    }
+    return true;
+}
+
+/* Removes 'entry' from the index; the replacement of its prefix in each slot
+ * is the same shorter prefix, found in at most 15 lookups. */
+static void
+unindex_entry(struct flow_cls_lpm *lpm, struct flow_entry *entry) {
+    struct lpm_family *fam;
+    struct lpm_prefix key, *p, *cover;
+    struct lpm_slot *slots;
+    size_t start, span, i;
+    bool miss;
+
+    if (!parse_entry(lpm, entry, &key, &miss)) {
+        return;
+    }
+    if (miss) {
+        if (lpm->miss == entry) {
+            lpm->miss = NULL;
+        }
+        return;
+    }
+    p = find_prefix(lpm, &key);
+    if (p == NULL || p->entry != entry) {
+        return;
+    }
+
+    fam = &lpm->families[p->family];
+    if (p->len == 0) {
+        fam->dflt = NULL;
+    } else {
+        slots = prefix_slots(fam, p, false, &start, &span);
+        cover = covering_prefix(lpm, p);
+        for (i = start; slots != NULL && i < start + span; i++) {
+            if (slots[i].best == p) {
+                slots[i].best = cover;
+            }
+        }
+    }
+    fam->count[p->len]--;
+    fam->n_prefixes--;
+    hmap_remove(&lpm->prefixes, &p->node);
+    free(p);
+}
+
+static void
+drop(struct flow_cls_lpm *lpm) {
+    clear(lpm);
+    lpm->broken = true;
+    lpm->dirty = false;
+}
+
+static void
+rebuild(struct flow_cls_lpm *lpm) {
+    struct flow_entry *entry;
+
+    clear(lpm);
+    lpm->broken = false;
+    lpm->dirty = false;
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &lpm->table->match_entries) {
+        if (!index_entry(lpm, entry)) {
+            drop(lpm);
+            return;
+        }
+    }
+}
+
+void
+flow_cls_lpm_insert(struct flow_cls_lpm *lpm, struct flow_entry *entry) {
+    if (lpm->broken) {
+        lpm->dirty = true;
+    } else if (!index_entry(lpm, entry)) {
+        drop(lpm);
+    }
+}
+
+void
+flow_cls_lpm_remove(struct flow_cls_lpm *lpm, struct flow_entry *entry) {
+    if (lpm->broken) {
+        lpm->dirty = true;
+    } else {
+        unindex_entry(lpm, entry);
+    }
+}
+
+void
+flow_cls_lpm_run(struct flow_cls_lpm *lpm) {
+    if (lpm->broken && lpm->dirty) {
+        rebuild(lpm);
+    }
+}
+
+bool
+flow_cls_lpm_ready(struct flow_cls_lpm *lpm) {
+    return !lpm->broken;
+}
+
+static struct lpm_prefix *
+trie_lookup(const struct lpm_family *fam, const uint8_t *addr) {
+    struct lpm_prefix *best = fam->dflt;
+    const struct lpm_slot *slot;
+    size_t i;
+
+    if (fam->root == NULL) {
+        return best;
+    }
+    slot = &fam->root[addr[0] << 8 | addr[1]];
+    for (i = 2; ; i++) {
+        if (slot->best != NULL) {
+            best = slot->best;
+        }
+        if (slot->child == NULL || i == fam->addr_len) {
+            return best;
+        }
+        slot = &slot->child->slots[addr[i]];
+    }
+}
+
+struct flow_entry *
+flow_cls_lpm_lookup(struct flow_cls_lpm *lpm, struct packet *pkt) {
+    struct packet_handle_std *handle = pkt->handle_std;
+    struct ofl_match_tlv *f;
+    size_t i;
+
+    if (!handle->valid) {
+        packet_handle_std_validate(handle);
+        if (!handle->valid) {
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < LPM_N_FAMILIES; i++) {
+        const struct lpm_family *fam = &lpm->families[i];
+
+        if (fam->n_prefixes > 0) {
+            f = oxm_match_lookup(fam->dst_header, &handle->match);
+            if (f != NULL) {
+                struct lpm_prefix *p = trie_lookup(fam, f->value);
+
+                return p != NULL ? p->entry : lpm->miss;
+            }
+        }
+    }
+
+    /* Packets without the address still match the /0 entries, which only
+     * check the Ethernet type. */
+    if (lpm->families[LPM_IPV4].dflt != NULL || lpm->families[LPM_IPV6].dflt != NULL) {
+        f = oxm_match_lookup(OXM_OF_ETH_TYPE, &handle->match);
+        for (i = 0; f != NULL && i < LPM_N_FAMILIES; i++) {
+            const struct lpm_family *fam = &lpm->families[i];
+            uint16_t eth_type;
+
+            memcpy(&eth_type, f->value, sizeof eth_type);
+            if (fam->dflt != NULL && fam->eth_type == eth_type) {
+                return fam->dflt->entry;
+            }
+        }
+    }
+    return lpm->miss;
+}
@@ -0,0 +1,69 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOW_CLS_LPM_H
+#define FLOW_CLS_LPM_H 1
+
+#include <stdbool.h>
+
+/****************************************************************************
+ * Longest-prefix-match index for flow tables used as routing tables: every
+ * entry matches on an IPv4 or IPv6 destination prefix, and maybe on the
+ * matching Ethernet type, with a priority that grows with the length of the
+ * prefix. A table-miss entry of lower priority is allowed too.
+ *
+ * Prefixes live in a multibit trie, cut 16-8-8-... bits from the top of the
+ * address, so that an IPv4 lookup takes at most three memory accesses. The
+ * trie is updated in place as entries come and go. When an entry of another
+ * shape is added, the index is dropped, and built again from the main loop
+ * after the table changes.
+ ****************************************************************************/
+
+struct flow_entry;
+struct flow_table;
+struct packet;
+
+/* Creates an empty index for the entries of 'table'. */
+struct flow_cls_lpm *
+flow_cls_lpm_create(struct flow_table *table);
+
+/* Destroys the index. The entries are not touched. */
+void
+flow_cls_lpm_destroy(struct flow_cls_lpm *lpm);
+
+/* Adds 'entry', just added to the table, to the index. */
+void
+flow_cls_lpm_insert(struct flow_cls_lpm *lpm, struct flow_entry *entry);
+
+/* Removes 'entry', about to be removed from the table, from the index. */
+void
+flow_cls_lpm_remove(struct flow_cls_lpm *lpm, struct flow_entry *entry);
+
+/* Tries to index the table again if it was dropped and the table changed. */
+void
+flow_cls_lpm_run(struct flow_cls_lpm *lpm);
+
+/* Returns true if the index holds every entry of the table. */
+bool
+flow_cls_lpm_ready(struct flow_cls_lpm *lpm);
+
+/* Returns the entry of highest priority matching the packet, or NULL. The
+ * index must be ready. Statistics are left to the caller. */
+struct flow_entry *
+flow_cls_lpm_lookup(struct flow_cls_lpm *lpm, struct packet *pkt);
+
+#endif /* FLOW_CLS_LPM_H */
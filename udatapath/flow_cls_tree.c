@@ -0,0 +1,743 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "flow_cls_tree.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "list.h"
+#include "match_std.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "timeval.h"
+#include "util.h"
+#include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
+#include "openflow/openflow.h"
+
+/* Tables with fewer entries are served well enough by the linear classifier
+ * or the list. */
+#define TREE_MIN_ENTRIES 256
+
+/* Leaves hold at most this many entries, unless they cannot be split. */
+#define TREE_LEAF_RULES 8
+#define TREE_MAX_DEPTH  40
+
+/* An entry spanning a cut goes to both sides. Once the copies in the leaves
+ * reach this many times the entries, the remaining nodes become leaves. */
+#define TREE_MAX_COPIES 16
+
+/* The tree is built once no flow mod came for TREE_SETTLE_MSEC, or at the
+ * latest TREE_STALE_MSEC after the first change. */
+#define TREE_SETTLE_MSEC 50
+#define TREE_STALE_MSEC  1000
+
+/* Every field the tree looks at is cut along one dimension, or two for the
+ * 16-byte fields, each an unsigned integer of up to 64 bits. */
+#define TREE_MAX_DIMS 64
+
+/* Cut points tried per dimension. */
+#define TREE_CUTS 5
+
+/* Entries of a node are checked for being shadowed by this many of the
+ * entries of higher priority kept before them. */
+#define TREE_SHADOW_RULES 64
+
+struct tree_field {
+    uint32_t header;   /* OXM header of the packet field */
+    uint8_t  len;
+    uint8_t  dim;      /* first dimension of the field */
+};
+
+struct tree_dim {
+    bool     be;       /* bytes read most significant first */
+    uint8_t  field;
+    uint8_t  offset;   /* of the first byte in the field */
+    uint8_t  len;
+    uint64_t max;      /* all ones over 'len' bytes */
+};
+
+/* An entry of the table. Its match is its constraints on the dimensions,
+ * unless 'verify' is set: then the constraints are only necessary, and the
+ * entry is matched in full. */
+struct tree_rule {
+    struct flow_entry *entry;
+    uint64_t present;  /* dimensions the packet must have */
+    uint32_t cons;     /* first constraint in flow_cls_tree.cons */
+    uint16_t n_cons;
+    bool     verify;
+    bool     prefix;   /* all constraints are prefixes, and not verified */
+};
+
+struct tree_cons {
+    uint8_t  dim;
+    uint64_t value;    /* already masked */
+    uint64_t mask;
+};
+
+/* An inner node sends keys up to 'cut' to 'a', and the rest to 'b'. A leaf
+ * has 'b' rules starting at leaf_rules['a'], in priority order. */
+struct tree_node {
+    bool     leaf;
+    uint8_t  dim;
+    uint32_t a, b;
+    uint64_t cut;
+};
+
+struct flow_cls_tree {
+    struct flow_table *table;
+    bool               dirty;       /* entries changed since the last build */
+    long long          changed;     /* time_msec() of the last change */
+    long long          dirty_since; /* time_msec() of the first change */
+
+    struct tree_field  fields[TREE_MAX_DIMS];
+    size_t             n_fields;
+    struct tree_dim    dims[TREE_MAX_DIMS];
+    size_t             n_dims;
+
+    struct tree_rule  *rules;       /* in priority order */
+    size_t             n_rules;
+    struct tree_cons  *cons;
+    size_t             n_cons, cons_alloc;
+
+    struct tree_node  *nodes;       /* nodes[0] is the root */
+    size_t             n_nodes, nodes_alloc;
+    uint32_t          *leaf_rules;
+    size_t             n_leaf_rules, leaf_rules_alloc;
+
+    struct flow_cls_tree_stats stats;
+};
+
+/* Intervals of the rules over the dimensions, while the tree is built. */
+struct tree_build {
+    struct flow_cls_tree *tree;
+    uint64_t *lo, *hi;      /* [rule * n_dims + dim] */
+    uint64_t *cuts;         /* scratch for cut points */
+    size_t    max_copies;
+    bool      full;         /* max_copies was reached */
+};
+
+static long long int
+now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct flow_cls_tree *
+flow_cls_tree_create(struct flow_table *table) {
+    struct flow_cls_tree *tree = xcalloc(1, sizeof(struct flow_cls_tree));
+
+    tree->table = table;
+    tree->dirty = true;
+    tree->changed = tree->dirty_since = time_msec();
+    return tree;
+}
+
+static void
+free_tree(struct flow_cls_tree *tree) {
+    free(tree->rules);
+    free(tree->cons);
+    free(tree->nodes);
+    free(tree->leaf_rules);
+    tree->rules = NULL;
+    tree->cons = NULL;
+    tree->nodes = NULL;
+    tree->leaf_rules = NULL;
+    tree->n_rules = tree->n_cons = tree->cons_alloc = 0;
+    tree->n_nodes = tree->nodes_alloc = 0;
+    tree->n_leaf_rules = tree->leaf_rules_alloc = 0;
+}
+
+void
+flow_cls_tree_destroy(struct flow_cls_tree *tree) {
+    free_tree(tree);
+    free(tree);
+}
+
+void
+flow_cls_tree_invalidate(struct flow_cls_tree *tree) {
+    long long now = time_msec();
+
+    if (!tree->dirty) {
+        tree->dirty = true;
+        tree->dirty_since = now;
+    }
+    tree->changed = now;
+}
+
+void
+flow_cls_tree_get_stats(struct flow_cls_tree *tree, struct flow_cls_tree_stats *stats) {
+    *stats = tree->stats;
+}
+
+/* Reads 'len' bytes as an integer, in the byte order of the dimension. */
+static inline uint64_t
+dim_value(const struct tree_dim *dim, const uint8_t *p) {
+    uint64_t v = 0;
+    size_t i;
+
+    if (dim->be) {
+        for (i = 0; i < dim->len; i++) {
+            v = (v << 8) | p[i];
+        }
+    } else {
+        for (i = 0; i < dim->len; i++) {
+            v |= (uint64_t)p[i] << (8 * i);
+        }
+    }
+    return v;
+}
+
+/* Returns true if 'mask' is a prefix mask within 'max': ones, then zeros. */
+static inline bool
+is_prefix(uint64_t mask, uint64_t max) {
+    uint64_t inv = ~mask & max;
+
+    return (inv & (inv + 1)) == 0;
+}
+
+/* Splits the OXM header of a flow field into the header of the packet field
+ * and its length. */
+static inline uint32_t
+packet_header(uint32_t header, size_t *len) {
+    *len = OXM_LENGTH(header);
+    if (OXM_HASMASK(header)) {
+        *len /= 2;
+        header = (header & 0xfffffe00) | *len;
+    }
+    return header;
+}
+
+static struct ofl_match *
+entry_match(struct flow_entry *entry) {
+    struct ofl_match_header *m = entry->match == NULL ? entry->stats->match : entry->match;
+
+    return m->type == OFPMT_OXM ? (struct ofl_match *)m : NULL;
+}
+
+/* Returns true if the tree can look at the field. The VLAN ID and IPv6
+ * extension header fields do not match bit for bit, and the eHDDP lists are
+ * too wide. */
+static inline bool
+field_is_tree(uint32_t header, size_t len) {
+    return header != OXM_OF_VLAN_VID && header != OXM_OF_IPV6_EXTHDR
+           && (len <= 8 || len == 16);
+}
+
+static int
+find_field(struct flow_cls_tree *tree, uint32_t header) {
+    size_t i;
+
+    for (i = 0; i < tree->n_fields; i++) {
+        if (tree->fields[i].header == header) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Finds the fields the entries match on, and lays out their dimensions. The
+ * byte order of each dimension is the one in which most entries match on a
+ * prefix. */
+static void
+layout_dims(struct flow_cls_tree *tree) {
+    int prefix_be[TREE_MAX_DIMS], prefix_le[TREE_MAX_DIMS];
+    struct flow_entry *entry;
+    size_t i;
+
+    tree->n_fields = 0;
+    tree->n_dims = 0;
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &tree->table->match_entries) {
+        struct ofl_match *m = entry_match(entry);
+        struct ofl_match_tlv *f;
+
+        if (m == NULL) {
+            continue;
+        }
+        HMAP_FOR_EACH (f, struct ofl_match_tlv, hmap_node, &m->match_fields) {
+            size_t len, n_dims;
+            uint32_t header = packet_header(f->header, &len);
+            struct tree_field *field;
+
+            if (!field_is_tree(header, len) || find_field(tree, header) >= 0) {
+                continue;
+            }
+            n_dims = len == 16 ? 2 : 1;
+            if (tree->n_dims + n_dims > TREE_MAX_DIMS) {
+                continue;
+            }
+            field = &tree->fields[tree->n_fields];
+            field->header = header;
+            field->len = len;
+            field->dim = tree->n_dims;
+            for (i = 0; i < n_dims; i++) {
+                struct tree_dim *dim = &tree->dims[tree->n_dims + i];
+
+                dim->be = true;
+                dim->field = tree->n_fields;
+                dim->offset = i * 8;
+                dim->len = len / n_dims;
+                dim->max = dim->len == 8 ? UINT64_MAX : (1ULL << (8 * dim->len)) - 1;
+                prefix_be[tree->n_dims + i] = prefix_le[tree->n_dims + i] = 0;
+            }
+            tree->n_dims += n_dims;
+            tree->n_fields++;
+        }
+    }
+
+    /* The 16-byte fields are addresses, in network byte order; other
+     * fields may be kept in host order. */
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &tree->table->match_entries) {
+        struct ofl_match *m = entry_match(entry);
+        struct ofl_match_tlv *f;
+
+        if (m == NULL) {
+            continue;
+        }
+        HMAP_FOR_EACH (f, struct ofl_match_tlv, hmap_node, &m->match_fields) {
+            size_t len;
+            uint32_t header = packet_header(f->header, &len);
+            int field = find_field(tree, header);
+            struct tree_dim *dim;
+            struct tree_dim le;
+
+            if (field < 0 || len == 16 || !OXM_HASMASK(f->header)) {
+                continue;
+            }
+            dim = &tree->dims[tree->fields[field].dim];
+            le = *dim;
+            le.be = false;
+            prefix_be[dim - tree->dims] += is_prefix(dim_value(dim, f->value + len), dim->max);
+            prefix_le[dim - tree->dims] += is_prefix(dim_value(&le, f->value + len), le.max);
+        }
+    }
+    for (i = 0; i < tree->n_dims; i++) {
+        tree->dims[i].be = prefix_be[i] >= prefix_le[i];
+    }
+}
+
+static void
+add_cons(struct flow_cls_tree *tree, uint8_t dim, uint64_t value, uint64_t mask) {
+    struct tree_cons *c;
+
+    if (tree->n_cons == tree->cons_alloc) {
+        tree->cons = x2nrealloc(tree->cons, &tree->cons_alloc, sizeof *tree->cons);
+    }
+    c = &tree->cons[tree->n_cons++];
+    c->dim = dim;
+    c->value = value & mask;
+    c->mask = mask;
+}
+
+/* Compiles the match of 'entry' into rule 'r', and its interval in every
+ * dimension. Masks that are not prefixes leave the whole dimension to the
+ * rule: it is then found in every part, and checked against its mask in the
+ * leaf. */
+static void
+compile_rule(struct tree_build *b, size_t r, struct flow_entry *entry) {
+    struct flow_cls_tree *tree = b->tree;
+    struct tree_rule *rule = &tree->rules[r];
+    struct ofl_match *m = entry_match(entry);
+    uint64_t *lo = &b->lo[r * tree->n_dims];
+    uint64_t *hi = &b->hi[r * tree->n_dims];
+    struct ofl_match_tlv *f;
+    size_t d;
+
+    rule->entry = entry;
+    rule->present = 0;
+    rule->cons = tree->n_cons;
+    rule->verify = m == NULL;
+    rule->prefix = true;
+    for (d = 0; d < tree->n_dims; d++) {
+        lo[d] = 0;
+        hi[d] = tree->dims[d].max;
+    }
+    if (m == NULL) {
+        rule->n_cons = 0;
+        return;
+    }
+
+    HMAP_FOR_EACH (f, struct ofl_match_tlv, hmap_node, &m->match_fields) {
+        size_t len;
+        uint32_t header = packet_header(f->header, &len);
+        int field = find_field(tree, header);
+        size_t n_dims, i;
+
+        if (field < 0) {
+            rule->verify = true;
+            continue;
+        }
+        n_dims = len == 16 ? 2 : 1;
+        for (i = 0; i < n_dims; i++) {
+            const struct tree_dim *dim = &tree->dims[tree->fields[field].dim + i];
+            uint64_t value = dim_value(dim, f->value + dim->offset);
+            uint64_t mask = OXM_HASMASK(f->header)
+                            ? dim_value(dim, f->value + len + dim->offset) : dim->max;
+
+            d = dim - tree->dims;
+
+            rule->present |= 1ULL << d;
+            add_cons(tree, d, value, mask);
+            if (is_prefix(mask, dim->max)) {
+                lo[d] = value & mask;
+                hi[d] = lo[d] | (~mask & dim->max);
+            } else {
+                rule->prefix = false;
+            }
+        }
+    }
+    rule->n_cons = tree->n_cons - rule->cons;
+    rule->prefix = rule->prefix && !rule->verify;
+}
+
+static uint32_t
+new_node(struct flow_cls_tree *tree) {
+    if (tree->n_nodes == tree->nodes_alloc) {
+        tree->nodes = x2nrealloc(tree->nodes, &tree->nodes_alloc, sizeof *tree->nodes);
+    }
+    return tree->n_nodes++;
+}
+
+static void
+make_leaf(struct flow_cls_tree *tree, uint32_t node, const uint32_t *rules, size_t n,
+          size_t depth) {
+    while (tree->n_leaf_rules + n > tree->leaf_rules_alloc) {
+        tree->leaf_rules = x2nrealloc(tree->leaf_rules, &tree->leaf_rules_alloc,
+                                      sizeof *tree->leaf_rules);
+    }
+    memcpy(&tree->leaf_rules[tree->n_leaf_rules], rules, n * sizeof *rules);
+    tree->nodes[node].leaf = true;
+    tree->nodes[node].a = tree->n_leaf_rules;
+    tree->nodes[node].b = n;
+    tree->n_leaf_rules += n;
+    tree->stats.depth = MAX(tree->stats.depth, depth);
+}
+
+static int
+compare_u64(const void *a_, const void *b_) {
+    uint64_t a = *(const uint64_t *)a_;
+    uint64_t b = *(const uint64_t *)b_;
+
+    return a < b ? -1 : a > b;
+}
+
+/* Picks the cut of the region [rlo, rhi] that leaves the fewest rules on the
+ * larger side. Cuts are tried at quantiles of the ends of the intervals of
+ * the rules, as they fall in the region. Returns false if no cut leaves out
+ * any rule. */
+static bool
+choose_cut(struct tree_build *b, const uint32_t *rules, size_t n,
+           const uint64_t *rlo, const uint64_t *rhi, uint8_t *best_dim, uint64_t *best_cut) {
+    struct flow_cls_tree *tree = b->tree;
+    size_t best = n, best_sum = 2 * n;
+    size_t d, i, k;
+
+    for (d = 0; d < tree->n_dims; d++) {
+        size_t n_cuts = 0;
+
+        if (rlo[d] == rhi[d]) {
+            continue;
+        }
+        for (i = 0; i < n; i++) {
+            uint64_t lo = b->lo[rules[i] * tree->n_dims + d];
+            uint64_t hi = b->hi[rules[i] * tree->n_dims + d];
+
+            if (lo > rlo[d]) {
+                b->cuts[n_cuts++] = lo - 1;
+            }
+            if (hi < rhi[d]) {
+                b->cuts[n_cuts++] = hi;
+            }
+        }
+        if (n_cuts == 0) {
+            continue;
+        }
+        qsort(b->cuts, n_cuts, sizeof *b->cuts, compare_u64);
+
+        for (k = 1; k <= TREE_CUTS; k++) {
+            uint64_t cut = b->cuts[(n_cuts - 1) * k / (TREE_CUTS + 1)];
+            size_t nl = 0, nr = 0;
+
+            for (i = 0; i < n; i++) {
+                nl += b->lo[rules[i] * tree->n_dims + d] <= cut;
+                nr += b->hi[rules[i] * tree->n_dims + d] > cut;
+            }
+            if (MAX(nl, nr) < best || (MAX(nl, nr) == best && nl + nr < best_sum)) {
+                best = MAX(nl, nr);
+                best_sum = nl + nr;
+                *best_dim = d;
+                *best_cut = cut;
+            }
+        }
+    }
+    return best < n;
+}
+
+/* Returns true if, within the region, every packet rule 's' matches is also
+ * matched by rule 'r'. */
+static bool
+shadows(const struct tree_build *b, uint32_t r, uint32_t s,
+        const uint64_t *rlo, const uint64_t *rhi) {
+    const struct flow_cls_tree *tree = b->tree;
+    const struct tree_rule *rule = &tree->rules[r];
+    size_t n_dims = tree->n_dims;
+    size_t j;
+
+    if (!rule->prefix || (rule->present & ~tree->rules[s].present) != 0) {
+        return false;
+    }
+    for (j = 0; j < rule->n_cons; j++) {
+        size_t d = tree->cons[rule->cons + j].dim;
+
+        if (MAX(b->lo[s * n_dims + d], rlo[d]) < b->lo[r * n_dims + d]
+            || MIN(b->hi[s * n_dims + d], rhi[d]) > b->hi[r * n_dims + d]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Drops the rules of a node that can never be the first to match in its
+ * region, and returns how many are left. Wide rules spanning many cuts are
+ * the ones copied the most, and often are shadowed deeper in the tree. */
+static size_t
+drop_shadowed(const struct tree_build *b, uint32_t *rules, size_t n,
+              const uint64_t *rlo, const uint64_t *rhi) {
+    size_t kept = 0;
+    size_t i, j;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < MIN(kept, TREE_SHADOW_RULES); j++) {
+            if (shadows(b, rules[j], rules[i], rlo, rhi)) {
+                break;
+            }
+        }
+        if (j == MIN(kept, TREE_SHADOW_RULES)) {
+            rules[kept++] = rules[i];
+        }
+    }
+    return kept;
+}
+
+static void
+build_node(struct tree_build *b, uint32_t node, uint32_t *rules, size_t n,
+           uint64_t *rlo, uint64_t *rhi, size_t depth) {
+    struct flow_cls_tree *tree = b->tree;
+    uint32_t *left, *right;
+    uint32_t a, c;
+    size_t nl, nr, i;
+    uint64_t cut = 0, saved;
+    uint8_t dim = 0;
+
+    n = drop_shadowed(b, rules, n, rlo, rhi);
+    if (n <= TREE_LEAF_RULES || depth >= TREE_MAX_DEPTH || b->full
+        || !choose_cut(b, rules, n, rlo, rhi, &dim, &cut)) {
+        make_leaf(tree, node, rules, n, depth);
+        return;
+    }
+
+    left = xmalloc(n * sizeof *left);
+    right = xmalloc(n * sizeof *right);
+    nl = nr = 0;
+    for (i = 0; i < n; i++) {
+        if (b->lo[rules[i] * tree->n_dims + dim] <= cut) {
+            left[nl++] = rules[i];
+        }
+        if (b->hi[rules[i] * tree->n_dims + dim] > cut) {
+            right[nr++] = rules[i];
+        }
+    }
+    if (tree->n_leaf_rules + nl + nr > b->max_copies) {
+        b->full = true;
+    }
+
+    /* Adding nodes may move them all. */
+    a = new_node(tree);
+    c = new_node(tree);
+    tree->nodes[node].leaf = false;
+    tree->nodes[node].dim = dim;
+    tree->nodes[node].cut = cut;
+    tree->nodes[node].a = a;
+    tree->nodes[node].b = c;
+
+    saved = rhi[dim];
+    rhi[dim] = cut;
+    build_node(b, a, left, nl, rlo, rhi, depth + 1);
+    rhi[dim] = saved;
+
+    saved = rlo[dim];
+    rlo[dim] = cut + 1;
+    build_node(b, c, right, nr, rlo, rhi, depth + 1);
+    rlo[dim] = saved;
+
+    free(left);
+    free(right);
+}
+
+static void
+build(struct flow_cls_tree *tree) {
+    uint64_t rlo[TREE_MAX_DIMS], rhi[TREE_MAX_DIMS];
+    struct tree_build b;
+    struct flow_entry *entry;
+    uint32_t *rules;
+    long long start = now_ns();
+    size_t n = tree->table->stats->active_count;
+    size_t i;
+
+    free_tree(tree);
+    layout_dims(tree);
+
+    memset(&b, 0, sizeof b);
+    b.tree = tree;
+    b.lo = xmalloc(MAX(n * tree->n_dims, 1) * sizeof *b.lo);
+    b.hi = xmalloc(MAX(n * tree->n_dims, 1) * sizeof *b.hi);
+    b.cuts = xmalloc(MAX(2 * n, 1) * sizeof *b.cuts);
+    b.max_copies = TREE_MAX_COPIES * MAX(n, TREE_LEAF_RULES);
+
+    tree->rules = xmalloc(MAX(n, 1) * sizeof *tree->rules);
+    rules = xmalloc(MAX(n, 1) * sizeof *rules);
+    i = 0;
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &tree->table->match_entries) {
+        compile_rule(&b, i, entry);
+        rules[i] = i;
+        i++;
+    }
+    tree->n_rules = i;
+
+    for (i = 0; i < tree->n_dims; i++) {
+        rlo[i] = 0;
+        rhi[i] = tree->dims[i].max;
+    }
+    tree->stats.depth = 0;
+    build_node(&b, new_node(tree), rules, tree->n_rules, rlo, rhi, 0);
+
+    free(rules);
+    free(b.lo);
+    free(b.hi);
+    free(b.cuts);
+
+    tree->stats.rules = tree->n_rules;
+    tree->stats.nodes = tree->n_nodes;
+    tree->stats.leaf_refs = tree->n_leaf_rules;
+    tree->stats.builds++;
+    tree->stats.build_ns = now_ns() - start;
+    tree->dirty = false;
+}
+
+void
+flow_cls_tree_run(struct flow_cls_tree *tree) {
+    long long now;
+
+    if (!tree->dirty) {
+        return;
+    }
+    if (tree->table->stats->active_count < TREE_MIN_ENTRIES) {
+        /* Nothing to build; just let go of the old tree. */
+        if (tree->nodes != NULL) {
+            free_tree(tree);
+        }
+        return;
+    }
+    now = time_msec();
+    if (now - tree->changed >= TREE_SETTLE_MSEC || now - tree->dirty_since >= TREE_STALE_MSEC) {
+        build(tree);
+    }
+}
+
+bool
+flow_cls_tree_ready(struct flow_cls_tree *tree, bool force) {
+    if (force) {
+        if (tree->dirty) {
+            build(tree);
+        }
+        return true;
+    }
+    return !tree->dirty && tree->n_rules >= TREE_MIN_ENTRIES;
+}
+
+struct flow_entry *
+flow_cls_tree_lookup(struct flow_cls_tree *tree, struct packet *pkt) {
+    struct packet_handle_std *handle = pkt->handle_std;
+    uint64_t key[TREE_MAX_DIMS];
+    uint64_t present = 0;
+    const struct tree_node *node;
+    size_t i;
+
+    if (!handle->valid) {
+        packet_handle_std_validate(handle);
+        if (!handle->valid) {
+            return NULL;
+        }
+    }
+
+    /* Dimensions of fields the packet lacks are left at zero. Only rules
+     * not matching on such a field can match, and those are on both sides
+     * of every cut along it. */
+    for (i = 0; i < tree->n_fields; i++) {
+        const struct tree_field *field = &tree->fields[i];
+        struct ofl_match_tlv *f = oxm_match_lookup(field->header, &handle->match);
+        size_t d, n_dims = field->len == 16 ? 2 : 1;
+
+        for (d = field->dim; d < field->dim + n_dims; d++) {
+            if (f != NULL) {
+                key[d] = dim_value(&tree->dims[d], f->value + tree->dims[d].offset);
+                present |= 1ULL << d;
+            } else {
+                key[d] = 0;
+            }
+        }
+    }
+
+    node = &tree->nodes[0];
+    while (!node->leaf) {
+        node = &tree->nodes[key[node->dim] <= node->cut ? node->a : node->b];
+    }
+
+    for (i = 0; i < node->b; i++) {
+        const struct tree_rule *rule = &tree->rules[tree->leaf_rules[node->a + i]];
+        const struct tree_cons *c = &tree->cons[rule->cons];
+        size_t j;
+
+        if ((present & rule->present) != rule->present) {
+            continue;
+        }
+        for (j = 0; j < rule->n_cons; j++) {
+            if ((key[c[j].dim] & c[j].mask) != c[j].value) {
+                break;
+            }
+        }
+        if (j < rule->n_cons) {
+            continue;
+        }
+        if (rule->verify) {
+            struct ofl_match *m = entry_match(rule->entry);
+
+            if (m == NULL || !packet_match(m, &handle->match)) {
+                continue;
+            }
+        }
+        return rule->entry;
+    }
+    return NULL;
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOW_CLS_TREE_H
+#define FLOW_CLS_TREE_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Decision-tree classifier for flow tables of thousands of ACL-style entries,
+ * matching on prefixes of addresses and on ports. The space of each field is
+ * cut in two, HyperSplit-style, until few enough entries are left in each
+ * part to check them one by one.
+ *
+ * The tree is built from the main loop, once flow mods have settled; until
+ * then the table is looked up as if it had no tree.
+ ****************************************************************************/
+
+struct flow_entry;
+struct flow_table;
+struct packet;
+
+/* Shape of the last tree built. */
+struct flow_cls_tree_stats {
+    uint32_t rules;     /* entries in the tree */
+    uint32_t nodes;     /* inner nodes and leaves */
+    uint32_t leaf_refs; /* entries in all leaves, with copies */
+    uint32_t depth;     /* deepest leaf */
+    uint64_t builds;    /* trees built */
+    uint64_t build_ns;  /* time the last build took */
+};
+
+/* Creates an empty classifier for the entries of 'table'. */
+struct flow_cls_tree *
+flow_cls_tree_create(struct flow_table *table);
+
+/* Destroys the classifier. The entries are not touched. */
+void
+flow_cls_tree_destroy(struct flow_cls_tree *tree);
+
+/* Tells the classifier that entries were added to or removed from the table.
+ * The tree is unusable until it is built again. */
+void
+flow_cls_tree_invalidate(struct flow_cls_tree *tree);
+
+/* Builds the tree again if entries changed and flow mods have settled. */
+void
+flow_cls_tree_run(struct flow_cls_tree *tree);
+
+/* Returns true if the tree should serve the lookups of the table. If 'force'
+ * is set, an outdated tree is built right away, whatever the size of the
+ * table; otherwise only built trees of large tables are used. */
+bool
+flow_cls_tree_ready(struct flow_cls_tree *tree, bool force);
+
+/* Returns the entry of highest priority matching the packet, or NULL. The
+ * classifier must be ready. Statistics are left to the caller. */
+struct flow_entry *
+flow_cls_tree_lookup(struct flow_cls_tree *tree, struct packet *pkt);
+
+/* Returns the shape of the last tree built. */
+void
+flow_cls_tree_get_stats(struct flow_cls_tree *tree, struct flow_cls_tree_stats *stats);
+
+#endif /* FLOW_CLS_TREE_H */
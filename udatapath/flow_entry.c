@@ -25,6 +25,7 @@
 #include "group_entry.h"
 #include "meter_table.h"
 #include "meter_entry.h"
+#include "pipeline.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-actions.h"
@@ -38,15 +39,9 @@
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
-struct group_ref_entry {
-    struct list   node;
-    uint32_t      group_id;
-};
-
-struct meter_ref_entry {
-    struct list   node;
-    uint32_t      meter_id;
-};
+/* Chunk size of the arenas holding the match and instructions of an entry;
+ * a typical entry fits in a single chunk of each. */
+#define FLOW_ENTRY_ARENA_CHUNK 256
 
 static void
 init_group_refs(struct flow_entry *entry);
@@ -120,21 +115,56 @@ flow_entry_overlaps(struct flow_entry *entry, struct ofl_msg_flow_mod *mod) {
 }
 
 
-void
+/* Copies the instructions to 'arena'. Fails if any of them cannot be
+ * copied; the arena then holds garbage. */
+static ofl_err
+copy_instructions(struct ofl_arena *arena, struct ofl_exp *exp,
+                  size_t instructions_num, struct ofl_instruction_header **instructions,
+                  struct ofl_instruction_header ***copy) {
+    struct ofl_arena *prev;
+    ofl_err error = 0;
+    size_t i;
+
+    prev = ofl_arena_set_current(arena);
+    *copy = ofl_malloc(instructions_num * sizeof(struct ofl_instruction_header *));
+    for (i=0; i<instructions_num; i++) {
+        error = ofl_structs_instruction_clone(instructions[i], &(*copy)[i], exp);
+        if (error) {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "Could not copy instruction of type %u.", instructions[i]->type);
+            break;
+        }
+    }
+    ofl_arena_set_current(prev);
+
+    return error;
+}
+
+ofl_err
 flow_entry_replace_instructions(struct flow_entry *entry,
                                       size_t instructions_num,
                                       struct ofl_instruction_header **instructions) {
+    struct ofl_instruction_header **copy;
+    struct ofl_arena arena;
+    ofl_err error;
+
+    /* Copy to a new arena first, so the entry is left as it is on failure. */
+    ofl_arena_init(&arena, FLOW_ENTRY_ARENA_CHUNK);
+    error = copy_instructions(&arena, entry->dp->exp, instructions_num, instructions, &copy);
+    if (error) {
+        ofl_arena_destroy(&arena);
+        return error;
+    }
 
     /* TODO Zoltan: could be done more efficiently, but... */
     del_group_refs(entry);
 
-    OFL_UTILS_FREE_ARR_FUN2(entry->stats->instructions, entry->stats->instructions_num,
-                            ofl_structs_free_instruction, entry->dp->exp);
-
+    ofl_arena_destroy(&entry->inst_arena);
+    entry->inst_arena = arena;
+    entry->stats->instructions = copy;
     entry->stats->instructions_num = instructions_num;
-    entry->stats->instructions     = instructions;
 
     init_group_refs(entry);
+    return 0;
 }
 
 void
@@ -181,23 +211,40 @@ flow_entry_update(struct flow_entry *entry) {
     entry->stats->duration_nsec = ((time_msec() - entry->created) % 1000) * 1000000;
 }
 
-/* Returns true if the flow entry has a reference to the given group. */
+/* Returns true if the list of references has one to the given ID. The
+ * lists are short: one node per distinct group or meter of the flow. */
 static bool
-has_group_ref(struct flow_entry *entry, uint32_t group_id) {
-    struct group_ref_entry *g;
+has_ref(struct list *refs, uint32_t id) {
+    struct flow_ref *r;
 
-    LIST_FOR_EACH(g, struct group_ref_entry, node, &entry->group_refs) {
-        if (g->group_id == group_id) {
+    LIST_FOR_EACH(r, struct flow_ref, node, refs) {
+        if (r->id == id) {
             return true;
         }
     }
     return false;
 }
 
+/* Adds a reference to the given ID to the list, if there is none yet.
+ * Returns the new reference, or NULL. */
+static struct flow_ref *
+add_ref(struct flow_entry *entry, struct list *refs, uint32_t id) {
+    struct flow_ref *ref;
+
+    if (has_ref(refs, id)) {
+        return NULL;
+    }
+    ref = xmalloc(sizeof(struct flow_ref));
+    ref->entry = entry;
+    ref->id = id;
+    list_init(&ref->target_node);
+    list_insert(refs, &ref->node);
+    return ref;
+}
+
 /* Initializes the group references of the flow entry. */
 static void
 init_group_refs(struct flow_entry *entry) {
-    struct group_ref_entry *e;
     size_t i,j;
 
     for (i=0; i<entry->stats->instructions_num; i++) {
@@ -208,113 +255,91 @@ init_group_refs(struct flow_entry *entry) {
             for (j=0; j < ia->actions_num; j++) {
                 if (ia->actions[j]->type == OFPAT_GROUP) {
                     struct ofl_action_group *ag = (struct ofl_action_group *)(ia->actions[j]);
-                    if (!has_group_ref(entry, ag->group_id)) {
-                        struct group_ref_entry *gre = xmalloc(sizeof(struct group_ref_entry));
-                        gre->group_id = ag->group_id;
-                        list_insert(&entry->group_refs, &gre->node);
+                    struct flow_ref *ref = add_ref(entry, &entry->group_refs, ag->group_id);
+                    struct group_entry *group;
+
+                    if (ref == NULL) {
+                        continue;
+                    }
+                    /* notify the group of the new referencing flow entry */
+                    group = group_table_find(entry->dp->groups, ag->group_id);
+                    if (group != NULL) {
+                        group_entry_add_flow_ref(group, ref);
+                    } else {
+                        VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to access non-existing group(%u).", ag->group_id);
                     }
                 }
             }
         }
     }
-
-    /* notify groups of the new referencing flow entry */
-    LIST_FOR_EACH(e, struct group_ref_entry, node, &entry->group_refs) {
-    	struct group_entry *group = group_table_find(entry->dp->groups, e->group_id);
-    	if (group != NULL) {
-    	    group_entry_add_flow_ref(group, entry);
-    	} else {
-            VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to access non-existing group(%u).", e->group_id);
-    	}
-    }
 }
 
 /* Deletes group references from the flow, and also deletes the flow references
  * from the referecenced groups. */
 static void
 del_group_refs(struct flow_entry *entry) {
-    struct group_ref_entry *gre, *next;
-
-    LIST_FOR_EACH_SAFE(gre, next, struct group_ref_entry, node, &entry->group_refs) {
-
-    	struct group_entry *group = group_table_find(entry->dp->groups, gre->group_id);
-    	if (group != NULL) {
-    	    group_entry_del_flow_ref(group, entry);
-    	} else {
-            VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to access non-existing group(%u).", gre->group_id);
-    	}
-    	list_remove(&gre->node);
-        free(gre);
-    }
-}
+    struct flow_ref *ref, *next;
 
+    LIST_FOR_EACH_SAFE(ref, next, struct flow_ref, node, &entry->group_refs) {
+        if (!list_is_empty(&ref->target_node)) {
+            struct group_entry *group = group_table_find(entry->dp->groups, ref->id);
 
-/* Returns true if the flow entry has a reference to the given meter. */
-static bool
-has_meter_ref(struct flow_entry *entry, uint32_t meter_id) {
-    struct meter_ref_entry *m;
-
-    LIST_FOR_EACH(m, struct meter_ref_entry, node, &entry->meter_refs) {
-        if (m->meter_id == meter_id) {
-            return true;
+            group_entry_del_flow_ref(group, ref);
         }
+        list_remove(&ref->node);
+        free(ref);
     }
-    return false;
 }
 
 /* Initializes the meter references of the flow entry. */
 static void
 init_meter_refs(struct flow_entry *entry) {
-    struct meter_ref_entry *e;
     size_t i;
 
     for (i=0; i<entry->stats->instructions_num; i++) {
         if (entry->stats->instructions[i]->type == OFPIT_METER ) {
             struct ofl_instruction_meter *ia = (struct ofl_instruction_meter *)entry->stats->instructions[i];
+            struct flow_ref *ref = add_ref(entry, &entry->meter_refs, ia->meter_id);
+            struct meter_entry *meter;
 
-			if (!has_meter_ref(entry, ia->meter_id)) {
-				struct meter_ref_entry *mre = xmalloc(sizeof(struct meter_ref_entry));
-				mre->meter_id = ia->meter_id;
-				list_insert(&entry->meter_refs, &mre->node);
-			}
-
+            if (ref == NULL) {
+                continue;
+            }
+            /* notify the meter of the new referencing flow entry */
+            meter = meter_table_find(entry->dp->meters, ia->meter_id);
+            if (meter != NULL) {
+                meter_entry_add_flow_ref(meter, ref);
+            } else {
+                VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to access non-existing meter(%u).", ia->meter_id);
+            }
         }
     }
-
-    /* notify meter of the new referencing flow entry */
-    LIST_FOR_EACH(e, struct meter_ref_entry, node, &entry->meter_refs) {
-    	struct meter_entry *meter = meter_table_find(entry->dp->meters, e->meter_id);
-    	if (meter != NULL) {
-    		meter_entry_add_flow_ref(meter, entry);
-    	} else {
-            VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to access non-existing meter(%u).", e->meter_id);
-    	}
-    }
 }
 
 /* Deletes meter references from the flow, and also deletes the flow references
- * from the referecenced groups. */
+ * from the referecenced meters. */
 static void
 del_meter_refs(struct flow_entry *entry) {
-    struct meter_ref_entry *mre, *next;
-
-    LIST_FOR_EACH_SAFE(mre, next, struct meter_ref_entry, node, &entry->meter_refs) {
-
-    	struct meter_entry *meter = meter_table_find(entry->dp->meters, mre->meter_id);
-    	if (meter != NULL) {
-    		meter_entry_del_flow_ref(meter, entry);
-    	} else {
-            VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to access non-existing meter(%u).", mre->meter_id);
-    	}
-    	list_remove(&mre->node);
-        free(mre);
+    struct flow_ref *ref, *next;
+
+    LIST_FOR_EACH_SAFE(ref, next, struct flow_ref, node, &entry->meter_refs) {
+        if (!list_is_empty(&ref->target_node)) {
+            struct meter_entry *meter = meter_table_find(entry->dp->meters, ref->id);
+
+            meter_entry_del_flow_ref(meter, ref);
+        }
+        list_remove(&ref->node);
+        free(ref);
     }
 }
 
 
-struct flow_entry *
-flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod) {
+ofl_err
+flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod,
+                  struct flow_entry **new_entry) {
     struct flow_entry *entry;
+    struct ofl_arena *prev;
+    ofl_err error;
     uint64_t now;
 
     now = time_msec();
@@ -344,11 +369,28 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     else 
         entry->stats->byte_count       = 0;
 
-    entry->stats->match            = mod->match;
+    /* The flow mod only lives as long as its message, so the match and the
+     * instructions are copied into storage owned by the entry. */
+    ofl_arena_init(&entry->match_arena, FLOW_ENTRY_ARENA_CHUNK);
+    ofl_arena_init(&entry->inst_arena, FLOW_ENTRY_ARENA_CHUNK);
+
+    error = copy_instructions(&entry->inst_arena, dp->exp, mod->instructions_num,
+                              mod->instructions, &entry->stats->instructions);
+    if (error) {
+        ofl_arena_destroy(&entry->inst_arena);
+        free(entry->stats);
+        free(entry);
+        return error;
+    }
     entry->stats->instructions_num = mod->instructions_num;
-    entry->stats->instructions     = mod->instructions;
 
-    entry->match = mod->match; /* TODO: MOD MATCH? */
+    prev = ofl_arena_set_current(&entry->match_arena);
+    /* Only OXM matches reach this point, and those are always copied. */
+    ofl_structs_match_clone(mod->match, &entry->stats->match, dp->exp);
+    ofl_arena_set_current(prev);
+    pipeline_add_match_fields(dp->pipeline, (struct ofl_match *)entry->stats->match);
+
+    entry->match = entry->stats->match; /* TODO: MOD MATCH? */
 
     entry->created      = now;
     entry->remove_at    = mod->hard_timeout == 0 ? 0
@@ -365,7 +407,8 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     list_init(&entry->meter_refs);
     init_meter_refs(entry);
 
-    return entry;
+    *new_entry = entry;
+    return 0;
 }
 
 void
@@ -374,9 +417,12 @@ flow_entry_destroy(struct flow_entry *entry) {
     //       flow; but it won't be a problem.
     del_group_refs(entry);
     del_meter_refs(entry);
-    ofl_structs_free_flow_stats(entry->stats, entry->dp->exp);
     // assumes it is a standard match
-    //free(entry->match);
+    pipeline_remove_match_fields(entry->dp->pipeline, (struct ofl_match *)entry->stats->match);
+    hmap_destroy(&((struct ofl_match *)entry->stats->match)->match_fields);
+    ofl_arena_destroy(&entry->match_arena);
+    ofl_arena_destroy(&entry->inst_arena);
+    free(entry->stats);
     free(entry);
 }
 
@@ -398,5 +444,6 @@ flow_entry_remove(struct flow_entry *entry, uint8_t reason) {
     list_remove(&entry->hard_node);
     list_remove(&entry->idle_node);
     entry->table->stats->active_count--;
+    flow_table_entry_removed(entry->table, entry);
     flow_entry_destroy(entry);
 }
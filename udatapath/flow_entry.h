@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include "datapath.h"
 #include "list.h"
+#include "oflib/ofl-arena.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-messages.h"
 #include "timeval.h"
@@ -31,6 +32,17 @@
  * Implementation of a flow table entry.
  ****************************************************************************/
 
+/* A reference from a flow entry to a group or meter it uses. It is in a list
+ * of the flow and, while the group or meter exists, also in the flow_refs
+ * list of that group or meter, so either side drops it without a search. */
+struct flow_ref {
+    struct list              node;        /* in flow_entry.group_refs or meter_refs. */
+    struct list              target_node; /* in the flow_refs of the group or meter;
+                                             empty if not linked. */
+    struct flow_entry       *entry;
+    uint32_t                 id;          /* group or meter ID. */
+};
+
 struct flow_entry {
     struct list              match_node;  /* list nodes in flow table lists. */
     struct list              hard_node;
@@ -53,6 +65,8 @@ struct flow_entry {
     bool                     no_byt_count; /* true if doesn't keep track of flow matched bytes*/
     struct list              group_refs;  /* list of groups referencing the flow. */
     struct list              meter_refs;  /* list of meters referencing the flow. */
+    struct ofl_arena         match_arena; /* storage of the match. */
+    struct ofl_arena         inst_arena;  /* storage of the instructions. */
 };
 
 struct packet;
@@ -65,8 +79,10 @@ flow_entry_matches(struct flow_entry *entry, struct ofl_msg_flow_mod *mod, bool
 bool
 flow_entry_overlaps(struct flow_entry *entry, struct ofl_msg_flow_mod *mod);
 
-/* Replaces the current instructions of the entry with the given ones. */
-void
+/* Replaces the current instructions of the entry with a copy of the given
+ * ones. If they cannot be copied, the entry is left unchanged and an error is
+ * returned. */
+ofl_err
 flow_entry_replace_instructions(struct flow_entry *entry,
                                       size_t instructions_num,
                                       struct ofl_instruction_header **instructions);
@@ -97,9 +113,12 @@ flow_entry_has_out_group(struct flow_entry *entry, uint32_t group);
 void
 flow_entry_update(struct flow_entry *entry);
 
-/* Creates a flow entry. */
-struct flow_entry *
-flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod);
+/* Creates a flow entry. The match and instructions of the flow mod are copied,
+ * so the message can be freed afterwards. Returns an error if the
+ * instructions cannot be copied. */
+ofl_err
+flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_flow_mod *mod,
+                  struct flow_entry **new_entry);
 
 /* Destroys a flow entry. */
 void
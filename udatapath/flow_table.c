@@ -21,6 +21,9 @@
 #include "datapath.h"
 #include "flow_table.h"
 #include "flow_entry.h"
+#include "flow_cls_linear.h"
+#include "flow_cls_lpm.h"
+#include "flow_cls_tree.h"
 #include "oflib/ofl.h"
 #include "oflib/oxm-match.h"
 #include "time.h"
@@ -100,9 +103,10 @@ add_to_timeout_lists(struct flow_table *table, struct flow_entry *entry) {
 
 /* Handles flow mod messages with ADD command. */
 static ofl_err
-flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap, bool *match_kept, bool *insts_kept) {
+flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap) {
     // Note: new entries will be placed behind those with equal priority
     struct flow_entry *entry, *new_entry;
+    ofl_err error;
 
     LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
         if (check_overlap && flow_entry_overlaps(entry, mod)) {
@@ -111,16 +115,19 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
 
         /* if the entry equals, replace the old one */
         if (flow_entry_matches(entry, mod, true/*strict*/, false/*check_cookie*/)) {
-            new_entry = flow_entry_create(table->dp, table, mod);
-            *match_kept = true;
-            *insts_kept = true;
+            error = flow_entry_create(table->dp, table, mod, &new_entry);
+            if (error) {
+                return error;
+            }
 
             /* NOTE: no flow removed message should be generated according to spec. */
             list_replace(&new_entry->match_node, &entry->match_node);
             list_remove(&entry->hard_node);
             list_remove(&entry->idle_node);
+            flow_table_entry_removed(table, entry);
             flow_entry_destroy(entry);
             add_to_timeout_lists(table, new_entry);
+            flow_table_entry_added(table, new_entry);
             return 0;
         }
 
@@ -132,14 +139,16 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
     if (table->stats->active_count == FLOW_TABLE_MAX_ENTRIES) {
         return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
     }
-    table->stats->active_count++;
 
-    new_entry = flow_entry_create(table->dp, table, mod);
-    *match_kept = true;
-    *insts_kept = true;
+    error = flow_entry_create(table->dp, table, mod, &new_entry);
+    if (error) {
+        return error;
+    }
+    table->stats->active_count++;
 
     list_insert(&entry->match_node, &new_entry->match_node);
     add_to_timeout_lists(table, new_entry);
+    flow_table_entry_added(table, new_entry);
 
     return 0;
 }
@@ -147,14 +156,18 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
 /* Handles flow mod messages with MODIFY command. 
     If the flow doesn't exists don't do nothing*/
 static ofl_err
-flow_table_modify(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool strict, bool *insts_kept) {
+flow_table_modify(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool strict) {
     struct flow_entry *entry;
 
     LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
         if (flow_entry_matches(entry, mod, strict, true/*check_cookie*/)) {
-            flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
+            /* Copying only fails on the instructions themselves, so either
+             * the first entry fails, or none does. */
+            ofl_err error = flow_entry_replace_instructions(entry, mod->instructions_num, mod->instructions);
+            if (error) {
+                return error;
+            }
 	    flow_entry_modify_stats(entry, mod);
-            *insts_kept = true;
         }
     }
 
@@ -179,17 +192,17 @@ flow_table_delete(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool s
 
 
 ofl_err
-flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool *match_kept, bool *insts_kept) {
+flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod) {
     switch (mod->command) {
         case (OFPFC_ADD): {
             bool overlap = ((mod->flags & OFPFF_CHECK_OVERLAP) != 0);
-            return flow_table_add(table, mod, overlap, match_kept, insts_kept);
+            return flow_table_add(table, mod, overlap);
         }
         case (OFPFC_MODIFY): {
-            return flow_table_modify(table, mod, false, insts_kept);
+            return flow_table_modify(table, mod, false);
         }
         case (OFPFC_MODIFY_STRICT): {
-            return flow_table_modify(table, mod, true, insts_kept);
+            return flow_table_modify(table, mod, true);
         }
         case (OFPFC_DELETE): {
             return flow_table_delete(table, mod, false);
@@ -204,12 +217,43 @@ flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool
 }
 
 
+/* Accounts a packet matching the entry. */
+static struct flow_entry *
+flow_table_hit(struct flow_table *table, struct flow_entry *entry, struct packet *pkt) {
+    if (!entry->no_byt_count)
+        entry->stats->byte_count += pkt->buffer->size;
+    if (!entry->no_pkt_count)
+        entry->stats->packet_count++;
+    entry->last_used = time_msec();
+
+    table->stats->matched_count++;
+
+    return entry;
+}
+
 struct flow_entry *
 flow_table_lookup(struct flow_table *table, struct packet *pkt) {
     struct flow_entry *entry;
 
     table->stats->lookup_count++;
 
+    if ((table->classifier == FLOW_TABLE_CLS_AUTO || table->classifier == FLOW_TABLE_CLS_LPM)
+        && flow_cls_lpm_ready(table->lpm)) {
+        entry = flow_cls_lpm_lookup(table->lpm, pkt);
+        return entry == NULL ? NULL : flow_table_hit(table, entry, pkt);
+    }
+    /* While a tree is rebuilt, the table is looked up as if it had none. */
+    if ((table->classifier == FLOW_TABLE_CLS_AUTO || table->classifier == FLOW_TABLE_CLS_TREE)
+        && flow_cls_tree_ready(table->tree, table->classifier == FLOW_TABLE_CLS_TREE)) {
+        entry = flow_cls_tree_lookup(table->tree, pkt);
+        return entry == NULL ? NULL : flow_table_hit(table, entry, pkt);
+    }
+    if ((table->classifier == FLOW_TABLE_CLS_AUTO || table->classifier == FLOW_TABLE_CLS_LINEAR)
+        && flow_cls_linear_ready(table->linear, table->classifier == FLOW_TABLE_CLS_LINEAR)) {
+        entry = flow_cls_linear_lookup(table->linear, pkt);
+        return entry == NULL ? NULL : flow_table_hit(table, entry, pkt);
+    }
+
     LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
         struct ofl_match_header *m;
 
@@ -220,19 +264,9 @@ flow_table_lookup(struct flow_table *table, struct packet *pkt) {
             case (OFPMT_OXM): {
                if (packet_handle_std_match(pkt->handle_std,
                                             (struct ofl_match *)m)) {
-                    if (!entry->no_byt_count)                                            
-                        entry->stats->byte_count += pkt->buffer->size;
-                    if (!entry->no_pkt_count)
-                        entry->stats->packet_count++;
-                    entry->last_used = time_msec();
-
-                    table->stats->matched_count++;
-
-                    return entry;
+                    return flow_table_hit(table, entry, pkt);
                 }
                 break;
-
-                break;
             }
             default: {
                 VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to process flow entry with unknown match type (%u).", m->type);
@@ -243,6 +277,32 @@ flow_table_lookup(struct flow_table *table, struct packet *pkt) {
     return NULL;
 }
 
+void
+flow_table_entry_added(struct flow_table *table, struct flow_entry *entry) {
+    flow_cls_lpm_insert(table->lpm, entry);
+    flow_cls_linear_invalidate(table->linear);
+    flow_cls_tree_invalidate(table->tree);
+}
+
+void
+flow_table_entry_removed(struct flow_table *table, struct flow_entry *entry) {
+    flow_cls_lpm_remove(table->lpm, entry);
+    flow_cls_linear_invalidate(table->linear);
+    flow_cls_tree_invalidate(table->tree);
+}
+
+void
+flow_table_run(struct flow_table *table) {
+    flow_cls_lpm_run(table->lpm);
+    if (table->classifier == FLOW_TABLE_CLS_AUTO) {
+        flow_cls_tree_run(table->tree);
+    }
+}
+
+void
+flow_table_set_classifier(struct flow_table *table, enum flow_table_classifier classifier) {
+    table->classifier = classifier;
+}
 
 
 void
@@ -402,6 +462,11 @@ flow_table_create(struct datapath *dp, uint8_t table_id) {
     list_init(&table->hard_entries);
     list_init(&table->idle_entries);
 
+    table->classifier = FLOW_TABLE_CLS_AUTO;
+    table->linear = flow_cls_linear_create(table);
+    table->tree = flow_cls_tree_create(table);
+    table->lpm = flow_cls_lpm_create(table);
+
     return table;
 }
 
@@ -412,6 +477,9 @@ flow_table_destroy(struct flow_table *table) {
     LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, match_node, &table->match_entries) {
         flow_entry_destroy(entry);
     }
+    flow_cls_linear_destroy(table->linear);
+    flow_cls_tree_destroy(table->tree);
+    flow_cls_lpm_destroy(table->lpm);
     free(table->features);
     free(table->stats);
     free(table);
@@ -29,10 +29,23 @@
 
 /****************************************************************************
  * Implementation of a flow table. The current implementation stores flow
- * entries in priority and then insertion order.
+ * entries in priority and then insertion order. Tables of moderate size are
+ * also compiled for the linear classifier, and large tables get a decision
+ * tree, both of which look them up faster. Routing tables, matching only on
+ * destination prefixes, are indexed for longest-prefix match.
  ****************************************************************************/
 
 
+/* How a table finds the entry a packet matches. */
+enum flow_table_classifier {
+    FLOW_TABLE_CLS_AUTO,      /* picked from the size and masks of the table */
+    FLOW_TABLE_CLS_LIST,      /* walk the list of entries */
+    FLOW_TABLE_CLS_LINEAR,    /* scan the rules compiled by flow_cls_linear */
+    FLOW_TABLE_CLS_TREE,      /* descend the decision tree of flow_cls_tree */
+    FLOW_TABLE_CLS_LPM        /* use the prefix index of flow_cls_lpm if the
+                                 table has the shape for it, else the list */
+};
+
 struct flow_table {
     struct datapath           *dp;
     bool                       disabled;      /* Don't use that table. */
@@ -44,6 +57,10 @@ struct flow_table {
                                                 ordered by their timeout times. */
     struct list               idle_entries;   /* unordered list of entries with
                                                 idle timeout. */
+    enum flow_table_classifier classifier;
+    struct flow_cls_linear    *linear;        /* compiled copy of match_entries. */
+    struct flow_cls_tree      *tree;          /* decision tree over match_entries. */
+    struct flow_cls_lpm       *lpm;           /* prefix index of routing tables. */
 };
 
 extern uint32_t oxm_ids[];
@@ -53,14 +70,33 @@ extern uint32_t wildcarded[];
 extern struct ofl_instruction_header instructions[];
 
 extern struct ofl_action_header actions[];
-/* Handles a flow mod message. */
+/* Handles a flow mod message. Entries keep copies of its match and
+ * instructions, so the message remains owned by the caller. */
 ofl_err
-flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool *match_kept, bool *insts_kept);
+flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod);
 
 /* Finds the flow entry with the highest priority, which matches the packet. */
 struct flow_entry *
 flow_table_lookup(struct flow_table *table, struct packet *pkt);
 
+/* Tells the classifiers of the table that 'entry' was added to it. */
+void
+flow_table_entry_added(struct flow_table *table, struct flow_entry *entry);
+
+/* Tells the classifiers of the table that 'entry' is being removed from it.
+ * The entry must still be valid. */
+void
+flow_table_entry_removed(struct flow_table *table, struct flow_entry *entry);
+
+/* Selects how the table looks up its entries. */
+void
+flow_table_set_classifier(struct flow_table *table, enum flow_table_classifier classifier);
+
+/* Performs deferred work of the table, such as rebuilding its decision tree
+ * once flow mods have settled. */
+void
+flow_table_run(struct flow_table *table);
+
 /* Orders the flow table to check the timeout its flows. */
 void
 flow_table_timeout(struct flow_table *table);
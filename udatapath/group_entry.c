@@ -36,28 +36,36 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 struct group_table;
 struct datapath;
 
-/* Node in the list of references to flows, which reference the group entry. */
-struct flow_ref_entry {
-    struct list node;
-    struct flow_entry *entry;
-};
-
-/* Private data for select groups; for implementing weighted round-robin. */
+/* Private data for select groups; for implementing weighted round-robin
+ * over the live buckets. */
 struct group_entry_wrr_data {
-    uint16_t max_weight;  /* maximum weight of the buckets. */
-    uint16_t gcd_weight;  /* g.c.d. of bucket weights. */
+    uint16_t max_weight;  /* maximum weight of the live buckets. */
+    uint16_t gcd_weight;  /* g.c.d. of live bucket weights. */
     uint16_t curr_weight; /* current weight in w.r.r. algorithm. */
-    size_t   curr_bucket; /* bucket executed last time. */
+    size_t   curr_bucket; /* index in entry->live executed last time. */
+};
+
+/* Private data for all groups; how each bucket is executed. Buckets that
+ * only output the packet are "shared": they send the packet the group got,
+ * without a copy of their own. */
+struct group_entry_all_data {
+    bool     shared;   /* true if the bucket does not modify the packet. */
+    uint32_t port;     /* output port of a shared bucket, or OFPP_ANY. */
+    uint32_t queue;    /* its output queue. */
+    uint16_t max_len;  /* its max_len. */
 };
 
 static uint16_t
 gcd(uint16_t a, uint16_t b);
 
 static bool
-bucket_is_alive(struct ofl_bucket *bucket, struct datapath *dp);
+bucket_is_alive(struct ofl_bucket *bucket, struct datapath *dp, bool watch_required);
+
+static void
+init_select_group(struct group_entry *entry);
 
 static void
-init_select_group(struct group_entry *entry, struct ofl_msg_group_mod *mod);
+init_all_group(struct group_entry *entry);
 
 static size_t
 select_from_select_group(struct group_entry *entry);
@@ -95,14 +103,22 @@ group_entry_create(struct datapath *dp, struct group_table *table, struct ofl_ms
         entry->stats->counters[i]->byte_count = 0;
     }
     switch (mod->type) {
+        case (OFPGT_ALL): {
+            init_all_group(entry);
+            break;
+        }
         case (OFPGT_SELECT): {
-            init_select_group(entry, mod);
+            entry->data = xmalloc(sizeof(struct group_entry_wrr_data));
             break;
         }
         default: {
             entry->data = NULL;
         }
     }
+    entry->live = xmalloc(sizeof(size_t) * MAX(entry->desc->buckets_num, 1));
+    entry->live_num = 0;
+    group_entry_update_live(entry);
+
     list_init(&entry->flow_refs);
     return entry;
 }
@@ -110,32 +126,67 @@ group_entry_create(struct datapath *dp, struct group_table *table, struct ofl_ms
 
 void
 group_entry_destroy(struct group_entry *entry) {
-    struct flow_ref_entry *ref, *next;
-
-    // remove all referencing flows
-    LIST_FOR_EACH_SAFE(ref, next, struct flow_ref_entry, node, &entry->flow_refs) {
+    // remove all referencing flows, in a single pass: each reference is
+    // unlinked first, so the flow does not look for the group being destroyed
+    while (!list_is_empty(&entry->flow_refs)) {
+        struct flow_ref *ref = CONTAINER_OF(list_pop_front(&entry->flow_refs),
+                                            struct flow_ref, target_node);
+        list_init(&ref->target_node);
         flow_entry_remove(ref->entry, OFPRR_GROUP_DELETE);
-        // Note: the flow_ref_entryf will be destroyed after a chain of calls in flow_entry_remove
+        // Note: the flow_ref will be destroyed after a chain of calls in flow_entry_remove
         // no point in decreasing stats counter, as the group is destroyed anyway
-
     }
 
     ofl_structs_free_group_desc_stats(entry->desc, entry->dp->exp);
     ofl_structs_free_group_stats(entry->stats);
     free(entry->data);
+    free(entry->live);
     free(entry);
 }
 
-/* Executes a group entry of type ALL. */
+/* Executes a group entry of type ALL, bucket by bucket in order. Shared
+ * buckets output the packet the group got, which stays unmodified: the other
+ * buckets each get a copy, except for the last bucket of the group, which
+ * takes the packet itself. */
 static void
 execute_all(struct group_entry *entry, struct packet *pkt) {
+    struct group_entry_all_data *data = (struct group_entry_all_data *)entry->data;
+    bool consumed = false;
     size_t i;
 
-    /* TODO Zoltan: Currently packets are always cloned. However it should
-     * be possible to see if cloning is necessary, or not, based on bucket actions. */
     for (i=0; i<entry->desc->buckets_num; i++) {
         struct ofl_bucket *bucket = entry->desc->buckets[i];
-        struct packet *p = packet_clone(pkt);
+        struct packet *p;
+
+        if (data[i].shared) {
+            if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+                char *b = ofl_structs_bucket_to_string(bucket, entry->dp->exp);
+                VLOG_DBG_RL(LOG_MODULE, &rl, "Executing shared bucket: %s.", b);
+                free(b);
+            }
+
+            entry->stats->byte_count += pkt->buffer->size;
+            entry->stats->packet_count++;
+            entry->stats->counters[i]->byte_count += pkt->buffer->size;
+            entry->stats->counters[i]->packet_count++;
+
+            if (data[i].port != OFPP_ANY) {
+                dp_actions_output_port(pkt, data[i].port, data[i].queue, data[i].max_len, 0xffffffffffffffff);
+            }
+            continue;
+        }
+
+        /* A packet kept in a buffer must stay as it is. */
+        if (i == entry->desc->buckets_num - 1 && pkt->buffer_id == NO_BUFFER) {
+            p = pkt;
+            p->out_group        = OFPG_ANY;
+            p->out_port         = OFPP_ANY;
+            p->out_port_max_len = 0;
+            p->out_queue        = 0;
+            consumed = true;
+        } else {
+            p = packet_clone(pkt);
+        }
 
         if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
             char *b = ofl_structs_bucket_to_string(bucket, entry->dp->exp);
@@ -143,7 +194,7 @@ execute_all(struct group_entry *entry, struct packet *pkt) {
             free(b);
         }
 
-        action_set_write_actions(p->action_set, bucket->actions_num, bucket->actions);
+        action_set_write_actions(&p->action_set, bucket->actions_num, bucket->actions);
 
         entry->stats->byte_count += p->buffer->size;
         entry->stats->packet_count++;
@@ -153,10 +204,12 @@ execute_all(struct group_entry *entry, struct packet *pkt) {
         /* Cookie field is set 0xffffffffffffffff
            because we cannot associate to any
            particular flow */
-        action_set_execute(p->action_set, p, 0xffffffffffffffff);
+        action_set_execute(&p->action_set, p, 0xffffffffffffffff);
         /* Clone will be destroyed above. Jean II */
     }
-    packet_destroy(pkt);
+    if (!consumed) {
+        packet_destroy(pkt);
+    }
 }
 
 /* Executes a group entry of type SELECT. */
@@ -173,7 +226,7 @@ execute_select(struct group_entry *entry, struct packet *pkt) {
             free(b);
         }
 
-        action_set_write_actions(pkt->action_set, bucket->actions_num, bucket->actions);
+        action_set_write_actions(&pkt->action_set, bucket->actions_num, bucket->actions);
 
         entry->stats->byte_count += pkt->buffer->size;
         entry->stats->packet_count++;
@@ -182,7 +235,7 @@ execute_select(struct group_entry *entry, struct packet *pkt) {
         /* Cookie field is set 0xffffffffffffffff
            because we cannot associate to any
            particular flow */
-        action_set_execute(pkt->action_set, pkt, 0xffffffffffffffff);
+        action_set_execute(&pkt->action_set, pkt, 0xffffffffffffffff);
     } else {
         VLOG_DBG_RL(LOG_MODULE, &rl, "No bucket in group.");
         packet_destroy(pkt);
@@ -202,7 +255,7 @@ execute_indirect(struct group_entry *entry, struct packet *pkt) {
             free(b);
         }
 
-        action_set_write_actions(pkt->action_set, bucket->actions_num, bucket->actions);
+        action_set_write_actions(&pkt->action_set, bucket->actions_num, bucket->actions);
 
         entry->stats->byte_count += pkt->buffer->size;
         entry->stats->packet_count++;
@@ -211,7 +264,7 @@ execute_indirect(struct group_entry *entry, struct packet *pkt) {
         /* Cookie field is set 0xffffffffffffffff
            because we cannot associate to any
            particular flow */
-        action_set_execute(pkt->action_set, pkt, 0xffffffffffffffff);
+        action_set_execute(&pkt->action_set, pkt, 0xffffffffffffffff);
     } else {
         VLOG_DBG_RL(LOG_MODULE, &rl, "No bucket in group.");
         packet_destroy(pkt);
@@ -232,7 +285,7 @@ execute_ff(struct group_entry *entry, struct packet *pkt) {
             free(b);
         }
 
-        action_set_write_actions(pkt->action_set, bucket->actions_num, bucket->actions);
+        action_set_write_actions(&pkt->action_set, bucket->actions_num, bucket->actions);
 
         entry->stats->byte_count += pkt->buffer->size;
         entry->stats->packet_count++;
@@ -241,7 +294,7 @@ execute_ff(struct group_entry *entry, struct packet *pkt) {
         /* Cookie field is set 0xffffffffffffffff
            because we cannot associate to any
            particular flow */
-        action_set_execute(pkt->action_set, pkt, 0xffffffffffffffff);
+        action_set_execute(&pkt->action_set, pkt, 0xffffffffffffffff);
     } else {
         VLOG_DBG_RL(LOG_MODULE, &rl, "No bucket in group.");
         packet_destroy(pkt);
@@ -299,19 +352,6 @@ group_entry_update(struct group_entry *entry){
     entry->stats->duration_nsec = ((time_msec() - entry->created) % 1000) * 1000000;
 }
 
-/* Returns true if the group entry has  reference to the flow entry. */
-static bool
-has_flow_ref(struct group_entry *entry, struct flow_entry *fe) {
-    struct flow_ref_entry *f;
-
-    LIST_FOR_EACH(f, struct flow_ref_entry, node, &entry->flow_refs) {
-        if (f->entry == fe) {
-            return true;
-        }
-    }
-    return false;
-}
-
 bool
 group_entry_has_out_group(struct group_entry *entry, uint32_t group_id) {
     size_t i;
@@ -326,85 +366,149 @@ group_entry_has_out_group(struct group_entry *entry, uint32_t group_id) {
 }
 
 void
-group_entry_add_flow_ref(struct group_entry *entry, struct flow_entry *fe) {
-    if (!(has_flow_ref(entry, fe))) {
-        struct flow_ref_entry *f = xmalloc(sizeof(struct flow_ref_entry));
-        f->entry = fe;
-        list_insert(&entry->flow_refs, &f->node);
-        entry->stats->ref_count++;
-    }
+group_entry_add_flow_ref(struct group_entry *entry, struct flow_ref *ref) {
+    list_push_back(&entry->flow_refs, &ref->target_node);
+    entry->stats->ref_count++;
 }
 
 void
-group_entry_del_flow_ref(struct group_entry *entry, struct flow_entry *fe) {
-    struct flow_ref_entry *f, *next;
-
-    LIST_FOR_EACH_SAFE(f, next, struct flow_ref_entry, node, &entry->flow_refs) {
-        if (f->entry == fe) {
-            list_remove(&f->node);
-            free(f);
-            entry->stats->ref_count--;
-        }
-    }
+group_entry_del_flow_ref(struct group_entry *entry, struct flow_ref *ref) {
+    list_remove(&ref->target_node);
+    list_init(&ref->target_node);
+    entry->stats->ref_count--;
 }
 
 
-/* Returns true if the bucket is alive. */
+/* Returns true if the bucket is alive. Buckets not watching any port are
+ * alive unless 'watch_required' is set. */
 static bool
-bucket_is_alive(struct ofl_bucket *bucket, struct datapath *dp) {
-    struct sw_port *p =  dp_ports_lookup(dp, bucket->watch_port);
+bucket_is_alive(struct ofl_bucket *bucket, struct datapath *dp, bool watch_required) {
+    struct sw_port *p;
 
-    if(bucket->watch_port == OFPP_ANY || (p->conf->config & OFPPC_PORT_DOWN) ||
-        (p->conf->state & OFPPS_LINK_DOWN)){
+    if (bucket->watch_port == OFPP_ANY) {
+        return !watch_required;
+    }
+    p = dp_ports_lookup(dp, bucket->watch_port);
+    if (p == NULL || (p->conf->config & OFPPC_PORT_DOWN) ||
+        (p->conf->state & OFPPS_LINK_DOWN)) {
         return false;
     }
-    // TODO Zoltan: Implement link up/down detection
     return true;
 }
 
+bool
+group_entry_watches_port(struct group_entry *entry, uint32_t port_no) {
+    size_t i;
 
-/* Initializes the private w.r.r. data for a select group entry. */
+    for (i=0; i<entry->desc->buckets_num; i++) {
+        if (entry->desc->buckets[i]->watch_port == port_no) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+group_entry_update_live(struct group_entry *entry) {
+    /* Fast failover buckets must watch a port or group; group liveness is
+     * not tracked, so buckets watching only a group are never used. */
+    bool watch_required = (entry->desc->type == OFPGT_FF);
+    size_t i;
+
+    entry->live_num = 0;
+    for (i=0; i<entry->desc->buckets_num; i++) {
+        if (bucket_is_alive(entry->desc->buckets[i], entry->dp, watch_required)) {
+            entry->live[entry->live_num++] = i;
+        }
+    }
+    if (entry->desc->type == OFPGT_SELECT) {
+        init_select_group(entry);
+    }
+}
+
+
+/* Initializes the private data for an all group entry. A bucket is shared
+ * if it only sets the queue and outputs to a port; output to the controller
+ * may keep the packet in a buffer, so it needs a copy. */
 static void
-init_select_group(struct group_entry *entry, struct ofl_msg_group_mod *mod) {
+init_all_group(struct group_entry *entry) {
+    struct group_entry_all_data *data;
+    size_t i, j;
+
+    data = xmalloc(sizeof(struct group_entry_all_data) * MAX(entry->desc->buckets_num, 1));
+    entry->data = data;
+
+    for (i=0; i<entry->desc->buckets_num; i++) {
+        struct ofl_bucket *bucket = entry->desc->buckets[i];
+
+        data[i].shared  = true;
+        data[i].port    = OFPP_ANY;
+        data[i].queue   = 0;
+        data[i].max_len = 0;
+
+        /* As in the action set, the last output and queue win. */
+        for (j=0; j<bucket->actions_num && data[i].shared; j++) {
+            struct ofl_action_header *act = bucket->actions[j];
+
+            if (act->type == OFPAT_OUTPUT) {
+                struct ofl_action_output *ao = (struct ofl_action_output *)act;
+
+                data[i].shared  = (ao->port != OFPP_CONTROLLER);
+                data[i].port    = ao->port;
+                data[i].max_len = ao->max_len;
+            } else if (act->type == OFPAT_SET_QUEUE) {
+                data[i].queue = ((struct ofl_action_set_queue *)act)->queue_id;
+            } else {
+                data[i].shared = false;
+            }
+        }
+    }
+}
+
+/* Initializes the private w.r.r. data for a select group entry from its live
+ * buckets. */
+static void
+init_select_group(struct group_entry *entry) {
     struct group_entry_wrr_data *data;
     size_t i;
 
-    entry->data = xmalloc(sizeof(struct group_entry_wrr_data));
     data = (struct group_entry_wrr_data *)entry->data;
 
     data->curr_weight = 0;
     data->curr_bucket = -1;
 
-    if (mod->buckets_num == 0) {
+    if (entry->live_num == 0) {
         data->gcd_weight = 0;
         data->max_weight = 0;
     } else {
-        data->gcd_weight = entry->desc->buckets[0]->weight;
-        data->max_weight = entry->desc->buckets[0]->weight;
+        data->gcd_weight = entry->desc->buckets[entry->live[0]]->weight;
+        data->max_weight = entry->desc->buckets[entry->live[0]]->weight;
+
+        for (i=1; i< entry->live_num; i++) {
+            uint16_t weight = entry->desc->buckets[entry->live[i]]->weight;
 
-        for (i=1; i< entry->desc->buckets_num; i++) {
-            data->gcd_weight = gcd(data->gcd_weight, entry->desc->buckets[i]->weight);
-            data->max_weight = MAX(data->max_weight, entry->desc->buckets[i]->weight);
+            data->gcd_weight = gcd(data->gcd_weight, weight);
+            data->max_weight = MAX(data->max_weight, weight);
         }
 
     }
 }
 
-/* Selects a bucket from a select group, based on the w.r.r. algorithm. */
+/* Selects a live bucket from a select group, based on the w.r.r. algorithm. */
 static size_t
 select_from_select_group(struct group_entry *entry) {
     struct group_entry_wrr_data *data;
     size_t guard;
 
-    if (entry->desc->buckets_num == 0) {
+    if (entry->live_num == 0) {
         return -1;
     }
 
     data = (struct group_entry_wrr_data *)entry->data;
     guard = 0;
 
-    while (guard < entry->desc->buckets_num) {
-        data->curr_bucket = (data->curr_bucket + 1) % entry->desc->buckets_num;
+    while (guard < entry->live_num) {
+        data->curr_bucket = (data->curr_bucket + 1) % entry->live_num;
 
         if (data->curr_bucket == 0) {
             if (data->curr_weight <= data->gcd_weight) {
@@ -414,8 +518,8 @@ select_from_select_group(struct group_entry *entry) {
             }
         }
 
-        if (entry->desc->buckets[data->curr_bucket]->weight >= data->curr_weight) {
-            return data->curr_bucket;
+        if (entry->desc->buckets[entry->live[data->curr_bucket]]->weight >= data->curr_weight) {
+            return entry->live[data->curr_bucket];
         }
         guard++;
     }
@@ -426,14 +530,7 @@ select_from_select_group(struct group_entry *entry) {
 /* Selects the first live bucket from the failfast group. */
 static size_t
 select_from_ff_group(struct group_entry *entry) {
-    size_t i;
-
-    for (i=0; i<entry->desc->buckets_num; i++) {
-        if (bucket_is_alive(entry->desc->buckets[i], entry->dp)) {
-            return i;
-        }
-    }
-    return -1;
+    return entry->live_num > 0 ? entry->live[0] : (size_t)-1;
 }
 
 /* Returns the g.c.d. of the two numbers. */
@@ -34,6 +34,7 @@
 struct packet;
 struct datapath;
 struct flow_entry;
+struct flow_ref;
 
 struct group_entry {
     struct hmap_node             node;
@@ -45,6 +46,9 @@ struct group_entry {
     uint64_t created;
     void                        *data;     /* private data for group implementation. */
 
+    size_t                      *live;      /* indices of the live buckets, in order. */
+    size_t                       live_num;
+
     struct list                  flow_refs; /* references to flows referencing the group. */
 };
 
@@ -68,17 +72,27 @@ group_entry_destroy(struct group_entry *entry);
 bool
 group_entry_has_out_group(struct group_entry *entry, uint32_t group_id);
 
-/* Adds a flow reference to the group entry. */
+/* Links a reference of a flow to the group entry. The flow must not have
+ * another one to this group. */
 void
-group_entry_add_flow_ref(struct group_entry *entry, struct flow_entry *fe);
+group_entry_add_flow_ref(struct group_entry *entry, struct flow_ref *ref);
 
-/* Removes a flow reference from the group entry. */
+/* Unlinks a flow reference from the group entry. */
 void
-group_entry_del_flow_ref(struct group_entry *entry, struct flow_entry *fe);
+group_entry_del_flow_ref(struct group_entry *entry, struct flow_ref *ref);
 
 /* Updates the time fields of the group entry statistics. Used before generating
  * group statistics messages. */
 void
 group_entry_update(struct group_entry *entry);
 
+/* Returns true if a bucket of the group entry watches the given port. */
+bool
+group_entry_watches_port(struct group_entry *entry, uint32_t port_no);
+
+/* Recomputes the set of live buckets of the group entry. Must be called when
+ * the liveness of a watched port changes. */
+void
+group_entry_update_live(struct group_entry *entry);
+
 #endif /* GROUP_entry_H */
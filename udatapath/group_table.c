@@ -21,6 +21,7 @@
 #include "datapath.h"
 #include "dp_actions.h"
 #include "dp_capabilities.h"
+#include "dp_latency.h"
 #include "hmap.h"
 #include "list.h"
 #include "packet.h"
@@ -114,6 +115,7 @@ group_table_modify(struct group_table *table, struct ofl_msg_group_mod *mod) {
     /* keep flow references from old group entry */
     list_replace(&new_entry->flow_refs, &entry->flow_refs);
     list_init(&entry->flow_refs);
+    new_entry->stats->ref_count = entry->stats->ref_count;
 
     group_entry_destroy(entry);
 
@@ -299,6 +301,7 @@ group_table_handle_stats_request_group_features(struct group_table *table,
 void
 group_table_execute(struct group_table *table, struct packet *packet, uint32_t group_id) {
     struct group_entry *entry;
+    uint64_t start;
 
     entry = group_table_find(table, group_id);
 
@@ -307,7 +310,20 @@ group_table_execute(struct group_table *table, struct packet *packet, uint32_t g
         return;
     }
 
+   start = dp_latency_start(table->dp->latency);
    group_entry_execute(entry, packet);
+   dp_latency_stop(table->dp->latency, OFP_EXT_LATENCY_GROUP, start);
+}
+
+void
+group_table_port_live_changed(struct group_table *table, uint32_t port_no) {
+    struct group_entry *entry;
+
+    HMAP_FOR_EACH(entry, struct group_entry, node, &table->entries) {
+        if (group_entry_watches_port(entry, port_no)) {
+            group_entry_update_live(entry);
+        }
+    }
 }
 
 struct group_table *
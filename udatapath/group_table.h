@@ -76,6 +76,11 @@ group_table_find(struct group_table *table, uint32_t group_id);
 void
 group_table_execute(struct group_table *table, struct packet *packet, uint32_t group_id);
 
+/* Recomputes the live buckets of the groups watching the given port. Called
+ * when the port appears, or its liveness changes. */
+void
+group_table_port_live_changed(struct group_table *table, uint32_t port_no);
+
 /* Creates a group table. */
 struct group_table *
 group_table_create(struct datapath *dp);
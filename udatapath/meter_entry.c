@@ -39,11 +39,6 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 struct meter_table;
 struct datapath;
 
-/* Node in the list of references to flows, which reference the meter entry. */
-struct flow_ref_entry {
-    struct list node;
-    struct flow_entry *entry;
-};
 
 
 
@@ -133,12 +128,14 @@ meter_entry_update(struct meter_entry *entry) {
 
 void
 meter_entry_destroy(struct meter_entry *entry) {
-    struct flow_ref_entry *ref, *next;
-
-    // remove all referencing flows
-    LIST_FOR_EACH_SAFE(ref, next, struct flow_ref_entry, node, &entry->flow_refs) {
+    // remove all referencing flows, in a single pass: each reference is
+    // unlinked first, so the flow does not look for the meter being destroyed
+    while (!list_is_empty(&entry->flow_refs)) {
+        struct flow_ref *ref = CONTAINER_OF(list_pop_front(&entry->flow_refs),
+                                            struct flow_ref, target_node);
+        list_init(&ref->target_node);
         flow_entry_remove(ref->entry, OFPRR_METER_DELETE);// METER_DELETE ???????
-        // Note: the flow_ref_entryf will be destroyed after a chain of calls in flow_entry_remove
+        // Note: the flow_ref will be destroyed after a chain of calls in flow_entry_remove
     }
 
     OFL_UTILS_FREE_ARR_FUN(entry->config->bands, entry->config->meter_bands_num, ofl_structs_free_meter_bands);
@@ -263,41 +260,17 @@ meter_entry_apply(struct meter_entry *entry, struct packet **pkt){
 
 }
 
-/* Returns true if the meter entry has  reference to the flow entry. */
-static bool
-has_flow_ref(struct meter_entry *entry, struct flow_entry *fe) {
-    struct flow_ref_entry *f;
-
-    LIST_FOR_EACH(f, struct flow_ref_entry, node, &entry->flow_refs) {
-        if (f->entry == fe) {
-            return true;
-        }
-    }
-    return false;
-}
-
-
 void
-meter_entry_add_flow_ref(struct meter_entry *entry, struct flow_entry *fe) {
-    if (!(has_flow_ref(entry, fe))) {
-        struct flow_ref_entry *f = xmalloc(sizeof(struct flow_ref_entry));
-        f->entry = fe;
-        list_insert(&entry->flow_refs, &f->node);
-        entry->stats->flow_count++;
-    }
+meter_entry_add_flow_ref(struct meter_entry *entry, struct flow_ref *ref) {
+    list_push_back(&entry->flow_refs, &ref->target_node);
+    entry->stats->flow_count++;
 }
 
 void
-meter_entry_del_flow_ref(struct meter_entry *entry, struct flow_entry *fe) {
-    struct flow_ref_entry *f, *next;
-
-    LIST_FOR_EACH_SAFE(f, next, struct flow_ref_entry, node, &entry->flow_refs) {
-        if (f->entry == fe) {
-            list_remove(&f->node);
-            free(f);
-            entry->stats->flow_count--;
-        }
-    }
+meter_entry_del_flow_ref(struct meter_entry *entry, struct flow_ref *ref) {
+    list_remove(&ref->target_node);
+    list_init(&ref->target_node);
+    entry->stats->flow_count--;
 }
 
 /* Add tokens to the bucket based on elapsed time. */
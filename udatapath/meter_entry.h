@@ -37,6 +37,7 @@
 struct packet;
 struct datapath;
 struct flow_entry;
+struct flow_ref;
 struct sender;
 
 /* Meter entry */
@@ -72,13 +73,14 @@ void
 meter_entry_apply(struct meter_entry *entry, struct packet **pkt);
 
 
-/* Adds a flow reference to the meter entry. */
+/* Links a reference of a flow to the meter entry. The flow must not have
+ * another one to this meter. */
 void
-meter_entry_add_flow_ref(struct meter_entry *entry, struct flow_entry *fe);
+meter_entry_add_flow_ref(struct meter_entry *entry, struct flow_ref *ref);
 
-/* Removes a flow reference from the meter entry. */
+/* Unlinks a flow reference from the meter entry. */
 void
-meter_entry_del_flow_ref(struct meter_entry *entry, struct flow_entry *fe);
+meter_entry_del_flow_ref(struct meter_entry *entry, struct flow_ref *ref);
 
 void
 refill_bucket(struct meter_entry *entry);
@@ -41,7 +41,7 @@ packet_create(struct datapath *dp, uint32_t in_port,
     pkt->dp         = dp;
     pkt->buffer     = buf;
     pkt->in_port    = in_port;
-    pkt->action_set = action_set_create(dp->exp);
+    action_set_init(&pkt->action_set, dp->exp);
 
     pkt->packet_out       = packet_out;
     pkt->out_group        = OFPG_ANY;
@@ -65,9 +65,9 @@ packet_clone(struct packet *pkt) {
     clone->in_port    = pkt->in_port;
     /* There is no case we need to keep the action-set, but if it's needed
      * we could add a parameter to the function... Jean II
-     * clone->action_set = action_set_clone(pkt->action_set);
+     * clone->action_set = pkt->action_set;
      */
-    clone->action_set = action_set_create(pkt->dp->exp);
+    action_set_init(&clone->action_set, pkt->dp->exp);
 
 
     clone->packet_out       = pkt->packet_out;
@@ -98,7 +98,6 @@ packet_destroy(struct packet *pkt) {
         }
     }
 
-    action_set_destroy(pkt->action_set);
     ofpbuf_delete(pkt->buffer);
     packet_handle_std_destroy(pkt->handle_std);
     free(pkt);
@@ -113,7 +112,7 @@ packet_to_string(struct packet *pkt) {
     fprintf(stream, "pkt{in=\"");
     ofl_port_print(stream, pkt->in_port);
     fprintf(stream, "\", actset=");
-    action_set_print(stream, pkt->action_set);
+    action_set_print(stream, &pkt->action_set);
     fprintf(stream, ", pktout=\"%u\", ogrp=\"", pkt->packet_out);
     ofl_group_print(stream, pkt->out_group);
     fprintf(stream, "\", oprt=\"");
@@ -129,6 +128,112 @@ packet_to_string(struct packet *pkt) {
 }
 
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
+/* Returns the smallest width among 1, 2, 4 and 8 bytes, up to 'max_len', that
+ * holds 'value'. */
+static size_t
+ehddp_field_len(uint64_t value, size_t max_len)
+{
+    size_t len = 1;
+
+    while (len < max_len && (value >> (len * 8)) != 0) {
+        len *= 2;
+    }
+    return len;
+}
+
+static void
+ehddp_put_be(struct ofpbuf *buf, uint64_t value, size_t len)
+{
+    uint8_t *p = ofpbuf_put_uninit(buf, len);
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        p[len - 1 - i] = value >> (i * 8);
+    }
+}
+
+static uint64_t
+ehddp_get_be(const uint8_t *p, size_t len)
+{
+    uint64_t value = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint8_t
+ehddp_element_conf(uint16_t type_device, uint64_t id, uint32_t in_port, uint32_t out_port)
+{
+    size_t type_len = ehddp_field_len(type_device, sizeof(uint16_t));
+    size_t id_len = ehddp_field_len(id, sizeof(uint64_t));
+    size_t port_len = ehddp_field_len(MAX(in_port, out_port), sizeof(uint32_t));
+
+    return ((type_len - 1) << 6) | ((id_len - 1) << 3) | ((port_len - 1) << 1)
+           | EHDDP_CONF_BIDIRECTIONAL;
+}
+
+void
+ehddp_put_element(struct ofpbuf *buf, uint8_t conf, uint16_t type_device, uint64_t id,
+                  uint32_t in_port, uint32_t out_port)
+{
+    ofpbuf_put(buf, &conf, sizeof conf);
+    ehddp_put_be(buf, type_device, EHDDP_CONF_TYPE_LEN(conf));
+    ehddp_put_be(buf, id, EHDDP_CONF_ID_LEN(conf));
+    ehddp_put_be(buf, in_port, EHDDP_CONF_PORT_LEN(conf));
+    ehddp_put_be(buf, out_port, EHDDP_CONF_PORT_LEN(conf));
+}
+
+size_t
+ehddp_get_element(const uint8_t *p, size_t len, struct ehddp_element *element)
+{
+    uint8_t conf;
+    size_t type_len, id_len, port_len;
+
+    if (len < 1 || len < EHDDP_CONF_ELEMENT_LEN(p[0])) {
+        return 0;
+    }
+    conf = *p++;
+    type_len = EHDDP_CONF_TYPE_LEN(conf);
+    id_len = EHDDP_CONF_ID_LEN(conf);
+    port_len = EHDDP_CONF_PORT_LEN(conf);
+
+    element->configuration = conf;
+    element->type_device = ehddp_get_be(p, type_len);
+    p += type_len;
+    element->id = ehddp_get_be(p, id_len);
+    p += id_len;
+    element->in_port = ehddp_get_be(p, port_len);
+    p += port_len;
+    element->out_port = ehddp_get_be(p, port_len);
+    return EHDDP_CONF_ELEMENT_LEN(conf);
+}
+
+const uint8_t *
+ehddp_elements(struct packet *pkt, size_t *len)
+{
+    const struct ehddp_header *ehddp = pkt->handle_std->proto->ehddp;
+    const uint8_t *start = (const uint8_t *)(ehddp + 1);
+    const uint8_t *end = (const uint8_t *)pkt->buffer->data + pkt->buffer->size;
+    size_t used = 0;
+    int i;
+
+    /* Short frames are padded, so the list ends where its last element does,
+     * not at the end of the frame. */
+    for (i = 0; i < ehddp->num_devices && start + used < end; i++) {
+        size_t n = EHDDP_CONF_ELEMENT_LEN(start[used]);
+
+        if (start + used + n > end) {
+            break;
+        }
+        used += n;
+    }
+    *len = used;
+    return start;
+}
+
 struct packet * create_ehddp_reply_packet(struct datapath *dp, uint8_t * mac_dst,
     uint32_t in_port, uint32_t out_port, uint16_t type_device, uint8_t num_devices,
     u_int64_t num_sec, u_int64_t num_ack, u_int32_t time_block)
@@ -145,18 +250,16 @@ struct packet * create_ehddp_reply_packet(struct datapath *dp, uint8_t * mac_dst
     struct packet *pkt = NULL;
     struct ofpbuf *buffer2 = NULL;
     
-    uint8_t opcode = 0x02, flag_and_ersion = 0x01, num_device = num_devices, previous_size_mac = 0x06, configurations = 0b01111111;
-    uint16_t etherType = bigtolittle16(ETH_TYPE_EHDDP), type_devices = htons(type_device);
+    uint8_t opcode = 0x02, flag_and_ersion = 0x01, num_device = num_devices, previous_size_mac = 0x06;
+    uint16_t etherType = bigtolittle16(ETH_TYPE_EHDDP);
     uint8_t device_mac[ETH_ADDR_LEN];
-    uint32_t out_ports = htonl(out_port), in_ports = htonl(in_port); 
-    uint64_t id_sdn = bigtolittle64(dp->id);
+    uint8_t conf = ehddp_element_conf(type_device, dp->id, in_port, out_port);
  
     //int2mac(mac_device_64, device_mac);
     eth_addr_from_uint64(dp->id, device_mac);
-    time_block = time_block;
 
     //Now, create the packet and add the Ethernet header
-    buffer2= ofpbuf_new( sizeof(struct eth_header) + sizeof(struct ehddp_header));
+    buffer2= ofpbuf_new( sizeof(struct eth_header) + sizeof(struct ehddp_header) + EHDDP_CONF_ELEMENT_LEN(conf));
     ofpbuf_put(buffer2, mac_dst, ETH_ADDR_LEN); 
     ofpbuf_put(buffer2, device_mac, ETH_ADDR_LEN);
     ofpbuf_put(buffer2, &etherType, sizeof(uint16_t));
@@ -173,85 +276,68 @@ struct packet * create_ehddp_reply_packet(struct datapath *dp, uint8_t * mac_dst
     ofpbuf_put(buffer2,device_mac, sizeof(uint8_t)*ETH_ADDR_LEN);
     ofpbuf_put(buffer2,&time_block, sizeof(uint32_t));
 
-    ofpbuf_put(buffer2,&configurations, sizeof(uint8_t));
-    ofpbuf_put(buffer2,&type_devices, sizeof(uint16_t));
-    ofpbuf_put(buffer2,&id_sdn, sizeof(uint64_t));
+    //Cada campo del dispositivo ocupa lo justo para su valor
+    ehddp_put_element(buffer2, conf, type_device, dp->id, in_port, out_port);
 
-    ofpbuf_put(buffer2,&in_ports, sizeof(uint32_t));
-    ofpbuf_put(buffer2,&out_ports, sizeof(uint32_t));
-
-    //Creamos la estructura del paquete
+    //Creamos la estructura del paquete; el parser apunta las cabeceras al buffer
     pkt = packet_create(dp, in_port, buffer2, false);
-
-    //Creamos la cabecera ethernet
-    pkt->handle_std->proto->eth = xmalloc(sizeof(struct eth_header));
-    memcpy(pkt->handle_std->proto->eth->eth_dst, mac_dst, ETH_ADDR_LEN);
-    memcpy(pkt->handle_std->proto->eth->eth_src, device_mac, ETH_ADDR_LEN);
-    //Insertamos el eth al reves por tema de little endian
-    pkt->handle_std->proto->eth->eth_type=ETH_TYPE_EHDDP_INV;
-
-    //creamos la cabecera de nuestro protocolo
-    pkt->handle_std->proto->ehddp=xmalloc(sizeof(struct ehddp_header));
-    pkt->handle_std->proto->ehddp->flags = flag_and_ersion;
-    pkt->handle_std->proto->ehddp->opcode = opcode;
-    pkt->handle_std->proto->ehddp->num_devices = num_device;
-    pkt->handle_std->proto->ehddp->previous_size_mac = previous_size_mac;
-    memcpy(&pkt->handle_std->proto->ehddp->nxt_mac, mac_dst, sizeof(uint8_t)*ETH_ADDR_LEN);
-    pkt->handle_std->proto->ehddp->num_sec = num_sec;
-    pkt->handle_std->proto->ehddp->num_ack = num_ack;
-    memcpy(&pkt->handle_std->proto->ehddp->last_mac, device_mac, sizeof(uint8_t)*ETH_ADDR_LEN);
-    memcpy(&pkt->handle_std->proto->ehddp->src_mac, device_mac, sizeof(uint8_t)*ETH_ADDR_LEN);
-    pkt->handle_std->proto->ehddp->time_block = time_block;
-
-    pkt->handle_std->proto->ehddp->configurations[0] = configurations;
-    pkt->handle_std->proto->ehddp->type_devices[0] = type_devices;
-    pkt->handle_std->proto->ehddp->ids[0] = dp->id;
-    pkt->handle_std->proto->ehddp->in_ports[0] = in_ports;
-    pkt->handle_std->proto->ehddp->out_ports[0] = out_ports;
-   
-    //validamos el paquete
-    packet_handle_std_validate(pkt->handle_std);
     return pkt;
 }
 
-uint16_t update_data_msg(struct packet * pkt, uint32_t out_port,  uint8_t * nxt_mac){
-    uint8_t configuration = 0b01111111;
-    uint8_t device_mac [ETH_ADDR_LEN];
-    uint16_t type_device = 0, num_elements=pkt->handle_std->proto->ehddp->num_devices + 1;
-    uint32_t in_port = htonl(pkt->in_port), out_port_update=0;
-    uint64_t id_sdn = bigtolittle64(pkt->dp->id);
+/* Type this switch gives itself in the device lists. */
+static uint16_t
+ehddp_local_type_device(void)
+{
+    if (type_device_general == 1 || type_device_general == 3)
+        return NODO_SDN_CONFIG;
+    return NODO_NO_SDN;
+}
 
-    eth_addr_from_uint64(pkt->dp->id, device_mac);
-  
-    if (num_elements > EHDDP_MAX_ELEMENTS || num_repetido(pkt) > 0 )
-        return num_elements;
+/* Points the frame at its next hop 'nxt_mac' and records the switch 'dp' as
+ * the last one that modified it. */
+static void
+ehddp_set_next_hop(struct datapath *dp, struct eth_header *eth, struct ehddp_header *ehddp,
+                   uint8_t *nxt_mac)
+{
+    //Puerto de entrada sentido SRC->DST
+    if (ehddp->opcode == 2)
+        memcpy(eth->eth_dst, nxt_mac,sizeof(uint8_t)*ETH_ADDR_LEN);
+
+    ehddp->previous_size_mac = 0x06; //estamos en un switch ethernet
+    eth_addr_from_uint64(dp->id, ehddp->last_mac); //decimos que hemos sido nosotros los ultimos en modificar
+    memcpy(ehddp->nxt_mac, nxt_mac,sizeof(uint8_t)*ETH_ADDR_LEN);
+}
+
+uint16_t update_data_msg(struct packet * pkt, uint32_t out_port,  uint8_t * nxt_mac){
+    uint16_t type_device = ehddp_local_type_device(), num_elements=pkt->handle_std->proto->ehddp->num_devices + 1;
+    size_t eth_off, ehddp_off, elements_len;
+    struct ehddp_header *ehddp;
+    struct eth_header *eth;
+    uint8_t conf;
 
     if (out_port > 255)
         out_port = 255;
 
-    out_port_update = htonl(out_port);
+    conf = ehddp_element_conf(type_device, pkt->dp->id, pkt->in_port, out_port);
+    ehddp_elements(pkt, &elements_len);
 
-    if (type_device_general == 1 || type_device_general == 3)
-        type_device = htons(NODO_SDN_CONFIG);
-    else
-        type_device = htons(NODO_NO_SDN);
-
-    //Modificamos El buffer primero y luego mi trabla
-        /*Introducimos el valor del campo en el paquete */
-    ofpbuf_put(pkt->buffer,&configuration, sizeof(uint8_t));
-    ofpbuf_put(pkt->buffer,&type_device, sizeof(uint16_t));
-    ofpbuf_put(pkt->buffer,&id_sdn, sizeof(uint64_t));
-    ofpbuf_put(pkt->buffer,&in_port, sizeof(uint32_t));
-    ofpbuf_put(pkt->buffer,&out_port_update, sizeof(uint32_t));
+    if (num_elements > EHDDP_MAX_DEVICES || num_repetido(pkt) > 0
+        || elements_len + EHDDP_CONF_ELEMENT_LEN(conf) > EHDDP_MAX_ELEMENTS_LEN)
+        return num_elements;
 
-    //Puerto de entrada sentido SRC->DST
-    if (pkt->handle_std->proto->ehddp->opcode == 2)
-        memcpy(&pkt->handle_std->proto->eth->eth_dst, nxt_mac,sizeof(uint8_t)*ETH_ADDR_LEN);
+    //El buffer puede moverse al crecer, asi que guardamos las posiciones
+    eth_off = (uint8_t *)pkt->handle_std->proto->eth - (uint8_t *)pkt->buffer->data;
+    ehddp_off = (uint8_t *)pkt->handle_std->proto->ehddp - (uint8_t *)pkt->buffer->data;
+
+    //Modificamos El buffer primero, quitando el relleno de las tramas cortas
+    pkt->buffer->size = ehddp_off + sizeof(struct ehddp_header) + elements_len;
+    ehddp_put_element(pkt->buffer, conf, type_device, pkt->dp->id, pkt->in_port, out_port);
 
-    pkt->handle_std->proto->ehddp->num_devices = num_elements;
-    pkt->handle_std->proto->ehddp->previous_size_mac = 0x06; //estamos en un switch ethernet
-    memcpy(&pkt->handle_std->proto->ehddp->last_mac, device_mac, sizeof(uint8_t)*ETH_ADDR_LEN); //decimos que hemos sido nosotros los ultimos en modificar
-    memcpy(&pkt->handle_std->proto->ehddp->nxt_mac, nxt_mac,sizeof(uint8_t)*ETH_ADDR_LEN); 
+    eth = (struct eth_header *)((uint8_t *)pkt->buffer->data + eth_off);
+    ehddp = (struct ehddp_header *)((uint8_t *)pkt->buffer->data + ehddp_off);
+
+    ehddp->num_devices = num_elements;
+    ehddp_set_next_hop(pkt->dp, eth, ehddp, nxt_mac);
 
     pkt->packet_out=false;
     pkt->handle_std->valid = false;
@@ -260,14 +346,112 @@ uint16_t update_data_msg(struct packet * pkt, uint32_t out_port,  uint8_t * nxt_
     return 0;
 }
 
-uint16_t num_repetido(struct packet * pkt){
-    int i = 0, repetidos = 0;
+void ehddp_forward_reply(struct packet *pkt, uint8_t *nxt_mac){
+    ehddp_set_next_hop(pkt->dp, pkt->handle_std->proto->eth, pkt->handle_std->proto->ehddp, nxt_mac);
+
+    pkt->packet_out=false;
+    pkt->handle_std->valid = false;
+    packet_handle_std_validate(pkt->handle_std);
+}
+
+struct packet *ehddp_continue_reply(struct packet *pkt, uint32_t out_port, uint8_t *nxt_mac){
+    struct ehddp_header header = *pkt->handle_std->proto->ehddp;
+    uint16_t type_device = ehddp_local_type_device();
+    uint16_t eth_type = bigtolittle16(ETH_TYPE_EHDDP);
+    uint8_t device_mac[ETH_ADDR_LEN];
+    struct ehddp_element tail;
+    const uint8_t *p;
+    struct ofpbuf *buf;
+    size_t len, n;
+
+    //Buscamos el ultimo dispositivo de la lista
+    p = ehddp_elements(pkt, &len);
+    if (len == 0)
+        return NULL;
+    while ((n = ehddp_get_element(p, len, &tail)) != 0 && n < len) {
+        p += n;
+        len -= n;
+    }
+
+    if (out_port > 255)
+        out_port = 255;
+    eth_addr_from_uint64(pkt->dp->id, device_mac);
+
+    /* The continuation starts again from the last device of the full frame,
+     * so that the controller can join both: its null input port keeps the
+     * controller from inferring a link into it, and its output port leads to
+     * the input port of this switch, which comes next. */
+    buf = ofpbuf_new(sizeof(struct eth_header) + sizeof(struct ehddp_header) + 2 * EHDDP_ELEMENT_MAX_LEN);
+    ofpbuf_put(buf, nxt_mac, ETH_ADDR_LEN);
+    ofpbuf_put(buf, device_mac, ETH_ADDR_LEN);
+    ofpbuf_put(buf, &eth_type, sizeof(uint16_t));
+
+    header.flags &= ~EHDDP_FLAG_MORE;
+    header.num_devices = 2;
+    ofpbuf_put(buf, &header, sizeof header);
+    ehddp_put_element(buf, tail.configuration, tail.type_device, tail.id, 0, tail.out_port);
+    ehddp_put_element(buf, ehddp_element_conf(type_device, pkt->dp->id, pkt->in_port, out_port),
+                      type_device, pkt->dp->id, pkt->in_port, out_port);
+    ehddp_set_next_hop(pkt->dp, (struct eth_header *)buf->data,
+                       (struct ehddp_header *)((uint8_t *)buf->data + sizeof(struct eth_header)), nxt_mac);
+
+    //La trama llena sigue su camino sin este salto, avisando de que hay mas
+    pkt->handle_std->proto->ehddp->flags |= EHDDP_FLAG_MORE;
+    ehddp_forward_reply(pkt, nxt_mac);
+
+    return packet_create(pkt->dp, pkt->in_port, buf, false);
+}
 
-    for (i = 0; i < pkt->handle_std->proto->ehddp->num_devices; i++)
-    {
-        if (pkt->handle_std->proto->ehddp->ids[i] == pkt->dp->id)
+uint16_t ehddp_merge_reply(struct packet *dst, struct packet *src){
+    uint16_t num_elements = dst->handle_std->proto->ehddp->num_devices
+                            + src->handle_std->proto->ehddp->num_devices;
+    const uint8_t *elements;
+    size_t dst_len, src_len, ehddp_off, first_off, port_len;
+    uint8_t conf;
+
+    /* The last device of a frame that is continued elsewhere must stay last,
+     * since the controller does not link it to the switch it arrives at. */
+    if ((dst->handle_std->proto->ehddp->flags | src->handle_std->proto->ehddp->flags) & EHDDP_FLAG_MORE)
+        return num_elements;
+
+    elements = ehddp_elements(src, &src_len);
+    ehddp_elements(dst, &dst_len);
+    if (num_elements > EHDDP_MAX_DEVICES || src_len == 0
+        || dst_len + src_len > EHDDP_MAX_ELEMENTS_LEN)
+        return num_elements;
+
+    /* The buffer may move, so the header is reached through its offset. */
+    ehddp_off = (uint8_t *)dst->handle_std->proto->ehddp - (uint8_t *)dst->buffer->data;
+    first_off = ehddp_off + sizeof(struct ehddp_header) + dst_len;
+    dst->buffer->size = first_off;
+    ofpbuf_put(dst->buffer, elements, src_len);
+
+    /* The controller infers a link between each device and the next one in
+     * the list; a null input port on the first appended device tells it that
+     * a new path starts there. */
+    conf = elements[0];
+    port_len = EHDDP_CONF_PORT_LEN(conf);
+    memset((uint8_t *)dst->buffer->data + first_off + 1 + EHDDP_CONF_TYPE_LEN(conf) + EHDDP_CONF_ID_LEN(conf),
+           0, port_len);
+    ((struct ehddp_header *)((uint8_t *)dst->buffer->data + ehddp_off))->num_devices = num_elements;
+
+    dst->handle_std->valid = false;
+    packet_handle_std_validate(dst->handle_std);
+    return 0;
+}
+
+uint16_t num_repetido(struct packet * pkt){
+    struct ehddp_element element;
+    const uint8_t *p;
+    size_t len, n;
+    int repetidos = 0;
+
+    p = ehddp_elements(pkt, &len);
+    while ((n = ehddp_get_element(p, len, &element)) != 0) {
+        if (element.id == pkt->dp->id)
             repetidos ++;
-        
+        p += n;
+        len -= n;
     }
     return repetidos;
 
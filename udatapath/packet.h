@@ -37,7 +37,7 @@ struct packet {
     struct datapath    *dp;
     struct ofpbuf      *buffer;    /* buffer containing the packet */
     uint32_t            in_port;
-    struct action_set  *action_set; /* action set associated with the packet */
+    struct action_set   action_set; /* action set associated with the packet */
     bool                packet_out; /* true if the packet arrived in a packet out msg */
 
     uint32_t            out_group; /* OFPG_ANY = no out group */
@@ -80,8 +80,33 @@ struct packet * create_ehddp_reply_packet(struct datapath *dp, uint8_t * mac_dst
     uint32_t in_port, uint32_t out_port, uint16_t type_device, uint8_t num_devices,
     u_int64_t num_sec, u_int64_t num_ack, u_int32_t time_block);
 
+/* Returns the configuration byte giving each field of a device element the
+ * narrowest width that holds its value. */
+uint8_t ehddp_element_conf(uint16_t type_device, uint64_t id, uint32_t in_port, uint32_t out_port);
+/* Appends to 'buf' a device element encoded as 'conf' says. */
+void ehddp_put_element(struct ofpbuf *buf, uint8_t conf, uint16_t type_device, uint64_t id,
+                       uint32_t in_port, uint32_t out_port);
+/* Decodes the device element at 'p', of at most 'len' bytes, into 'element'.
+ * Returns its length, or 0 if it is truncated. */
+size_t ehddp_get_element(const uint8_t *p, size_t len, struct ehddp_element *element);
+/* Returns the device list of the eHDDP packet 'pkt' and stores its length, not
+ * counting any frame padding, in '*len'. */
+const uint8_t *ehddp_elements(struct packet *pkt, size_t *len);
+
 //funcion para actualizar los paquetes
 uint16_t update_data_msg(struct packet * pkt, uint32_t out_port,  uint8_t * nxt_mac);
+/* Points the reply 'pkt' at its next hop 'nxt_mac' without adding this
+ * switch to its device list. */
+void ehddp_forward_reply(struct packet *pkt, uint8_t *nxt_mac);
+/* Called when the reply 'pkt' has no room left for this switch, which leaves
+ * through 'out_port'. Flags 'pkt' with EHDDP_FLAG_MORE, points it at its next
+ * hop 'nxt_mac' and returns a continuation reply carrying the last device of
+ * 'pkt' and this switch, or NULL if 'pkt' has no devices. */
+struct packet *ehddp_continue_reply(struct packet *pkt, uint32_t out_port, uint8_t *nxt_mac);
+/* Appends the device list of the reply 'src' to the reply 'dst'. Returns 0, or
+ * the number of devices the merged reply would have if they do not fit or if
+ * either reply is continued in another frame. */
+uint16_t ehddp_merge_reply(struct packet *dst, struct packet *src);
 uint16_t num_repetido(struct packet * pkt);
 struct packet *create_ehddp_new_localport_packet_UAH(struct datapath *dp, uint32_t new_local_port, char *port_name, 
     uint8_t *mac, uint32_t *old_local_port, uint64_t * time_start_process);
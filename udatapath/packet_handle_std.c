@@ -18,10 +18,13 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include "packet_handle_std.h"
 #include "packet.h"
+#include "datapath.h"
+#include "pipeline.h"
 #include "packets.h"
 #include "oflib/ofl-structs.h"
 #include "openflow/openflow.h"
@@ -37,9 +40,17 @@
 void
 packet_handle_std_validate(struct packet_handle_std *handle) {
     struct ofl_match_tlv * iter, *next, *f;
+    const struct oxm_field_set *fields = NULL;
     uint64_t metadata = 0;
     uint64_t tunnel_id = 0;
-    if(handle->valid)
+
+    /* Only the fields installed flows match on are extracted. A packet parsed
+     * before a flow_mod widened that set (e.g. one buffered for a packet-out)
+     * is parsed again. */
+    if (handle->pkt->dp != NULL && handle->pkt->dp->pipeline != NULL) {
+        fields = &handle->pkt->dp->pipeline->match_fields;
+    }
+    if(handle->valid && (fields == NULL || oxm_field_set_covers(&handle->fields, fields)))
         return;
     
     HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
@@ -59,10 +70,15 @@ packet_handle_std_validate(struct packet_handle_std *handle) {
     ofl_structs_match_init(&handle->match);
 
     if (nblink_packet_parse(handle->pkt->buffer,&handle->match,
-                            handle->proto) < 0)
+                            handle->proto, fields) < 0)
         return;
 
     handle->valid = true;
+    if (fields != NULL) {
+        handle->fields = *fields;
+    } else {
+        memset(&handle->fields, 0xff, sizeof handle->fields);
+    }
 
     /* Add in_port value to the hash_map */
     ofl_structs_match_put32(&handle->match, OXM_OF_IN_PORT, handle->pkt->in_port);
@@ -24,6 +24,7 @@
 #include "packets.h"
 #include "match_std.h"
 #include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
 #include "nbee_link/nbee_link.h"
 
 /****************************************************************************
@@ -42,6 +43,7 @@ struct packet_handle_std {
                                            executing any methods. */
    bool						   table_miss; /*Packet was matched
    											against table miss flow*/
+   struct oxm_field_set        fields; /* Fields 'match' was extracted for. */
 };
 
 /* Creates a handler */
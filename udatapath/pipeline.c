@@ -18,13 +18,18 @@
 #include <sys/types.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "action_set.h"
 #include "compiler.h"
 #include "dp_actions.h"
 #include "dp_buffers.h"
 #include "dp_exp.h"
+#include "dp_latency.h"
 #include "dp_ports.h"
+#include "ehddp_coalesce.h"
+#include "ehddp_seen.h"
+#include "ehddp_stats.h"
 #include "datapath.h"
 #include "packet.h"
 #include "pipeline.h"
@@ -33,6 +38,7 @@
 #include "meter_table.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-structs.h"
+#include "trace.h"
 #include "util.h"
 #include "hash.h"
 #include "oflib/oxm-match.h"
@@ -52,6 +58,8 @@ pipeline_create(struct datapath *dp) {
     struct pipeline *pl;
     int i;
     pl = xmalloc(sizeof(struct pipeline));
+    memset(&pl->match_fields, 0, sizeof pl->match_fields);
+    memset(pl->match_field_refs, 0, sizeof pl->match_field_refs);
     for (i=0; i<PIPELINE_TABLES; i++) {
         pl->tables[i] = flow_table_create(dp, i);
     }
@@ -60,6 +68,30 @@ pipeline_create(struct datapath *dp) {
     return pl;
 }
 
+void
+pipeline_add_match_fields(struct pipeline *pl, struct ofl_match *match) {
+    struct ofl_match_tlv *f;
+
+    HMAP_FOR_EACH(f, struct ofl_match_tlv, hmap_node, &match->match_fields) {
+        if (OXM_VENDOR(f->header) == OFPXMC_OPENFLOW_BASIC
+            && pl->match_field_refs[OXM_FIELD(f->header)]++ == 0) {
+            oxm_field_set_add(&pl->match_fields, f->header);
+        }
+    }
+}
+
+void
+pipeline_remove_match_fields(struct pipeline *pl, struct ofl_match *match) {
+    struct ofl_match_tlv *f;
+
+    HMAP_FOR_EACH(f, struct ofl_match_tlv, hmap_node, &match->match_fields) {
+        if (OXM_VENDOR(f->header) == OFPXMC_OPENFLOW_BASIC
+            && --pl->match_field_refs[OXM_FIELD(f->header)] == 0) {
+            oxm_field_set_remove(&pl->match_fields, f->header);
+        }
+    }
+}
+
 static bool
 is_table_miss(struct flow_entry *entry){
     return ((entry->stats->priority) == 0 && (entry->match->length <= 4));
@@ -68,34 +100,11 @@ is_table_miss(struct flow_entry *entry){
 /* Sends a packet to the controller in a packet_in message */
 static void
 send_packet_to_controller(struct pipeline *pl, struct packet *pkt, uint8_t table_id, uint8_t reason) {
-
-    struct ofl_msg_packet_in msg;
-    struct ofl_match *m;
-    msg.header.type = OFPT_PACKET_IN;
-    msg.total_len   = pkt->buffer->size;
-    msg.reason      = reason;
-    msg.table_id    = table_id;
-    msg.cookie      = 0xffffffffffffffff;
-    msg.data = pkt->buffer->data;
-
-
-    /* A max_len of OFPCML_NO_BUFFER means that the complete
-        packet should be sent, and it should not be buffered.*/
-    if (pl->dp->config.miss_send_len != OFPCML_NO_BUFFER){
-        dp_buffers_save(pl->dp->buffers, pkt);
-        msg.buffer_id   = pkt->buffer_id;
-        msg.data_length = MIN(pl->dp->config.miss_send_len, pkt->buffer->size);
-    }else {
-        msg.buffer_id   = OFP_NO_BUFFER;
-        msg.data_length = pkt->buffer->size;
-    }
-
-    m = &pkt->handle_std->match;
     /* In this implementation the fields in_port and in_phy_port
         always will be the same, because we are not considering logical
         ports                                 */
-    msg.match = (struct ofl_match_header*)m;
-    dp_send_message(pl->dp, (struct ofl_msg_header *)&msg, NULL);
+    dp_send_packet_in(pl->dp, pkt, table_id, reason, 0xffffffffffffffff,
+                      pl->dp->config.miss_send_len);
 }
 
 /* Pass the packet through the flow tables.
@@ -103,6 +112,8 @@ send_packet_to_controller(struct pipeline *pl, struct packet *pkt, uint8_t table
 void
 pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     struct flow_table *table, *next_table;
+    struct dp_latency *lat = pl->dp->latency;
+    uint64_t start;
 
     uint8_t resent_packet_ehddp = 0;
 
@@ -127,6 +138,29 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     }
 
     resent_packet_ehddp = ehddp_mod_local_port (pkt);
+
+    if (pkt->handle_std->proto->ehddp != NULL) {
+        static const enum openflow_ext_discovery_counters opcode_counters[] = {
+            OFP_EXT_DISCOVERY_BAD_OPCODE_IN, OFP_EXT_DISCOVERY_REQUEST_IN,
+            OFP_EXT_DISCOVERY_REPLY_IN, OFP_EXT_DISCOVERY_ACK_IN
+        };
+        uint8_t opcode = pkt->handle_std->proto->ehddp->opcode;
+
+        ehddp_stats_count(pl->dp->ehddp_stats, pkt->in_port,
+                          opcode_counters[opcode < ARRAY_SIZE(opcode_counters) ? opcode : 0]);
+    }
+
+    /* Repeats of a request already handled over this link and along this
+     * path are dropped before they are copied to the controller or flooded
+     * again. Copies over other links still get their reply or flood. */
+    if (pkt->handle_std->proto->ehddp != NULL && pkt->handle_std->proto->ehddp->opcode == 1
+        && ehddp_seen_check(pl->dp->ehddp_seen, pkt)) {
+        TRACE(EHDDP_REQUEST_DUP, pkt->in_port, eth_addr_to_uint64(pkt->handle_std->proto->ehddp->src_mac),
+              pkt->handle_std->proto->ehddp->num_sec);
+        ehddp_stats_count(pl->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REQUEST_DUP);
+        packet_destroy(pkt);
+        return;
+    }
     
     /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
 
@@ -134,13 +168,11 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
 	{
         VLOG_DBG(LOG_MODULE, "El paquete recibido es un paquete ARP.");
         if (htons(pkt->handle_std->proto->arp->ar_op) == 1 && pkt->handle_std->proto->arp->ar_tpa == ip_de_control_in_band.s_addr){
-            /*Aumentamos el estadisitico de ARP Request*/
-            num_pkt_arp_req++;
+            ehddp_stats_count(pl->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_REQUEST);
             pipeline_arp_path(pkt);
         }
         else if(htons(pkt->handle_std->proto->arp->ar_op) == 2 && pkt->handle_std->proto->arp->ar_spa == ip_de_control_in_band.s_addr){
-            /*Aumentamos el estadisitico de ARP Replay*/
-            num_pkt_arp_rep++;             
+            ehddp_stats_count(pl->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_REPLY);
         }
     }
     
@@ -160,7 +192,9 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
             VLOG_DBG_RL(LOG_MODULE, &rl, "searching table entry for packet match: %s.", m);
             free(m);
         }
+        start = dp_latency_start(lat);
         entry = flow_table_lookup(table, pkt);
+        dp_latency_stop_lookup(lat, table->stats->table_id, start);
         if (entry != NULL) {
 	        if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
                 char *m = ofl_structs_flow_stats_to_string(entry->stats, pkt->dp->exp);
@@ -177,7 +211,9 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
                /* Cookie field is set 0xffffffffffffffff
                 because we cannot associate it to any
                 particular flow */
-                action_set_execute(pkt->action_set, pkt, 0xffffffffffffffff);
+                start = dp_latency_start(lat);
+                action_set_execute(&pkt->action_set, pkt, 0xffffffffffffffff);
+                dp_latency_stop(lat, OFP_EXT_LATENCY_ACTIONS, start);
                 return;
             }
 
@@ -217,14 +253,10 @@ pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
      *       from all tables */
     ofl_err error;
     size_t i;
-    bool match_kept,insts_kept;
 
     if(sender->remote->role == OFPCR_ROLE_SLAVE)
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
 
-    match_kept = false;
-    insts_kept = false;
-
     /*Sort by execution oder*/
     qsort(msg->instructions, msg->instructions_num,
         sizeof(struct ofl_instruction_header *), inst_compare);
@@ -256,22 +288,17 @@ pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
 
             error = 0;
             for (i=0; i < PIPELINE_TABLES; i++) {
-                error = flow_table_flow_mod(pl->tables[i], msg, &match_kept, &insts_kept);
+                error = flow_table_flow_mod(pl->tables[i], msg);
                 if (error) {
                     break;
                 }
             }
-            if (error) {
-                return error;
-            } else {
-                ofl_msg_free_flow_mod(msg, !match_kept, !insts_kept, pl->dp->exp);
-                return 0;
-            }
+            return error;
         } else {
             return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID);
         }
     } else {
-        error = flow_table_flow_mod(pl->tables[msg->table_id], msg, &match_kept, &insts_kept);
+        error = flow_table_flow_mod(pl->tables[msg->table_id], msg);
         if (error) {
             return error;
         }
@@ -287,8 +314,6 @@ pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
                 VLOG_WARN_RL(LOG_MODULE, &rl, "The buffer flow_mod referred to was empty (%u).", msg->buffer_id);
             }
         }
-
-        ofl_msg_free_flow_mod(msg, !match_kept, !insts_kept, pl->dp->exp);
         return 0;
     }
 
@@ -608,6 +633,15 @@ pipeline_timeout(struct pipeline *pl) {
     }
 }
 
+void
+pipeline_run(struct pipeline *pl) {
+    int i;
+
+    for (i = 0; i < PIPELINE_TABLES; i++) {
+        flow_table_run(pl->tables[i]);
+    }
+}
+
 
 /* Executes the instructions associated with a flow entry */
 static void
@@ -624,6 +658,8 @@ execute_entry(struct pipeline *pl, struct flow_entry *entry,
     */
     size_t i;
     struct ofl_instruction_header *inst;
+    struct dp_latency *lat = pl->dp->latency;
+    uint64_t start;
 
     for (i=0; i < entry->stats->instructions_num; i++) {
         /*Packet was dropped by some instruction or action*/
@@ -658,21 +694,25 @@ execute_entry(struct pipeline *pl, struct flow_entry *entry,
             }
             case OFPIT_WRITE_ACTIONS: {
                 struct ofl_instruction_actions *wa = (struct ofl_instruction_actions *)inst;
-                action_set_write_actions((*pkt)->action_set, wa->actions_num, wa->actions);
+                action_set_write_actions(&(*pkt)->action_set, wa->actions_num, wa->actions);
                 break;
             }
             case OFPIT_APPLY_ACTIONS: {
                 struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)inst;
+                start = dp_latency_start(lat);
                 dp_execute_action_list((*pkt), ia->actions_num, ia->actions, entry->stats->cookie);
+                dp_latency_stop(lat, OFP_EXT_LATENCY_ACTIONS, start);
                 break;
             }
             case OFPIT_CLEAR_ACTIONS: {
-                action_set_clear_actions((*pkt)->action_set);
+                action_set_clear_actions(&(*pkt)->action_set);
                 break;
             }
             case OFPIT_METER: {
             	struct ofl_instruction_meter *im = (struct ofl_instruction_meter *)inst;
+                start = dp_latency_start(lat);
                 meter_table_apply(pl->dp->meters, pkt , im->meter_id);
+                dp_latency_stop(lat, OFP_EXT_LATENCY_METER, start);
                 break;
             }
             case OFPIT_EXPERIMENTER: {
@@ -701,27 +741,23 @@ uint8_t select_ehddp_packets(struct packet *pkt, uint8_t resent_packet_ehddp){
         //paquetes broadcast son paquetes request
         // VLOG_INFO(LOG_MODULE, "Paquete ehddp detectado Opcode : %d", (int)pkt->handle_std->proto->ehddp->opcode);
         if (pkt->handle_std->proto->ehddp->opcode == 1){
-            VLOG_INFO(LOG_MODULE, "Paquete ehddp REQUEST detectado");
+            TRACE(EHDDP_REQUEST, pkt->in_port, pkt->handle_std->proto->ehddp->num_sec);
             if (time_start == 0 || pkt->handle_std->proto->ehddp->num_sec == time_start){
                 time_start = bigtolittle64(pkt->handle_std->proto->ehddp->num_sec);
-                time_exploration = current_timestamp(); //time_msec();
-                //if(time_msec() - time_start < 0)
-                if (current_timestamp() - time_start < 0)
-                    convergence_time = 0; // indica que es tan rapido que no soy capaz de medir
-                else
-                    convergence_time = abs(current_timestamp() - time_start) ; //time_msec() - time_start); 
+                ehddp_stats_exploration(pkt->dp->ehddp_stats, time_start);
             }
             handle_ehddp_request_packets(pkt, resent_packet_ehddp);
         }//paquetes unicast son paquetes reply
         else if (pkt->handle_std->proto->ehddp->opcode == 2){
-            VLOG_INFO(LOG_MODULE, "Paquete ehddp REPLY detectado");
+            TRACE(EHDDP_REPLY, pkt->in_port, pkt->handle_std->proto->ehddp->num_sec);
             handle_ehddp_reply_packets(pkt);
         }
         else if (pkt->handle_std->proto->ehddp->opcode == 3){
-            VLOG_INFO(LOG_MODULE, "Paquete ehddp ACK detectado No nos interesa para redes ethernet");
+            /* ACKs are of no interest in Ethernet networks. */
+            TRACE(EHDDP_ACK, pkt->in_port);
         }
         else{
-            VLOG_INFO(LOG_MODULE, "Paquete ehddp DEFECTUOSO option code: >>> %d <<< !!!", pkt->handle_std->proto->ehddp->opcode);
+            TRACE(EHDDP_BAD_OPCODE, pkt->in_port, pkt->handle_std->proto->ehddp->opcode);
         }
         return 0; //ya ha sido tratado por eHDDP
     }
@@ -740,8 +776,6 @@ uint8_t ehddp_mod_local_port (struct packet * pkt){
         //VLOG_WARN(LOG_MODULE, "UAH -> eHDDP detectado miramos si tenemos que crear local port");
         if (pkt->handle_std->proto->ehddp->opcode == 1)
         {
-            //Aumentamos el estadistico de ehddp
-            num_pkt_ehddp_req++;
             result = mac_to_port_found_port(&bt_table, pkt->handle_std->proto->ehddp->src_mac, pkt->handle_std->proto->ehddp->num_sec);
             if (result <= 0){
                 /*le marcamos como puerto de controller*/
@@ -753,7 +787,7 @@ uint8_t ehddp_mod_local_port (struct packet * pkt){
                 else
                     mac_to_port_update(&bt_table, pkt->handle_std->proto->ehddp->src_mac, pkt->in_port, htonl(pkt->handle_std->proto->ehddp->time_block),
                         pkt->handle_std->proto->ehddp->num_sec);
-                VLOG_WARN(LOG_MODULE, "UAH -> Guardado correctamente el puerto en la tabla de eHDDP pasamos a comprobar local port");
+                TRACE(EHDDP_BT_SAVED, eth_addr_to_uint64(pkt->handle_std->proto->ehddp->src_mac), pkt->in_port);
                 /*Configuramos el puerto de entrada como nuevo puerto local*/
                 /*Modificaciones UAH*/
                 if (type_device_general != 2){ //le metemos la condición de que existen los no sdn para que no conecte)
@@ -781,7 +815,7 @@ uint8_t ehddp_mod_local_port (struct packet * pkt){
                                 }
                                 else
                                 {
-                                    VLOG_WARN(LOG_MODULE, "UAH -> Existe un puerto local ya asi que no hacemos");
+                                    TRACE(EHDDP_LOCAL_PORT_EXISTS, pkt->in_port);
                                 }
                                 break;
                             }
@@ -803,22 +837,20 @@ uint8_t ehddp_mod_local_port (struct packet * pkt){
 }
 
 uint8_t handle_ehddp_request_packets(struct packet *pkt, uint8_t resent_packet_ehddp){
-    int table_port = 0; //varible auxiliar para puertp
     int send_ehddp_packet = 0; //1 only request paquet; 2 only reply packet;
     int num_ports = 0; //numero de puertos disponibles
     struct packet * cpy_pkt; //forzamos el envio al controller para que mande arp
 
-    VLOG_INFO(LOG_MODULE, "Calculamos el puerto de entrada y el numero de puertos disponible");
     num_ports = num_port_available(pkt->dp);
     //table_port = mac_to_port_found_port(&bt_table, pkt->handle_std->proto->eth->eth_src, pkt->handle_std->proto->ehddp->num_sec);
-    VLOG_INFO(LOG_MODULE, "Puerto: entrada %d | Puerto en tabla: %d | Numero de puertos disponibles: %d  | Tiempo de bloqueo: %d", 
-        pkt->in_port, table_port ,num_ports, htonl(pkt->handle_std->proto->ehddp->time_block));
+    TRACE(EHDDP_REQUEST_IN, pkt->in_port, num_ports, htonl(pkt->handle_std->proto->ehddp->time_block),
+        resent_packet_ehddp);
 
     // Mismo puerto que el anotado en el paso anterior 
     //-> no puede existir un puerto no encontrado cuando llegue aqui(table_port == -1 ) //Puerto no encontrado
     if (resent_packet_ehddp == 1) //&& (conection_status_ofp_controller & (4 | 8 | 16)) == 0)
     {
-        VLOG_INFO(LOG_MODULE, "actualizo el puerto de la entrada de tabla BT al puerto: %d", pkt->in_port);
+        TRACE(EHDDP_BT_UPDATE, eth_addr_to_uint64(pkt->handle_std->proto->eth->eth_src), pkt->in_port);
         mac_to_port_update(&bt_table, pkt->handle_std->proto->eth->eth_src, pkt->in_port, htonl(pkt->handle_std->proto->ehddp->time_block),
             pkt->handle_std->proto->ehddp->num_sec);
         send_ehddp_packet = 1;
@@ -837,7 +869,7 @@ uint8_t handle_ehddp_request_packets(struct packet *pkt, uint8_t resent_packet_e
     
     /* Si solo tengo un puerto contesto con reply */
     if (num_ports == 1 || send_ehddp_packet == 2){
-        VLOG_INFO(LOG_MODULE, "Entramos en generar el reply: num_ports: %d", num_ports);
+        TRACE(EHDDP_REPLY_CREATE, pkt->in_port, num_ports);
         //visualizar_tabla(&bt_table, pkt->dp->id);
         creator_ehddp_reply_packets(pkt);
     }
@@ -848,12 +880,12 @@ uint8_t handle_ehddp_request_packets(struct packet *pkt, uint8_t resent_packet_e
         //Mandamos al controlador para forzar el arp
         cpy_pkt = packet_clone(pkt);
         send_packet_to_controller(pkt->dp->pipeline, pkt, pkt->table_id, OFPR_NO_MATCH);
-        VLOG_INFO(LOG_MODULE, "Se ha enviado un copia del eHDDP al controller para forzar el envio del ARP al controlador");
         packet_destroy(cpy_pkt);
 
         /*continamos nosotros haciendo el proceso*/
         update_data_msg(pkt, (uint32_t) OFPP_FLOOD, pkt->handle_std->proto->ehddp->nxt_mac);
-        VLOG_INFO(LOG_MODULE,"Update number of jump: %d ", pkt->handle_std->proto->ehddp->num_devices);
+        TRACE(EHDDP_REQUEST_FLOOD, pkt->in_port, pkt->handle_std->proto->ehddp->num_devices);
+        ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REQUEST_FLOOD);
         //visualizar_tabla(&bt_table, pkt->dp->id);
         dp_actions_output_port(pkt, OFPP_FLOOD, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
     }
@@ -870,32 +902,59 @@ uint8_t handle_ehddp_reply_packets(struct packet *pkt){
         pkt->handle_std->proto->ehddp->num_sec);
 
     if (out_port < 1){
-        VLOG_INFO(LOG_MODULE,"ERROR!!!! DON'T found any out_port!!!!");
+        TRACE(EHDDP_REPLY_NO_PORT, pkt->in_port, eth_addr_to_uint64(pkt->handle_std->proto->ehddp->nxt_mac));
+        ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_NO_PORT);
         return 0;
     }
     else
     {
 
-        VLOG_INFO(LOG_MODULE, "Update the eHDDP reply packet: in-port: %d | out-port %d | type_device: %d",
-            pkt->in_port, out_port, NODO_SDN_CONFIG);
-
         if (mac_to_port_found_mac_position(&bt_table, 1, nxt_mac) < 0) //obtenemos la mac del controller
         {
-            VLOG_INFO(LOG_MODULE, "No tenemos la mac del controller todavia asi que no podemos hacer nada");
+            /* The MAC of the controller is still unknown. */
+            TRACE(EHDDP_REPLY_NO_CTRL, pkt->in_port);
             return -1;
         }
 
+        if (pkt->handle_std->proto->ehddp->flags & EHDDP_FLAG_MORE) {
+            /* The path goes on in a continuation reply, which gets this hop. */
+            ehddp_forward_reply(pkt, nxt_mac);
+            ehddp_coalesce_output(pkt->dp->ehddp_coalesce, pkt, out_port);
+            ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_FORWARD);
+            return 1;
+        }
+
         num_elementos = update_data_msg(pkt, out_port, nxt_mac);
-        VLOG_INFO(LOG_MODULE, "Reply packet: %s", packet_to_string(pkt));
+        TRACE(EHDDP_REPLY_FORWARD, pkt->in_port, out_port, NODO_SDN_CONFIG);
+        if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+            char *pkt_str = packet_to_string(pkt);
+            VLOG_DBG_RL(LOG_MODULE, &rl, "reply packet: %s", pkt_str);
+            free(pkt_str);
+        }
 
         if(num_elementos == 0){ // Indica que tenemos hueco en el paquete para enviar 
             //visualizar_tabla(mac_port, pkt->dp->id);
-            dp_actions_output_port(pkt, out_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
-            /*Aumentamos el estadistico de ehddp reply*/
-            num_pkt_ehddp_rep++;
+            ehddp_coalesce_output(pkt->dp->ehddp_coalesce, pkt, out_port);
+            ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_FORWARD);
+        }
+        else if (num_repetido(pkt) == 0) {
+            /* No room left for this switch: the full reply goes on as it is
+             * and a continuation reply carries the rest of the path. */
+            struct packet *cont = ehddp_continue_reply(pkt, out_port, nxt_mac);
+
+            TRACE(EHDDP_REPLY_CONTINUED, pkt->in_port, out_port, num_elementos);
+            ehddp_coalesce_output(pkt->dp->ehddp_coalesce, pkt, out_port);
+            ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_FORWARD);
+            if (cont != NULL) {
+                ehddp_coalesce_output(pkt->dp->ehddp_coalesce, cont, out_port);
+                ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_CONTINUE);
+                packet_destroy(cont);
+            }
+        }
+        else {
+            TRACE(EHDDP_REPLY_FULL, pkt->in_port, num_elementos);
+            ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_FULL);
         }
-        else
-            VLOG_INFO(LOG_MODULE, "Se ha sobrepasado el numero de elementos maximos en el paquete: %d",num_elementos);
                 
         return 1;
     }    
@@ -916,17 +975,14 @@ void creator_ehddp_reply_packets(struct packet *pkt){
     pkt_reply = create_ehddp_reply_packet(pkt->dp, pkt->handle_std->proto->eth->eth_src,pkt->in_port,
         pkt->in_port, type_device, num_devices,
         pkt->handle_std->proto->ehddp->num_sec, pkt->handle_std->proto->ehddp->num_ack, pkt->handle_std->proto->ehddp->time_block);
-    VLOG_INFO(LOG_MODULE, "create_ehddp_reply_packet OK");
     //envio el paquete por el puerto de entrada
     dp_actions_output_port(pkt_reply, pkt->in_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
-    VLOG_INFO(LOG_MODULE, "dp_actions_output_port OK OUT PORT : %d", pkt->in_port);
-    /*Aumentamos el estadistico de ehddp reply*/
-    num_pkt_ehddp_rep++;
+    TRACE(EHDDP_REPLY_SENT, pkt->in_port, type_device);
+    ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_REPLY_CREATE);
 
     //destruyo el paquete para limpiar la memoria
     if (pkt_reply){
         packet_destroy(pkt_reply);
-        VLOG_INFO(LOG_MODULE, "pkt_reply delete!! OK");
     }
 }
 
@@ -943,19 +999,19 @@ void pipeline_arp_path(struct packet *pkt)
 
     if (!pkt)
     {
-        VLOG_INFO(LOG_MODULE, "Es un paquete no es válido");
+        VLOG_WARN_RL(LOG_MODULE, &rl, "ARP path called without a packet.");
         return;
     }
 
     if (!pkt->dp)
     {
-        VLOG_INFO(LOG_MODULE, "El dp no esta creado correctamente");
+        VLOG_WARN_RL(LOG_MODULE, &rl, "ARP path called for a packet without datapath.");
         return;
     }
 
     if (pkt->dp->local_port){
         if (memcmp(pkt->handle_std->proto->eth->eth_src, netdev_get_etheraddr(pkt->dp->local_port->netdev),ETH_ADDR_LEN) ==0){
-            VLOG_INFO(LOG_MODULE, "Es un paquete ARP que he creado yo mismo");
+            TRACE(ARP_OWN, pkt->in_port);
             return;
         }
     }
@@ -963,13 +1019,13 @@ void pipeline_arp_path(struct packet *pkt)
 	if (pkt->handle_std->proto->eth->eth_type == ETH_TYPE_ARP || pkt->handle_std->proto->eth->eth_type == ETH_TYPE_ARP_INV) 
 	{
         puerto_mac = mac_to_port_found_port(&learning_table, pkt->handle_std->proto->eth->eth_src, 0);
-        VLOG_INFO(LOG_MODULE, "Puerto_mac = %d | pkt->in_port = %d", puerto_mac, pkt->in_port);
+        TRACE(ARP_IN, pkt->in_port, eth_addr_to_uint64(pkt->handle_std->proto->eth->eth_src), puerto_mac);
         if (eth_addr_is_broadcast(pkt->handle_std->proto->eth->eth_dst) || eth_addr_is_multicast(pkt->handle_std->proto->eth->eth_dst))
         {
-            VLOG_INFO(LOG_MODULE, "Es un paquete ARP-Request del tipo broadcast");
 			if (puerto_mac == -1 || puerto_mac == 0){
-                VLOG_INFO(LOG_MODULE, "No conozco Puerto anterior");
+                TRACE(ARP_BCAST_LEARN, eth_addr_to_uint64(pkt->handle_std->proto->eth->eth_src), pkt->in_port);
 				mac_to_port_add(&learning_table, pkt->handle_std->proto->eth->eth_src, pkt->in_port, BT_TIME_PKT, 0);
+                ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_LEARN);
             }
 			else if (puerto_mac == pkt->in_port){
                 //VLOG_INFO(LOG_MODULE, "SI conozco Puerto anterior y es el mismo que el que tengo");
@@ -983,49 +1039,44 @@ void pipeline_arp_path(struct packet *pkt)
             if (type_device_general != 2) { //} && controller_connected == true){
                 cpy_pkt = packet_clone(pkt);
                 send_packet_to_controller(pkt->dp->pipeline, pkt, pkt->table_id, OFPR_NO_MATCH);
-                VLOG_INFO(LOG_MODULE, "Se ha enviado un copia del ARP al controller para su aprendizaje");
+                TRACE(ARP_BCAST_TO_CTRL, pkt->in_port);
                 packet_destroy(cpy_pkt);
             }
-            VLOG_INFO(LOG_MODULE, "Se guarda correctamente todo pasamos a hacer el broadcast del ARP");
-
-            VLOG_INFO(LOG_MODULE, "ar_tpa = %u | ar_tpa=%u | s_addr = %u", pkt->handle_std->proto->arp->ar_tpa, 
-                htonl(pkt->handle_std->proto->arp->ar_tpa), ip_del_controlller.s_addr);
             //dependiendo del arp puedo sacarlo por el puerto del controlador
             if (pkt->handle_std->proto->arp->ar_tpa != ip_del_controlller.s_addr)
             {
-                VLOG_INFO(LOG_MODULE, "La IP NO es la del CONTROLLER se envia por FLOOD");
+                TRACE(ARP_BCAST_FLOOD, pkt->in_port, pkt->handle_std->proto->arp->ar_tpa);
+                ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_FLOOD);
 			    dp_actions_output_port(pkt, OFPP_FLOOD, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
             }
             else{
-                VLOG_INFO(LOG_MODULE, "La IP SI es la del CONTROLLER se envia por %d", port_to_controller);
+                /* Left to the SDN rules, which already cover the controller. */
+                TRACE(ARP_BCAST_CTRL_IP, pkt->in_port, pkt->handle_std->proto->arp->ar_tpa, port_to_controller);
                 //dp_actions_output_port(pkt, port_to_controller, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
-                VLOG_INFO(LOG_MODULE, "PERO SE LO DEJAMOS A SDN QUE YA TIENE LA REGLA");
             }
             return;
         }
         else 
         {
-            VLOG_INFO(LOG_MODULE, "El paquete no es broadcast");
             if (htons(pkt->handle_std->proto->arp->ar_op) == 2){
                 if (puerto_mac == -1){
-                    VLOG_INFO(LOG_MODULE, "Es un ARP-Reply pero NO conocemos un puerto anterior"); 
+                    TRACE(ARP_REPLY_LEARN, eth_addr_to_uint64(pkt->handle_std->proto->eth->eth_src), pkt->in_port, 0);
                     mac_to_port_add(&learning_table, pkt->handle_std->proto->eth->eth_src, pkt->in_port, LT_TIME, 0);
+                    ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_LEARN);
                 }
                 else
                 {
-                    VLOG_INFO(LOG_MODULE, "Es un ARP-Reply pero conocemos un puerto anterior"); 
+                    TRACE(ARP_REPLY_LEARN, eth_addr_to_uint64(pkt->handle_std->proto->eth->eth_src), pkt->in_port, 1);
                     if(mac_to_port_check_timeout(&learning_table, pkt->handle_std->proto->eth->eth_src) == 1)
                         mac_to_port_update(&learning_table, pkt->handle_std->proto->eth->eth_src, pkt->in_port, LT_TIME, 0);
                     else
                         mac_to_port_time_refresh(&learning_table, pkt->handle_std->proto->eth->eth_src,LT_TIME, 0); 
                 } 
             }
-            VLOG_INFO(LOG_MODULE, "Todo actualizado de forma correcta");         
        }
     }
-    VLOG_INFO(LOG_MODULE, "Buscamos puerto de salida");
     puerto_mac = mac_to_port_found_port(&learning_table, pkt->handle_std->proto->eth->eth_dst, 0);
-    VLOG_INFO(LOG_MODULE, "sacamos paquete unicast por puerto = %d", puerto_mac);
+    TRACE(ARP_UNICAST, eth_addr_to_uint64(pkt->handle_std->proto->eth->eth_dst), puerto_mac);
     arp_path_send_unicast(pkt, puerto_mac);
 
     return;
@@ -1039,8 +1090,11 @@ int arp_path_send_unicast(struct packet * pkt, int out_port)
 		{
 			mac_to_port_time_refresh(&learning_table, pkt->handle_std->proto->eth->eth_dst, LT_TIME, 0);
 			dp_actions_output_port(pkt, out_port,pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
+			ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_UNICAST);
+			return 0;
 		}
 	}
+	ehddp_stats_count(pkt->dp->ehddp_stats, pkt->in_port, OFP_EXT_DISCOVERY_ARP_UNKNOWN);
 	return 0;
 }
 
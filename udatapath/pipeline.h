@@ -24,6 +24,7 @@
 #include "flow_table.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-messages.h"
+#include "oflib/oxm-match.h"
 
 
 struct sender;
@@ -39,21 +40,12 @@ struct sender;
 extern struct mac_to_port bt_table, learning_table;
 extern bool local_port_ok;
 extern uint8_t conection_status_ofp_controller;
-extern uint64_t time_connect_to_contoller;
-extern uint64_t time_exploration;
 extern struct in_addr ip_if;
 extern uint32_t old_local_port;
 extern struct in_addr ip_de_control_in_band;
 extern struct in_addr ip_del_controlller;
 extern uint64_t time_no_move_local_port;
-extern uint64_t convergence_time;
 extern uint64_t time_start;
-extern int num_pkt_ehddp_req ;
-extern int num_pkt_ehddp_rep ;
-extern int num_pkt_arp_rep ;
-extern int num_pkt_arp_req ;
-extern uint64_t time_to_connect;
-extern uint64_t packet_time;
 extern uint8_t type_device_general;
 extern bool controller_connected;
 extern int port_to_controller;
@@ -71,6 +63,11 @@ extern int port_to_controller;
 struct pipeline {
     struct datapath    *dp;
     struct flow_table  *tables[PIPELINE_TABLES];
+
+    /* Fields matched by installed flows; only these are extracted from
+     * packets. 'match_field_refs' counts the flows using each field. */
+    struct oxm_field_set match_fields;
+    uint32_t             match_field_refs[128];
 };
 
 
@@ -82,7 +79,16 @@ pipeline_create(struct datapath *dp);
 void
 pipeline_process_packet(struct pipeline *pl, struct packet *pkt);
 
-/* Handles a flow_mod message. */
+/* Accounts for the fields of 'match', which a new flow entry matches on. */
+void
+pipeline_add_match_fields(struct pipeline *pl, struct ofl_match *match);
+
+/* Releases the fields of 'match' when its flow entry is destroyed. */
+void
+pipeline_remove_match_fields(struct pipeline *pl, struct ofl_match *match);
+
+/* Handles a flow_mod message. Unlike other handlers, it never frees the
+ * message; flow entries keep their own copies, and the caller releases it. */
 ofl_err
 pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
                          const struct sender *sender);
@@ -122,6 +128,11 @@ pipeline_handle_stats_request_aggregate(struct pipeline *pl,
 void
 pipeline_timeout(struct pipeline *pl);
 
+/* Performs the deferred work of the flow tables, such as rebuilding their
+ * classifiers after flow mods. */
+void
+pipeline_run(struct pipeline *pl);
+
 /* Detroys the pipeline. */
 void
 pipeline_destroy(struct pipeline *pl);
@@ -0,0 +1,1116 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmarks of the stages a packet goes through in the datapath.
+ *
+ * Each case runs its stage over a fixed number of packets and reports the
+ * time and the allocation calls it took per packet, as a JSON document, so
+ * that runs of different releases can be compared. Packets are prepared in
+ * batches outside of the timed sections: only the stage itself is measured.
+ *
+ * Allocations are counted by replacing malloc(), calloc() and realloc() in
+ * the program; this needs the C library to export its own allocator under
+ * another name, as glibc does. Elsewhere they are reported as null. Calls
+ * the C library makes to its own allocator are not seen. */
+
+#include <config.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "command-line.h"
+#include "datapath.h"
+#include "dp_actions.h"
+#include "dp_ports.h"
+#include "flow_cls_linear.h"
+#include "flow_cls_lpm.h"
+#include "flow_entry.h"
+#include "flow_table.h"
+#include "match_std.h"
+#include "ofpbuf.h"
+#include "openflow/openflow.h"
+#include "packet.h"
+#include "packet_handle_std.h"
+#include "packets.h"
+#include "pipeline.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+#include "xtoxll.h"
+#include "nbee_link/nbee_link.h"
+#include "oflib/ofl-actions.h"
+#include "oflib/ofl-messages.h"
+#include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
+
+/* Packets prepared ahead of each timed section. */
+#define BENCH_BATCH 256
+
+/* Ports of the benchmark datapath; all of them discard what they get. */
+#define PORT_IN  1
+#define PORT_OUT 2
+#define N_PORTS  5
+
+/* Options. */
+static long long n_packets = 100000;
+static const char *output_name;
+static int check_rounds;
+
+static struct datapath *dp;
+static FILE *output;
+static int n_results;
+
+static void parse_options(int argc, char *argv[]);
+static void usage(void) NO_RETURN;
+
+/* Allocation counting. */
+
+#ifdef __GLIBC__
+#define BENCH_COUNT_ALLOCS 1
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static unsigned long long int n_allocs;
+
+void *
+malloc(size_t size) {
+    n_allocs++;
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t n, size_t size) {
+    n_allocs++;
+    return __libc_calloc(n, size);
+}
+
+void *
+realloc(void *p, size_t size) {
+    n_allocs++;
+    return __libc_realloc(p, size);
+}
+#else
+#define BENCH_COUNT_ALLOCS 0
+static unsigned long long int n_allocs;
+#endif
+
+/* Timing. */
+
+struct bench_clock {
+    long long int ns;
+    unsigned long long int allocs;
+    long long int start_ns;
+    unsigned long long int start_allocs;
+};
+
+static long long int
+now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void
+clock_start(struct bench_clock *c) {
+    c->start_allocs = n_allocs;
+    c->start_ns = now_ns();
+}
+
+static inline void
+clock_stop(struct bench_clock *c) {
+    c->ns += now_ns() - c->start_ns;
+    c->allocs += n_allocs - c->start_allocs;
+}
+
+/* Writes one result. 'entries' is the size of the flow table, or 0 if the
+ * stage does not use one. */
+static void
+report(const char *stage, const char *name, int entries, const struct bench_clock *c) {
+    fprintf(output, "%s\n    {\"stage\": \"%s\", \"case\": \"%s\"",
+            n_results++ ? "," : "", stage, name);
+    if (entries) {
+        fprintf(output, ", \"entries\": %d", entries);
+    }
+    fprintf(output, ", \"ns_per_packet\": %.1f", (double)c->ns / n_packets);
+    if (BENCH_COUNT_ALLOCS) {
+        fprintf(output, ", \"allocs_per_packet\": %.2f", (double)c->allocs / n_packets);
+    } else {
+        fprintf(output, ", \"allocs_per_packet\": null");
+    }
+    fprintf(output, "}");
+    fflush(output);
+}
+
+/* Frames. */
+
+static const uint8_t host_a[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t host_b[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+static struct ofpbuf *
+frame_start(uint16_t eth_type, const uint8_t src[ETH_ADDR_LEN]) {
+    struct ofpbuf *buf = ofpbuf_new(256);
+    struct eth_header *eth = ofpbuf_put_zeros(buf, sizeof *eth);
+
+    memcpy(eth->eth_dst, host_b, ETH_ADDR_LEN);
+    memcpy(eth->eth_src, src, ETH_ADDR_LEN);
+    eth->eth_type = htons(eth_type);
+    return buf;
+}
+
+/* Pads 'buf' to the minimum Ethernet frame size. */
+static struct ofpbuf *
+frame_finish(struct ofpbuf *buf) {
+    if (buf->size < ETH_TOTAL_MIN) {
+        ofpbuf_put_zeros(buf, ETH_TOTAL_MIN - buf->size);
+    }
+    return buf;
+}
+
+static struct ofpbuf *
+make_arp(void) {
+    struct ofpbuf *buf = frame_start(ETH_TYPE_ARP, host_a);
+    struct arp_eth_header *arp = ofpbuf_put_zeros(buf, sizeof *arp);
+
+    arp->ar_hrd = htons(ARP_HRD_ETHERNET);
+    arp->ar_pro = htons(ARP_PRO_IP);
+    arp->ar_hln = ETH_ADDR_LEN;
+    arp->ar_pln = 4;
+    arp->ar_op = htons(ARP_OP_REQUEST);
+    memcpy(arp->ar_sha, host_a, ETH_ADDR_LEN);
+    arp->ar_spa = htonl(0x0a000001);
+    arp->ar_tpa = htonl(0x0a000002);
+    return frame_finish(buf);
+}
+
+/* An IPv4/TCP frame whose addresses and ports are derived from 'i', the
+ * index of the flow it belongs to. */
+static struct ofpbuf *
+make_tcp4(int i) {
+    uint8_t src[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, i >> 8, i & 0xff};
+    struct ofpbuf *buf = frame_start(ETH_TYPE_IP, src);
+    struct ip_header *ip = ofpbuf_put_zeros(buf, sizeof *ip);
+    struct tcp_header *tcp = ofpbuf_put_zeros(buf, sizeof *tcp);
+
+    ip->ip_ihl_ver = IP_IHL_VER(5, 4);
+    ip->ip_tot_len = htons(sizeof *ip + sizeof *tcp);
+    ip->ip_ttl = 64;
+    ip->ip_proto = IP_TYPE_TCP;
+    ip->ip_src = htonl(0x0a000000 | i);
+    ip->ip_dst = htonl(0xac100000 | i);
+    tcp->tcp_src = htons(20000 + i);
+    tcp->tcp_dst = htons(1024 + i);
+    tcp->tcp_ctl = htons(5 << 12 | TCP_ACK);
+    return frame_finish(buf);
+}
+
+/* An IPv6/TCP frame with hop-by-hop and destination options headers. */
+static struct ofpbuf *
+make_tcp6_ext(void) {
+    struct ofpbuf *buf = frame_start(ETH_TYPE_IPV6, host_a);
+    struct ipv6_header *ip6 = ofpbuf_put_zeros(buf, sizeof *ip6);
+    uint8_t *hbh, *doh;
+    struct tcp_header *tcp;
+
+    /* Each extension header is 8 bytes: next header, length and a PadN
+     * option filling the rest. */
+    hbh = ofpbuf_put_zeros(buf, 8);
+    hbh[0] = IPV6_TYPE_DOH;
+    hbh[2] = 1;
+    hbh[3] = 4;
+    doh = ofpbuf_put_zeros(buf, 8);
+    doh[0] = IP_TYPE_TCP;
+    doh[2] = 1;
+    doh[3] = 4;
+    tcp = ofpbuf_put_zeros(buf, sizeof *tcp);
+
+    ip6->ipv6_ver_tc_fl = htonl(IPV6_VERSION << 28);
+    ip6->ipv6_pay_len = htons(16 + sizeof *tcp);
+    ip6->ipv6_next_hd = IPV6_TYPE_HBH;
+    ip6->ipv6_hop_limit = 64;
+    ip6->ipv6_src.s6_addr[0] = 0x20;
+    ip6->ipv6_src.s6_addr[1] = 0x01;
+    ip6->ipv6_src.s6_addr[15] = 0x01;
+    ip6->ipv6_dst.s6_addr[0] = 0x20;
+    ip6->ipv6_dst.s6_addr[1] = 0x01;
+    ip6->ipv6_dst.s6_addr[15] = 0x02;
+    tcp->tcp_src = htons(20000);
+    tcp->tcp_dst = htons(80);
+    tcp->tcp_ctl = htons(5 << 12 | TCP_ACK);
+    return frame_finish(buf);
+}
+
+/* An eHDDP reply that went through 'hops' switches. */
+static struct ofpbuf *
+make_ehddp(int hops) {
+    struct ofpbuf *buf = frame_start(ETH_TYPE_EHDDP, host_a);
+    struct ehddp_header *ehddp = ofpbuf_put_zeros(buf, sizeof *ehddp);
+    int i;
+
+    ehddp->flags = 0x01;
+    ehddp->opcode = 2;
+    ehddp->num_devices = hops;
+    ehddp->num_sec = htonll(1);
+    ehddp->previous_size_mac = ETH_ADDR_LEN;
+    memcpy(ehddp->nxt_mac, host_b, ETH_ADDR_LEN);
+    memcpy(ehddp->last_mac, host_a, ETH_ADDR_LEN);
+    memcpy(ehddp->src_mac, host_a, ETH_ADDR_LEN);
+    ehddp->time_block = htonl(3000);
+    for (i = 0; i < hops; i++) {
+        uint64_t id = i + 2;
+
+        ehddp_put_element(buf, ehddp_element_conf(NODO_SDN, id, 1, 2),
+                          NODO_SDN, id, 1, 2);
+    }
+    return frame_finish(buf);
+}
+
+/* Parsing. */
+
+static void
+match_clear(struct ofl_match *match) {
+    struct ofl_match_tlv *iter, *next;
+
+    HMAP_FOR_EACH_SAFE (iter, next, struct ofl_match_tlv, hmap_node, &match->match_fields) {
+        free(iter->value);
+        free(iter);
+    }
+    hmap_destroy(&match->match_fields);
+}
+
+/* Extracts every field from the frame, as for a packet whose datapath has
+ * flows matching on all of them. */
+static void
+bench_parse(const char *name, struct ofpbuf *buf) {
+    struct ofl_match matches[BENCH_BATCH];
+    struct protocols_std proto;
+    struct bench_clock c;
+    long long int done;
+
+    memset(&c, 0, sizeof c);
+    for (done = 0; done < n_packets; done += BENCH_BATCH) {
+        int n = MIN(BENCH_BATCH, n_packets - done);
+        int i;
+
+        for (i = 0; i < n; i++) {
+            ofl_structs_match_init(&matches[i]);
+        }
+        clock_start(&c);
+        for (i = 0; i < n; i++) {
+            nblink_packet_parse(buf, &matches[i], &proto, NULL);
+        }
+        clock_stop(&c);
+        for (i = 0; i < n; i++) {
+            match_clear(&matches[i]);
+        }
+    }
+    report("parse", name, 0, &c);
+    ofpbuf_delete(buf);
+}
+
+/* Flow table lookup. */
+
+enum mask_mix {
+    MIX_EXACT,    /* the 5-tuple of a TCP flow */
+    MIX_PREFIX,   /* IPv4 destination prefixes of 24 to 32 bits */
+    MIX_MIXED,    /* a different set of fields in every fourth flow */
+    MIX_ACL       /* IPv4 source and destination prefixes, and half of the
+                     flows on a TCP port too */
+};
+
+static const char *mix_names[] = {"exact", "prefix", "mixed", "acl"};
+
+static void
+add_flow(struct flow_table *table, enum mask_mix mix, int i) {
+    struct ofl_instruction_actions inst;
+    struct ofl_instruction_header *insts[1];
+    struct ofl_action_output out;
+    struct ofl_action_header *acts[1];
+    struct ofl_msg_flow_mod mod;
+    struct ofl_match match;
+    uint8_t src[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, i >> 8, i & 0xff};
+    uint16_t priority = 100;
+    int plen;
+
+    ofl_structs_match_init(&match);
+    switch (mix) {
+    case MIX_EXACT:
+        ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+        ofl_structs_match_put8(&match, OXM_OF_IP_PROTO, IP_TYPE_TCP);
+        ofl_structs_match_put32(&match, OXM_OF_IPV4_SRC, htonl(0x0a000000 | i));
+        ofl_structs_match_put32(&match, OXM_OF_IPV4_DST, htonl(0xac100000 | i));
+        ofl_structs_match_put16(&match, OXM_OF_TCP_SRC, 20000 + i);
+        ofl_structs_match_put16(&match, OXM_OF_TCP_DST, 1024 + i);
+        break;
+
+    case MIX_PREFIX:
+        plen = 24 + i % 9;
+        priority = plen;
+        ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+        ofl_structs_match_put32m(&match, OXM_OF_IPV4_DST_W,
+                                 htonl((0xac100000 | i) & (0xffffffff << (32 - plen))),
+                                 htonl(0xffffffff << (32 - plen)));
+        break;
+
+    case MIX_MIXED:
+        priority = 100 + i % 7;
+        switch (i % 4) {
+        case 0:
+            ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+            ofl_structs_match_put32(&match, OXM_OF_IPV4_DST, htonl(0xac100000 | i));
+            break;
+        case 1:
+            ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+            ofl_structs_match_put8(&match, OXM_OF_IP_PROTO, IP_TYPE_TCP);
+            ofl_structs_match_put16(&match, OXM_OF_TCP_DST, 1024 + i);
+            break;
+        case 2:
+            ofl_structs_match_put_eth(&match, OXM_OF_ETH_SRC, src);
+            break;
+        case 3:
+            ofl_structs_match_put32(&match, OXM_OF_IN_PORT, PORT_IN);
+            ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+            ofl_structs_match_put32m(&match, OXM_OF_IPV4_SRC_W, htonl(0x0a000000 | i),
+                                     htonl(0xffffff00));
+            break;
+        }
+        break;
+
+    case MIX_ACL:
+        plen = 16 + i % 9;
+        priority = 1000 - i % 97;
+        ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+        ofl_structs_match_put8(&match, OXM_OF_IP_PROTO, IP_TYPE_TCP);
+        ofl_structs_match_put32m(&match, OXM_OF_IPV4_SRC_W,
+                                 htonl((0x0a000000 | i) & (0xffffffff << (32 - plen))),
+                                 htonl(0xffffffff << (32 - plen)));
+        plen = 24 + i % 9;
+        ofl_structs_match_put32m(&match, OXM_OF_IPV4_DST_W,
+                                 htonl((0xac100000 | i) & (0xffffffff << (32 - plen))),
+                                 htonl(0xffffffff << (32 - plen)));
+        if (i % 2) {
+            ofl_structs_match_put16(&match, OXM_OF_TCP_DST, 1024 + i);
+        }
+        break;
+    }
+
+    out.header.type = OFPAT_OUTPUT;
+    out.port = PORT_OUT;
+    out.max_len = 0;
+    acts[0] = &out.header;
+    inst.header.type = OFPIT_APPLY_ACTIONS;
+    inst.actions_num = 1;
+    inst.actions = acts;
+    insts[0] = &inst.header;
+
+    memset(&mod, 0, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.table_id = 0;
+    mod.command = OFPFC_ADD;
+    mod.priority = priority;
+    mod.buffer_id = OFP_NO_BUFFER;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.match = &match.header;
+    mod.instructions_num = 1;
+    mod.instructions = insts;
+
+    if (flow_table_flow_mod(table, &mod)) {
+        ofp_fatal(0, "failed to add flow %d", i);
+    }
+    match_clear(&match);
+}
+
+static void
+clear_flows(struct flow_table *table) {
+    struct ofl_msg_flow_mod mod;
+    struct ofl_match match;
+
+    ofl_structs_match_init(&match);
+    memset(&mod, 0, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.table_id = 0;
+    mod.command = OFPFC_DELETE;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.match = &match.header;
+    flow_table_flow_mod(table, &mod);
+}
+
+static const char *classifier_names[] = {"auto", "list", "linear", "tree", "lpm"};
+
+/* Looks up packets of flows spread over the whole table. The packets are
+ * created once the flows are in, so that they are parsed for the fields the
+ * flows match on, as in the datapath. */
+static void
+bench_lookup(enum mask_mix mix, int n_flows, enum flow_table_classifier classifier) {
+    struct flow_table *table = dp->pipeline->tables[0];
+    struct packet *pkts[BENCH_BATCH];
+    struct bench_clock c;
+    char name[32];
+    long long int done;
+    int i;
+
+    for (i = 0; i < n_flows; i++) {
+        add_flow(table, mix, i);
+    }
+    for (i = 0; i < BENCH_BATCH; i++) {
+        int flow = (int)(((uint64_t)i * 2654435761u) % n_flows);
+        pkts[i] = packet_create(dp, PORT_IN, make_tcp4(flow), false);
+    }
+
+    /* Let the flow mods settle, as in the datapath, for large tables to get
+     * their tree. The first lookup compiles the table for the forced
+     * classifiers. */
+    flow_table_set_classifier(table, classifier);
+    if (classifier == FLOW_TABLE_CLS_AUTO) {
+        time_poll(NULL, 0, 100);
+        flow_table_run(table);
+    }
+    flow_table_lookup(table, pkts[0]);
+
+    memset(&c, 0, sizeof c);
+    clock_start(&c);
+    for (done = 0; done < n_packets; done++) {
+        flow_table_lookup(table, pkts[done % BENCH_BATCH]);
+    }
+    clock_stop(&c);
+
+    snprintf(name, sizeof name, "%s/%d/%s", mix_names[mix], n_flows,
+             classifier_names[classifier]);
+    report("lookup", name, table->stats->active_count, &c);
+
+    for (i = 0; i < BENCH_BATCH; i++) {
+        packet_destroy(pkts[i]);
+    }
+    clear_flows(table);
+    flow_table_set_classifier(table, FLOW_TABLE_CLS_AUTO);
+}
+
+/* Differential check of the classifiers. */
+
+/* Rules and packets per round of the check. */
+#define CHECK_MAX_FLOWS   300
+#define CHECK_PACKETS     64
+
+/* Rounds of lookups and route changes per round of the prefix check. */
+#define CHECK_LPM_STEPS   8
+
+static uint64_t check_seed = 1;
+
+/* Deterministic xorshift generator, so that a failing round can be run
+ * again. */
+static uint32_t
+check_random(uint32_t n) {
+    check_seed ^= check_seed << 13;
+    check_seed ^= check_seed >> 7;
+    check_seed ^= check_seed << 17;
+    return check_seed % n;
+}
+
+/* Values are drawn from small ranges, so that rules overlap and packets hit
+ * several of them. */
+static uint32_t
+check_ip(uint32_t base) {
+    return base | check_random(16) | (check_random(4) << 8);
+}
+
+static void
+check_put_prefix(struct ofl_match *match, uint32_t header, uint32_t header_w,
+                 uint32_t addr) {
+    int plen = check_random(33);
+
+    if (plen == 32) {
+        ofl_structs_match_put32(match, header, htonl(addr));
+    } else if (plen > 0) {
+        uint32_t mask = 0xffffffff << (32 - plen);
+        ofl_structs_match_put32m(match, header_w, htonl(addr & mask), htonl(mask));
+    }
+}
+
+/* Sends a flow mod of 'command' for 'match' at 'priority', whose entry
+ * outputs to PORT_OUT. */
+static void
+check_flow_mod(struct flow_table *table, uint8_t command, struct ofl_match *match,
+               uint16_t priority) {
+    struct ofl_instruction_actions inst;
+    struct ofl_instruction_header *insts[1];
+    struct ofl_action_output out;
+    struct ofl_action_header *acts[1];
+    struct ofl_msg_flow_mod mod;
+
+    out.header.type = OFPAT_OUTPUT;
+    out.port = PORT_OUT;
+    out.max_len = 0;
+    acts[0] = &out.header;
+    inst.header.type = OFPIT_APPLY_ACTIONS;
+    inst.actions_num = 1;
+    inst.actions = acts;
+    insts[0] = &inst.header;
+
+    memset(&mod, 0, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.table_id = 0;
+    mod.command = command;
+    mod.priority = priority;
+    mod.buffer_id = OFP_NO_BUFFER;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.match = &match->header;
+    mod.instructions_num = 1;
+    mod.instructions = insts;
+
+    if (flow_table_flow_mod(table, &mod)) {
+        ofp_fatal(0, "failed to %s a random flow",
+                  command == OFPFC_ADD ? "add" : "delete");
+    }
+}
+
+static void
+check_add_flow(struct flow_table *table) {
+    struct ofl_match match;
+
+    ofl_structs_match_init(&match);
+    if (check_random(4) == 0) {
+        ofl_structs_match_put32(&match, OXM_OF_IN_PORT, 1 + check_random(3));
+    }
+    if (check_random(8) == 0) {
+        uint8_t src[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 1 + check_random(2)};
+        ofl_structs_match_put_eth(&match, OXM_OF_ETH_SRC, src);
+    } else if (check_random(8) != 0) {
+        ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+        check_put_prefix(&match, OXM_OF_IPV4_SRC, OXM_OF_IPV4_SRC_W, check_ip(0x0a000000));
+        check_put_prefix(&match, OXM_OF_IPV4_DST, OXM_OF_IPV4_DST_W, check_ip(0xac100000));
+        if (check_random(2) == 0) {
+            ofl_structs_match_put8(&match, OXM_OF_IP_PROTO,
+                                   check_random(4) ? IP_TYPE_TCP : IP_TYPE_UDP);
+            if (check_random(3) == 0) {
+                ofl_structs_match_put16(&match, OXM_OF_TCP_DST, 80 + check_random(4));
+            }
+        }
+    }
+
+    check_flow_mod(table, OFPFC_ADD, &match, check_random(16));
+    match_clear(&match);
+}
+
+/* A route: a destination prefix of the ranges of check_ip(). */
+struct check_route {
+    uint32_t addr;
+    int plen;
+};
+
+static struct check_route
+check_random_route(void) {
+    struct check_route r;
+
+    r.plen = 1 + check_random(32);
+    r.addr = check_ip(0xac100000) & (0xffffffff << (32 - r.plen));
+    return r;
+}
+
+/* Adds or deletes the entry of a route, whose priority is its prefix length
+ * as in a routing table, so that the prefix index can hold it. */
+static void
+check_route_mod(struct flow_table *table, uint8_t command, const struct check_route *r) {
+    struct ofl_match match;
+
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+    if (r->plen == 32) {
+        ofl_structs_match_put32(&match, OXM_OF_IPV4_DST, htonl(r->addr));
+    } else {
+        ofl_structs_match_put32m(&match, OXM_OF_IPV4_DST_W, htonl(r->addr),
+                                 htonl(0xffffffff << (32 - r->plen)));
+    }
+    check_flow_mod(table, command, &match, r->plen);
+    match_clear(&match);
+}
+
+/* An ARP frame, or an IPv4/TCP frame from the ranges of check_add_flow(). */
+static struct packet *
+check_make_packet(void) {
+    uint8_t src[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 1 + check_random(2)};
+    uint32_t in_port = 1 + check_random(3);
+    struct ofpbuf *buf;
+    struct ip_header *ip;
+    struct tcp_header *tcp;
+
+    if (check_random(8) == 0) {
+        return packet_create(dp, in_port, make_arp(), false);
+    }
+    buf = frame_start(ETH_TYPE_IP, src);
+    ip = ofpbuf_put_zeros(buf, sizeof *ip);
+    tcp = ofpbuf_put_zeros(buf, sizeof *tcp);
+    ip->ip_ihl_ver = IP_IHL_VER(5, 4);
+    ip->ip_tot_len = htons(sizeof *ip + sizeof *tcp);
+    ip->ip_ttl = 64;
+    ip->ip_proto = IP_TYPE_TCP;
+    ip->ip_src = htonl(check_ip(0x0a000000));
+    ip->ip_dst = htonl(check_ip(0xac100000));
+    tcp->tcp_src = htons(20000);
+    tcp->tcp_dst = htons(80 + check_random(4));
+    tcp->tcp_ctl = htons(5 << 12 | TCP_ACK);
+    return packet_create(dp, in_port, frame_finish(buf), false);
+}
+
+/* The entry the packet matches, as the flow table defines it: the first in
+ * the table's order for which packet_match() holds. */
+static struct flow_entry *
+check_reference(struct flow_table *table, struct packet *pkt) {
+    struct flow_entry *entry;
+
+    packet_handle_std_validate(pkt->handle_std);
+    if (!pkt->handle_std->valid) {
+        return NULL;
+    }
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
+        struct ofl_match_header *m = entry->match == NULL ? entry->stats->match : entry->match;
+
+        if (m->type == OFPMT_OXM && packet_match((struct ofl_match *)m, &pkt->handle_std->match)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Looks up the packets with 'classifier', and returns the number of them
+ * for which it did not find the reference entry. */
+static int
+check_lookups(int round, struct flow_table *table, struct packet *pkts[],
+              enum flow_table_classifier classifier) {
+    int errors = 0;
+    int i;
+
+    flow_table_set_classifier(table, classifier);
+    for (i = 0; i < CHECK_PACKETS; i++) {
+        struct flow_entry *expected = check_reference(table, pkts[i]);
+        struct flow_entry *found = flow_table_lookup(table, pkts[i]);
+
+        if (found != expected) {
+            char *pkt_str = packet_to_string(pkts[i]);
+
+            fprintf(stderr, "round %d, %"PRIu32" flows, %s classifier: %s matched "
+                    "%s%"PRIu16" instead of %s%"PRIu16"\n",
+                    round, table->stats->active_count, classifier_names[classifier], pkt_str,
+                    found ? "priority " : "no entry", found ? found->stats->priority : 0,
+                    expected ? "priority " : "no entry", expected ? expected->stats->priority : 0);
+            free(pkt_str);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/* Fills the table with random flows, and checks that every classifier finds
+ * the reference entry for random packets. Returns the number of lookups that
+ * disagreed. */
+static int
+check_round(int round) {
+    struct flow_table *table = dp->pipeline->tables[0];
+    struct packet *pkts[CHECK_PACKETS];
+    int n_flows = 1 + check_random(CHECK_MAX_FLOWS);
+    int errors = 0;
+    int i;
+    size_t k;
+
+    for (i = 0; i < n_flows; i++) {
+        check_add_flow(table);
+    }
+    for (i = 0; i < CHECK_PACKETS; i++) {
+        pkts[i] = check_make_packet();
+    }
+
+    for (k = 0; k < ARRAY_SIZE(classifier_names); k++) {
+        errors += check_lookups(round, table, pkts, k);
+    }
+
+    for (i = 0; i < CHECK_PACKETS; i++) {
+        packet_destroy(pkts[i]);
+    }
+    clear_flows(table);
+    flow_table_set_classifier(table, FLOW_TABLE_CLS_AUTO);
+    return errors;
+}
+
+/* Fills the table with random routes, which the prefix index holds, then
+ * deletes and adds routes between lookups, so that the index is updated in
+ * place. Checks that the index stays in use and finds the reference entry.
+ * Returns the number of lookups that disagreed, and of times the index was
+ * not in use. */
+static int
+check_lpm_round(int round) {
+    struct flow_table *table = dp->pipeline->tables[0];
+    struct check_route routes[CHECK_MAX_FLOWS];
+    struct packet *pkts[CHECK_PACKETS];
+    int n_routes = 1 + check_random(CHECK_MAX_FLOWS);
+    int errors = 0;
+    int i, step;
+
+    for (i = 0; i < n_routes; i++) {
+        routes[i] = check_random_route();
+        check_route_mod(table, OFPFC_ADD, &routes[i]);
+    }
+    for (i = 0; i < CHECK_PACKETS; i++) {
+        pkts[i] = check_make_packet();
+    }
+    /* The index was dropped by the flows of the previous round. */
+    flow_table_run(table);
+
+    for (step = 0; step < CHECK_LPM_STEPS; step++) {
+        int n_changes = 1 + check_random(8);
+
+        if (!flow_cls_lpm_ready(table->lpm)) {
+            fprintf(stderr, "round %d, step %d, %"PRIu32" routes: the prefix "
+                    "index is not in use\n", round, step, table->stats->active_count);
+            errors++;
+        }
+        errors += check_lookups(round, table, pkts, FLOW_TABLE_CLS_LPM);
+        errors += check_lookups(round, table, pkts, FLOW_TABLE_CLS_AUTO);
+
+        /* Some routes are deleted, some of them added back, and new ones
+         * take the place of the others. */
+        for (i = 0; i < n_changes; i++) {
+            int r = check_random(n_routes);
+
+            check_route_mod(table, OFPFC_DELETE_STRICT, &routes[r]);
+            if (check_random(2) == 0) {
+                routes[r] = check_random_route();
+            }
+            check_route_mod(table, OFPFC_ADD, &routes[r]);
+        }
+    }
+
+    for (i = 0; i < CHECK_PACKETS; i++) {
+        packet_destroy(pkts[i]);
+    }
+    clear_flows(table);
+    flow_table_set_classifier(table, FLOW_TABLE_CLS_AUTO);
+    return errors;
+}
+
+/* Action execution. */
+
+static struct ofl_action_header *
+action_output(uint32_t port) {
+    struct ofl_action_output *a = xcalloc(1, sizeof *a);
+
+    a->header.type = OFPAT_OUTPUT;
+    a->header.len = sizeof(struct ofp_action_output);
+    a->port = port;
+    return &a->header;
+}
+
+static struct ofl_action_header *
+action_set_field(uint32_t header, const void *value) {
+    struct ofl_action_set_field *a = xcalloc(1, sizeof *a);
+
+    a->header.type = OFPAT_SET_FIELD;
+    a->field = xcalloc(1, sizeof *a->field);
+    a->field->header = header;
+    a->field->value = xmemdup(value, OXM_LENGTH(header));
+    return &a->header;
+}
+
+static struct ofl_action_header *
+action_push_vlan(void) {
+    struct ofl_action_push *a = xcalloc(1, sizeof *a);
+
+    a->header.type = OFPAT_PUSH_VLAN;
+    a->ethertype = ETH_TYPE_VLAN;
+    return &a->header;
+}
+
+static struct ofl_action_header *
+action_dec_ttl(void) {
+    struct ofl_action_header *a = xcalloc(1, sizeof *a);
+
+    a->type = OFPAT_DEC_NW_TTL;
+    return a;
+}
+
+static void
+free_actions(struct ofl_action_header **acts, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if (acts[i]->type == OFPAT_SET_FIELD) {
+            struct ofl_action_set_field *a = (struct ofl_action_set_field *)acts[i];
+            free(a->field->value);
+            free(a->field);
+        }
+        free(acts[i]);
+    }
+}
+
+/* Runs the action list on clones of an IPv4/TCP packet, as the list of an
+ * apply-actions instruction. */
+static void
+bench_actions(const char *name, struct ofl_action_header **acts, size_t n_acts) {
+    struct packet *pkts[BENCH_BATCH];
+    struct packet *orig;
+    struct bench_clock c;
+    long long int done;
+
+    orig = packet_create(dp, PORT_IN, make_tcp4(1), false);
+    memset(&c, 0, sizeof c);
+    for (done = 0; done < n_packets; done += BENCH_BATCH) {
+        int n = MIN(BENCH_BATCH, n_packets - done);
+        int i;
+
+        for (i = 0; i < n; i++) {
+            pkts[i] = packet_clone(orig);
+        }
+        clock_start(&c);
+        for (i = 0; i < n; i++) {
+            dp_execute_action_list(pkts[i], n_acts, acts, 0xffffffffffffffffULL);
+        }
+        clock_stop(&c);
+        for (i = 0; i < n; i++) {
+            packet_destroy(pkts[i]);
+        }
+    }
+    report("execute", name, 0, &c);
+    packet_destroy(orig);
+    free_actions(acts, n_acts);
+}
+
+static void
+bench_all_actions(void) {
+    static const uint8_t new_dst[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x99};
+    uint32_t new_ip = htonl(0xc0a80001);
+    uint16_t vid = 10;
+    struct ofl_action_header *acts[4];
+
+    acts[0] = action_output(PORT_OUT);
+    bench_actions("output", acts, 1);
+
+    acts[0] = action_set_field(OXM_OF_ETH_DST, new_dst);
+    acts[1] = action_output(PORT_OUT);
+    bench_actions("set-eth-dst,output", acts, 2);
+
+    acts[0] = action_dec_ttl();
+    acts[1] = action_set_field(OXM_OF_IPV4_DST, &new_ip);
+    acts[2] = action_output(PORT_OUT);
+    bench_actions("dec-ttl,set-ipv4-dst,output", acts, 3);
+
+    acts[0] = action_push_vlan();
+    acts[1] = action_set_field(OXM_OF_VLAN_VID, &vid);
+    acts[2] = action_output(PORT_OUT);
+    bench_actions("push-vlan,set-vlan-vid,output", acts, 3);
+
+    acts[0] = action_output(PORT_OUT);
+    acts[1] = action_output(PORT_OUT + 1);
+    acts[2] = action_output(PORT_OUT + 2);
+    acts[3] = action_output(PORT_OUT + 3);
+    bench_actions("output x4", acts, 4);
+}
+
+/* Packet cloning and destruction, timed apart. */
+static void
+bench_clone(void) {
+    struct packet *pkts[BENCH_BATCH];
+    struct packet *orig;
+    struct bench_clock clone, destroy;
+    long long int done;
+
+    orig = packet_create(dp, PORT_IN, make_tcp4(1), false);
+    memset(&clone, 0, sizeof clone);
+    memset(&destroy, 0, sizeof destroy);
+    for (done = 0; done < n_packets; done += BENCH_BATCH) {
+        int n = MIN(BENCH_BATCH, n_packets - done);
+        int i;
+
+        clock_start(&clone);
+        for (i = 0; i < n; i++) {
+            pkts[i] = packet_clone(orig);
+        }
+        clock_stop(&clone);
+        clock_start(&destroy);
+        for (i = 0; i < n; i++) {
+            packet_destroy(pkts[i]);
+        }
+        clock_stop(&destroy);
+    }
+    report("packet", "clone", 0, &clone);
+    report("packet", "destroy", 0, &destroy);
+    packet_destroy(orig);
+}
+
+static void
+create_datapath(void) {
+    int i;
+
+    dp = dp_new();
+    dp_set_dpid(dp, 1);
+    dp_set_max_queues(dp, 0);
+    for (i = 0; i < N_PORTS; i++) {
+        char name[16];
+        int error;
+
+        snprintf(name, sizeof name, "sink:bench%d", i + 1);
+        error = dp_ports_add(dp, name);
+        if (error) {
+            ofp_fatal(error, "failed to add port %s", name);
+        }
+    }
+}
+
+int
+main(int argc, char *argv[]) {
+    static const int table_sizes[] = {10, 64, 256, 1024, 4096};
+    size_t i, j, k;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+    vlog_set_levels(VLM_ANY_MODULE, VLF_ANY_FACILITY, VLL_EMER);
+    parse_options(argc, argv);
+
+    if (output_name) {
+        output = fopen(output_name, "w");
+        if (!output) {
+            ofp_fatal(errno, "%s: open failed", output_name);
+        }
+    } else {
+        output = stdout;
+    }
+
+    create_datapath();
+
+    if (check_rounds > 0) {
+        int errors = 0;
+
+        /* Every other round has routes only, for the prefix index. */
+        for (i = 0; i < (size_t)check_rounds; i++) {
+            errors += i % 2 ? check_lpm_round(i) : check_round(i);
+        }
+        fprintf(output, "%d rounds: %d lookups disagreed\n", check_rounds, errors);
+        return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    fprintf(output, "{\n  \"version\": \"%s\",\n  \"packets\": %lld,\n"
+            "  \"linear_isa\": \"%s\",\n  \"results\": [",
+            VERSION BUILDNR, n_packets, flow_cls_linear_isa());
+
+    bench_parse("arp", make_arp());
+    bench_parse("ipv4-tcp", make_tcp4(1));
+    bench_parse("ipv6-ext-tcp", make_tcp6_ext());
+    bench_parse("ehddp-1", make_ehddp(1));
+    bench_parse("ehddp-16", make_ehddp(16));
+    bench_parse("ehddp-31", make_ehddp(31));
+
+    for (i = 0; i < ARRAY_SIZE(mix_names); i++) {
+        for (j = 0; j < ARRAY_SIZE(table_sizes); j++) {
+            for (k = 0; k < ARRAY_SIZE(classifier_names); k++) {
+                bench_lookup(i, table_sizes[j], k);
+            }
+        }
+    }
+
+    bench_all_actions();
+    bench_clone();
+
+    fprintf(output, "\n  ]\n}\n");
+    if (output != stdout && fclose(output)) {
+        ofp_fatal(errno, "%s: write failed", output_name);
+    }
+    return EXIT_SUCCESS;
+}
+
+static void
+parse_options(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"packets",   required_argument, 0, 'n'},
+        {"output",    required_argument, 0, 'o'},
+        {"check",     required_argument, 0, 'c'},
+        {"help",      no_argument, 0, 'h'},
+        {"version",   no_argument, 0, 'V'},
+        {0, 0, 0, 0},
+    };
+    char *short_options = long_options_to_short_options(long_options);
+
+    for (;;) {
+        int c = getopt_long(argc, argv, short_options, long_options, NULL);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'n':
+            n_packets = atoll(optarg);
+            if (n_packets < 1) {
+                ofp_fatal(0, "--packets must be positive");
+            }
+            break;
+
+        case 'o':
+            output_name = optarg;
+            break;
+
+        case 'c':
+            check_rounds = atoi(optarg);
+            if (check_rounds < 1) {
+                ofp_fatal(0, "--check must be positive");
+            }
+            break;
+
+        case 'h':
+            usage();
+
+        case 'V':
+            printf("%s %s compiled "__DATE__" "__TIME__"\n",
+                   program_name, VERSION BUILDNR);
+            exit(EXIT_SUCCESS);
+
+        case '?':
+            exit(EXIT_FAILURE);
+
+        default:
+            abort();
+        }
+    }
+    free(short_options);
+}
+
+static void
+usage(void) {
+    printf("%s: datapath pipeline microbenchmarks\n"
+           "usage: %s [OPTIONS]\n"
+           "Times packet parsing, flow table lookup, action execution and\n"
+           "packet cloning, and writes the results as JSON.\n"
+           "\nOptions:\n"
+           "  -n, --packets=N         packets run through each case (default: 100000)\n"
+           "  -o, --output=FILE       write the results to FILE instead of stdout\n"
+           "  -c, --check=ROUNDS      instead of timing, check that every classifier\n"
+           "                          finds the entry packet_match() does, for\n"
+           "                          ROUNDS sets of random flows and packets;\n"
+           "                          every other set has routes only, and is\n"
+           "                          changed between lookups\n"
+           "  -h, --help              display this help message\n"
+           "  -V, --version           display version information\n",
+           program_name, program_name);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,397 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "port_sched.h"
+#include "datapath.h"
+#include "dp_latency.h"
+#include "dp_ports.h"
+#include "netdev.h"
+#include "ofpbuf.h"
+#include "packets.h"
+#include "poll-loop.h"
+#include "timeval.h"
+#include "util.h"
+
+/* Tokens are kept in thousandths of a byte, so that a rate in bytes per
+ * second adds rate * elapsed msec tokens. */
+#define TOKENS_PER_BYTE 1000
+
+/* A bucket holds the tokens of this many msec at its rate, and never less
+ * than two full frames; the poll loop wakes up every msec or so. */
+#define SCHED_BURST_MSEC 10
+#define SCHED_MIN_BURST  (2 * (VLAN_ETH_HEADER_LEN + ETH_PAYLOAD_MAX))
+
+/* Link speed assumed when the device does not report one, in Mbps. */
+#define SCHED_DEFAULT_SPEED 1000
+
+struct sched_bucket {
+    uint64_t rate;    /* bytes per second, 0 if not limited */
+    int64_t  burst;   /* tokens */
+    int64_t  tokens;  /* may go below zero by the last frame sent */
+};
+
+/* A frame waiting in a queue. */
+struct sched_entry {
+    struct ofpbuf *buffer;
+    long long      arrived;  /* time_msec() when queued */
+    uint64_t       start;    /* dp_latency_start() when queued */
+};
+
+struct sched_class {
+    struct sched_entry *ring;   /* PORT_SCHED_QUEUE_LEN, NULL until used */
+    unsigned int head;          /* oldest frame */
+    struct sched_bucket min;    /* guaranteed rate */
+    struct sched_bucket max;    /* ceiling */
+    int64_t quantum;            /* bytes added to deficit per round */
+    int64_t deficit;            /* bytes the queue may send this round */
+    struct port_sched_queue_stats stats;
+};
+
+struct port_sched {
+    struct sw_port *port;
+    struct sched_bucket link;
+    long long last;             /* time_msec() of the last refill */
+    uint32_t backlog;           /* frames waiting in all queues */
+    unsigned int next;          /* queue the next excess round starts at */
+    bool resume;                /* 'next' was stopped amid its turn */
+    bool blocked;               /* the device has no room for frames */
+    struct sched_class classes[NETDEV_MAX_QUEUES];
+};
+
+static void
+bucket_init(struct sched_bucket *b, uint64_t rate) {
+    b->rate = rate;
+    b->burst = MAX(rate * SCHED_BURST_MSEC, (uint64_t)SCHED_MIN_BURST * TOKENS_PER_BYTE);
+    b->tokens = b->burst;
+}
+
+static void
+bucket_refill(struct sched_bucket *b, long long elapsed) {
+    if (b->rate != 0) {
+        b->tokens = MIN(b->burst, b->tokens + (int64_t)(b->rate * elapsed));
+    }
+}
+
+static inline bool
+bucket_conforms(const struct sched_bucket *b) {
+    return b->rate == 0 || b->tokens > 0;
+}
+
+static inline void
+bucket_take(struct sched_bucket *b, size_t bytes) {
+    if (b->rate != 0) {
+        b->tokens -= (int64_t)bytes * TOKENS_PER_BYTE;
+    }
+}
+
+/* Returns the rate in bytes per second of 'rate' .1% of the link, or 0 if
+ * 'rate' is not configured. */
+static uint64_t
+link_share(const struct port_sched *ps, uint16_t rate) {
+    return rate <= 1000 ? ps->link.rate * rate / 1000 : 0;
+}
+
+static void
+class_set_rates(struct port_sched *ps, struct sched_class *c,
+                uint16_t min_rate, uint16_t max_rate) {
+    int mtu = netdev_get_mtu(ps->port->netdev);
+
+    bucket_init(&c->min, link_share(ps, min_rate));
+    bucket_init(&c->max, link_share(ps, max_rate));
+    /* Every round lets a queue send at least a full frame, plus one more per
+     * 10% of guaranteed rate. */
+    c->quantum = (VLAN_ETH_HEADER_LEN + mtu) * (1 + (min_rate <= 1000 ? min_rate / 100 : 0));
+}
+
+struct port_sched *
+port_sched_create(struct sw_port *port) {
+    struct port_sched *ps = xcalloc(1, sizeof(struct port_sched));
+    int speed = netdev_get_speed(port->netdev);
+    size_t i;
+
+    if (speed <= 0 || speed == UINT16_MAX) {
+        speed = SCHED_DEFAULT_SPEED;
+    }
+    ps->port = port;
+    ps->last = time_msec();
+    bucket_init(&ps->link, (uint64_t)speed * 1000 * 1000 / 8);
+    for (i = 0; i < NETDEV_MAX_QUEUES; i++) {
+        class_set_rates(ps, &ps->classes[i], OFPQ_MIN_RATE_UNCFG, OFPQ_MAX_RATE_UNCFG);
+    }
+    return ps;
+}
+
+void
+port_sched_set_rates(struct port_sched *ps, uint16_t class_id,
+                     uint16_t min_rate, uint16_t max_rate) {
+    class_set_rates(ps, &ps->classes[class_id], min_rate, max_rate);
+}
+
+/* Returns the OpenFlow counters of queue 'class_id', if it is configured. */
+static struct ofl_queue_stats *
+queue_stats(struct port_sched *ps, uint16_t class_id) {
+    struct sw_queue *q = &ps->port->queues[class_id];
+
+    return q->port != NULL ? q->stats : NULL;
+}
+
+static struct sched_entry *
+class_front(struct sched_class *c) {
+    return &c->ring[c->head];
+}
+
+static void
+class_pop(struct port_sched *ps, struct sched_class *c) {
+    struct sched_entry *e = class_front(c);
+
+    c->stats.backlog_packets--;
+    c->stats.backlog_bytes -= e->buffer->size;
+    ps->backlog--;
+    ofpbuf_delete(e->buffer);
+    c->head = (c->head + 1) % PORT_SCHED_QUEUE_LEN;
+}
+
+void
+port_sched_clear_queue(struct port_sched *ps, uint16_t class_id) {
+    struct sched_class *c = &ps->classes[class_id];
+
+    while (c->stats.backlog_packets > 0) {
+        class_pop(ps, c);
+    }
+    free(c->ring);
+    memset(c, 0, sizeof *c);
+    class_set_rates(ps, c, OFPQ_MIN_RATE_UNCFG, OFPQ_MAX_RATE_UNCFG);
+}
+
+void
+port_sched_destroy(struct port_sched *ps) {
+    size_t i;
+
+    if (ps == NULL) {
+        return;
+    }
+    for (i = 0; i < NETDEV_MAX_QUEUES; i++) {
+        struct sched_class *c = &ps->classes[i];
+
+        while (c->stats.backlog_packets > 0) {
+            class_pop(ps, c);
+        }
+        free(c->ring);
+    }
+    free(ps);
+}
+
+void
+port_sched_enqueue(struct port_sched *ps, uint16_t class_id,
+                   const struct ofpbuf *buffer) {
+    struct sched_class *c = &ps->classes[class_id];
+    struct sched_entry *e;
+
+    if (c->stats.backlog_packets == PORT_SCHED_QUEUE_LEN) {
+        struct ofl_queue_stats *qs = queue_stats(ps, class_id);
+
+        c->stats.dropped++;
+        ps->port->stats->tx_dropped++;
+        if (qs != NULL) {
+            qs->tx_errors++;
+        }
+        return;
+    }
+    if (c->ring == NULL) {
+        c->ring = xmalloc(PORT_SCHED_QUEUE_LEN * sizeof *c->ring);
+    }
+
+    e = &c->ring[(c->head + c->stats.backlog_packets) % PORT_SCHED_QUEUE_LEN];
+    e->buffer = ofpbuf_clone(buffer);
+    e->arrived = time_msec();
+    e->start = dp_latency_start(ps->port->dp->latency);
+    c->stats.backlog_packets++;
+    c->stats.backlog_bytes += buffer->size;
+    ps->backlog++;
+}
+
+/* Sends the oldest frame of queue 'class_id' and takes its tokens; those of
+ * the minimum rate only if 'guaranteed'. Returns false if the device has no
+ * room for it, in which case the frame stays queued. */
+static bool
+transmit(struct port_sched *ps, uint16_t class_id, bool guaranteed) {
+    struct sched_class *c = &ps->classes[class_id];
+    struct sched_entry *e = class_front(c);
+    struct sw_queue *q = &ps->port->queues[class_id];
+    size_t size = e->buffer->size;
+    long long sojourn;
+    int error;
+
+    error = dp_ports_send(ps->port, q->port != NULL ? q : NULL, e->buffer, 0);
+    if (error == EAGAIN) {
+        ps->blocked = true;
+        return false;
+    }
+
+    if (error) {
+        c->stats.dropped++;
+        ps->port->stats->tx_dropped++;
+        if (q->port != NULL) {
+            q->stats->tx_errors++;
+        }
+    } else {
+        dp_latency_stop(ps->port->dp->latency, OFP_EXT_LATENCY_QUEUE, e->start);
+        sojourn = time_msec() - e->arrived;
+        c->stats.sent++;
+        c->stats.sojourn_msec += sojourn;
+        c->stats.sojourn_max_msec = MAX(c->stats.sojourn_max_msec, (uint64_t)sojourn);
+    }
+    class_pop(ps, c);
+
+    bucket_take(&ps->link, size);
+    bucket_take(&c->max, size);
+    if (guaranteed) {
+        bucket_take(&c->min, size);
+    }
+    return true;
+}
+
+/* Serves each queue up to its minimum rate. Returns false if the link or the
+ * device has no room left. */
+static bool
+run_guaranteed(struct port_sched *ps) {
+    bool sent;
+
+    do {
+        size_t i;
+
+        sent = false;
+        for (i = 0; i < NETDEV_MAX_QUEUES; i++) {
+            struct sched_class *c = &ps->classes[i];
+
+            if (c->stats.backlog_packets == 0 || c->min.rate == 0
+                || c->min.tokens <= 0 || !bucket_conforms(&c->max)) {
+                continue;
+            }
+            if (!bucket_conforms(&ps->link) || !transmit(ps, i, true)) {
+                return false;
+            }
+            sent = true;
+        }
+    } while (sent);
+
+    return true;
+}
+
+/* Shares the link bandwidth left among the backlogged queues, by deficit
+ * round robin. */
+static void
+run_excess(struct port_sched *ps) {
+    bool active;
+
+    do {
+        size_t k;
+
+        active = false;
+        for (k = 0; k < NETDEV_MAX_QUEUES; k++) {
+            uint16_t i = (ps->next + k) % NETDEV_MAX_QUEUES;
+            struct sched_class *c = &ps->classes[i];
+
+            if (c->stats.backlog_packets == 0) {
+                c->deficit = 0;
+                continue;
+            }
+            if (!bucket_conforms(&c->max)) {
+                continue;
+            }
+
+            active = true;
+            if (k > 0 || !ps->resume) {
+                c->deficit += c->quantum;
+            }
+            ps->resume = false;
+            while (c->stats.backlog_packets > 0 && bucket_conforms(&c->max)
+                   && c->deficit >= (int64_t)class_front(c)->buffer->size) {
+                size_t size = class_front(c)->buffer->size;
+
+                if (!bucket_conforms(&ps->link) || !transmit(ps, i, false)) {
+                    ps->next = i;
+                    ps->resume = true;
+                    return;
+                }
+                c->deficit -= size;
+            }
+            if (c->stats.backlog_packets == 0) {
+                c->deficit = 0;
+            }
+        }
+    } while (active);
+
+    ps->resume = false;
+}
+
+void
+port_sched_run(struct port_sched *ps) {
+    long long now = time_msec();
+    long long elapsed = MIN(now - ps->last, 1000);
+    size_t i;
+
+    if (elapsed > 0) {
+        ps->last = now;
+        bucket_refill(&ps->link, elapsed);
+        for (i = 0; i < NETDEV_MAX_QUEUES; i++) {
+            bucket_refill(&ps->classes[i].min, elapsed);
+            bucket_refill(&ps->classes[i].max, elapsed);
+        }
+    }
+
+    ps->blocked = false;
+    if (ps->backlog > 0 && run_guaranteed(ps)) {
+        run_excess(ps);
+    }
+}
+
+void
+port_sched_wait(struct port_sched *ps) {
+    size_t i;
+
+    if (ps->backlog == 0) {
+        return;
+    }
+    if (ps->blocked) {
+        netdev_send_wait(ps->port->netdev);
+        return;
+    }
+    if (bucket_conforms(&ps->link)) {
+        /* Frames queued after the last run may be sendable already. */
+        for (i = 0; i < NETDEV_MAX_QUEUES; i++) {
+            struct sched_class *c = &ps->classes[i];
+
+            if (c->stats.backlog_packets > 0 && bucket_conforms(&c->max)) {
+                poll_immediate_wake();
+                return;
+            }
+        }
+    }
+    poll_timer_wait(1);
+}
+
+void
+port_sched_get_queue_stats(struct port_sched *ps, uint16_t class_id,
+                           struct port_sched_queue_stats *stats) {
+    *stats = ps->classes[class_id].stats;
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/eHDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PORT_SCHED_H
+#define PORT_SCHED_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Userspace egress scheduler of a port. Frames sent to a queue wait in a
+ * per-queue FIFO; each queue is first served up to its minimum rate, and the
+ * link bandwidth left is shared among the backlogged queues by deficit round
+ * robin, weighted by their minimum rates and capped by their maximum rates.
+ * Best-effort traffic is queue 0. Unlike tc classes, this works on any kind
+ * of port and counts the backlog and drops of each queue.
+ ****************************************************************************/
+
+struct ofpbuf;
+struct sw_port;
+
+/* Frames a queue holds before new ones are dropped. */
+#define PORT_SCHED_QUEUE_LEN 512
+
+/* Counters of a queue of the scheduler. */
+struct port_sched_queue_stats {
+    uint32_t backlog_packets;  /* frames waiting */
+    uint64_t backlog_bytes;
+    uint64_t sent;             /* frames sent */
+    uint64_t dropped;          /* frames dropped, queue full or send error */
+    uint64_t sojourn_msec;     /* total time sent frames waited */
+    uint64_t sojourn_max_msec; /* longest time a sent frame waited */
+};
+
+/* Creates the scheduler of 'port', with every queue best-effort. */
+struct port_sched *
+port_sched_create(struct sw_port *port);
+
+/* Drops the frames waiting in every queue and frees the scheduler. */
+void
+port_sched_destroy(struct port_sched *ps);
+
+/* Sets the minimum and maximum rates of queue 'class_id', in .1% of the link
+ * speed; rates above 1000 are not configured. */
+void
+port_sched_set_rates(struct port_sched *ps, uint16_t class_id,
+                     uint16_t min_rate, uint16_t max_rate);
+
+/* Drops the frames waiting in queue 'class_id' and makes it best-effort. */
+void
+port_sched_clear_queue(struct port_sched *ps, uint16_t class_id);
+
+/* Queues a copy of 'buffer' in queue 'class_id'; the caller keeps the
+ * ownership of 'buffer'. */
+void
+port_sched_enqueue(struct port_sched *ps, uint16_t class_id,
+                   const struct ofpbuf *buffer);
+
+/* Sends the frames the rates allow. */
+void
+port_sched_run(struct port_sched *ps);
+
+/* Arranges for the poll loop to wake up when frames can be sent. */
+void
+port_sched_wait(struct port_sched *ps);
+
+/* Fills stats with the current counters of queue 'class_id'. */
+void
+port_sched_get_queue_stats(struct port_sched *ps, uint16_t class_id,
+                           struct port_sched_queue_stats *stats);
+
+#endif /* PORT_SCHED_H */
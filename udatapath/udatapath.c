@@ -27,7 +27,9 @@
 #include "command-line.h"
 #include "daemon.h"
 #include "datapath.h"
+#include "dp_ports.h"
 #include "fault.h"
+#include "netdev-pcap.h"
 #include "openflow/openflow.h"
 #include "poll-loop.h"
 #include "queue.h"
@@ -65,8 +67,10 @@ static char *port_list;
 static char *local_port = "tap:";
 
 static void add_ports(struct datapath *dp, char *port_list);
+static void bench_report(struct datapath *dp);
 
-static bool use_multiple_connections = false;
+static size_t n_aux_conns = 0;
+static bool bench = false;
 
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
 extern struct packet *pkt_hello;
@@ -81,20 +85,9 @@ struct in_addr ip_del_controlller;
 uint64_t time_init_local_port = 0;
 uint64_t time_init_cicle = 0;
 uint8_t conection_status_ofp_controller = 0;
-uint64_t time_connect_to_contoller = 0;
-uint64_t time_exploration = 0;
 uint32_t old_local_port = 0;
 uint64_t time_no_move_local_port = 0;
-uint64_t convergence_time = 0;
 uint64_t time_start = 0;
-uint8_t log_escrito = 0;
-uint64_t timestamp_connecto_to_controller = 0;
-uint64_t packet_time = 0;
-int num_pkt_ehddp_req = 0;
-int num_pkt_ehddp_rep = 0;
-int num_pkt_arp_rep = 0;
-int num_pkt_arp_req = 0;
-uint64_t time_to_connect = 0;
 bool Reply_ON = false;
 uint8_t type_device_general;
 int port_to_controller = 0;
@@ -146,27 +139,28 @@ udatapath_cmd(int argc, char *argv[])
           "use --help for usage");
     }
 
-    if (use_multiple_connections && (argc - optind) % 2 != 0)
-        OFP_FATAL(0, "when using multiple connections, you must specify an even number of listeners");
-        
+    if ((argc - optind) % (1 + n_aux_conns) != 0)
+        OFP_FATAL(0, "when using multiple connections, each listener must be "
+                  "followed by %zu auxiliary listeners", n_aux_conns);
+
+    dp_set_aux_conns(dp, n_aux_conns);
     n_listeners = 0;
-    for (i = optind; i < argc; i += 2) {
+    for (i = optind; i < argc; i += 1 + n_aux_conns) {
         const char *pvconn_name = argv[i];
-        const char *pvconn_name_aux = NULL;
-        struct pvconn *pvconn, *pvconn_aux = NULL;
-        int retval, retval_aux;
-
-        if (use_multiple_connections)
-            pvconn_name_aux = argv[i + 1];
+        struct pvconn *pvconn, *pvconn_aux[DP_MAX_AUX_CONNS];
+        int retval;
+        size_t j;
 
         retval = pvconn_open(pvconn_name, &pvconn);
         if (!retval || retval == EAGAIN) {
-            // Get another listener if we are using auxiliary connections
-            if (use_multiple_connections) {
-                retval_aux = pvconn_open(pvconn_name_aux, &pvconn_aux);
+            // Get the auxiliary listeners if we are using auxiliary connections
+            for (j = 0; j < n_aux_conns; j++) {
+                const char *pvconn_name_aux = argv[i + 1 + j];
+                int retval_aux = pvconn_open(pvconn_name_aux, &pvconn_aux[j]);
+
                 if (retval_aux && retval_aux != EAGAIN) {
                     ofp_error(retval_aux, "opening auxiliary %s", pvconn_name_aux);
-                    pvconn_aux = NULL;
+                    pvconn_aux[j] = NULL;
                 }
             }
             dp_add_pvconn(dp, pvconn, pvconn_aux);
@@ -208,6 +202,10 @@ udatapath_cmd(int argc, char *argv[])
     /*Fin Modificacion UAH eHDDP, JAH-*/
     for (;;) {
         dp_run(dp);
+        if (bench && netdev_pcap_replay_done()) {
+            bench_report(dp);
+            break;
+        }
         dp_wait(dp);
         poll_block();
         
@@ -223,6 +221,7 @@ udatapath_cmd(int argc, char *argv[])
         /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
     }
 
+    dp_destroy(dp);
     return 0;
 }
 
@@ -244,6 +243,19 @@ add_ports(struct datapath *dp, char *port_list)
     }
 }
 
+/* Prints the summary of --bench, once the replay ports are over. */
+static void
+bench_report(struct datapath *dp)
+{
+    unsigned long long int dropped = 0;
+    struct sw_port *p;
+
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        dropped += p->stats->tx_dropped;
+    }
+    netdev_pcap_bench_report(stdout, dropped);
+}
+
 static void
 parse_options(struct datapath *dp, int argc, char *argv[])
 {
@@ -255,7 +267,12 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         OPT_SERIAL_NUM,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_NO_LOCAL_PORT,
-        OPT_NO_SLICING
+        OPT_NO_SLICING,
+        OPT_BUFFERS,
+        OPT_BUFFER_BYTES,
+        OPT_EHDDP_COALESCE,
+        OPT_QUEUE_SCHED,
+        OPT_BENCH
     };
 
     static struct option long_options[] = {
@@ -263,7 +280,7 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         {"local-port",  required_argument, 0, 'L'},
         {"no-local-port", no_argument, 0, OPT_NO_LOCAL_PORT},
         {"datapath-id", required_argument, 0, 'd'},
-        {"multiconn",     no_argument, 0, 'm'},
+        {"multiconn",     optional_argument, 0, 'm'},
         {"verbose",     optional_argument, 0, 'v'},
         {"help",        no_argument, 0, 'h'},
         {"version",     no_argument, 0, 'V'},
@@ -271,6 +288,11 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         {"type-device", required_argument, 0, 'T'}, //Modificación UAH
         {"ip-controller", required_argument, 0, 'C'}, //Modificación UAH
         {"no-slicing",  no_argument, 0, OPT_NO_SLICING},
+        {"buffers",     required_argument, 0, OPT_BUFFERS},
+        {"buffer-bytes", required_argument, 0, OPT_BUFFER_BYTES},
+        {"ehddp-coalesce", required_argument, 0, OPT_EHDDP_COALESCE},
+        {"queue-sched", no_argument, 0, OPT_QUEUE_SCHED},
+        {"bench",       no_argument, 0, OPT_BENCH},
         {"mfr-desc",    required_argument, 0, OPT_MFR_DESC},
         {"hw-desc",     required_argument, 0, OPT_HW_DESC},
         {"sw-desc",     required_argument, 0, OPT_SW_DESC},
@@ -313,7 +335,12 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         }
         
         case 'm': {
-            use_multiple_connections = true;
+            int n = optarg ? atoi(optarg) : 1;
+            if (n < 1 || n > DP_MAX_AUX_CONNS) {
+                ofp_fatal(0, "argument to -m or --multiconn must be "
+                          "between 1 and %d", DP_MAX_AUX_CONNS);
+            }
+            n_aux_conns = n;
             break;
         }
         
@@ -396,6 +423,52 @@ parse_options(struct datapath *dp, int argc, char *argv[])
             dp_set_max_queues(dp, 0);
             break;
 
+        case OPT_BUFFERS: {
+            char *end;
+            unsigned long n;
+
+            errno = 0;
+            n = strtoul(optarg, &end, 10);
+            if (errno || end == optarg || *end != '\0' || n == 0
+                || n > DP_BUFFERS_MAX) {
+                ofp_fatal(0, "argument to --buffers must be a number between "
+                          "1 and %d", DP_BUFFERS_MAX);
+            }
+            dp_set_buffers(dp, n, 0);
+            break;
+        }
+
+        case OPT_BUFFER_BYTES: {
+            unsigned long long bytes = strtoull(optarg, NULL, 10);
+            if (bytes == 0) {
+                ofp_fatal(0, "argument to --buffer-bytes must be nonzero");
+            }
+            dp_set_buffers(dp, dp_buffers_size(dp->buffers), bytes);
+            break;
+        }
+
+        case OPT_EHDDP_COALESCE: {
+            char *end;
+            unsigned long msec;
+
+            errno = 0;
+            msec = strtoul(optarg, &end, 10);
+            if (errno || end == optarg || *end != '\0' || msec > UINT_MAX) {
+                ofp_fatal(0, "argument to --ehddp-coalesce must be a number "
+                          "of milliseconds");
+            }
+            dp_set_ehddp_coalesce(dp, msec);
+            break;
+        }
+
+        case OPT_QUEUE_SCHED:
+            dp_set_queue_sched(dp, true);
+            break;
+
+        case OPT_BENCH:
+            bench = true;
+            break;
+
         DAEMON_OPTION_HANDLERS
 
 #ifdef HAVE_OPENSSL
@@ -432,9 +505,15 @@ usage(void)
            "  --no-local-port         disable local port\n"
            "  -d, --datapath-id=ID    Use ID as the OpenFlow switch ID\n"
            "                          (ID must consist of 12 hex digits)\n"
-           "  -m, --multiconn         enable multiple connections to the\n"
-           "                          same controller.\n"
+           "  -m, --multiconn[=N]     open N (default 1) auxiliary connections to\n"
+           "                          each controller; packet-ins are spread\n"
+           "                          across them by flow\n"
            "  --no-slicing            disable slicing\n"
+           "  --buffers=COUNT         number of packets buffered for packet-in\n"
+           "  --buffer-bytes=BYTES    memory budget for buffered packets\n"
+           "  --ehddp-coalesce=MSEC   hold eHDDP replies MSEC ms to merge them\n"
+           "  --queue-sched           schedule port queues in userspace, not tc\n"
+           "  --bench                 exit with a summary when pcap: ports end\n"
            "\nOther options:\n"
            "  -D, --detach            run in background as daemon\n"
            "  -P, --pidfile[=FILE]    create pidfile (default: %s/ofdatapath.pid)\n"
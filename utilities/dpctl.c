@@ -202,11 +202,21 @@ static struct ofl_exp_msg dpctl_exp_msg =
          .free      = ofl_exp_msg_free,
          .to_string = ofl_exp_msg_to_string};
 
+static struct ofl_exp_stats dpctl_exp_mp =
+        {.req_pack          = ofl_exp_stats_req_pack,
+         .req_unpack        = ofl_exp_stats_req_unpack,
+         .req_free          = ofl_exp_stats_req_free,
+         .req_to_string     = ofl_exp_stats_req_to_string,
+         .reply_pack        = ofl_exp_stats_reply_pack,
+         .reply_unpack      = ofl_exp_stats_reply_unpack,
+         .reply_free        = ofl_exp_stats_reply_free,
+         .reply_to_string   = ofl_exp_stats_reply_to_string};
+
 static struct ofl_exp dpctl_exp =
         {.act   = NULL,
          .inst  = NULL,
          .match = NULL,
-         .stats = NULL,
+         .stats = &dpctl_exp_mp,
          .msg   = &dpctl_exp_msg};
 
 
@@ -829,10 +839,77 @@ set_desc(struct vconn *vconn, int argc UNUSED, char *argv[]) {
     dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
 }
 
+static void
+stats_latency(struct vconn *vconn, int argc, char *argv[]) {
+    struct ofl_exp_openflow_mp_request_latency req =
+            {{{{{.type = OFPT_MULTIPART_REQUEST},
+                .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_STATS_LATENCY},
+             .command = OFP_EXT_LATENCY_GET};
+
+    if (argc > 0) {
+        if (strcmp(argv[0], "on") == 0) {
+            req.command = OFP_EXT_LATENCY_ENABLE;
+        } else if (strcmp(argv[0], "off") == 0) {
+            req.command = OFP_EXT_LATENCY_DISABLE;
+        } else if (strcmp(argv[0], "clear") == 0) {
+            req.command = OFP_EXT_LATENCY_CLEAR;
+        } else {
+            ofp_fatal(0, "Error parsing stats-latency command: %s.", argv[0]);
+        }
+    }
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+static void
+stats_discovery(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_mp_request_header req =
+            {{{{.type = OFPT_MULTIPART_REQUEST},
+               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_STATS_DISCOVERY};
 
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
 
 static void
-queue_mod(struct vconn *vconn, int argc UNUSED, char *argv[]) {
+stats_connections(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_mp_request_header req =
+            {{{{.type = OFPT_MULTIPART_REQUEST},
+               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_STATS_CONNECTIONS};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+static void
+stats_buffers(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_mp_request_header req =
+            {{{{.type = OFPT_MULTIPART_REQUEST},
+               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_STATS_BUFFERS};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+static void
+stats_queues(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_mp_request_header req =
+            {{{{.type = OFPT_MULTIPART_REQUEST},
+               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFP_EXT_STATS_QUEUES};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+
+static void
+queue_mod(struct vconn *vconn, int argc, char *argv[]) {
     struct ofl_packet_queue *pq;
     struct ofl_queue_prop_min_rate *p;
 
@@ -853,8 +930,8 @@ queue_mod(struct vconn *vconn, int argc UNUSED, char *argv[]) {
         ofp_fatal(0, "Error parsing queue_mod queue: %s.", argv[1]);
     }
 
-    pq->properties_num = 1;
-    pq->properties = xmalloc(sizeof(struct ofl_queue_prop_header *));
+    pq->properties_num = argc > 3 ? 2 : 1;
+    pq->properties = xmalloc(pq->properties_num * sizeof(struct ofl_queue_prop_header *));
 
     p = xmalloc(sizeof(struct ofl_queue_prop_min_rate));
     pq->properties[0] = (struct ofl_queue_prop_header *)p;
@@ -864,6 +941,18 @@ queue_mod(struct vconn *vconn, int argc UNUSED, char *argv[]) {
         ofp_fatal(0, "Error parsing queue_mod bw: %s.", argv[2]);
     }
 
+    if (argc > 3) {
+        struct ofl_queue_prop_max_rate *m;
+
+        m = xmalloc(sizeof(struct ofl_queue_prop_max_rate));
+        pq->properties[1] = (struct ofl_queue_prop_header *)m;
+        m->header.type = OFPQT_MAX_RATE;
+
+        if (parse16(argv[3], NULL,0, UINT16_MAX, &m->rate)) {
+            ofp_fatal(0, "Error parsing queue_mod max bw: %s.", argv[3]);
+        }
+    }
+
 
     dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
 }
@@ -925,6 +1014,11 @@ static struct command all_commands[] = {
     {"stats-group", 0, 1, stats_group },
     {"stats-group-desc", 0, 1, stats_group_desc },
     {"stats-meter", 0, 1, stats_meter},
+    {"stats-latency", 0, 1, stats_latency},
+    {"stats-discovery", 0, 0, stats_discovery},
+    {"stats-connections", 0, 0, stats_connections},
+    {"stats-buffers", 0, 0, stats_buffers},
+    {"stats-queues", 0, 0, stats_queues},
     {"meter-config", 0, 1, meter_config},
     {"port-desc", 0, 0, port_desc},
     {"set-config", 1, 1, set_config},
@@ -938,7 +1032,7 @@ static struct command all_commands[] = {
     {"set-desc", 1, 1, set_desc},
     {"set-table-match", 0, 2, set_table_features_match},
 
-    {"queue-mod", 3, 3, queue_mod},
+    {"queue-mod", 3, 4, queue_mod},
     {"queue-del", 2, 2, queue_del}
 };
 
@@ -1099,8 +1193,13 @@ usage(void)
             "\n"
             "OpenFlow extensions\n"
             "  SWITCH set-desc DESC                   sets the DP description\n"
-            "  SWITCH queue-mod PORT QUEUE BW         adds/modifies queue\n"
+            "  SWITCH queue-mod PORT QUEUE BW [MAX]   adds/modifies queue\n"
             "  SWITCH queue-del PORT QUEUE            deletes queue\n"
+            "  SWITCH stats-latency [on|off|clear]    print per-stage latencies\n"
+            "  SWITCH stats-discovery                 print eHDDP and ARP-path statistics\n"
+            "  SWITCH stats-connections               print controller connection statistics\n"
+            "  SWITCH stats-buffers                   print packet-in buffer statistics\n"
+            "  SWITCH stats-queues                    print userspace queue statistics\n"
             "\n",
             program_name, program_name);
      vconn_usage(true, false, false);
@@ -40,10 +40,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "command-line.h"
 #include "compiler.h"
 #include "timeval.h"
+#include "trace.h"
 #include "util.h"
 #include "vlog-socket.h"
 
@@ -64,6 +66,12 @@ usage(char *prog_name, int exit_code)
            "        FACILITY may be 'syslog', 'console', 'file', or 'ANY' (default)\n"
            "        LEVEL may be 'emer', 'err', 'warn', 'info', or 'dbg' (default)\n"
            "  -r, --reopen       Make the program reopen its log file\n"
+           "  -T, --trace=on|off Enable or disable the binary trace ring\n"
+           "  -d, --trace-dump=FILE\n"
+           "        Make the program dump its trace ring to FILE\n"
+           "        (suffixed with .N if there are several targets)\n"
+           "  -D, --trace-decode=FILE\n"
+           "        Print the trace dumped in FILE (needs no target)\n"
            "  -h, --help         Print this helpful information\n",
            prog_name);
     exit(exit_code);
@@ -99,6 +107,24 @@ transact_ack(struct vlog_client *client, const char* request, bool *ok)
     free(reply);
 }
 
+/* Returns the absolute name of the file that target 'i' out of 'n' should
+ * dump its trace to, since targets do not share our working directory. */
+static char *
+trace_file_name(const char *name, size_t i, size_t n)
+{
+    char *cwd = name[0] == '/' ? NULL : getcwd(NULL, 0);
+    char *path;
+
+    if (n > 1) {
+        path = xasprintf("%s%s%s.%zu", cwd ? cwd : "", cwd ? "/" : "",
+                         name, i);
+    } else {
+        path = xasprintf("%s%s%s", cwd ? cwd : "", cwd ? "/" : "", name);
+    }
+    free(cwd);
+    return path;
+}
+
 static void
 add_target(struct vlog_client ***clients, size_t *n_clients,
            const char *path, bool *ok)
@@ -150,6 +176,9 @@ int main(int argc, char *argv[])
         {"list", no_argument, NULL, 'l'},
         {"set", required_argument, NULL, 's'},
         {"reopen", no_argument, NULL, 'r'},
+        {"trace", required_argument, NULL, 'T'},
+        {"trace-dump", required_argument, NULL, 'd'},
+        {"trace-decode", required_argument, NULL, 'D'},
         {0, 0, 0, 0},
     };
     char *short_options;
@@ -172,7 +201,7 @@ int main(int argc, char *argv[])
         if (option == -1) {
             break;
         }
-        if (!strchr("ath", option) && n_clients == 0) {
+        if (!strchr("athD", option) && n_clients == 0) {
             ofp_fatal(0, "no targets specified (use --help for help)");
         } else {
             ++n_actions;
@@ -216,6 +245,46 @@ int main(int argc, char *argv[])
             }
             break;
 
+        case 'T':
+            if (strcmp(optarg, "on") && strcmp(optarg, "off")) {
+                ofp_fatal(0, "--trace argument must be \"on\" or \"off\"");
+            }
+            for (i = 0; i < n_clients; i++) {
+                struct vlog_client *client = clients[i];
+                char *request = xasprintf("trace %s", optarg);
+                transact_ack(client, request, &ok);
+                free(request);
+            }
+            break;
+
+        case 'd':
+            for (i = 0; i < n_clients; i++) {
+                struct vlog_client *client = clients[i];
+                char *path = trace_file_name(optarg, i, n_clients);
+                char *request = xasprintf("trace-dump %s", path);
+                transact_ack(client, request, &ok);
+                free(request);
+                free(path);
+            }
+            break;
+
+        case 'D': {
+            FILE *file = fopen(optarg, "rb");
+            int error;
+
+            if (!file) {
+                ofp_fatal(errno, "%s: open failed", optarg);
+            }
+            error = trace_decode(file, stdout);
+            if (error) {
+                fprintf(stderr, "%s: could not decode trace: %s\n",
+                        optarg, strerror(error));
+                ok = false;
+            }
+            fclose(file);
+            break;
+        }
+
         case 'h':
             usage(argv[0], EXIT_SUCCESS);
             break;